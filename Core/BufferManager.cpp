@@ -164,7 +164,7 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
                         g_AOHighQuality4.Create( L"AO High Quality 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R8_UNORM, esram );
                     esram.PopStack();	// End generating SSAO
 
-					g_ShadowBuffer.Create( L"Shadow Map", 2048, 2048, esram );
+					g_ShadowBuffer.CreateArray( L"Shadow Map", 2048, 2048, 4, esram ); // a slice per shadow cascade
 
                 esram.PopStack();	// End Shading
 
@@ -2,6 +2,13 @@
 #include "FileUtility.h"
 #include <fstream>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace Utility;
@@ -12,8 +19,9 @@ namespace Utility
 
 	ByteArray ReadFileSync( const wstring& fileName )
 	{
-		std::ifstream inputFile;
-		inputFile.open( fileName, std::ios::binary | std::ios::ate );
+		// Opens a wide path on any platform
+		boost::filesystem::ifstream inputFile;
+		inputFile.open( boost::filesystem::path( fileName ), std::ios::binary | std::ios::ate );
 		if (!inputFile.is_open())
 			return NullFile;
 		auto filesize = static_cast<size_t>(inputFile.tellg());
@@ -25,6 +33,80 @@ namespace Utility
 		return buf;
 	}
 
+	MappedFile::~MappedFile()
+	{
+		if (m_View == nullptr)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile( m_View );
+#else
+		munmap( m_View, m_Size );
+#endif
+	}
+
+	MappedByteArray MapFileSync( const wstring& fileName )
+	{
+		auto file = shared_ptr<MappedFile>( new MappedFile );
+
+#ifdef _WIN32
+		HANDLE hFile = CreateFileW( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if (hFile == INVALID_HANDLE_VALUE)
+			return file;
+
+		LARGE_INTEGER fileSize = {};
+		if (!GetFileSizeEx( hFile, &fileSize ) || fileSize.QuadPart == 0)
+		{
+			CloseHandle( hFile );
+			return file;
+		}
+
+		// Empty files and network shares without section support can't be mapped
+		HANDLE hMapping = CreateFileMappingW( hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if (hMapping != nullptr)
+		{
+			// View keeps the section alive after both handles are closed
+			file->m_View = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+			CloseHandle( hMapping );
+		}
+		CloseHandle( hFile );
+
+		if (file->m_View != nullptr)
+		{
+			file->m_Data = static_cast<const char*>(file->m_View);
+			file->m_Size = static_cast<size_t>(fileSize.QuadPart);
+		}
+#else
+		const int fd = open( boost::filesystem::path( fileName ).c_str(), O_RDONLY );
+		if (fd < 0)
+			return file;
+
+		struct stat status = {};
+		if (fstat( fd, &status ) != 0 || status.st_size == 0)
+		{
+			close( fd );
+			return file;
+		}
+
+		// Mapping stays valid after the descriptor is closed
+		void* view = mmap( nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+		if (view != MAP_FAILED)
+		{
+			file->m_View = view;
+			file->m_Data = static_cast<const char*>(view);
+			file->m_Size = size_t(status.st_size);
+		}
+#endif
+		if (file->m_View == nullptr)
+		{
+			file->m_Buffer = ReadFileSync( fileName );
+			file->m_Data = file->m_Buffer->data();
+			file->m_Size = file->m_Buffer->size();
+		}
+		return file;
+	}
+
 	uint32_t ReadUint( bufferstream& is )
 	{
 		uint32_t t;
@@ -38,4 +120,29 @@ namespace Utility
 		Read( is, t );
 		return t;
 	}
+
+	uint32_t ReadUint( ByteReader& is )
+	{
+		uint32_t t;
+		Read( is, t );
+		return t;
+	}
+
+	uint16_t ReadShort( ByteReader& is )
+	{
+		uint16_t t;
+		Read( is, t );
+		return t;
+	}
+
+	uint32_t ReadCount( ByteReader& is, size_t minElementSize )
+	{
+		uint32_t count = ReadUint( is );
+		if (!is.CanRead( count, minElementSize ))
+		{
+			is.SetFail();
+			return 0;
+		}
+		return count;
+	}
 }
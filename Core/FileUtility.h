@@ -1,8 +1,11 @@
 #pragma once
 
+#include <istream>
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstring>
+#include <algorithm>
 #include <DirectXMath.h>
 
 namespace Utility
@@ -20,7 +23,7 @@ namespace Utility
 	public:
 		Vectorwrapbuf( ByteArray vec ) : m_Vec(vec) 
 		{
-			setg( m_Vec->data(), m_Vec->data(), m_Vec->data() + m_Vec->size() );
+			this->setg( m_Vec->data(), m_Vec->data(), m_Vec->data() + m_Vec->size() );
 		}
 		ByteArray m_Vec;
 	};
@@ -41,6 +44,37 @@ namespace Utility
 	// Reads the entire contents of a binary file.  
 	ByteArray ReadFileSync(const wstring& fileName);
 
+	//
+	// Read-only view of an entire file. The file is mapped into memory so
+	// parsers read straight from the page cache, without a private copy.
+	// Where mapping is unavailable, the contents are read into a buffer
+	//
+	class MappedFile
+	{
+	public:
+		MappedFile() {}
+		~MappedFile();
+
+		const char* data() const { return m_Data; }
+		size_t size() const { return m_Size; }
+		bool IsMapped() const { return m_View != nullptr; }
+
+	private:
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator=( const MappedFile& ) = delete;
+
+		friend shared_ptr<const MappedFile> MapFileSync( const wstring& fileName );
+
+		const char* m_Data = nullptr;
+		size_t m_Size = 0;
+		void* m_View = nullptr;
+		ByteArray m_Buffer;
+	};
+	using MappedByteArray = shared_ptr<const MappedFile>;
+
+	// Maps the entire contents of a binary file; empty when it can't be opened
+	MappedByteArray MapFileSync( const wstring& fileName );
+
 	template <typename T, typename R>
 	void Read( basic_istream<T, char_traits<T>>& is, R& t, uint32_t size)
 	{
@@ -104,6 +138,157 @@ namespace Utility
 		return t;
 	}
 
+	//
+	// Bounds-checked cursor over an in-memory file. Reads are plain memcpy
+	// instead of streambuf calls, and strings can be decoded in place.
+	// A read past the end zero-fills the destination and latches Fail(),
+	// so a truncated file is reported instead of parsed as garbage
+	//
+	class ByteReader
+	{
+	public:
+		ByteReader( const void* data, size_t size ) :
+			m_Begin( static_cast<const char*>(data) ), m_Cur( m_Begin ), m_End( m_Begin + size )
+		{
+		}
+		ByteReader( const ByteArray& ba ) : ByteReader( ba->data(), ba->size() )
+		{
+		}
+		ByteReader( const MappedByteArray& ba ) : ByteReader( ba->data(), ba->size() )
+		{
+		}
+
+		const char* Data() const { return m_Begin; }
+		size_t Size() const { return size_t(m_End - m_Begin); }
+		size_t Tell() const { return size_t(m_Cur - m_Begin); }
+		size_t Remaining() const { return size_t(m_End - m_Cur); }
+		bool IsEOF() const { return m_Cur == m_End; }
+		bool Fail() const { return m_bFail; }
+		void SetFail() { m_bFail = true; m_Cur = m_End; }
+
+		bool Seek( size_t offset )
+		{
+			if (offset > Size())
+			{
+				SetFail();
+				return false;
+			}
+			m_Cur = m_Begin + offset;
+			return true;
+		}
+
+		// Returns 'size' bytes in place and advance, nullptr on overrun
+		const char* Skip( size_t size )
+		{
+			if (size > Remaining())
+			{
+				SetFail();
+				return nullptr;
+			}
+			const char* p = m_Cur;
+			m_Cur += size;
+			return p;
+		}
+
+		bool Read( void* dst, size_t size )
+		{
+			const char* src = Skip( size );
+			if (src == nullptr)
+			{
+				memset( dst, 0, size );
+				return false;
+			}
+			memcpy( dst, src, size );
+			return true;
+		}
+
+		template <typename R>
+		bool Read( R& t )
+		{
+			return Read( &t, sizeof( R ) );
+		}
+
+		template <typename R>
+		bool ReadArray( R* dst, size_t count )
+		{
+			if (count > Remaining() / sizeof( R ))
+			{
+				SetFail();
+				memset( dst, 0, count * sizeof( R ) );
+				return false;
+			}
+			return Read( dst, count * sizeof( R ) );
+		}
+
+		// Whether 'count' elements of at least 'elementSize' bytes can follow
+		bool CanRead( size_t count, size_t elementSize ) const
+		{
+			return count <= Remaining() / std::max<size_t>( elementSize, 1 );
+		}
+
+	private:
+		const char* m_Begin;
+		const char* m_Cur;
+		const char* m_End;
+		bool m_bFail = false;
+	};
+
+	template <typename R>
+	void Read( ByteReader& is, R& t, uint32_t size )
+	{
+		ASSERT( size <= sizeof( R ), "buffer overflow" );
+		if (size > sizeof( R ))
+			is.SetFail();
+		else
+			is.Read( &t, size );
+	}
+
+	template <typename R>
+	void Read( ByteReader& is, R& t )
+	{
+		is.Read( t );
+	}
+
+	template <typename R>
+	void Read( ByteReader& is, std::vector<R>& t )
+	{
+		is.ReadArray( t.data(), t.size() );
+	}
+
+	inline void ReadPosition( ByteReader& is, DirectX::XMFLOAT3& t, bool bRH )
+	{
+		Read( is, t );
+		if (bRH) t.z *= -1.0;
+	}
+
+	inline void ReadNormal( ByteReader& is, DirectX::XMFLOAT3& t, bool bRH )
+	{
+		Read( is, t );
+		if (bRH) t.z *= -1.0;
+	}
+
+	inline void ReadRotation( ByteReader& is, DirectX::XMFLOAT3& t, bool bRH )
+	{
+		Read( is, t );
+		if (bRH) t.x *= -1.0;
+		if (bRH) t.y *= -1.0;
+	}
+
+	// Quaternion
+	inline void ReadRotation( ByteReader& is, DirectX::XMFLOAT4& t, bool bRH )
+	{
+		Read( is, t );
+		if (bRH) t.x *= -1.0;
+		if (bRH) t.y *= -1.0;
+	}
+
+	uint32_t ReadUint( ByteReader& is );
+	uint16_t ReadShort( ByteReader& is );
+
+	// Reads element count; fails the reader when 'minElementSize' bytes
+	// per element can't follow, so a corrupt count never reaches resize()
+	uint32_t ReadCount( ByteReader& is, size_t minElementSize );
+
 	template <typename T, typename R>
 	void Write( basic_ostream<T, char_traits<T>>& is, const R& t )
 	{
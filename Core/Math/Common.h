@@ -14,9 +14,13 @@
 #pragma once
 
 #include <DirectXMath.h>
+#ifdef _MSC_VER
 #include <intrin.h>
-
 #define INLINE __forceinline
+#else
+#include <x86intrin.h>
+#define INLINE inline __attribute__((always_inline))
+#endif
 
 // Common types
 using DirectX::XMFLOAT2;
@@ -35,53 +39,57 @@ using DirectX::XMMATRIX;
 
 namespace Math
 {
-	template <typename T> __forceinline T AlignUpWithMask( T value, size_t mask )
+	template <typename T> INLINE T AlignUpWithMask( T value, size_t mask )
 	{
 		return (T)(((size_t)value + mask) & ~mask);
 	}
 
-	template <typename T> __forceinline T AlignDownWithMask( T value, size_t mask )
+	template <typename T> INLINE T AlignDownWithMask( T value, size_t mask )
 	{
 		return (T)((size_t)value & ~mask);
 	}
 
-	template <typename T> __forceinline T AlignUp( T value, size_t alignment )
+	template <typename T> INLINE T AlignUp( T value, size_t alignment )
 	{
 		return AlignUpWithMask(value, alignment - 1);
 	}
 
-	template <typename T> __forceinline T AlignDown( T value, size_t alignment )
+	template <typename T> INLINE T AlignDown( T value, size_t alignment )
 	{
 		return AlignDownWithMask(value, alignment - 1);
 	}
 
-	template <typename T> __forceinline bool IsAligned( T value, size_t alignment )
+	template <typename T> INLINE bool IsAligned( T value, size_t alignment )
 	{
 		return 0 == ((size_t)value & (alignment - 1));
 	}
 
-	template <typename T> __forceinline T DivideByMultiple( T value, size_t alignment )
+	template <typename T> INLINE T DivideByMultiple( T value, size_t alignment )
 	{
 		return (T)((value + alignment - 1) / alignment);
 	}
 
-	template <typename T> __forceinline bool IsPowerOfTwo(T value)
+	template <typename T> INLINE bool IsPowerOfTwo(T value)
 	{
 		return 0 == (value & (value - 1));
 	}
 
-	template <typename T> __forceinline bool IsDivisible(T value, T divisor)
+	template <typename T> INLINE bool IsDivisible(T value, T divisor)
 	{
 		return (value / divisor) * divisor == value;
 	}
 
-	__forceinline uint32_t Log2(uint32_t value)
+	INLINE uint32_t Log2(uint32_t value)
 	{
+#ifdef _MSC_VER
 		unsigned long lsb;
 		if (_BitScanForward(&lsb, value) > 0)
 			return lsb;
 		else
 			return 0;
+#else
+		return value != 0 ? uint32_t(__builtin_ctz(value)) : 0;
+#endif
 	}
 
     using namespace DirectX;
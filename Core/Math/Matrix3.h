@@ -19,7 +19,7 @@ namespace Math
 {
 	// Represents a 3x3 matrix while occuping a 4x4 memory footprint.  The unused row and column are undefined but implicitly
 	// (0, 0, 0, 1).  Constructing a Matrix4 will make those values explicit.
-	__declspec(align(16)) class Matrix3
+	class alignas(16) Matrix3
 	{
 	public:
 		INLINE Matrix3() {}
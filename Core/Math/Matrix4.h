@@ -17,7 +17,7 @@
 
 namespace Math
 {
-	__declspec(align(16)) class Matrix4
+	class alignas(16) Matrix4
 	{
 	public:
 		INLINE Matrix4() {}
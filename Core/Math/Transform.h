@@ -18,7 +18,7 @@
 namespace Math
 {
 	// This transform strictly prohibits non-uniform scale.  Scale itself is barely tolerated.
-	__declspec(align(16)) class OrthogonalTransform
+	class alignas(16) OrthogonalTransform
 	{
 	public:
 		INLINE OrthogonalTransform() : m_rotation(kIdentity), m_translation(kZero) {}
@@ -62,7 +62,7 @@ namespace Math
 
 	// A AffineTransform is a 3x4 matrix with an implicit 4th row = [0,0,0,1].  This is used to perform a change of
 	// basis on 3D points.  An affine transformation does not have to have orthonormal basis vectors.
-	__declspec(align(64)) class AffineTransform
+	class alignas(64) AffineTransform
 	{
 	public:
 		INLINE AffineTransform()
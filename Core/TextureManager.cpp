@@ -356,13 +356,13 @@ const ManagedTexture* TextureManager::LoadDDSFromFile( const wstring& fileName,
 
     ManagedTexture::Task task( [=]
     {
-        Utility::ByteArray ba = Utility::ReadFileSync( fileName );
+        Utility::MappedByteArray ba = Utility::MapFileSync( fileName );
         if (ba->size() == 0)
         {
             fs::path path( s_RootPath );
             path /= fileName;
 
-            ba = Utility::ReadFileSync( path.generic_wstring() );
+            ba = Utility::MapFileSync( path.generic_wstring() );
         }
 
         if (ba->size() == 0 || !ManTex->CreateDDSFromMemory( ba->data(), ba->size(), sRGB ))
@@ -390,13 +390,13 @@ const ManagedTexture* TextureManager::LoadHDRFromFile( const wstring& fileName,
 
     ManagedTexture::Task task( [=]
     {
-        Utility::ByteArray ba = Utility::ReadFileSync( fileName );
+        Utility::MappedByteArray ba = Utility::MapFileSync( fileName );
         if (ba->size() == 0)
         {
             fs::path path( s_RootPath );
             path /= fileName;
 
-            ba = Utility::ReadFileSync( path.generic_wstring() );
+            ba = Utility::MapFileSync( path.generic_wstring() );
         }
 
         if (ba->size() == 0 || !ManTex->CreateHDRFromMemory( ba->data(), ba->size(), sRGB ))
@@ -425,13 +425,13 @@ const ManagedTexture* TextureManager::LoadTGAFromFile( const wstring& fileName,
 
     ManagedTexture::Task task( [=]
     {
-        Utility::ByteArray ba = Utility::ReadFileSync( fileName );
+        Utility::MappedByteArray ba = Utility::MapFileSync( fileName );
         if (ba->size() == 0)
         {
             fs::path path( s_RootPath );
             path /= fileName;
 
-            ba = Utility::ReadFileSync( path.generic_wstring() );
+            ba = Utility::MapFileSync( path.generic_wstring() );
         }
 
         if (ba->size() == 0 || !ManTex->CreateTGAFromMemory( ba->data(), ba->size(), sRGB ))
@@ -460,13 +460,13 @@ const ManagedTexture* TextureManager::LoadWISFromFile( const wstring& fileName,
 
     ManagedTexture::Task task( [=]
     {
-        Utility::ByteArray ba = Utility::ReadFileSync( fileName );
+        Utility::MappedByteArray ba = Utility::MapFileSync( fileName );
         if (ba->size() == 0)
         {
             fs::path path( s_RootPath );
             path /= fileName;
 
-            ba = Utility::ReadFileSync( path.generic_wstring() );
+            ba = Utility::MapFileSync( path.generic_wstring() );
         }
 
         if (ba->size() == 0 || !ManTex->CreateWICFromMemory( ba->data(), ba->size(), sRGB ))
@@ -13,18 +13,24 @@
 
 #pragma once
 
+#include <cstdio>
 #include <string>
+#include <xmmintrin.h>
+
+#ifndef _MSC_VER
+#define __debugbreak() __builtin_trap()
+#endif
 
 namespace Utility
 {
 	inline void Print( const char* msg ) { printf("%s", msg); }
-	inline void Print( const wchar_t* msg ) { wprintf(L"%ws", msg); }
+	inline void Print( const wchar_t* msg ) { wprintf(L"%ls", msg); }
 
     template <typename ... Args>
 	inline void Printf( const char* format, Args const & ... args ) noexcept
 	{
 		char buffer[256];
-		sprintf_s(buffer, 256, format, args ...);
+		snprintf(buffer, 256, format, args ...);
 		Print(buffer);
 	}
 
@@ -42,7 +48,7 @@ namespace Utility
 	{
 		Print("--> ");
 		char buffer[256];
-		sprintf_s(buffer, 256, format, args ...);
+		snprintf(buffer, 256, format, args ...);
 		Print(buffer);
 		Print("\n");
 	}
@@ -48,6 +48,7 @@ extern "C" {
 #include <string>
 
 #include "ZIP.h"
+#include "FileUtility.h"
 
 #pragma warning( push )  
 #pragma warning( disable : 4100 )  
@@ -208,6 +209,39 @@ namespace Partio {
 			return true;
 		}
 
+		// Global header from in memory copy of central directory
+		bool Read( Utility::ByteReader& reader )
+		{
+			unsigned int sig;
+			unsigned short version, flags;
+			reader.Read( sig );
+			if (sig != 0x02014b50) { std::cerr << "Did not find global header signature" << std::endl; return false; }
+			reader.Read( version ); // version made by
+			reader.Read( version );
+			reader.Read( flags );
+			reader.Read( compression_type );
+			reader.Read( stamp_date );
+			reader.Read( stamp_time );
+			reader.Read( crc );
+			reader.Read( compressed_size );
+			reader.Read( uncompressed_size );
+			unsigned short filename_length, extra_length, comment_length;
+			reader.Read( filename_length );
+			reader.Read( extra_length );
+			reader.Read( comment_length ); // filecomment
+			unsigned short disk_number_start, int_file_attrib;
+			unsigned int ext_file_attrib;
+			reader.Read( disk_number_start ); // disk# start
+			reader.Read( int_file_attrib ); // internal file
+			reader.Read( ext_file_attrib ); // ext final
+			reader.Read( header_offset ); // rel offset
+			const char* name = reader.Skip( filename_length );
+			reader.Skip( size_t(extra_length) + comment_length );
+			if (reader.Fail()) { std::cerr << "ZIP: Truncated central directory" << std::endl; return false; }
+			filename = std::string( name, strnlen( name, filename_length ) );
+			return true;
+		}
+
 		void Write( std::ostream& ostream, const bool global ) const
 		{
 			if (global) {
@@ -556,39 +590,45 @@ namespace Partio {
 		std::ios::streamoff read_start = max_comment_size + read_size_before_comment;
 		if (read_start > end_position) read_start = end_position;
 		istream.seekg( end_position - read_start );
-		char *buf = new char[read_start];
 		if (read_start <= 0) { std::cerr << "ZIP: Invalid read buffer size" << std::endl; return false; }
-		istream.read( buf, read_start );
+		std::vector<char> buf( (size_t)read_start );
+		istream.read( buf.data(), read_start );
 		int found = -1;
 		for (unsigned int i = 0; i < read_start - 3; i++) {
 			if (buf[i] == 0x50 && buf[i + 1] == 0x4b && buf[i + 2] == 0x05 && buf[i + 3] == 0x06) { found = i; break; }
 		}
-		delete[] buf;
 		if (found == -1) { std::cerr << "ZIP: Failed to find zip header" << std::endl; return false; }
-		// seek to end of central header and read
-		istream.seekg( end_position - (read_start - found) );
+		// end of central header is already in buffer
+		Utility::ByteReader tail( buf.data() + found, buf.size() - found );
 		unsigned int word;
 		unsigned short disk_number1, disk_number2, num_files, num_files_this_disk;
-		Read_Primitive( istream, word ); // end of central
-		Read_Primitive( istream, disk_number1 ); // this disk number
-		Read_Primitive( istream, disk_number2 ); // this disk number
+		tail.Read( word ); // end of central
+		tail.Read( disk_number1 ); // this disk number
+		tail.Read( disk_number2 ); // this disk number
 		if (disk_number1 != disk_number2 || disk_number1 != 0) {
 			std::cerr << "ZIP: multiple disk zip files are not supported" << std::endl; return false;
 		}
-		Read_Primitive( istream, num_files ); // one entry in center in this disk
-		Read_Primitive( istream, num_files_this_disk ); // one entry in center 
+		tail.Read( num_files ); // one entry in center in this disk
+		tail.Read( num_files_this_disk ); // one entry in center 
 		if (num_files != num_files_this_disk) {
 			std::cerr << "ZIP: multi disk zip files are not supported" << std::endl; return false;
 		}
 		unsigned int size_of_header, header_offset;
-		Read_Primitive( istream, size_of_header ); // size of header
-		Read_Primitive( istream, header_offset ); // offset to header
-		// go to header and read all file headers
+		tail.Read( size_of_header ); // size of header
+		tail.Read( header_offset ); // offset to header
+		if (tail.Fail() || std::ios::streamoff( header_offset ) + size_of_header > end_position) {
+			std::cerr << "ZIP: Invalid central directory" << std::endl; return false;
+		}
+		// read whole central directory at once and parse all file headers from memory
+		std::vector<char> directory( size_of_header );
 		istream.seekg( header_offset );
+		istream.read( directory.data(), size_of_header );
+		Utility::ByteReader reader( directory.data(), directory.size() );
 		for (int i = 0; i < num_files; i++) {
 			ZipFileHeader* header = new ZipFileHeader;
-			bool valid = header->Read( istream, true );
+			bool valid = header->Read( reader );
 			if (valid) filename_to_header[header->filename] = header;
+			else delete header;
 		}
 		return true;
 	}
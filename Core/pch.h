@@ -1,5 +1,7 @@
 #pragma once
 
+// Elsewhere than Windows only the file and math utilities are built, for the headless runner
+#ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
 	#define WIN32_LEAN_AND_MEAN
 #endif
@@ -31,18 +33,21 @@
 #include <d3d11_4.h>
 #include <d3d11shader.h>
 #include <d3dcompiler.h>
+#include <wrl.h>
+#include <wincodec.h>
+#endif
 
 #include <array>
 #include <map>
 #include <cstdio>
 #include <vector>
-#include <wrl.h>
 #include <exception>
 #include <memory>
 #include <future>
-#include <wincodec.h>
 
 #include "Utility.h"
 #include "VectorMath.h"
+#ifdef _WIN32
 #include "EngineTuning.h"
 #include "EngineProfiling.h"
+#endif
@@ -95,19 +95,19 @@ namespace {
         Utility::ByteArray ba = Utility::ReadFileSync( filePath );
         if (ba->size() > 0)
         {
-            Utility::ByteStream bs( ba );
+            Utility::ByteReader reader( ba );
             size_t refHashCode;
-            Read( bs, refHashCode );
+            Read( reader, refHashCode );
             if (refHashCode == HashCode)
             {
                 DEBUGPRINT( "Use shader cache %s", tag.c_str() );
                 size_t ShaderLength;
-                Read( bs, ShaderLength );
+                Read( reader, ShaderLength );
                 // HashCode + ShaderLength + ShaderData
                 ASSERT( ba->size() == sizeof(size_t)*2 + ShaderLength );
                 ComPtr<ID3DBlob> blob;
                 ASSERT_SUCCEEDED( D3DCreateBlob( ShaderLength, blob.GetAddressOf() ) );
-                bs.read( (char*)blob->GetBufferPointer(), blob->GetBufferSize() );
+                reader.Read( blob->GetBufferPointer(), blob->GetBufferSize() );
                 return blob;
             }
             DEBUGPRINT( "Shader cache hash mis-matched recompile shader %s", tag.c_str() );
@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#include "PmxRig.h"
+#include "PmxSimulation.h"
+#include "AnimationClip.h"
+#include "Bullet/MultiThread.h"
+#include <chrono>
+#include <codecvt>
+#include <cstdlib>
+#include <locale>
+#include <boost/filesystem/fstream.hpp>
+#ifdef _MSC_VER
+#include "TaskManager.h"
+#endif
+
+//
+// Runs morph, bone, IK and physics of a PMX model without a device, at a
+// fixed time step, and writes bone poses and timings of every frame.
+//
+// Headless <model.pmx> [motion.vmd] [--frames N] [--dt seconds] [--sequential] [--reference-ik] [--out file]
+//
+// Arguments are taken as UTF-8. Parallel loops run on TaskManager where it is
+// built (MSVC), elsewhere on the sequential scheduler. Headless.vcxproj builds
+// it on Windows, CMakeLists.txt elsewhere given DirectXMath and Boost.
+//
+// '.csv' output is text, one row per frame. Any other is binary: "PSIM",
+// version, bone count and frame count (uint32_t), then per frame timings and
+// bone poses as float. Poses are in model space, translation xyz and rotation xyzw
+//
+
+using namespace Math;
+using namespace Physics;
+
+namespace {
+    const uint32_t kFileVersion = 1;
+
+    struct Options
+    {
+        std::wstring Model;
+        std::wstring Motion;
+        std::wstring Output = L"headless.csv";
+        uint32_t NumFrames = 600;
+        float DeltaT = 1.f / 60;
+        bool bSequential = false;
+        bool bFastIK = true;
+    };
+
+    enum ETiming
+    {
+        kTimingAnimation, // morph, bone and IK
+        kTimingPhysics, // step of the world
+        kTimingSync, // bodies into bones, skinning transforms
+        kTimingMax
+    };
+
+    std::wstring FromUTF8( const std::string& str )
+    {
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8conv;
+        return utf8conv.from_bytes( str );
+    }
+
+    // 'args' are UTF-8, without the program name
+    bool ParseOptions( const std::vector<std::string>& args, Options& options )
+    {
+        std::vector<std::wstring> files;
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            const std::string& arg = args[i];
+            const bool bValue = i + 1 < args.size();
+            if (arg == "--frames" && bValue)
+                options.NumFrames = static_cast<uint32_t>(std::strtoul( args[++i].c_str(), nullptr, 10 ));
+            else if (arg == "--dt" && bValue)
+                options.DeltaT = std::strtof( args[++i].c_str(), nullptr );
+            else if (arg == "--out" && bValue)
+                options.Output = FromUTF8( args[++i] );
+            else if (arg == "--sequential")
+                options.bSequential = true;
+            else if (arg == "--reference-ik")
+                options.bFastIK = false;
+            else if (arg.compare( 0, 2, "--" ) == 0)
+                return false;
+            else
+                files.push_back( FromUTF8( arg ) );
+        }
+        if (files.empty() || files.size() > 2 || options.DeltaT <= 0.f)
+            return false;
+        options.Model = files[0];
+        if (files.size() > 1)
+            options.Motion = files[1];
+        return true;
+    }
+
+    bool IsTextOutput( const std::wstring& path )
+    {
+        const std::wstring ext = L".csv";
+        if (path.size() < ext.size())
+            return false;
+        std::wstring tail = path.substr( path.size() - ext.size() );
+        std::transform( tail.begin(), tail.end(), tail.begin(), []( wchar_t c ) { return std::tolower( c, std::locale::classic() ); } );
+        return tail == ext;
+    }
+
+    //
+    // World made as Physics::Initialize makes its own. Physics module draws
+    // debug lines and picks with the mouse, so the runner keeps its own
+    //
+    class World
+    {
+    public:
+        World() : m_Parts( CreateDynamicsWorld( GetTaskScheduler()->GetNumThreads(),
+            []() -> btConstraintSolver* { return new btSequentialImpulseConstraintSolver(); } ) )
+        {
+        }
+
+        btDynamicsWorld* Get( void ) { return m_Parts.World.get(); }
+
+        void Step( float deltaT )
+        {
+            m_Parts.World->stepSimulation( deltaT, 2, btScalar(1.) / 60 );
+        }
+
+    protected:
+        DynamicsWorldParts m_Parts;
+    };
+
+    class Recorder
+    {
+    public:
+        Recorder( const std::wstring& path, uint32_t numBones, uint32_t numFrames ) :
+            m_bText( IsTextOutput( path ) ), m_NumBones( numBones )
+        {
+            m_File.open( boost::filesystem::path( path ), m_bText ? std::ios::out : std::ios::out | std::ios::binary );
+            if (!m_File)
+                return;
+            if (m_bText)
+            {
+                m_File << "frame,animation_ms,physics_ms,sync_ms";
+                for (uint32_t i = 0; i < numBones; i++)
+                    m_File << ",b" << i << ".tx,b" << i << ".ty,b" << i << ".tz"
+                        << ",b" << i << ".qx,b" << i << ".qy,b" << i << ".qz,b" << i << ".qw";
+                m_File << "\n";
+            }
+            else
+            {
+                const uint32_t header[] = { kFileVersion, numBones, numFrames };
+                m_File.write( "PSIM", 4 );
+                m_File.write( reinterpret_cast<const char*>(header), sizeof( header ) );
+            }
+        }
+
+        bool IsOpen( void ) const { return m_File.good(); }
+
+        void Write( uint32_t frame, const double (&timing)[kTimingMax], const std::vector<OrthogonalTransform>& pose )
+        {
+            m_Row.clear();
+            for (auto ms : timing)
+                m_Row.push_back( float(ms) );
+            for (uint32_t i = 0; i < m_NumBones; i++)
+            {
+                XMFLOAT3 t;
+                XMFLOAT4 q;
+                XMStoreFloat3( &t, pose[i].GetTranslation() );
+                XMStoreFloat4( &q, pose[i].GetRotation() );
+                m_Row.insert( m_Row.end(), { t.x, t.y, t.z, q.x, q.y, q.z, q.w } );
+            }
+            if (!m_bText)
+            {
+                m_File.write( reinterpret_cast<const char*>(m_Row.data()), m_Row.size() * sizeof( float ) );
+                return;
+            }
+            m_File << frame;
+            for (auto v : m_Row)
+                m_File << "," << v;
+            m_File << "\n";
+        }
+
+    protected:
+        bool m_bText;
+        uint32_t m_NumBones;
+        boost::filesystem::ofstream m_File; // opens a wide path on any platform
+        std::vector<float> m_Row;
+    };
+
+    void Usage( void )
+    {
+        std::wcout << L"Headless <model.pmx> [motion.vmd] [--frames N] [--dt seconds]"
+            L" [--sequential] [--reference-ik] [--out file]" << std::endl;
+    }
+
+    int Run( const std::vector<std::string>& args )
+    {
+        Options options;
+        if (!ParseOptions( args, options ))
+        {
+            Usage();
+            return 1;
+        }
+
+    #ifdef _MSC_VER
+        TaskManager::Initialize();
+        SetTaskScheduler( options.bSequential ? GetSequentialTaskScheduler() : GetTaskManagerScheduler() );
+        if (!options.bSequential)
+            Pmx::SetParallelFor( TaskManager::parallel_for_range );
+    #else
+        SetTaskScheduler( GetSequentialTaskScheduler() );
+    #endif
+
+        PmxRig rig;
+        if (!rig.LoadRig( options.Model ))
+            return 1;
+        Animation::AnimationClipPtr clip;
+        if (!options.Motion.empty())
+        {
+            clip = Animation::AnimationClip::LoadFromFile( options.Motion, true );
+            if (!clip)
+                return 1;
+        }
+
+        World world;
+        int result = 0;
+        {
+            PmxSimulation simulation( rig );
+            simulation.Load( AffineTransform( kIdentity ) );
+            simulation.LoadMotion( clip );
+            simulation.SetFastIK( options.bFastIK );
+            simulation.JoinWorld( world.Get() );
+
+            const uint32_t numBones = static_cast<uint32_t>(rig.m_Bones.size());
+            Recorder recorder( options.Output, numBones, options.NumFrames );
+            if (!recorder.IsOpen())
+            {
+                std::wcout << L"Fail to open " << options.Output << std::endl;
+                result = 1;
+            }
+
+            // Same order as a frame of the application, with the step waited on
+            using Clock = std::chrono::high_resolution_clock;
+            auto Elapsed = []( Clock::time_point from, Clock::time_point to ) {
+                return std::chrono::duration<double, std::milli>( to - from ).count();
+            };
+            double total[kTimingMax] = {};
+            double worst[kTimingMax] = {};
+            for (uint32_t f = 0; f < options.NumFrames && result == 0; f++)
+            {
+                const float frame = f * options.DeltaT * 30.f; // motion is in 30 fps
+                const auto t0 = Clock::now();
+                simulation.Update( frame, f );
+                const auto t1 = Clock::now();
+                simulation.BeginStep();
+                world.Step( options.DeltaT );
+                simulation.EndStep();
+                const auto t2 = Clock::now();
+                simulation.UpdateAfterPhysics( f + 1 );
+                const auto t3 = Clock::now();
+
+                const double timing[kTimingMax] = { Elapsed( t0, t1 ), Elapsed( t1, t2 ), Elapsed( t2, t3 ) };
+                for (int k = 0; k < kTimingMax; k++)
+                {
+                    total[k] += timing[k];
+                    worst[k] = std::max( worst[k], timing[k] );
+                }
+                recorder.Write( f, timing, simulation.GetPose() );
+            }
+
+            if (result == 0 && options.NumFrames > 0)
+            {
+                const char* names[kTimingMax] = { "animation", "physics", "sync" };
+                std::wcout << rig.m_Name << L": " << numBones << L" bones, " << rig.m_RigidBodies.size() << L" rigid bodies, "
+                    << rig.m_Joints.size() << L" joints, " << options.NumFrames << L" frames, "
+                    << GetTaskScheduler()->GetName() << L" " << GetTaskScheduler()->GetNumThreads() << L" threads" << std::endl;
+                for (int k = 0; k < kTimingMax; k++)
+                    std::cout << names[k] << " " << total[k] / options.NumFrames << " ms/frame, worst " << worst[k] << " ms" << std::endl;
+            }
+
+            simulation.LeaveWorld( world.Get() );
+            simulation.Clear();
+        }
+        SetTaskScheduler( nullptr );
+        Pmx::SetParallelFor( nullptr );
+    #ifdef _MSC_VER
+        TaskManager::Shutdown();
+    #endif
+        return result;
+    }
+}
+
+#ifdef _WIN32
+// Windows gives arguments in UTF-16 to 'wmain' only
+int wmain( int argc, wchar_t* argv[] )
+{
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8conv;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++)
+        args.push_back( utf8conv.to_bytes( argv[i] ) );
+    return Run( args );
+}
+#else
+int main( int argc, char* argv[] )
+{
+    return Run( std::vector<std::string>( argv + 1, argv + argc ) );
+}
+#endif
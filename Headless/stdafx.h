@@ -0,0 +1,21 @@
+#pragma once
+
+#pragma warning(disable: 4324)
+
+#include <stdint.h> // For int32_t, etc.
+#include <cctype>
+#include <cmath>
+#include <codecvt>
+#include <cstring>
+#include <locale>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include "Utility.h"
+#include "FileUtility.h"
+#include "VectorMath.h"
+#include "Math/BoundingBox.h"
@@ -0,0 +1,198 @@
+#include "stdafx.h"
+#include "AnimationClip.h"
+#include "Vmd.h"
+
+using namespace Animation;
+using namespace Math;
+
+namespace {
+    template <typename Frame>
+    std::map<std::wstring, std::vector<const Frame*>> GroupByName( const std::vector<Frame>& frames, const std::vector<std::wstring>& names )
+    {
+        std::vector<std::vector<const Frame*>> index( names.size() );
+        for (auto& frame : frames)
+            index[frame.NameIndex].push_back( &frame );
+
+        // Track is sorted by name for lookup
+        std::map<std::wstring, std::vector<const Frame*>> group;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (index[i].empty())
+                continue;
+            auto& list = group[names[i]];
+            list.insert( list.end(), index[i].begin(), index[i].end() );
+        }
+        for (auto& it : group)
+        {
+            std::stable_sort( it.second.begin(), it.second.end(), []( auto a, auto b ) {
+                return a->Frame < b->Frame;
+            });
+        }
+        return group;
+    }
+
+    int32_t FindTrack( const std::vector<AnimationClip::Track>& tracks, const std::wstring& name )
+    {
+        auto it = std::lower_bound( tracks.begin(), tracks.end(), name, []( const auto& track, const auto& key ) {
+            return track.Name < key;
+        });
+        if (it == tracks.end() || it->Name != name)
+            return -1;
+        return static_cast<int32_t>(std::distance( tracks.begin(), it ));
+    }
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::Create( const Vmd::VMD& vmd )
+{
+    auto clip = std::make_shared<AnimationClip>();
+
+    // Most of key frames use a few kind of curves, so share baked curves
+    std::map<uint32_t, uint16_t> curveIndex;
+    auto GetCurve = [&]( const char* interp, int channel ) -> uint16_t {
+        //
+        // http://harigane.at.webry.info/201103/article_1.html
+        //
+        // X_x1, Y_x1, Z_x1, R_x1,
+        // X_y1, Y_y1, Z_y1, R_y1,
+        // X_x2, Y_x2, Z_x2, R_x2,
+        // X_y2, Y_y2, Z_y2, R_y2,
+        //
+        uint8_t control[4] = {
+            uint8_t(interp[channel]), uint8_t(interp[channel+4]),
+            uint8_t(interp[channel+8]), uint8_t(interp[channel+12])
+        };
+        uint32_t key = control[0] | control[1] << 8 | control[2] << 16 | control[3] << 24;
+        auto it = curveIndex.find( key );
+        if (it != curveIndex.end())
+            return it->second;
+        ASSERT( clip->m_Curves.size() <= UINT16_MAX );
+        uint16_t index = static_cast<uint16_t>(clip->m_Curves.size());
+        Vector4 coeff = Vector4( control[0], control[1], control[2], control[3] ) / 127.f;
+        clip->m_Curves.emplace_back( coeff );
+        curveIndex[key] = index;
+        return index;
+    };
+
+    auto bones = GroupByName( vmd.BoneFrames, vmd.Names );
+    clip->m_BoneTracks.reserve( bones.size() );
+    clip->m_BoneFrame.reserve( vmd.BoneFrames.size() );
+    clip->m_BoneTranslation.reserve( vmd.BoneFrames.size() );
+    clip->m_BoneRotation.reserve( vmd.BoneFrames.size() );
+    clip->m_BoneCurve.reserve( vmd.BoneFrames.size() );
+    for (auto& it : bones)
+    {
+        Track track = { it.first, uint32_t(clip->m_BoneFrame.size()), uint32_t(it.second.size()) };
+        clip->m_BoneTracks.push_back( track );
+        for (auto frame : it.second)
+        {
+            auto interp = reinterpret_cast<const char*>(&frame->Interpolation[0]);
+            CurveIndex curve;
+            for (int k = kInterpX; k <= kInterpR; k++)
+                curve.Channel[k] = GetCurve( interp, k );
+            clip->m_BoneFrame.push_back( frame->Frame );
+            clip->m_BoneTranslation.push_back( frame->Offset );
+            clip->m_BoneRotation.push_back( frame->Rotation );
+            clip->m_BoneCurve.push_back( curve );
+            clip->m_LastFrame = std::max( clip->m_LastFrame, frame->Frame );
+        }
+    }
+
+    auto morphs = GroupByName( vmd.FaceFrames, vmd.Names );
+    clip->m_MorphTracks.reserve( morphs.size() );
+    clip->m_MorphFrame.reserve( vmd.FaceFrames.size() );
+    clip->m_MorphWeight.reserve( vmd.FaceFrames.size() );
+    for (auto& it : morphs)
+    {
+        Track track = { it.first, uint32_t(clip->m_MorphFrame.size()), uint32_t(it.second.size()) };
+        clip->m_MorphTracks.push_back( track );
+        for (auto frame : it.second)
+        {
+            clip->m_MorphFrame.push_back( int32_t(frame->Frame) );
+            clip->m_MorphWeight.push_back( frame->Weight );
+            clip->m_LastFrame = std::max( clip->m_LastFrame, int32_t(frame->Frame) );
+        }
+    }
+    return clip;
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::LoadFromFile( const std::wstring& FilePath, bool bRightHand )
+{
+    Utility::MappedByteArray ba = Utility::MapFileSync( FilePath );
+    Utility::ByteReader reader( ba );
+
+    Vmd::VMD vmd;
+    vmd.Fill( reader, bRightHand );
+    if (!vmd.IsValid()) {
+        wprintf( L"Fail to import motion %ws\n", FilePath.c_str() );
+        return nullptr;
+    }
+    return Create( vmd );
+}
+
+int32_t AnimationClip::FindBoneTrack( const std::wstring& name ) const
+{
+    return FindTrack( m_BoneTracks, name );
+}
+
+int32_t AnimationClip::FindMorphTrack( const std::wstring& name ) const
+{
+    return FindTrack( m_MorphTracks, name );
+}
+
+void AnimationClip::InterpolateBone( uint32_t track, float t, KeyFrameCursor& cursor, Vector3& translation, Quaternion& rotation ) const
+{
+    const Track& range = m_BoneTracks[track];
+    ASSERT( range.Count > 0 );
+    const uint32_t first = range.Offset, last = range.Offset + range.Count - 1;
+
+    if (t <= m_BoneFrame[first])
+    {
+        translation = Vector3( m_BoneTranslation[first] );
+        rotation = Quaternion( m_BoneRotation[first] );
+        return;
+    }
+    if (t >= m_BoneFrame[last])
+    {
+        translation = Vector3( m_BoneTranslation[last] );
+        rotation = Quaternion( m_BoneRotation[last] );
+        return;
+    }
+
+    // VMD provide 0 frame. So, negative value check is not nesseary.
+    int32_t prev = FindPreviousFrameIndex( &m_BoneFrame[first], int32_t(range.Count), t, cursor );
+    ASSERT( prev >= 0 );
+    const uint32_t a = first + prev, b = a + 1;
+
+    float p = 1.f;
+    if (m_BoneFrame[b] - m_BoneFrame[a] > 0)
+        p = (t - m_BoneFrame[a]) / (m_BoneFrame[b] - m_BoneFrame[a]);
+
+    const CurveIndex& curve = m_BoneCurve[a];
+    float c[kInterpR+1];
+    for (uint8_t k = kInterpX; k <= kInterpR; k++)
+        c[k] = m_Curves[curve.Channel[k]].Evaluate( p );
+
+    translation = Lerp( Vector3( m_BoneTranslation[a] ), Vector3( m_BoneTranslation[b] ), Vector3( c[kInterpX], c[kInterpY], c[kInterpZ] ) );
+    rotation = Slerp( Quaternion( m_BoneRotation[a] ), Quaternion( m_BoneRotation[b] ), c[kInterpR] );
+}
+
+float AnimationClip::InterpolateMorph( uint32_t track, float t, KeyFrameCursor& cursor ) const
+{
+    const Track& range = m_MorphTracks[track];
+    ASSERT( range.Count > 0 );
+    const uint32_t first = range.Offset, last = range.Offset + range.Count - 1;
+
+    if (t <= m_MorphFrame[first])
+        return m_MorphWeight[first];
+    if (t >= m_MorphFrame[last])
+        return m_MorphWeight[last];
+
+    int32_t prev = FindPreviousFrameIndex( &m_MorphFrame[first], int32_t(range.Count), t, cursor );
+    ASSERT( prev >= 0 );
+    const uint32_t a = first + prev, b = a + 1;
+
+    float p = 1.0f;
+    if (m_MorphFrame[b] - m_MorphFrame[a] > 0)
+        p = (t - m_MorphFrame[a]) / (m_MorphFrame[b] - m_MorphFrame[a]);
+    return m_MorphWeight[a] * (1.0f - p) + m_MorphWeight[b] * p;
+}
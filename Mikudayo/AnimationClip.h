@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "KeyFrameAnimation.h"
+
+namespace Vmd
+{
+    class VMD;
+}
+
+namespace Animation
+{
+    //
+    // Immutable key frame data of one motion file, shared by every instance which plays it.
+    // Key frames are stored as structure of arrays, grouped by track and sorted by frame.
+    // Playback state (cursor, weight) is owned by the instance.
+    //
+    class AnimationClip
+    {
+    public:
+        struct Track
+        {
+            std::wstring Name;
+            uint32_t Offset; // first key frame
+            uint32_t Count;
+        };
+
+        // Interpolation curves of bone key frame (index into 'm_Curves')
+        struct CurveIndex
+        {
+            uint16_t Channel[kInterpR+1];
+        };
+
+        static std::shared_ptr<AnimationClip> Create( const Vmd::VMD& vmd );
+        static std::shared_ptr<AnimationClip> LoadFromFile( const std::wstring& FilePath, bool bRightHand );
+
+        int32_t FindBoneTrack( const std::wstring& name ) const;
+        int32_t FindMorphTrack( const std::wstring& name ) const;
+        int32_t GetLastFrame() const { return m_LastFrame; }
+
+        // Translation is offset from bind pose (same as VMD)
+        void InterpolateBone( uint32_t track, float t, KeyFrameCursor& cursor, Vector3& translation, Quaternion& rotation ) const;
+        float InterpolateMorph( uint32_t track, float t, KeyFrameCursor& cursor ) const;
+
+        std::vector<Track> m_BoneTracks;
+        std::vector<int32_t> m_BoneFrame;
+        std::vector<XMFLOAT3> m_BoneTranslation;
+        std::vector<XMFLOAT4> m_BoneRotation;
+        std::vector<CurveIndex> m_BoneCurve;
+        std::vector<BezierCurve> m_Curves; // unique curves, baked from 8-bit VMD control points
+
+        std::vector<Track> m_MorphTracks;
+        std::vector<int32_t> m_MorphFrame;
+        std::vector<float> m_MorphWeight;
+
+    protected:
+
+        int32_t m_LastFrame = 0;
+    };
+
+    using AnimationClipPtr = std::shared_ptr<const AnimationClip>;
+}
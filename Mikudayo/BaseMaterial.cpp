@@ -53,6 +53,11 @@ void BaseMaterial::Bind( GraphicsContext& gfxContext )
     gfxContext.SetDynamicConstantBufferView( 4, sizeof( material ), &material, { kBindVertex, kBindPixel } );
 }
 
+const void* BaseMaterial::GetTextureKey() const
+{
+    return textures[kDiffuse];
+}
+
 RenderPipelinePtr BaseMaterial::GetPipeline( RenderQueue Queue ) 
 {
     const RenderPipelineList& list = BaseModel::FindTechniques( shader );
@@ -22,6 +22,7 @@ struct BaseMaterial : IMaterial
     std::wstring shader;
     bool IsTransparent() const override;
     void Bind( GraphicsContext& gfxContext ) override;
+    const void* GetTextureKey() const override;
     RenderPipelinePtr GetPipeline( RenderQueue Queue ) override;
 };
 
@@ -126,6 +126,30 @@ void BaseModel::Render( GraphicsContext& gfxContext, Visitor& visitor )
 	}
 }
 
+bool BaseModel::CollectMeshes( Visitor& visitor )
+{
+    for (auto& mesh : m_Meshes)
+    {
+        if (!visitor.Visit( *mesh, *this ))
+            continue;
+        visitor.Visit( *mesh->material );
+    }
+    return true;
+}
+
+// Packets of this node come from CollectMeshes, so 'mesh' is a BaseMesh
+void BaseModel::RenderMesh( GraphicsContext& gfxContext, IMesh& mesh, IMaterial& material, bool bBindGeometry )
+{
+    (material);
+    if (bBindGeometry)
+    {
+        gfxContext.SetVertexBuffer( 0, m_VertexBuffer.VertexBufferView() );
+        gfxContext.SetIndexBuffer( m_IndexBuffer.IndexBufferView() );
+    }
+    const auto& baseMesh = static_cast<BaseMesh&>(mesh);
+    gfxContext.DrawIndexed( baseMesh.indexCount, baseMesh.startIndex, baseMesh.baseVertex );
+}
+
 Math::AffineTransform BaseModel::GetTransform() const
 {
     return m_Transform;
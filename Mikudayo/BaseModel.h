@@ -19,6 +19,8 @@ public:
     virtual void Clear() override;
     virtual bool Load( const ModelInfo& info ) override;
     virtual void Render( GraphicsContext& gfxContext, Visitor& visitor ) override;
+    virtual bool CollectMeshes( Visitor& visitor ) override;
+    virtual void RenderMesh( GraphicsContext& gfxContext, IMesh& mesh, IMaterial& material, bool bBindGeometry ) override;
 
     virtual Math::AffineTransform GetTransform() const override;
     virtual void SetTransform( const Math::AffineTransform& transform ) override;
@@ -10,7 +10,8 @@ void BaseShadowCamera::UpdateViewProjMatrix( const Matrix4& View, const Matrix4&
     m_ViewProjMatrix = Projection * View;
     m_ClipToWorld = Invert(m_ViewProjMatrix);
 	m_FrustumVS = BoundingFrustum( m_ProjMatrix );
-	m_FrustumWS = m_CameraToWorld * m_FrustumVS;
+    // Light view is not 'm_CameraToWorld', so world space planes come from the whole matrix
+	m_FrustumWS = BoundingFrustum( m_ViewProjMatrix );
 
     // Transform from clip space to texture space
     m_ShadowMatrix = Matrix4( AffineTransform( Matrix3::MakeScale( 0.5f, -0.5f, 1.0f ), Vector3( 0.5f, 0.5f, 0.0f ) ) ) * m_ViewProjMatrix;
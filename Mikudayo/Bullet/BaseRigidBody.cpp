@@ -48,13 +48,8 @@ BaseRigidBody::KinematicMotionState::~KinematicMotionState()
 
 void BaseRigidBody::KinematicMotionState::getWorldTransform(btTransform &worldTransform) const
 {
-    if (const BoneRef *boneRef = m_parentRigidBodyRef->boneRef()) {
-        AffineTransform transform = boneRef->GetTransform();
-        worldTransform = Convert(transform) * m_startTransform;
-		ASSERT(!isnan(worldTransform));
-    } else {
-        worldTransform.setIdentity();
-    }
+    // Bone pose is not read here, the main thread may be writing it
+    worldTransform = m_parentRigidBodyRef->m_KinematicTarget;
 }
 
 BaseRigidBody::BaseRigidBody() :
@@ -121,6 +116,7 @@ std::shared_ptr<btRigidBody> BaseRigidBody::CreateRigidBody( btCollisionShape* S
         BonePosition = m_BoneRef.GetTransform().GetTranslation();
     m_Trans = btTransform( m_Rotation, m_Position - Convert(BonePosition) );
     m_InvTrans = m_Trans.inverse();
+    m_KinematicTarget = GetKinematicTarget();
 
     btTransform worldTransform( m_Rotation, m_Position );
 
@@ -162,7 +158,26 @@ btTransform BaseRigidBody::GetTransfrom() const
     return transform;
 }
 
-void BaseRigidBody::SyncLocalTransform()
+btTransform BaseRigidBody::GetKinematicTarget() const
+{
+    if (m_BoneRef.m_Index < 0 || m_BoneRef.m_Instance == nullptr)
+        return btTransform::getIdentity();
+    const btTransform target = Convert(AffineTransform(m_BoneRef.GetTransform())) * m_Trans;
+    ASSERT(!isnan(target));
+    return target;
+}
+
+void BaseRigidBody::SetKinematicTarget( const btTransform& Target )
+{
+    m_KinematicTarget = Target;
+}
+
+//
+// 'CenterOfMass' is the body in the snapshot physics published last.
+// The body itself belongs to the physics thread, so the aligned object
+// correction is handed back through 'AlignedOrigin'
+//
+void BaseRigidBody::SyncLocalTransform( const btTransform& CenterOfMass, btVector3& AlignedOrigin, float Weight )
 {
     if (m_BoneRef.m_Index < 0) 
         return;
@@ -181,8 +196,13 @@ void BaseRigidBody::SyncLocalTransform()
 
     if (m_Type != kStaticObject && m_BoneRef.m_Instance != nullptr)
     {
-        btTransform centerOfMassTransform = m_Body->getCenterOfMassTransform();
-        btTransform tr = centerOfMassTransform * m_InvTrans;
+        btTransform tr = CenterOfMass * m_InvTrans;
+        if (Weight < 1.f)
+        {
+            const btTransform pose = Convert(AffineTransform(m_BoneRef.GetTransform()));
+            tr.setOrigin( pose.getOrigin().lerp( tr.getOrigin(), Weight ) );
+            tr.setRotation( pose.getRotation().slerp( tr.getRotation(), Weight ) );
+        }
         //
         // Remove the disparity from bone to bone connection.
         // Even joint has 0 linear limit, small linear movement would be happend.
@@ -192,13 +212,22 @@ void BaseRigidBody::SyncLocalTransform()
         {
             m_BoneRef.UpdateLocalTransform();
             tr.setOrigin( Convert(m_BoneRef.GetTransform().GetTranslation()) );
-            // Update rigid-body
-            m_Body->setCenterOfMassTransform( tr * m_Trans );
+            AlignedOrigin = tr.getOrigin();
         }
         m_BoneRef.SetTransform( tr );
     }
 }
 
+// Same correction as 'SyncLocalTransform' did on the rigid-body, on the latest body
+void BaseRigidBody::AlignOrigin( const btVector3& Origin )
+{
+    if (m_Type != kAlignedObject || m_BoneRef.m_Index < 0 || m_BoneRef.m_Instance == nullptr)
+        return;
+    btTransform tr = m_Body->getCenterOfMassTransform() * m_InvTrans;
+    tr.setOrigin( Origin );
+    m_Body->setCenterOfMassTransform( tr * m_Trans );
+}
+
 void BaseRigidBody::JoinWorld( btDynamicsWorld* world )
 {
     // When use bullet 2.75, casting is needed
@@ -219,6 +248,7 @@ void BaseRigidBody::UpdateTransform()
     if (m_BoneRef.m_Index >= 0 && m_BoneRef.m_Instance != nullptr)
         transform = m_BoneRef.GetTransform();
     const btTransform newTransform = Convert(transform) * m_Trans;
+    m_KinematicTarget = newTransform;
     m_MotionState->setWorldTransform(newTransform);
     m_Body->setInterpolationWorldTransform(newTransform);
     m_Body->setWorldTransform( newTransform );
@@ -15,7 +15,7 @@
 #include "LinearMath/btTransform.h"
 #include "LinearMath/btMotionState.h"
 
-#include "PmxInstant.h"
+#include "ISkeleton.h"
 
 class btRigidBody;
 class btCollisionShape;
@@ -49,6 +49,7 @@ public:
         btTransform m_worldTransform;
     };
 
+    // Follows the target the physics thread took from the last published bone snapshot
     class KinematicMotionState : public DefaultMotionState {
     public:
         KinematicMotionState(const btTransform& startTransform, BaseRigidBody* parent);
@@ -89,7 +90,13 @@ public:
     void SetShapeType( ShapeType Type );
     void SetSize( const Math::Vector3& value );
 
-    void SyncLocalTransform();
+    // Main thread, from the bone pose and the center of mass physics published
+    btTransform GetKinematicTarget() const;
+    // 'Weight' below 1 blends from the current pose, e.g. after waking up
+    void SyncLocalTransform( const btTransform& CenterOfMass, btVector3& AlignedOrigin, float Weight = 1.f );
+    // Physics thread, between steps
+    void SetKinematicTarget( const btTransform& Target );
+    void AlignOrigin( const btVector3& Origin );
     void JoinWorld( btDynamicsWorld* world );
     void LeaveWorld( btDynamicsWorld* world );
     void UpdateTransform();
@@ -103,6 +110,7 @@ protected:
     btQuaternion m_Rotation;
     btTransform m_Trans;
     btTransform m_InvTrans;
+    btTransform m_KinematicTarget;
 
     float m_Mass;
     float m_linearDamping;
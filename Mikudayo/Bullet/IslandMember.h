@@ -0,0 +1,34 @@
+#pragma once
+
+#include "PhysicsLod.h"
+#include "Math/BoundingBox.h"
+
+class btVector3;
+class btDynamicsWorld;
+
+namespace Physics
+{
+    //
+    // Rigid bodies and joints moving between dynamics worlds as a unit (a model).
+    // With instance islands on, nearby members share a world of their own, and
+    // the worlds are stepped concurrently
+    //
+    class IIslandMember
+    {
+    public:
+        virtual ~IIslandMember() {}
+        virtual void JoinWorld( btDynamicsWorld* world ) = 0;
+        virtual void LeaveWorld( btDynamicsWorld* world ) = 0;
+        // False if there is no body to simulate
+        virtual bool GetAabb( btVector3& Min, btVector3& Max ) const = 0;
+        // Whole model, for visibility and distance of the level of detail
+        virtual Math::BoundingBox GetBoundingBox( void ) const = 0;
+        // Main thread, between steps. Out of 'kLodFrozen', bodies are put back
+        // on the current pose before the member joins the world again
+        virtual void SetLod( LodLevel Lod ) { (Lod); }
+        // Physics thread, before and after each step. Take the published bone
+        // snapshot, and publish the bodies. Nothing else is shared with the model
+        virtual void BeginStep( void ) {}
+        virtual void EndStep( void ) {}
+    };
+}
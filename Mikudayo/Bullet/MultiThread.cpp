@@ -0,0 +1,247 @@
+#include "stdafx.h"
+#include "MultiThread.h"
+
+#include <algorithm>
+#include "LinearMath/btPoolAllocator.h"
+#include "BulletDynamics/Dynamics/btSimulationIslandManagerMt.h"
+#include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+
+namespace Physics
+{
+    // Iterations per task, from bullet's multi thread demo
+    const int kPairGrainSize = 80;
+    const int kBodyGrainSize = 50;
+    const int kIntegrateGrainSize = 100;
+
+    void ParallelIslandDispatch( btAlignedObjectArray<btSimulationIslandManagerMt::Island*>* islands,
+        btSimulationIslandManagerMt::IslandCallback* callback );
+}
+
+using namespace Physics;
+
+void Physics::ParallelIslandDispatch( btAlignedObjectArray<btSimulationIslandManagerMt::Island*>* islands,
+    btSimulationIslandManagerMt::IslandCallback* callback )
+{
+    BT_PROFILE( "ParallelIslandDispatch" );
+    ParallelFor( 0, islands->size(), 1, [&]( int Begin, int End ) {
+        for (int i = Begin; i < End; i++)
+        {
+            auto* island = (*islands)[i];
+            btPersistentManifold** manifolds = island->manifoldArray.size() ? &island->manifoldArray[0] : nullptr;
+            btTypedConstraint** constraints = island->constraintArray.size() ? &island->constraintArray[0] : nullptr;
+            callback->processIsland( &island->bodyArray[0], island->bodyArray.size(),
+                manifolds, island->manifoldArray.size(),
+                constraints, island->constraintArray.size(), island->id );
+        }
+    });
+}
+
+CollisionDispatcherMt::CollisionDispatcherMt( btCollisionConfiguration* config ) : btCollisionDispatcher( config )
+{
+}
+
+// Same as base, but registration to the manifold list is locked
+btPersistentManifold* CollisionDispatcherMt::getNewManifold( const btCollisionObject* body0, const btCollisionObject* body1 )
+{
+    const btScalar contactBreakingThreshold = (m_dispatcherFlags & CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD) ?
+        btMin( body0->getCollisionShape()->getContactBreakingThreshold( gContactBreakingThreshold ),
+            body1->getCollisionShape()->getContactBreakingThreshold( gContactBreakingThreshold ) )
+        : gContactBreakingThreshold;
+    const btScalar contactProcessingThreshold = btMin( body0->getContactProcessingThreshold(), body1->getContactProcessingThreshold() );
+
+    void* mem = m_persistentManifoldPoolAllocator->allocate( sizeof( btPersistentManifold ) );
+    if (mem == nullptr)
+    {
+        if ((m_dispatcherFlags & CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION) != 0)
+        {
+            btAssert( 0 );
+            return nullptr;
+        }
+        mem = btAlignedAlloc( sizeof( btPersistentManifold ), 16 );
+    }
+    btPersistentManifold* manifold = new(mem) btPersistentManifold( body0, body1, 0, contactBreakingThreshold, contactProcessingThreshold );
+    m_ManifoldMutex.lock();
+    manifold->m_index1a = m_manifoldsPtr.size();
+    m_manifoldsPtr.push_back( manifold );
+    m_ManifoldMutex.unlock();
+    return manifold;
+}
+
+void CollisionDispatcherMt::releaseManifold( btPersistentManifold* manifold )
+{
+    clearManifold( manifold );
+
+    m_ManifoldMutex.lock();
+    const int findIndex = manifold->m_index1a;
+    btAssert( findIndex < m_manifoldsPtr.size() );
+    m_manifoldsPtr.swap( findIndex, m_manifoldsPtr.size() - 1 );
+    m_manifoldsPtr[findIndex]->m_index1a = findIndex;
+    m_manifoldsPtr.pop_back();
+    m_ManifoldMutex.unlock();
+
+    manifold->~btPersistentManifold();
+    if (m_persistentManifoldPoolAllocator->validPtr( manifold ))
+        m_persistentManifoldPoolAllocator->freeMemory( manifold );
+    else
+        btAlignedFree( manifold );
+}
+
+void CollisionDispatcherMt::dispatchAllCollisionPairs( btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* )
+{
+    BT_PROFILE( "dispatchAllCollisionPairs" );
+    const int pairCount = pairCache->getNumOverlappingPairs();
+    if (pairCount == 0)
+        return;
+    btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+    btNearCallback callback = getNearCallback();
+    ParallelFor( 0, pairCount, kPairGrainSize, [&]( int Begin, int End ) {
+        for (int i = Begin; i < End; i++)
+            callback( pairs[i], *this, info );
+    });
+
+    // Threads append manifolds in any order, rebuild it in pair order for determinism
+    if (m_manifoldsPtr.size() == 0)
+        return;
+    m_manifoldsPtr.resizeNoInitialize( 0 );
+    for (int i = 0; i < pairCount; i++)
+    {
+        if (btCollisionAlgorithm* algorithm = pairs[i].m_algorithm)
+            algorithm->getAllContactManifolds( m_manifoldsPtr );
+    }
+    for (int i = 0; i < m_manifoldsPtr.size(); i++)
+        m_manifoldsPtr[i]->m_index1a = i;
+}
+
+ConstraintSolverPool::ConstraintSolverPool( btConstraintSolver** solvers, int numSolvers )
+{
+    btAssert( numSolvers > 0 );
+    m_Solvers.resize( numSolvers );
+    for (int i = 0; i < numSolvers; i++)
+        m_Solvers[i].Solver = solvers[i];
+    m_SolverType = solvers[0]->getSolverType();
+}
+
+ConstraintSolverPool::~ConstraintSolverPool()
+{
+    for (int i = 0; i < m_Solvers.size(); i++)
+    {
+        delete m_Solvers[i].Solver;
+        m_Solvers[i].Solver = nullptr;
+    }
+}
+
+btScalar ConstraintSolverPool::solveGroup( btCollisionObject** bodies, int numBodies,
+    btPersistentManifold** manifolds, int numManifolds,
+    btTypedConstraint** constraints, int numConstraints,
+    const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher )
+{
+    for (int i = 0; ; i = (i + 1) % m_Solvers.size())
+    {
+        ThreadSolver& solver = m_Solvers[i];
+        if (!solver.Mutex.tryLock())
+            continue;
+        solver.Solver->solveGroup( bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher );
+        solver.Mutex.unlock();
+        return 0.f;
+    }
+}
+
+void ConstraintSolverPool::reset()
+{
+    for (int i = 0; i < m_Solvers.size(); i++)
+    {
+        ThreadSolver& solver = m_Solvers[i];
+        solver.Mutex.lock();
+        solver.Solver->reset();
+        solver.Mutex.unlock();
+    }
+}
+
+SoftRigidDynamicsWorldMt::SoftRigidDynamicsWorldMt( btDispatcher* dispatcher, btBroadphaseInterface* pairCache,
+    btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration ) :
+    btSoftRigidDynamicsWorldMT( dispatcher, pairCache, constraintSolver, collisionConfiguration )
+{
+    // A plain solver is not thread safe, keep the default serial dispatch for it
+    if (dynamic_cast<ConstraintSolverPool*>(constraintSolver) == nullptr)
+        return;
+    auto* islandManager = static_cast<btSimulationIslandManagerMt*>(getSimulationIslandManager());
+    islandManager->setIslandDispatchFunction( ParallelIslandDispatch );
+}
+
+void SoftRigidDynamicsWorldMt::predictUnconstraintMotion( btScalar timeStep )
+{
+    BT_PROFILE( "predictUnconstraintMotion" );
+    const int numBodies = m_nonStaticRigidBodies.size();
+    ParallelFor( 0, numBodies, kBodyGrainSize, [&]( int Begin, int End ) {
+        for (int i = Begin; i < End; i++)
+        {
+            btRigidBody* body = m_nonStaticRigidBodies[i];
+            if (body->isStaticOrKinematicObject())
+                continue;
+            // Velocities are integrated in the constraint solver
+            body->applyDamping( timeStep );
+            body->predictIntegratedTransform( timeStep, body->getInterpolationWorldTransform() );
+        }
+    });
+
+    // Soft body solver is private to the base. The world is built with the
+    // default one, whose prediction is just this loop
+    {
+        BT_PROFILE( "predictUnconstraintMotionSoftBody" );
+        btSoftBodyArray& softBodies = getSoftBodyArray();
+        for (int i = 0; i < softBodies.size(); i++)
+        {
+            if (softBodies[i]->isActive())
+                softBodies[i]->predictMotion( float(timeStep) );
+        }
+    }
+}
+
+void SoftRigidDynamicsWorldMt::createPredictiveContacts( btScalar timeStep )
+{
+    BT_PROFILE( "createPredictiveContacts" );
+    releasePredictiveContacts();
+    const int numBodies = m_nonStaticRigidBodies.size();
+    ParallelFor( 0, numBodies, kBodyGrainSize, [&]( int Begin, int End ) {
+        createPredictiveContactsInternal( &m_nonStaticRigidBodies[Begin], End - Begin, timeStep );
+    });
+}
+
+void SoftRigidDynamicsWorldMt::integrateTransforms( btScalar timeStep )
+{
+    // Speculative restitution is a serial pass after integration, leave it to the base
+    if (m_applySpeculativeContactRestitution)
+    {
+        btSoftRigidDynamicsWorldMT::integrateTransforms( timeStep );
+        return;
+    }
+    BT_PROFILE( "integrateTransforms" );
+    const int numBodies = m_nonStaticRigidBodies.size();
+    ParallelFor( 0, numBodies, kIntegrateGrainSize, [&]( int Begin, int End ) {
+        integrateTransformsInternal( &m_nonStaticRigidBodies[Begin], End - Begin, timeStep );
+    });
+}
+
+DynamicsWorldParts Physics::CreateDynamicsWorld( uint32_t NumThreads, const std::function<btConstraintSolver*( void )>& CreateSolver )
+{
+    DynamicsWorldParts parts;
+    btDefaultCollisionConstructionInfo cci;
+    cci.m_defaultMaxPersistentManifoldPoolSize = 80000;
+    cci.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+    parts.Config = std::make_unique<btSoftBodyRigidBodyCollisionConfiguration>( cci );
+    parts.Broadphase = std::make_unique<btDbvtBroadphase>();
+    parts.Dispatcher = std::make_unique<CollisionDispatcherMt>( parts.Config.get() );
+    {
+        // Caller of the parallel loop solves islands too
+        btConstraintSolver* solvers[BT_MAX_THREAD_COUNT];
+        const int numSolvers = btMin( int(BT_MAX_THREAD_COUNT), int(NumThreads) + 1 );
+        for (int i = 0; i < numSolvers; i++)
+            solvers[i] = CreateSolver();
+        parts.Solver = std::make_unique<ConstraintSolverPool>( solvers, numSolvers );
+    }
+    parts.World = std::make_unique<SoftRigidDynamicsWorldMt>( parts.Dispatcher.get(), parts.Broadphase.get(), parts.Solver.get(), parts.Config.get() );
+    parts.World->setGravity( btVector3( 0, -kEarthGravity * kUnitScale, 0 ) );
+    parts.World->getSolverInfo().m_solverMode = kWorldSolverMode;
+    parts.World->getSolverInfo().m_numIterations = kWorldIterations;
+    return parts;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+// Bullet Physcis
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#pragma warning(disable: 4456)
+#pragma warning(disable: 4702)
+#pragma warning(disable: 4819)
+#define BT_THREADSAFE 1
+#define BT_NO_SIMD_OPERATOR_OVERLOADS 1
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btThreads.h"
+#include "BulletSoftBody/btSoftRigidDynamicsWorldMT.h"
+#pragma warning(pop)
+#include <functional>
+#include <memory>
+#include "TaskScheduler.h"
+
+namespace Physics
+{
+    //
+    // Narrowphase runs over overlapping pairs in parallel. Manifold list is
+    // rebuilt in pair order afterwards, so contacts are the same as serial one
+    //
+    class CollisionDispatcherMt : public btCollisionDispatcher
+    {
+    public:
+        CollisionDispatcherMt( btCollisionConfiguration* config );
+
+        btPersistentManifold* getNewManifold( const btCollisionObject* body0, const btCollisionObject* body1 ) override;
+        void releaseManifold( btPersistentManifold* manifold ) override;
+        void dispatchAllCollisionPairs( btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* dispatcher ) override;
+
+    protected:
+        btSpinMutex m_ManifoldMutex;
+    };
+
+    //
+    // Pool of solvers, each island takes one that no other thread is using.
+    // Pool is sized to the thread count so it should not spin in practice
+    //
+    class ConstraintSolverPool : public btConstraintSolver
+    {
+    public:
+        // Takes ownership of 'solvers'
+        ConstraintSolverPool( btConstraintSolver** solvers, int numSolvers );
+        ~ConstraintSolverPool();
+
+        btScalar solveGroup( btCollisionObject** bodies, int numBodies,
+            btPersistentManifold** manifolds, int numManifolds,
+            btTypedConstraint** constraints, int numConstraints,
+            const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher ) override;
+        void reset() override;
+        btConstraintSolverType getSolverType() const override { return m_SolverType; }
+
+    protected:
+        struct ThreadSolver
+        {
+            btConstraintSolver* Solver;
+            btSpinMutex Mutex;
+            char Padding[128 - sizeof( btSpinMutex ) - sizeof( void* )]; // keep mutexes off a shared cache line
+        };
+        btAlignedObjectArray<ThreadSolver> m_Solvers;
+        btConstraintSolverType m_SolverType;
+    };
+
+    //
+    // Per body loops of the step (motion prediction, predictive contacts,
+    // transform integration) run in parallel. Islands are dispatched through
+    // the scheduler when the constraint solver is a 'ConstraintSolverPool'
+    //
+    ATTRIBUTE_ALIGNED16( class ) SoftRigidDynamicsWorldMt : public btSoftRigidDynamicsWorldMT
+    {
+    public:
+        BT_DECLARE_ALIGNED_ALLOCATOR();
+
+        SoftRigidDynamicsWorldMt( btDispatcher* dispatcher, btBroadphaseInterface* pairCache,
+            btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration );
+
+    protected:
+        void predictUnconstraintMotion( btScalar timeStep ) override;
+        void createPredictiveContacts( btScalar timeStep ) override;
+        void integrateTransforms( btScalar timeStep ) override;
+    };
+
+    // Models are in MikuMikuDance units, 10 to a meter (from MMD-Agent, PMX Editor)
+    const float kUnitScale = 10.f;
+    const float kEarthGravity = 9.8f;
+    const int kWorldIterations = 10; // bullet's default
+    const int kWorldSolverMode = SOLVER_SIMD | SOLVER_USE_WARMSTARTING;
+
+    // A world and what it is made of, the world is destroyed first
+    struct DynamicsWorldParts
+    {
+        std::unique_ptr<btDefaultCollisionConfiguration> Config;
+        std::unique_ptr<btBroadphaseInterface> Broadphase;
+        std::unique_ptr<btCollisionDispatcher> Dispatcher;
+        std::unique_ptr<btConstraintSolver> Solver;
+        std::unique_ptr<btSoftRigidDynamicsWorld> World;
+    };
+
+    //
+    // Multi thread capable soft and rigid body world with default gravity,
+    // solver mode and iterations. Physics::Initialize and the headless runner
+    // both make theirs here, so they simulate alike. The solver pool takes a
+    // solver from 'CreateSolver' for each of 'NumThreads' workers and the caller
+    //
+    DynamicsWorldParts CreateDynamicsWorld( uint32_t NumThreads, const std::function<btConstraintSolver*( void )>& CreateSolver );
+}
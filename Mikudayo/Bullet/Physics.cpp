@@ -5,6 +5,13 @@
 #include "BulletDebugDraw.h"
 #include "PrimitiveBatch.h"
 #include "TextUtility.h"
+#include "SystemTime.h"
+#include "TaskManager.h"
+#include "PhysicsIsland.h"
+#include "Math/BoundingFrustum.h"
+#if !USE_BULLET_2_75
+#include "MultiThread.h"
+#endif
 
 //
 // TODO:
@@ -15,25 +22,34 @@ namespace Physics
 {
     BoolVar m_bInterpolation( "Application/Physics/Motion Interpolation", true );
     BoolVar s_bDebugDraw( "Application/Physics/Debug Draw", false );
-
-    // use scalar from MMD-Agent, PMX Editor
-    // set default gravity 
-    // some tweak for the simulation to match that of MikuMikuDance
-    const float Scale = 10.f;
-    const float EarthGravity = 9.8f;
-
-    NumVar m_GravityAccel( "Application/Physics/Gravity Acceleration", EarthGravity, -100, 100, 1 );
+    BoolVar s_bMultithread( "Application/Physics/Multithread", true );
+    BoolVar s_bInstanceIsland( "Application/Physics/Instance Islands", false );
+    NumVar s_IslandMergeDistance( "Application/Physics/Island Merge Distance", 10.f, 0.f, 100.f, 1.f );
+    // 1 waits for every step, larger lets the step overrun a frame without blocking
+    IntVar s_MaxLatency( "Application/Physics/Max Latency", 2, 1, 8 );
+    BoolVar s_bShowStats( "Application/Physics/Show Stats", false );
+    // Level of a world is the finest of its members, so LOD puts members in islands
+    // of their own (merged only when close), whatever 'Instance Islands' is
+    BoolVar s_bLod( "Application/Physics/LOD", false );
+    NumVar s_LodBudget( "Application/Physics/LOD Budget (ms)", 8.f, 0.f, 100.f, 0.5f );
+    NumVar s_LodReduceDistance( "Application/Physics/LOD Reduce Distance", 100.f, 0.f, 1000.f, 10.f );
+    NumVar s_LodFreezeDistance( "Application/Physics/LOD Freeze Distance", 400.f, 0.f, 4000.f, 10.f );
+    IntVar s_LodFreezeDelay( "Application/Physics/LOD Freeze Delay", 30, 0, 600 );
+
+    // Solver iterations of a world at each level, full one is bullet's default
+    const int kFullIterations = kWorldIterations;
+    const int kReducedIterations = 4;
+
+    // Joined members split only past this multiple of the merge distance
+    const float kIslandSplitScale = 1.5f;
+
+    // Defaults are those of CreateDynamicsWorld
+    NumVar m_GravityAccel( "Application/Physics/Gravity Acceleration", kEarthGravity, -100, 100, 1 );
     NumVar m_GravityX( "Application/Physics/Gravity X", 0, -1, 1, 0.1 );
     NumVar m_GravityY( "Application/Physics/Gravity Y", -1, -1, 1, 0.1 );
     NumVar m_GravityZ( "Application/Physics/Gravity Z", 0, -1, 1, 0.1 );
 
     SolverType m_SolverType = SOLVER_TYPE_SEQUENTIAL_IMPULSE;
-    int m_SolverMode = SOLVER_SIMD |
-        SOLVER_USE_WARMSTARTING |
-        // SOLVER_RANDMIZE_ORDER |
-        // SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS |
-        // SOLVER_USE_2_FRICTION_DIRECTIONS |
-        0;
 
 	btSoftRigidDynamicsWorld* g_DynamicsWorld = nullptr;
 
@@ -50,11 +66,54 @@ namespace Physics
 	std::mutex mutexJob;
 	std::condition_variable condJob;
     float m_deltaT = 0.f;
+    float m_PendingDeltaT = 0.f; // frame time not handed to a step yet
 	bool bStepJob = false;
 	bool bExitJob = false;
 	std::unique_ptr<std::thread> pJob;
     void JobFunc();
 
+    // Main thread publishes bones of frame 'm_FrameIndex', the step runs on the
+    // snapshot of 'm_StepFrame', and 'm_ResultFrame' is the last one completed
+    std::atomic<uint64_t> m_FrameIndex( 0 );
+    uint64_t m_StepFrame = 0;
+    uint64_t m_ResultFrame = 0;
+    Stats m_Stats = {};
+
+    //
+    // Dynamics world of a cluster of nearby members. Rigid body only, they do
+    // not collide with primitives and soft bodies of the shared world
+    //
+    struct Island
+    {
+        Island();
+
+        std::unique_ptr<btDefaultCollisionConfiguration> Config;
+        std::unique_ptr<btBroadphaseInterface> Broadphase;
+        std::unique_ptr<btCollisionDispatcher> Dispatcher;
+        std::unique_ptr<btConstraintSolver> Solver;
+        std::unique_ptr<btDiscreteDynamicsWorld> World;
+        uint32_t NumMembers = 0;
+        LodLevel Lod = kLodFull;
+    };
+    std::vector<std::unique_ptr<Island>> m_Islands;
+    std::vector<IIslandMember*> m_IslandMembers;
+    std::vector<Island*> m_MemberIsland; // nullptr for the shared world
+    btDynamicsWorld* GetIslandWorld( Island* island );
+    void MoveIslandMember( size_t i, Island* island );
+    void RemoveEmptyIslands();
+    void UpdateIslands();
+
+    // Level of detail, members of 'kLodFrozen' are in no world
+    LodPolicy m_LodPolicy;
+    std::vector<LodState> m_MemberLod;
+    LodLevel m_SharedLod = kLodFull;
+    BoundingFrustum m_LodFrustum;
+    Vector3 m_LodEye( kZero );
+    bool m_bLodCamera = false;
+    void StepWorld( btDynamicsWorld* world, LodLevel lod );
+    void UpdateLod();
+    void UpdateWorldLod();
+
     class BulletPicking
     {
     public:
@@ -200,9 +259,12 @@ void BulletPicking::ReleasePickBody()
     m_PickedConstraint = nullptr;
 }
 
+// Markers are only pushed from the step thread, not from the workers of a parallel step
 void EnterProfileZoneDefault(const char* name)
 {
 #ifndef RELEASE
+    if (std::this_thread::get_id() != pJob->get_id())
+        return;
     PushProfilingMarker( Utility::MakeWStr(std::string(name)), nullptr );
 #endif
 }
@@ -210,6 +272,8 @@ void EnterProfileZoneDefault(const char* name)
 void LeaveProfileZoneDefault()
 {
 #ifndef RELEASE
+    if (std::this_thread::get_id() != pJob->get_id())
+        return;
     PopProfilingMarker( nullptr );
 #endif
 }
@@ -245,6 +309,8 @@ btConstraintSolver* Physics::CreateSolverByType( SolverType t )
 
 void Physics::Initialize( void )
 {
+    // Models are decoded on it before the first step picks one
+    SetTaskScheduler( GetTaskManagerScheduler() );
     pJob.reset( new std::thread( JobFunc ) );
 
     BulletDebug::Initialize();
@@ -254,15 +320,26 @@ void Physics::Initialize( void )
     btSetCustomLeaveProfileZoneFunc(LeaveProfileZoneDefault);
 #endif
 
+#if USE_BULLET_2_75
     Config = std::make_unique<btSoftBodyRigidBodyCollisionConfiguration>();
     Broadphase = std::make_unique<btDbvtBroadphase>();
     Dispatcher = std::make_unique<btCollisionDispatcher>( Config.get() );
     Solver = std::make_unique<btSequentialImpulseConstraintSolver>();
     Solver.reset( CreateSolverByType( m_SolverType ) );
     DynamicsWorld = std::make_unique<btSoftRigidDynamicsWorld>( Dispatcher.get(), Broadphase.get(), Solver.get(), Config.get() );
+#else
+    // Multi thread capable world, 's_bMultithread' picks the scheduler it runs on each step
+    DynamicsWorldParts parts = CreateDynamicsWorld( TaskManager::GetMaxNumThreads(),
+        []() { return CreateSolverByType( m_SolverType ); } );
+    Config = std::move( parts.Config );
+    Broadphase = std::move( parts.Broadphase );
+    Dispatcher = std::move( parts.Dispatcher );
+    Solver = std::move( parts.Solver );
+    DynamicsWorld = std::move( parts.World );
+#endif
     ASSERT( DynamicsWorld != nullptr );
     UpdateGravity();
-    DynamicsWorld->getSolverInfo().m_solverMode = m_SolverMode;
+    DynamicsWorld->getSolverInfo().m_solverMode = kWorldSolverMode;
 
     SoftBodyWorldInfo.m_broadphase = Broadphase.get();
     SoftBodyWorldInfo.m_dispatcher = Dispatcher.get();
@@ -285,22 +362,54 @@ void Physics::Initialize( void )
 
 }
 
+//
+// The lock is held only to take and finish the job. While stepping, the main
+// thread keeps running on the snapshots, and worlds, islands and members are
+// left alone as long as 'bStepJob' is set
+//
 void Physics::JobFunc()
 {
     while (true) 
     {
         {
 			std::unique_lock<std::mutex> lk(mutexJob);
-            condJob.wait( lk, [] { return bStepJob; } );
+            condJob.wait( lk, [] { return bStepJob || bExitJob; } );
             if (bExitJob)
                 break;
-            UpdateGravity();
-        #if !USE_BULLET_2_75
-            DynamicsWorld->setLatencyMotionStateInterpolation( m_bInterpolation );
-		#endif
-            ASSERT( DynamicsWorld.get() != nullptr );
-            DynamicsWorld->stepSimulation( m_deltaT, 2 );
+        }
+        const int64_t startTick = SystemTime::GetCurrentTick();
+        UpdateGravity();
+    #if !USE_BULLET_2_75
+        DynamicsWorld->setLatencyMotionStateInterpolation( m_bInterpolation );
+        for (auto& island : m_Islands)
+            island->World->setLatencyMotionStateInterpolation( m_bInterpolation );
+        SetTaskScheduler( s_bMultithread ? GetTaskManagerScheduler() : GetSequentialTaskScheduler() );
+    #endif
+        ASSERT( DynamicsWorld.get() != nullptr );
+        for (auto member : m_IslandMembers)
+            member->BeginStep();
+        if (m_Islands.empty())
+        {
+            StepWorld( DynamicsWorld.get(), m_SharedLod );
+        }
+        else
+        {
+            // Shared world is one more task next to the islands
+            TaskManager::parallel_for( 0, m_Islands.size() + 1, []( size_t i ) {
+                if (i == 0)
+                    StepWorld( DynamicsWorld.get(), m_SharedLod );
+                else
+                    StepWorld( m_Islands[i - 1]->World.get(), m_Islands[i - 1]->Lod );
+            });
+        }
+        for (auto member : m_IslandMembers)
+            member->EndStep();
+        const float stepTime = float(SystemTime::TimeBetweenTicks( startTick, SystemTime::GetCurrentTick() ) * 1000.0);
 
+        {
+            std::unique_lock<std::mutex> lk( mutexJob );
+            m_Stats.StepTime = stepTime;
+            m_ResultFrame = m_StepFrame;
             bStepJob = false;
         }
         condJob.notify_one();
@@ -318,6 +427,8 @@ void Physics::RenderDebug( GraphicsContext& Context, const Matrix4& WorldToClip
     if (s_bDebugDraw)
     {
         DynamicsWorld->debugDrawWorld();
+        for (auto& island : m_Islands)
+            island->World->debugDrawWorld();
         for (int i = 0; i < DynamicsWorld->getSoftBodyArray().size(); i++)
 		{
             btSoftBody*	psb = DynamicsWorld->getSoftBodyArray()[i];
@@ -326,6 +437,20 @@ void Physics::RenderDebug( GraphicsContext& Context, const Matrix4& WorldToClip
 		}
         DebugDrawer->flush( Context, WorldToClip );
     }
+    if (s_bShowStats)
+    {
+        const Stats stats = GetStats();
+        TextContext Text( Context );
+        Text.Begin();
+        Text.ResetCursor( 10.f, 60.f );
+        Text.DrawFormattedString( "Physics: step %.2f ms, latency %u frames, wait %.2f ms",
+            stats.StepTime, stats.Latency, stats.WaitTime );
+        Text.NewLine();
+        Text.DrawFormattedString( "Overrun %llu frames, waited %llu frames", stats.NumOverrun, stats.NumWait );
+        Text.NewLine();
+        Text.DrawFormattedString( "LOD scale %.2f, reduced %u, frozen %u", stats.LodScale, stats.NumReduced, stats.NumFrozen );
+        Text.End();
+    }
 }
 
 bool Physics::PickBody( const btVector3& From, const btVector3& To, const btVector3& Forward )
@@ -347,13 +472,27 @@ void Physics::Stop()
 {
     {
         std::unique_lock<std::mutex> lk( mutexJob );
-        bStepJob = true;
         bExitJob = true;
         condJob.notify_one();
     }
 	pJob->join();
 }
 
+void Physics::Sync()
+{
+    std::unique_lock<std::mutex> lk( mutexJob );
+    const uint64_t frame = m_FrameIndex;
+    m_Stats.WaitTime = 0.f;
+    if (bStepJob && frame - m_StepFrame >= uint64_t(int32_t(s_MaxLatency)))
+    {
+        const int64_t startTick = SystemTime::GetCurrentTick();
+        condJob.wait( lk, [] { return !bStepJob || bExitJob; } );
+        m_Stats.WaitTime = float(SystemTime::TimeBetweenTicks( startTick, SystemTime::GetCurrentTick() ) * 1000.0);
+        m_Stats.NumWait++;
+    }
+    m_Stats.Latency = uint32_t(frame - m_ResultFrame);
+}
+
 void Physics::Shutdown( void )
 {
     SoftBodyWorldInfo.m_sparsesdf.Reset();
@@ -367,26 +506,56 @@ void Physics::Shutdown( void )
         DynamicsWorld->removeSoftBody( psb );
         delete psb;
     }
-    ASSERT(DynamicsWorld->getNumCollisionObjects() == 0,
+    ASSERT(DynamicsWorld->getNumCollisionObjects() == 0 && m_IslandMembers.empty(),
         "Remove all rigidbody objects from world");
+    m_Islands.clear();
 
     DynamicsWorld.reset( nullptr );
     g_DynamicsWorld = nullptr;
 }
 
 
+//
+// Kicks a step on the snapshots published in this frame. If the last step is
+// still running, the frame time is carried over to the next one
+//
 void Physics::Update( float deltaT )
 {
     std::unique_lock<std::mutex> lk( mutexJob );
-    if (bStepJob) return;
-    m_deltaT = deltaT;
+    m_PendingDeltaT += deltaT;
+    if (bStepJob)
+    {
+        m_FrameIndex++;
+        m_Stats.NumOverrun++;
+        return;
+    }
+    UpdateLod();
+    UpdateIslands();
+    UpdateWorldLod();
+    m_deltaT = m_PendingDeltaT;
+    m_PendingDeltaT = 0.f;
+    m_StepFrame = m_FrameIndex++;
     bStepJob = true;
 	condJob.notify_one();
 }
 
+uint64_t Physics::GetFrameIndex( void )
+{
+    return m_FrameIndex;
+}
+
+Physics::Stats Physics::GetStats( void )
+{
+    std::unique_lock<std::mutex> lk( mutexJob );
+    return m_Stats;
+}
+
 void Physics::UpdateGravity( void )
 {
-    DynamicsWorld->setGravity( btVector3( m_GravityX, m_GravityY, m_GravityZ ) * m_GravityAccel * Scale );
+    const btVector3 gravity = btVector3( m_GravityX, m_GravityY, m_GravityZ ) * m_GravityAccel * kUnitScale;
+    DynamicsWorld->setGravity( gravity );
+    for (auto& island : m_Islands)
+        island->World->setGravity( gravity );
 }
 
 void Physics::UpdatePicking( D3D11_VIEWPORT MainViewport, const Math::BaseCamera& Camera )
@@ -429,5 +598,246 @@ void Physics::UpdatePicking( D3D11_VIEWPORT MainViewport, const Math::BaseCamera
 void Physics::Wait()
 {
     std::unique_lock<std::mutex> lk( mutexJob );
-    condJob.wait( lk, [] { return !bStepJob; } );
-}
\ No newline at end of file
+    condJob.wait( lk, [] { return !bStepJob || bExitJob; } );
+}
+
+Physics::Island::Island()
+{
+    Config = std::make_unique<btDefaultCollisionConfiguration>();
+    Broadphase = std::make_unique<btDbvtBroadphase>();
+    Dispatcher = std::make_unique<btCollisionDispatcher>( Config.get() );
+    Solver.reset( CreateSolverByType( m_SolverType ) );
+    World = std::make_unique<btDiscreteDynamicsWorld>( Dispatcher.get(), Broadphase.get(), Solver.get(), Config.get() );
+    World->getSolverInfo().m_solverMode = kWorldSolverMode;
+    World->setGravity( DynamicsWorld->getGravity() );
+    World->setDebugDrawer( DebugDrawer.get() );
+}
+
+// Only between steps, the main thread waits for the running one here
+void Physics::AddIslandMember( IIslandMember* Member )
+{
+    std::unique_lock<std::mutex> lk( mutexJob );
+    condJob.wait( lk, [] { return !bStepJob || bExitJob; } );
+    ASSERT( std::find( m_IslandMembers.begin(), m_IslandMembers.end(), Member ) == m_IslandMembers.end() );
+    m_IslandMembers.push_back( Member );
+    m_MemberIsland.push_back( nullptr );
+    m_MemberLod.push_back( LodState() );
+    Member->JoinWorld( DynamicsWorld.get() );
+}
+
+void Physics::RemoveIslandMember( IIslandMember* Member )
+{
+    std::unique_lock<std::mutex> lk( mutexJob );
+    condJob.wait( lk, [] { return !bStepJob || bExitJob; } );
+    auto it = std::find( m_IslandMembers.begin(), m_IslandMembers.end(), Member );
+    if (it == m_IslandMembers.end())
+        return;
+    const size_t i = it - m_IslandMembers.begin();
+    Island* island = m_MemberIsland[i];
+    if (m_MemberLod[i].Level != kLodFrozen)
+        Member->LeaveWorld( GetIslandWorld( island ) );
+    if (island)
+        island->NumMembers--;
+    m_IslandMembers.erase( it );
+    m_MemberIsland.erase( m_MemberIsland.begin() + i );
+    m_MemberLod.erase( m_MemberLod.begin() + i );
+    RemoveEmptyIslands();
+}
+
+btDynamicsWorld* Physics::GetIslandWorld( Island* island )
+{
+    return island ? island->World.get() : DynamicsWorld.get();
+}
+
+void Physics::MoveIslandMember( size_t i, Island* island )
+{
+    Island* current = m_MemberIsland[i];
+    if (current == island)
+        return;
+    // Bodies keep their transform and velocity across worlds
+    if (m_MemberLod[i].Level != kLodFrozen)
+    {
+        m_IslandMembers[i]->LeaveWorld( GetIslandWorld( current ) );
+        m_IslandMembers[i]->JoinWorld( GetIslandWorld( island ) );
+    }
+    if (current)
+        current->NumMembers--;
+    if (island)
+        island->NumMembers++;
+    m_MemberIsland[i] = island;
+}
+
+void Physics::RemoveEmptyIslands()
+{
+    auto it = std::remove_if( m_Islands.begin(), m_Islands.end(), []( const std::unique_ptr<Island>& island ) {
+        return island->NumMembers == 0;
+    });
+    m_Islands.erase( it, m_Islands.end() );
+}
+
+//
+// Regroup members by distance between steps. A cluster whose members are
+// exactly one island keeps it, others get a new island
+//
+void Physics::UpdateIslands()
+{
+    const size_t numMembers = m_IslandMembers.size();
+    std::vector<IslandBound> bounds;
+    std::vector<size_t> boundMember;
+    if (s_bInstanceIsland || s_bLod)
+    {
+        for (size_t i = 0; i < numMembers; i++)
+        {
+            IslandBound bound;
+            if (m_MemberLod[i].Level == kLodFrozen || !m_IslandMembers[i]->GetAabb( bound.Min, bound.Max ))
+                continue;
+            auto it = std::find_if( m_Islands.begin(), m_Islands.end(), [&]( const std::unique_ptr<Island>& island ) {
+                return island.get() == m_MemberIsland[i];
+            });
+            bound.Island = (it == m_Islands.end()) ? -1 : int32_t(it - m_Islands.begin());
+            bounds.push_back( bound );
+            boundMember.push_back( i );
+        }
+    }
+    const float mergeDistance = s_IslandMergeDistance;
+    const std::vector<uint32_t> cluster = ClusterIslands( bounds, mergeDistance, mergeDistance * kIslandSplitScale );
+
+    bool bMoved = false;
+    std::vector<bool> bClustered( numMembers, false );
+    for (size_t k = 0; k < bounds.size(); k++)
+    {
+        if (cluster[k] != k)
+            continue;
+        std::vector<size_t> members;
+        for (size_t n = k; n < bounds.size(); n++)
+        {
+            if (cluster[n] == k)
+                members.push_back( boundMember[n] );
+        }
+        Island* current = m_MemberIsland[members[0]];
+        bool bSame = current && current->NumMembers == members.size();
+        for (size_t i : members)
+        {
+            bSame = bSame && m_MemberIsland[i] == current;
+            bClustered[i] = true;
+        }
+        if (bSame)
+            continue;
+        m_Islands.push_back( std::make_unique<Island>() );
+        for (size_t i : members)
+            MoveIslandMember( i, m_Islands.back().get() );
+        bMoved = true;
+    }
+    // Islands off, or nothing to simulate
+    for (size_t i = 0; i < numMembers; i++)
+    {
+        if (bClustered[i] || m_MemberIsland[i] == nullptr)
+            continue;
+        MoveIslandMember( i, nullptr );
+        bMoved = true;
+    }
+    RemoveEmptyIslands();
+
+    // Picking constraint lives in the shared world, and can't hold a body moved out
+    if (bMoved)
+        m_Picking.ReleasePickBody();
+}
+
+void Physics::UpdateLodCamera( const Math::BaseCamera& Camera )
+{
+    std::unique_lock<std::mutex> lk( mutexJob );
+    m_LodFrustum = Camera.GetWorldSpaceFrustum();
+    m_LodEye = Camera.GetPosition();
+    m_bLodCamera = true;
+}
+
+// Reduced world runs half the substeps with fewer solver iterations
+void Physics::StepWorld( btDynamicsWorld* world, LodLevel lod )
+{
+    const bool bReduced = lod == kLodReduced;
+    world->getSolverInfo().m_numIterations = bReduced ? kReducedIterations : kFullIterations;
+    world->stepSimulation( m_deltaT, bReduced ? 1 : 2, bReduced ? btScalar(1.) / 30 : btScalar(1.) / 60 );
+}
+
+//
+// Level of each member from the camera and the last step time. Frozen members
+// leave their world, and join it again from the current pose when they wake up
+//
+void Physics::UpdateLod()
+{
+    const size_t numMembers = m_IslandMembers.size();
+    std::vector<LodPolicy::Input> inputs( numMembers, { true, 0.f } );
+    if (s_bLod && m_bLodCamera)
+    {
+        for (size_t i = 0; i < numMembers; i++)
+        {
+            const BoundingBox box = m_IslandMembers[i]->GetBoundingBox();
+            if (!box.IsValid())
+                continue;
+            const Vector3 closest = Max( box.GetMin(), Min( m_LodEye, box.GetMax() ) );
+            inputs[i].bVisible = m_LodFrustum.IntersectBox( box );
+            inputs[i].Distance = Length( m_LodEye - closest );
+        }
+    }
+    LodSettings settings;
+    settings.ReduceDistance = s_LodReduceDistance;
+    settings.FreezeDistance = s_LodFreezeDistance;
+    settings.FreezeDelay = uint32_t(int32_t(s_LodFreezeDelay));
+    settings.Budget = s_bLod ? float(s_LodBudget) : 0.f;
+    std::vector<LodState> states = m_MemberLod;
+    m_LodPolicy.Update( settings, m_Stats.StepTime, inputs, states );
+
+    bool bFrozen = false;
+    m_Stats.NumReduced = m_Stats.NumFrozen = 0;
+    for (size_t i = 0; i < numMembers; i++)
+    {
+        const LodLevel from = m_MemberLod[i].Level, to = states[i].Level;
+        m_MemberLod[i] = states[i];
+        m_Stats.NumReduced += (to == kLodReduced) ? 1 : 0;
+        m_Stats.NumFrozen += (to == kLodFrozen) ? 1 : 0;
+        if (from == to)
+            continue;
+        IIslandMember* member = m_IslandMembers[i];
+        btDynamicsWorld* world = GetIslandWorld( m_MemberIsland[i] );
+        if (to == kLodFrozen)
+        {
+            member->LeaveWorld( world );
+            bFrozen = true;
+        }
+        member->SetLod( to );
+        if (from == kLodFrozen)
+            member->JoinWorld( world );
+    }
+    m_Stats.LodScale = m_LodPolicy.GetScale();
+
+    // Picked body may be in a frozen member
+    if (bFrozen)
+        m_Picking.ReleasePickBody();
+}
+
+// A world runs reduced only if all the members in it are. With LOD on, every
+// member is in an island, and members sharing one are close to each other
+void Physics::UpdateWorldLod()
+{
+    m_SharedLod = kLodFull;
+    for (auto& island : m_Islands)
+        island->Lod = kLodReduced;
+    bool bSharedMember = false;
+    for (size_t i = 0; i < m_IslandMembers.size(); i++)
+    {
+        const LodLevel lod = m_MemberLod[i].Level;
+        if (lod == kLodFrozen)
+            continue;
+        if (Island* island = m_MemberIsland[i])
+        {
+            if (lod == kLodFull)
+                island->Lod = kLodFull;
+            continue;
+        }
+        if (!bSharedMember)
+            m_SharedLod = lod;
+        else if (lod == kLodFull)
+            m_SharedLod = kLodFull;
+        bSharedMember = true;
+    }
+}
@@ -5,6 +5,8 @@ class GraphicsContext;
 class btSoftRigidDynamicsWorld;
 struct btSoftBodyWorldInfo;
 
+#include "IslandMember.h"
+
 // Bullet Physcis
 #pragma warning(push)
 #pragma warning(disable: 4100)
@@ -56,6 +58,26 @@ namespace Physics
     extern NumVar m_GravityY;
     extern NumVar m_GravityZ;
 
+    struct Stats
+    {
+        float StepTime; // ms, last step
+        float WaitTime; // ms, main thread waited in the last 'Sync'
+        uint32_t Latency; // frames from the bone snapshot to the bodies in use
+        uint64_t NumOverrun; // frames the step was still running at 'Update'
+        uint64_t NumWait; // frames 'Sync' had to wait
+        float LodScale; // distance scale the budget allows
+        uint32_t NumReduced;
+        uint32_t NumFrozen;
+    };
+
+    // Member joins the shared world, and is regrouped on the next update
+    void AddIslandMember( IIslandMember* Member );
+    void RemoveIslandMember( IIslandMember* Member );
+
+    // Version of the snapshots published in this frame
+    uint64_t GetFrameIndex( void );
+    Stats GetStats( void );
+
     void Initialize( void );
     bool MovePickBody(const btVector3& From, const btVector3& To, const btVector3& Forward );
     bool PickBody( const btVector3& From, const btVector3& To, const btVector3& Forward );
@@ -64,7 +86,11 @@ namespace Physics
     void RenderDebug( GraphicsContext& Context, const Matrix4& WorldToClip );
     void Shutdown( void );
     void Stop();
+    // Waits for the step only if the bodies would lag more than the latency limit
+    void Sync();
     void Update( float deltaT );
+    // Camera the level of detail is decided from
+    void UpdateLodCamera( const Math::BaseCamera& Camera );
     void UpdatePicking( D3D11_VIEWPORT MainViewport, const Math::BaseCamera& Camera );
     void Wait();
 };
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#include "PhysicsIsland.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+float Physics::AabbDistance( const btVector3& MinA, const btVector3& MaxA, const btVector3& MinB, const btVector3& MaxB )
+{
+    float dist2 = 0.f;
+    for (int i = 0; i < 3; i++)
+    {
+        const float gap = std::max( { float(MinB[i] - MaxA[i]), float(MinA[i] - MaxB[i]), 0.f } );
+        dist2 += gap * gap;
+    }
+    return std::sqrt( dist2 );
+}
+
+std::vector<uint32_t> Physics::ClusterIslands( const std::vector<IslandBound>& Bounds, float MergeDistance, float SplitDistance )
+{
+    const uint32_t numBounds = uint32_t(Bounds.size());
+    std::vector<uint32_t> parent( numBounds );
+    std::iota( parent.begin(), parent.end(), 0 );
+    auto Find = [&]( uint32_t i ) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    // A scene has a handful of models, all pairs are cheap enough
+    for (uint32_t i = 0; i < numBounds; i++)
+    {
+        for (uint32_t j = i + 1; j < numBounds; j++)
+        {
+            const IslandBound& a = Bounds[i];
+            const IslandBound& b = Bounds[j];
+            const bool bJoined = a.Island >= 0 && a.Island == b.Island;
+            if (AabbDistance( a.Min, a.Max, b.Min, b.Max ) > (bJoined ? SplitDistance : MergeDistance))
+                continue;
+            // Smaller index is always the root
+            const uint32_t rootA = Find( i ), rootB = Find( j );
+            parent[std::max( rootA, rootB )] = std::min( rootA, rootB );
+        }
+    }
+
+    std::vector<uint32_t> cluster( numBounds );
+    for (uint32_t i = 0; i < numBounds; i++)
+        cluster[i] = Find( i );
+    return cluster;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Bullet Physcis
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#pragma warning(disable: 4456)
+#pragma warning(disable: 4702)
+#pragma warning(disable: 4819)
+#define BT_THREADSAFE 1
+#define BT_NO_SIMD_OPERATOR_OVERLOADS 1
+#include "LinearMath/btVector3.h"
+#pragma warning(pop)
+
+namespace Physics
+{
+    struct IslandBound
+    {
+        btVector3 Min;
+        btVector3 Max;
+        int32_t Island; // island it is in now, -1 for the shared world
+    };
+
+    // Gap between two boxes, zero if they overlap
+    float AabbDistance( const btVector3& MinA, const btVector3& MaxA, const btVector3& MinB, const btVector3& MaxB );
+
+    //
+    // Groups bounds that come within 'MergeDistance' of each other. Bounds already
+    // sharing an island stay together up to 'SplitDistance', so a pair around the
+    // threshold does not flip between worlds every frame. Returns cluster per bound,
+    // which is the smallest bound index in the cluster
+    //
+    std::vector<uint32_t> ClusterIslands( const std::vector<IslandBound>& Bounds, float MergeDistance, float SplitDistance );
+}
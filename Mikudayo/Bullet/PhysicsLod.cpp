@@ -0,0 +1,45 @@
+#include "stdafx.h"
+#include "PhysicsLod.h"
+
+#include <algorithm>
+
+namespace {
+    // Distance scale control, per frame
+    const float kMinScale = 0.05f;
+    const float kShrink = 0.8f;
+    const float kGrow = 1.05f;
+    const float kRelaxBudget = 0.7f; // grow back only under this fraction of the budget
+
+    // Coming back to a finer level needs to be this much closer, not to flip at the threshold
+    const float kHysteresis = 0.9f;
+}
+
+using namespace Physics;
+
+void LodPolicy::Update( const LodSettings& Settings, float StepTime, const std::vector<Input>& Inputs, std::vector<LodState>& States )
+{
+    if (Settings.Budget <= 0.f)
+        m_Scale = 1.f;
+    else if (StepTime > Settings.Budget)
+        m_Scale = std::max( kMinScale, m_Scale * kShrink );
+    else if (StepTime < Settings.Budget * kRelaxBudget)
+        m_Scale = std::min( 1.f, m_Scale * kGrow );
+
+    States.resize( Inputs.size() );
+    for (size_t i = 0; i < Inputs.size(); i++)
+    {
+        const Input& input = Inputs[i];
+        LodState& state = States[i];
+        state.HiddenFrames = input.bVisible ? 0 : state.HiddenFrames + 1;
+
+        auto Beyond = [&]( float distance, LodLevel level ) {
+            return input.Distance > distance * m_Scale * (state.Level >= level ? kHysteresis : 1.f);
+        };
+        if (state.HiddenFrames > Settings.FreezeDelay || Beyond( Settings.FreezeDistance, kLodFrozen ))
+            state.Level = kLodFrozen;
+        else if (Beyond( Settings.ReduceDistance, kLodReduced ))
+            state.Level = kLodReduced;
+        else
+            state.Level = kLodFull;
+    }
+}
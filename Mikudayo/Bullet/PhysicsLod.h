@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Physics
+{
+    enum LodLevel : uint8_t
+    {
+        kLodFull,
+        kLodReduced, // half the substeps and fewer solver iterations
+        kLodFrozen, // out of the world, bones follow the animation
+    };
+
+    struct LodSettings
+    {
+        float ReduceDistance;
+        float FreezeDistance;
+        uint32_t FreezeDelay; // frames off-screen before freezing
+        float Budget; // ms per step, 0 for no limit
+    };
+
+    struct LodState
+    {
+        LodLevel Level = kLodFull;
+        uint32_t HiddenFrames = 0;
+    };
+
+    //
+    // Picks the simulation level of each member from its visibility and
+    // distance to the camera. Distances shrink while the step is over the
+    // budget and grow back once it is well under, so the step time settles
+    // within the budget
+    //
+    class LodPolicy
+    {
+    public:
+        struct Input
+        {
+            bool bVisible;
+            float Distance;
+        };
+
+        void Update( const LodSettings& Settings, float StepTime, const std::vector<Input>& Inputs, std::vector<LodState>& States );
+        float GetScale( void ) const { return m_Scale; }
+
+    protected:
+        float m_Scale = 1.f;
+    };
+}
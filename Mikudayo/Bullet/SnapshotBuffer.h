@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Physics
+{
+    //
+    // Lock free exchange of a snapshot from one producer thread to one consumer
+    // thread. It is a double buffer (back is written, front is read) with a spare
+    // slot between them, so publishing never waits for the reader and the reader
+    // always sees a whole snapshot. Each publish carries a version, e.g. frame
+    //
+    template <typename T>
+    class SnapshotBuffer
+    {
+    public:
+        // Producer
+        T& GetBack( void ) { return m_Slots[m_Back]; }
+        void Publish( uint64_t Version )
+        {
+            m_Versions[m_Back] = Version;
+            m_Back = m_Shared.exchange( m_Back | kFresh, std::memory_order_acq_rel ) & kIndexMask;
+        }
+
+        // Consumer, false if nothing was published since the last acquire
+        bool Acquire( void )
+        {
+            if ((m_Shared.load( std::memory_order_relaxed ) & kFresh) == 0)
+                return false;
+            m_Front = m_Shared.exchange( m_Front, std::memory_order_acq_rel ) & kIndexMask;
+            m_bValid = true;
+            return true;
+        }
+        // Only after the first successful acquire
+        bool IsValid( void ) const { return m_bValid; }
+        const T& GetFront( void ) const { return m_Slots[m_Front]; }
+        uint64_t GetFrontVersion( void ) const { return m_Versions[m_Front]; }
+
+    protected:
+        static const uint32_t kIndexMask = 0x3;
+        static const uint32_t kFresh = 0x4;
+
+        T m_Slots[3];
+        uint64_t m_Versions[3] = {};
+        uint32_t m_Back = 0;
+        uint32_t m_Front = 1;
+        bool m_bValid = false;
+        std::atomic<uint32_t> m_Shared{ 2 };
+    };
+}
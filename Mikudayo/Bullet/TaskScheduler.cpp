@@ -0,0 +1,40 @@
+#include "stdafx.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+
+namespace Physics
+{
+    class SequentialTaskScheduler : public ITaskScheduler
+    {
+    public:
+        const char* GetName( void ) const override { return "Sequential"; }
+        uint32_t GetNumThreads( void ) const override { return 1; }
+        void ParallelFor( int Begin, int End, int, const ParallelForBody& Body ) override
+        {
+            if (Begin < End)
+                Body.forLoop( Begin, End );
+        }
+    };
+
+    SequentialTaskScheduler s_SequentialScheduler;
+    // Swapped by the physics job while a model may be decoded on another thread
+    std::atomic<ITaskScheduler*> s_TaskScheduler( &s_SequentialScheduler );
+}
+
+using namespace Physics;
+
+ITaskScheduler* Physics::GetSequentialTaskScheduler( void )
+{
+    return &s_SequentialScheduler;
+}
+
+void Physics::SetTaskScheduler( ITaskScheduler* Scheduler )
+{
+    s_TaskScheduler = Scheduler ? Scheduler : &s_SequentialScheduler;
+}
+
+ITaskScheduler* Physics::GetTaskScheduler( void )
+{
+    return s_TaskScheduler;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Physics
+{
+    //
+    // Task scheduler driving the parallel loops of the dynamics world
+    //
+    // Bullet 2.86 has no btITaskScheduler, only the Mt world and island manager
+    // hooks. This plays the same role: the world is built once, and the scheduler
+    // is swapped between steps to run it serial or on the TaskManager pool.
+    //
+    class ITaskScheduler
+    {
+    public:
+        struct ParallelForBody
+        {
+            virtual ~ParallelForBody() {}
+            virtual void forLoop( int Begin, int End ) const = 0;
+        };
+
+        virtual ~ITaskScheduler() {}
+        virtual const char* GetName( void ) const = 0;
+        virtual uint32_t GetNumThreads( void ) const = 0;
+        virtual void ParallelFor( int Begin, int End, int GrainSize, const ParallelForBody& Body ) = 0;
+    };
+
+    ITaskScheduler* GetSequentialTaskScheduler( void );
+    // Defined with TaskManager (TaskManager.cpp)
+    ITaskScheduler* GetTaskManagerScheduler( void );
+
+    // Only change between steps, not while the world is stepping
+    void SetTaskScheduler( ITaskScheduler* Scheduler );
+    ITaskScheduler* GetTaskScheduler( void );
+
+    // 'func' is called with sub range [Begin, End) of at most 'GrainSize' items
+    template <typename Func>
+    void ParallelFor( int Begin, int End, int GrainSize, const Func& func )
+    {
+        struct Body : public ITaskScheduler::ParallelForBody
+        {
+            Body( const Func& f ) : m_Func( f ) {}
+            void forLoop( int Begin, int End ) const override { m_Func( Begin, End ); }
+            const Func& m_Func;
+        } body( func );
+        GetTaskScheduler()->ParallelFor( Begin, End, GrainSize, body );
+    }
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 
+#include <cstring>
 #include <random>
 #pragma warning(push)
 #pragma warning(disable: 4201)
@@ -7,6 +8,7 @@
 #include <glm/gtc/random.hpp>
 #pragma warning(pop)
 #include "DeferredLighting.h"
+#include "LightCluster.h"
 #include "BufferManager.h"
 #include "CommandContext.h"
 #include "PipelineState.h"
@@ -25,6 +27,7 @@
 #include "CompiledShaders/ScreenQuadVS.h"
 #include "CompiledShaders/DeferredLightingVS.h"
 #include "CompiledShaders/DeferredLightingPS.h"
+#include "CompiledShaders/DeferredClusteredPS.h"
 #include "CompiledShaders/DeferredLightingDebugPS.h"
 
 using namespace Math;
@@ -45,14 +48,26 @@ namespace Lighting
     GraphicsPSO m_Lighting2PSO;
     GraphicsPSO m_DirectionalLightPSO;
     GraphicsPSO m_LightDebugPSO;
+    GraphicsPSO m_ClusteredPSO;
+
+    LightCluster m_LightCluster;
+    StructuredBuffer m_ClusterRangeBuffer;
+    StructuredBuffer m_ClusterIndexBuffer;
+    // CommandContext::WriteBuffer reads in 16 byte units, uploads are padded here
+    std::vector<uint32_t> m_UploadStaging;
+
     OutlinePass m_OutlinePass;
     TransparentPass m_TransparentPass;
 
     Matrix4 GetLightTransfrom( const LightData& Data, const Matrix4& ViewToProj );
     void RenderSubPass( GraphicsContext& gfxContext, LightType Type, const Matrix4& ViewToClip, GraphicsPSO& PSO );
+    void WriteInPlace( GraphicsContext& gfxContext, GpuBuffer& Dest, const void* Data, size_t NumBytes );
 }
 
 BoolVar s_bLightBoundary( "Application/Deferred/Light Boundary", false );
+// Point and spot lights in one full screen pass over per cluster light lists,
+// instead of a pass per light volume
+BoolVar s_bClusteredLighting( "Application/Deferred/Clustered Lighting", true );
 
 inline Vector3 Convert(const glm::vec3& v )
 {
@@ -169,6 +184,23 @@ void Lighting::Initialize( void )
     m_DirectionalLightPSO.SetDepthStencilState( DepthStateDisabled );
     m_DirectionalLightPSO.SetRasterizerState( RasterizerDefaultCW );
     m_DirectionalLightPSO.Finalize();
+
+    m_ClusteredPSO.SetVertexShader( MY_SHADER_ARGS( g_pScreenQuadVS ) );
+    m_ClusteredPSO.SetPixelShader( MY_SHADER_ARGS( g_pDeferredClusteredPS ) );
+    m_ClusteredPSO.SetRasterizerState( RasterizerTwoSided );
+    m_ClusteredPSO.SetBlendState( BlendAdditive );
+    m_ClusteredPSO.SetDepthStencilState( DepthStateDisabled );
+    m_ClusteredPSO.Finalize();
+
+    // 16:9 tiles of 120 pixels at 1080p
+    m_LightCluster.Create( 16, 9, 24 );
+
+    // Written in place by UpdateLights. The index list holds every light in
+    // every cluster at most
+    const uint32_t numClusters = m_LightCluster.GetClusterCount();
+    m_LightBuffer.Create( L"m_LightBuffer", MaxLights, sizeof( LightData ), m_LightData );
+    m_ClusterRangeBuffer.Create( L"Cluster Range", numClusters, sizeof( LightCluster::Range ) );
+    m_ClusterIndexBuffer.Create( L"Cluster Light Index", numClusters * MaxLights, sizeof( uint32_t ) );
 }
 
 Matrix4 Lighting::GetLightTransfrom(const LightData& Data, const Matrix4& ViewToProj)
@@ -258,10 +290,19 @@ void Lighting::Render( std::shared_ptr<Scene>& scene, RenderArgs& args )
         };
         gfxContext.SetRenderTargets( _countof( rtvs ), rtvs, g_SceneDepthBuffer.GetDSV_DepthReadOnly() );
         Matrix4 ViewToClip = args.m_ProjMatrix*args.m_ViewMatrix;
-        RenderSubPass( gfxContext, LightType::Point, ViewToClip, m_Lighting1PSO );
-        RenderSubPass( gfxContext, LightType::Spot, ViewToClip, m_Lighting1PSO );
-        RenderSubPass( gfxContext, LightType::Point, ViewToClip, m_Lighting2PSO );
-        RenderSubPass( gfxContext, LightType::Spot, ViewToClip, m_Lighting2PSO );
+        if (s_bClusteredLighting)
+        {
+            SetClusteredLights( gfxContext, uint32_t(args.m_MainViewport.Width), uint32_t(args.m_MainViewport.Height) );
+            gfxContext.SetPipelineState( m_ClusteredPSO );
+            gfxContext.Draw( 3 );
+        }
+        else
+        {
+            RenderSubPass( gfxContext, LightType::Point, ViewToClip, m_Lighting1PSO );
+            RenderSubPass( gfxContext, LightType::Spot, ViewToClip, m_Lighting1PSO );
+            RenderSubPass( gfxContext, LightType::Point, ViewToClip, m_Lighting2PSO );
+            RenderSubPass( gfxContext, LightType::Spot, ViewToClip, m_Lighting2PSO );
+        }
         RenderSubPass( gfxContext, LightType::Directional, ViewToClip, m_DirectionalLightPSO );
 
         D3D11_RTV_HANDLE nullrtvs[_countof( rtvs )] = { nullptr, };
@@ -308,6 +349,8 @@ void Lighting::Render( std::shared_ptr<Scene>& scene, RenderArgs& args )
 void Lighting::Shutdown( void )
 {
     m_LightBuffer.Destroy();
+    m_ClusterRangeBuffer.Destroy();
+    m_ClusterIndexBuffer.Destroy();
 
     m_DiffuseTexture.Destroy();
     m_SpecularTexture.Destroy();
@@ -315,7 +358,29 @@ void Lighting::Shutdown( void )
     m_SpecularPowerTexture.Destroy();
 }
 
-void Lighting::UpdateLights( const BaseCamera& C )
+void Lighting::WriteInPlace( GraphicsContext& gfxContext, GpuBuffer& Dest, const void* Data, size_t NumBytes )
+{
+    if (NumBytes == 0)
+        return;
+    ASSERT( NumBytes <= Dest.GetBufferSize() );
+    m_UploadStaging.resize( Math::DivideByMultiple( NumBytes, 16 ) * 4 );
+    std::memcpy( m_UploadStaging.data(), Data, NumBytes );
+    gfxContext.WriteBuffer( Dest, 0, m_UploadStaging.data(), NumBytes );
+}
+
+void Lighting::SetClusteredLights( GraphicsContext& gfxContext, uint32_t Width, uint32_t Height )
+{
+    __declspec(align(16)) ClusterConstants constants = m_LightCluster.GetConstants( Width, Height );
+    gfxContext.SetDynamicConstantBufferView( 7, sizeof( constants ), &constants, { kBindPixel } );
+    D3D11_SRV_HANDLE srvs[] = {
+        m_LightBuffer.GetSRV(),
+        m_ClusterRangeBuffer.GetSRV(),
+        m_ClusterIndexBuffer.GetSRV(),
+    };
+    gfxContext.SetDynamicDescriptors( 66, _countof( srvs ), srvs, { kBindPixel } );
+}
+
+void Lighting::UpdateLights( GraphicsContext& gfxContext, const BaseCamera& C )
 {
     const Matrix4& View = C.GetViewMatrix();
     for (uint32_t n = 0; n < MaxLights; n++)
@@ -324,5 +389,26 @@ void Lighting::UpdateLights( const BaseCamera& C )
         light.PositionVS = View * light.PositionWS;
         light.DirectionVS = View.Get3x3() * light.DirectionWS;
     }
-    m_LightBuffer.Create(L"m_LightBuffer", MaxLights, sizeof(LightData), m_LightData);
+    gfxContext.WriteBuffer( m_LightBuffer, 0, m_LightData, sizeof( m_LightData ) );
+
+    ClusterLight bounds[MaxLights];
+    for (uint32_t n = 0; n < MaxLights; n++)
+    {
+        const auto& light = m_LightData[n];
+        if (light.Type == LightType::Point)
+        {
+            XMStoreFloat3( &bounds[n].CenterVS, Vector3( light.PositionVS ) );
+            bounds[n].Radius = light.Range;
+        }
+        else if (light.Type == LightType::Spot)
+            bounds[n] = LightCluster::BoundSpot( Vector3( light.PositionVS ), light.DirectionVS, light.Range, light.SpotlightAngle );
+        else
+            bounds[n] = { XMFLOAT3( 0.f, 0.f, 0.f ), 0.f };
+    }
+    m_LightCluster.Build( C.GetProjMatrix(), C.GetNearClip(), C.GetFarClip(), bounds, MaxLights );
+
+    const auto& range = m_LightCluster.GetClusterRange();
+    const auto& index = m_LightCluster.GetLightIndex();
+    WriteInPlace( gfxContext, m_ClusterRangeBuffer, range.data(), range.size() * sizeof( LightCluster::Range ) );
+    WriteInPlace( gfxContext, m_ClusterIndexBuffer, index.data(), index.size() * sizeof( uint32_t ) );
 }
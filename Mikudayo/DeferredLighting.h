@@ -41,5 +41,8 @@ namespace Lighting
     void Initialize( void );
     void Render( std::shared_ptr<Scene>& scene, RenderArgs& args );
     void Shutdown( void );
-    void UpdateLights( const Math::BaseCamera& C );
+    // View space lights and their clusters of camera 'C', uploaded in place
+    void UpdateLights( GraphicsContext& gfxContext, const Math::BaseCamera& C );
+    // Binds the lights and clusters for pixel shaders, see ClusteredLighting.hlsli
+    void SetClusteredLights( GraphicsContext& gfxContext, uint32_t Width, uint32_t Height );
 }
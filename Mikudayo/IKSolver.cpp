@@ -0,0 +1,248 @@
+#include "stdafx.h"
+#include "IKSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Animation;
+using namespace Math;
+
+namespace {
+	// Goal distance which stops the iteration
+	const float kTolerance = 1.0e-4f;
+
+	//
+	// Needed to stable IK result (esp. Ankle)
+	// The value obtained from the test
+	//
+	const float kMinKneeRotX = 0.10f;
+}
+
+void IKAttr::BuildChain( const std::vector<int32_t>& Parent )
+{
+	Chain.clear();
+	ChainParent.clear();
+	LinkChain.clear();
+	bTwoBone = false;
+
+	const int32_t numBones = static_cast<int32_t>(Parent.size());
+	auto IsValid = [numBones]( int32_t i ) { return i >= 0 && i < numBones; };
+	if (!IsValid( BoneIndex ) || !IsValid( TargetBoneIndex ) || Link.empty())
+		return;
+	for (auto& link : Link)
+		if (!IsValid( link.BoneIndex ))
+			return;
+
+	// Walk up from effector until every link is passed
+	std::vector<int32_t> path;
+	size_t numFound = 0;
+	for (int32_t b = TargetBoneIndex; b >= 0 && numFound < Link.size(); b = Parent[b])
+	{
+		if (path.size() > size_t(numBones))
+			return;
+		path.push_back( b );
+		for (auto& link : Link)
+			numFound += (link.BoneIndex == b);
+	}
+	// A link outside of effector's ancestors, use reference solver
+	if (numFound < Link.size())
+		return;
+
+	Chain.assign( path.rbegin(), path.rend() );
+	for (auto b : Chain)
+		ChainParent.push_back( Parent[b] );
+	for (auto& link : Link)
+	{
+		auto it = std::find( Chain.begin(), Chain.end(), link.BoneIndex );
+		LinkChain.push_back( static_cast<uint32_t>(std::distance( Chain.begin(), it )) );
+	}
+
+	bTwoBone = Link.size() == 2 && Link[0].bLimit && !Link[1].bLimit && Chain.size() == 3 &&
+		Chain[0] == Link[1].BoneIndex && Chain[1] == Link[0].BoneIndex;
+}
+
+IKSolver::IKSolver( std::vector<OrthogonalTransform>& LocalPose, std::vector<OrthogonalTransform>& Pose,
+	const SubtreeUpdate& UpdateSubtree ) :
+	m_LocalPose( LocalPose ), m_Pose( Pose ), m_UpdateSubtree( UpdateSubtree )
+{
+}
+
+Vector3 IKSolver::GetPosition( int32_t i ) const
+{
+	return Vector3( m_Pose[i].GetTranslation() );
+}
+
+void IKSolver::Solve( const IKAttr& ik )
+{
+	if (ik.Chain.empty())
+	{
+		SolveReference( ik );
+		return;
+	}
+	if (ik.bTwoBone && ik.NumIteration > 0 && SolveTwoBone( ik ))
+		return;
+	SolveCCD( ik, true );
+}
+
+void IKSolver::SolveReference( const IKAttr& ik )
+{
+	SolveCCD( ik, false );
+}
+
+void IKSolver::UpdateChain( const IKAttr& ik, size_t k )
+{
+	for (size_t j = ik.LinkChain[k]; j < ik.Chain.size(); j++)
+	{
+		const int32_t b = ik.Chain[j], p = ik.ChainParent[j];
+		m_Pose[b] = p >= 0 ? m_Pose[p] * m_LocalPose[b] : m_LocalPose[b];
+	}
+}
+
+//
+// Knee is a hinge on local X axis bounded as CCD does, thigh swings freely.
+// Solve knee angle from the goal distance, turning the animated knee about
+// its own X axis, then rotate thigh toward the goal.
+//
+bool IKSolver::SolveTwoBone( const IKAttr& ik )
+{
+	const int32_t knee = ik.Link[0].BoneIndex;
+	const int32_t hip = ik.Link[1].BoneIndex;
+	const int32_t ankle = ik.TargetBoneIndex;
+
+	// Work in thigh frame, |t + rotBase * Rx(delta) * c| = |goal|
+	const Vector3 goal = (~m_Pose[hip]) * GetPosition( ik.BoneIndex );
+	const Vector3 t = m_LocalPose[knee].GetTranslation();
+	const Vector3 c = m_LocalPose[ankle].GetTranslation();
+	const Quaternion rotBase = m_LocalPose[knee].GetRotation();
+
+	// Ankle turns about the hinge axis, split into the part along it and two across
+	const Vector3 axis = rotBase * Vector3( 1.0f, 0.f, 0.f );
+	const Vector3 rest = rotBase * c;
+	const Vector3 along = axis * Dot( axis, rest );
+	const Vector3 u = rest - along;
+	const Vector3 v = Cross( axis, u );
+
+	// A * cos(delta) + B * sin(delta) = K
+	const float A = float(Dot( t, u ));
+	const float B = float(Dot( t, v ));
+	const float K = 0.5f * (float(LengthSquare( goal )) - float(LengthSquare( t )) - float(LengthSquare( c ))) - float(Dot( t, along ));
+	const float R = std::sqrt( A*A + B*B );
+	if (R < FLT_EPSILON)
+		return false;
+
+	// Summed X angle is clamped, as CCD does
+	const float baseX = float(rotBase.Euler().GetX());
+	auto Residual = [&]( float delta ) { return std::fabs( A*std::cos( delta ) + B*std::sin( delta ) - K ); };
+	auto Bound = [&]( float delta ) {
+		const float sum = std::remainder( baseX + delta, XM_2PI );
+		return std::min( std::max( sum, kMinKneeRotX ), XM_PI ) - baseX;
+	};
+	const float phi = std::atan2( B, A );
+	const float alpha = std::acos( std::min( std::max( K / R, -1.f ), 1.f ) );
+	const float delta0 = Bound( phi + alpha ), delta1 = Bound( phi - alpha );
+	const float delta = Residual( delta0 ) <= Residual( delta1 ) ? delta0 : delta1;
+
+	const Quaternion kneeRotation = Normalize( rotBase * Quaternion( Vector3( 1.0f, 0.f, 0.f ), delta ) );
+	m_LocalPose[knee].SetRotation( kneeRotation );
+
+	const Vector3 from = t + kneeRotation * c;
+	if (LengthSquare( from ) > FLT_EPSILON && LengthSquare( goal ) > FLT_EPSILON)
+	{
+		const Quaternion swing = RotationBetweenVectors( from, goal );
+		m_LocalPose[hip].SetRotation( Normalize( m_LocalPose[hip].GetRotation() * swing ) );
+	}
+	m_UpdateSubtree( hip );
+	return true;
+}
+
+//
+// Solve Constrainted IK
+// Cyclic-Coordinate-Descent（CCD）
+//
+// http://d.hatena.ne.jp/edvakf/20111102/1320268602
+//
+void IKSolver::SolveCCD( const IKAttr& ik, bool bChainLocal )
+{
+	// "effector" (Fixed)
+	const auto ikBonePos = GetPosition( ik.BoneIndex );
+
+	bool bConverged = false;
+	for (int n = 0; n < ik.NumIteration && !bConverged; n++)
+	{
+		if (bChainLocal && Length( ikBonePos - GetPosition( ik.TargetBoneIndex ) ) < kTolerance)
+			break;
+
+		// "effected" bone listed in order
+		for (auto k = 0; k < ik.Link.size(); k++)
+		{
+			// TargetVector (link-target) is updated in each iteration
+			// toward IkVector (link-ik)
+			const auto ikTargetBonePos = GetPosition( ik.TargetBoneIndex );
+
+			if (Length( ikBonePos - ikTargetBonePos ) < FLT_EPSILON)
+			{
+				bConverged = true;
+				break;
+			}
+
+			auto linkIndex = ik.Link[k].BoneIndex;
+			auto invLinkMtx = ~m_Pose[linkIndex];
+
+			// transform to child bone's local coordinate.
+			auto ikTargetVec = Vector3( invLinkMtx * ikTargetBonePos );
+			auto ikBoneVec = Vector3( invLinkMtx * ikBonePos );
+
+			auto axis = Cross( ikBoneVec, ikTargetVec );
+			auto axisLen = Length( axis );
+			auto sinTheta = axisLen / Length( ikTargetVec ) / Length( ikBoneVec );
+			if (sinTheta < 1.0e-5f)
+				continue;
+
+			// move angles in one iteration
+			auto maxAngle = (k + 1) * ik.LimitedRadian * 4;
+			auto theta = ASin( sinTheta );
+			if (Dot( ikTargetVec, ikBoneVec ) < 0.f)
+				theta = XM_PI - theta;
+			if (theta > maxAngle)
+				theta = maxAngle;
+
+			auto rotBase = m_LocalPose[linkIndex].GetRotation();
+			auto translate = m_LocalPose[linkIndex].GetTranslation();
+
+			// To apply base coordinate system which it is base on, inverted theta direction
+			Quaternion rotNext( axis, -theta );
+			auto rotFinish = rotBase * rotNext;
+
+			// Constraint IK, restrict rotation angle
+			if (ik.Link[k].bLimit)
+			{
+				// Use code from 'MMD-Agent'
+				// when this is the first iteration, we force rotating to the maximum angle toward limited direction
+				// this will help convergence the whole IK step earlier for most of models, especially for legs
+				if (n == 0)
+				{
+					if (theta < 0.0f)
+						theta = -theta;
+					rotFinish = rotBase * Quaternion( Vector3( 1.0f, 0.f, 0.f ), theta );
+				}
+				else
+				{
+					const Scalar PMDMinRotX = kMinKneeRotX;
+					auto next = rotNext.Euler();
+					auto base = rotBase.Euler();
+
+					auto sum = Clamp( next.GetX() + base.GetX(), PMDMinRotX, Scalar(XM_PI) );
+					next = Vector3( sum - base.GetX(), 0.f, 0.f );
+					rotFinish = rotBase * Quaternion( next.GetX(), next.GetY(), next.GetZ() );
+				}
+			}
+			m_LocalPose[linkIndex] = OrthogonalTransform( rotFinish, translate );
+			if (bChainLocal)
+				UpdateChain( ik, k );
+			else
+				m_UpdateSubtree( linkIndex );
+		}
+	}
+	if (bChainLocal)
+		m_UpdateSubtree( ik.Chain.front() );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include "VectorMath.h"
+
+namespace Animation
+{
+	using namespace Math;
+
+	struct IKChild
+	{
+		int32_t BoneIndex;
+		uint8_t bLimit;
+		XMFLOAT3 MinLimit;
+		XMFLOAT3 MaxLimit;
+	};
+
+	struct IKAttr
+	{
+		int32_t BoneIndex; // goal
+		int32_t TargetBoneIndex; // effector
+		int32_t NumIteration;
+		float LimitedRadian;
+		std::vector<IKChild> Link; // from effector side
+
+		// Derived by BuildChain. Bones from the top link down to the effector
+		std::vector<int32_t> Chain;
+		std::vector<int32_t> ChainParent;
+		std::vector<uint32_t> LinkChain; // Link[k] to position in Chain
+		bool bTwoBone = false; // hinge (knee) and ball (thigh) joint
+
+		void BuildChain( const std::vector<int32_t>& Parent );
+	};
+
+	//
+	// Solves IK over a skeleton pose. CCD only updates the chain between the
+	// links and the effector while iterating, and propagates the subtree once
+	// at the end. Knee and thigh pair is solved analytically.
+	//
+	class IKSolver
+	{
+	public:
+		using SubtreeUpdate = std::function<void( int32_t )>;
+
+		IKSolver( std::vector<OrthogonalTransform>& LocalPose, std::vector<OrthogonalTransform>& Pose,
+			const SubtreeUpdate& UpdateSubtree );
+
+		void Solve( const IKAttr& ik );
+		// Reference CCD, updates whole subtree of a link after each rotation
+		void SolveReference( const IKAttr& ik );
+
+	private:
+		Vector3 GetPosition( int32_t i ) const;
+		bool SolveTwoBone( const IKAttr& ik );
+		void SolveCCD( const IKAttr& ik, bool bChainLocal );
+		void UpdateChain( const IKAttr& ik, size_t k );
+
+		std::vector<OrthogonalTransform>& m_LocalPose;
+		std::vector<OrthogonalTransform>& m_Pose;
+		SubtreeUpdate m_UpdateSubtree;
+	};
+}
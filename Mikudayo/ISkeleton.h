@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+class btTransform;
+
+namespace Math
+{
+    class OrthogonalTransform;
+}
+
+//
+// Bone poses a rigid body follows and writes back to, in world space
+//
+class ISkeleton
+{
+public:
+    virtual ~ISkeleton() {}
+    virtual const Math::OrthogonalTransform GetTransform( int32_t i ) const = 0;
+    virtual void SetTransform( int32_t i, const Math::OrthogonalTransform& transform ) = 0;
+    // Pose of bone 'i' from its parent and its local transform
+    virtual void UpdateLocalTransform( int32_t i ) = 0;
+};
+
+class BoneRef
+{
+public:
+
+    BoneRef() {}
+    BoneRef( ISkeleton* inst, int32_t i );
+
+    const Math::OrthogonalTransform GetTransform() const;
+    void SetTransform( const Math::OrthogonalTransform& transform );
+    void SetTransform( const btTransform& trnasform );
+    void UpdateLocalTransform();
+
+    int32_t m_Index = 0; // valid check needed (-1)
+    ISkeleton* m_Instance = nullptr;
+};
@@ -4,31 +4,67 @@
 using namespace Animation;
 using namespace Math;
 
-template <typename T>
-int32_t FindPreviousFrameIndex( const std::vector<T>& frames, const float t )
-{
-	if (frames.size() <= 0)
-		return -1;
+namespace {
+	template <typename FrameAt>
+	int32_t FindPreviousFrameIndex( int32_t numFrames, const FrameAt& frameAt, const float t )
+	{
+		if (numFrames <= 0)
+			return -1;
+
+		int32_t low = 0, hi = numFrames - 1;
+		while (low < hi)
+		{
+			auto mid = low + (hi - low + 1) / 2;
+			if (frameAt( mid ) >= t)
+				hi = mid - 1;
+			else
+				low = mid;
+		}
+
+		if (frameAt( low ) >= t)
+			return -1;
+		return low;
+	}
 
-	int32_t low = 0, hi = (int32_t)frames.size();
-	while (low < hi)
+	//
+	// Playback mostly moves forward less than one key frame. So, check cached index
+	// and a few following ones before falling back to binary search (seek)
+	//
+	template <typename FrameAt>
+	int32_t FindPreviousFrameIndex( int32_t numFrames, const FrameAt& frameAt, const float t, KeyFrameCursor& cursor )
 	{
-		auto mid = low + (hi - low + 1) / 2;
-		if (frames[mid].Frame >= t)
-			hi = mid - 1;
-		else
-			low = mid;
+		const int32_t kMaxForwardStep = 4;
+
+		auto IsPrevious = [&]( int32_t i ) {
+			if (i >= 0 && frameAt( i ) >= t)
+				return false;
+			return i + 1 >= numFrames || frameAt( i+1 ) >= t;
+		};
+
+		int32_t index = cursor.Index;
+		if (index >= -1 && index < numFrames)
+		{
+			for (int32_t k = 0; k <= kMaxForwardStep && index < numFrames; k++, index++)
+			{
+				if (index >= 0 && frameAt( index ) >= t)
+					break; // moved backward
+				if (IsPrevious( index ))
+					return cursor.Index = index;
+			}
+		}
+		return cursor.Index = FindPreviousFrameIndex( numFrames, frameAt, t );
 	}
+}
 
-	if (frames[low].Frame >= t)
-		return -1;
-	return low;
+int32_t Animation::FindPreviousFrameIndex( const int32_t* frames, int32_t numFrames, float t, KeyFrameCursor& cursor )
+{
+	return ::FindPreviousFrameIndex( numFrames, [frames]( int32_t i ) { return frames[i]; }, t, cursor );
 }
 
 //
 // http://d.hatena.ne.jp/edvakf/20111016/1318716097
 //
-// TODO: apply partial cache, optimize (https://github.com/gre/bezier-easing/blob/master/src/index.js)
+// Reference implementation. Runtime interpolation uses baked 'BezierCurve'
 //
 float Animation::Bezier( Vector4 C, float p )
 {
@@ -53,109 +89,112 @@ float Animation::Bezier( Vector4 C, float p )
 	return 3 * s*s*t*y1 + 3 * s*t*t*y2 + t*t*t;
 }
 
-const BoneKeyFrame& ZeroFrame()
-{
-	static BoneKeyFrame zero;
-	zero.Frame = 0;
-	zero.Local = OrthogonalTransform( kIdentity );
-
-	// linear
-	for (uint8_t k = 0; k < 4; k++)
-		zero.BezierCoeff[k] = Vector4( 0.15748f, 0.1574f, 0.8425f, 0.8425f );
-	return zero;
-}
+namespace {
+	const int kNewtonIterations = 4;
+	const float kNewtonMinSlope = 0.001f;
+	const float kSubdivisionPrecision = 1e-7f;
+	// Sample interval is 0.1, so 12 steps are more precise than 15 steps of 'Bezier'
+	const int kSubdivisionMaxIterations = 12;
 
-void BoneMotion::InsertKeyFrame( const BoneKeyFrame& frame )
-{
-	m_KeyFrames.push_back( frame );
-}
+	inline float CoeffA( float a1, float a2 ) { return 1.0f - 3.0f*a2 + 3.0f*a1; }
+	inline float CoeffB( float a1, float a2 ) { return 3.0f*a2 - 6.0f*a1; }
+	inline float CoeffC( float a1 ) { return 3.0f*a1; }
 
-void BoneMotion::SortKeyFrame()
-{
-	std::sort( m_KeyFrames.begin(), m_KeyFrames.end(), [](const auto& a, const auto& b) {
-		return a.Frame < b.Frame;
-	});
-}
-
-void BoneMotion::Interpolate( float t, OrthogonalTransform& local )
-{
-	if (m_KeyFrames.size() == 0)
-		return;
-
-	auto& first = m_KeyFrames.front();
-	auto& last = m_KeyFrames.back();
-
-	if (t <= first.Frame)
+	// x(t) or y(t) given control points (0, a1, a2, 1)
+	inline float CalcBezier( float t, float a1, float a2 )
 	{
-		local = first.Local;
+		return ((CoeffA( a1, a2 )*t + CoeffB( a1, a2 ))*t + CoeffC( a1 ))*t;
 	}
-	else if (t >= last.Frame)
-	{
-		local = last.Local;
-	}
-	else
-	{
-		// VMD provide 0 frame. So, negative value check is not nesseary.
-		int32_t prev = FindPreviousFrameIndex( m_KeyFrames, t );
-		auto& a = (prev < 0) ? ZeroFrame() : m_KeyFrames[prev];
-		auto& b = m_KeyFrames[prev + 1];
 
-		float p = 1.f;
-		if (b.Frame - a.Frame > 0)
-			p = (t - a.Frame) / (b.Frame - a.Frame);
-
-		float c[kInterpR+1];
-		for (uint8_t k = kInterpX; k <= kInterpR; k++)
-			c[k] = Bezier( a.BezierCoeff[k], p );
-
-		local.SetTranslation( Lerp( a.Local.GetTranslation(), b.Local.GetTranslation(), Vector3( c[kInterpX], c[kInterpY], c[kInterpZ] ) ) );
-		local.SetRotation( Slerp( a.Local.GetRotation(), b.Local.GetRotation(), c[kInterpR] ) );
+	inline float GetSlope( float t, float a1, float a2 )
+	{
+		return 3.0f*CoeffA( a1, a2 )*t*t + 2.0f*CoeffB( a1, a2 )*t + CoeffC( a1 );
 	}
 }
 
-void MorphMotion::Interpolate( float t )
+BezierCurve::BezierCurve() : m_bLinear( true ), m_X1( 0.f ), m_Y1( 0.f ), m_X2( 1.f ), m_Y2( 1.f )
 {
-	if (m_KeyFrames.size() == 0)
-		return;
+	for (int i = 0; i < kSampleSize; i++)
+		m_Sample[i] = float(i) / (kSampleSize - 1);
+}
 
-	m_WeightPre = m_Weight;
+BezierCurve::BezierCurve( Vector4 C )
+{
+	XMFLOAT4 coeff;
+	XMStoreFloat4( &coeff, C );
 
-	auto& first = m_KeyFrames.front();
-	auto& last = m_KeyFrames.back();
+	m_X1 = coeff.x, m_Y1 = coeff.y, m_X2 = coeff.z, m_Y2 = coeff.w;
+	m_bLinear = (m_X1 == m_Y1 && m_X2 == m_Y2);
 
-	if (t <= first.Frame)
-		m_Weight = first.Weight;
-	else if (t >= last.Frame)
-		m_Weight = last.Weight;
-	else
-	{
-		auto prev = FindPreviousFrameIndex( m_KeyFrames, t );
-		auto &a = m_KeyFrames[prev], &b = m_KeyFrames[prev+1];
-		float p = 1.0f;
-		if (b.Frame - a.Frame > 0)
-			p = (t - a.Frame) / (b.Frame - a.Frame);
-		m_Weight = a.Weight * (1.0f - p) + b.Weight * p;
-	}
+	const float step = 1.0f / (kSampleSize - 1);
+	for (int i = 0; i < kSampleSize; i++)
+		m_Sample[i] = CalcBezier( i*step, m_X1, m_X2 );
 }
 
-MorphMotion::MorphMotion() : m_Weight( 0.f ), m_WeightPre( 0.f )
+float BezierCurve::SolveT( float x ) const
 {
-}
+	const float step = 1.0f / (kSampleSize - 1);
+
+	// Find interval where x lies
+	float start = 0.0f;
+	int k = 1;
+	for (; k != kSampleSize - 1 && m_Sample[k] <= x; k++)
+		start += step;
+	k--;
+
+	// Interpolate to provide an initial guess for t
+	float range = m_Sample[k+1] - m_Sample[k];
+	float guess = start;
+	if (range > 0.f)
+		guess += (x - m_Sample[k]) / range * step;
+
+	float slope = GetSlope( guess, m_X1, m_X2 );
+	if (slope >= kNewtonMinSlope)
+	{
+		for (int i = 0; i < kNewtonIterations; i++)
+		{
+			float currentSlope = GetSlope( guess, m_X1, m_X2 );
+			if (currentSlope == 0.0f)
+				break;
+			guess -= (CalcBezier( guess, m_X1, m_X2 ) - x) / currentSlope;
+		}
+		return guess;
+	}
+	if (slope == 0.0f)
+		return guess;
 
-void MorphMotion::InsertKeyFrame( const MorphKeyFrame& frame )
-{
-	m_KeyFrames.push_back( frame );
+	float low = start, high = start + step, t = guess;
+	for (int i = 0; i < kSubdivisionMaxIterations; i++)
+	{
+		t = (low + high) / 2;
+		float diff = CalcBezier( t, m_X1, m_X2 ) - x;
+		if (std::fabs( diff ) <= kSubdivisionPrecision)
+			break;
+		if (diff > 0.0f)
+			high = t;
+		else
+			low = t;
+	}
+	return t;
 }
 
-void MorphMotion::SortKeyFrame()
+float BezierCurve::Evaluate( float p ) const
 {
-	std::sort( m_KeyFrames.begin(), m_KeyFrames.end(),
-		[]( auto& a, auto& b ) { return a.Frame < b.Frame; } );
+	if (m_bLinear)
+		return p;
+	if (p <= 0.0f)
+		return 0.0f;
+	if (p >= 1.0f)
+		return 1.0f;
+	return CalcBezier( SolveT( p ), m_Y1, m_Y2 );
 }
 
 void CameraMotion::InsertKeyFrame( const CameraKeyFrame& frame )
 {
 	m_KeyFrames.push_back( frame );
+	auto& key = m_KeyFrames.back();
+	for (uint8_t k = kInterpX; k <= kInterpA; k++)
+		key.Curve[k] = BezierCurve( key.BezierCoeff[k] );
 }
 
 void CameraMotion::SortKeyFrame()
@@ -165,7 +204,7 @@ void CameraMotion::SortKeyFrame()
 	});
 }
 
-CameraFrame CameraMotion::Interpolate( float t )
+CameraFrame CameraMotion::Interpolate( float t, KeyFrameCursor& cursor ) const
 {
 	if (m_KeyFrames.size() <= 0)
 		return CameraFrame::Default();
@@ -185,7 +224,8 @@ CameraFrame CameraMotion::Interpolate( float t )
 	else
 	{
 		// VMD provide 0 frame. So, below zero check code is not nesseary.
-		int32_t prev = FindPreviousFrameIndex( m_KeyFrames, t );
+		auto frameAt = [this]( int32_t i ) { return m_KeyFrames[i].Frame; };
+		int32_t prev = ::FindPreviousFrameIndex( int32_t(m_KeyFrames.size()), frameAt, t, cursor );
 		ASSERT( prev >= 0 );
 		auto& a = m_KeyFrames[prev];
 		auto& b = m_KeyFrames[prev + 1];
@@ -198,7 +238,7 @@ CameraFrame CameraMotion::Interpolate( float t )
 
 		float c[kInterpA+1];
 		for (uint8_t k = kInterpX; k <= kInterpA; k++)
-			c[k] = Bezier( a.BezierCoeff[k], p );
+			c[k] = a.Curve[k].Evaluate( p );
 
 		Data.Position = Lerp( a.Data.Position, b.Data.Position, Vector3( c[kInterpX], c[kInterpY], c[kInterpZ] ) );
 		Data.Rotation = Slerp( a.Data.Rotation, b.Data.Rotation, c[kInterpR] );
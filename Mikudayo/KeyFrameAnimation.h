@@ -13,46 +13,42 @@ namespace Animation
 
 	float Bezier( Vector4 C, float p );
 
-	struct BoneKeyFrame
-	{
-		int Frame;
-		OrthogonalTransform Local;
-		Vector4 BezierCoeff[kInterpR+1];
-	};
-
-	class BoneMotion
+	//
+	// Bezier curve which is baked once when motion is loaded.
+	// Pre-sampled table gives initial guess of Newton-Raphson (bisection fallback)
+	//
+	// https://github.com/gre/bezier-easing/blob/master/src/index.js
+	//
+	class BezierCurve
 	{
 	public:
-		std::vector<BoneKeyFrame> m_KeyFrames;
+		static const int kSampleSize = 11;
 
-		void InsertKeyFrame( const BoneKeyFrame& frame );
-		void SortKeyFrame();
-		void Interpolate( float t, OrthogonalTransform& local );
-	};
+		BezierCurve();
+		BezierCurve( Vector4 C );
 
-	struct MorphKeyFrame
-	{
-		int32_t Frame;
-		float Weight;
+		float Evaluate( float p ) const;
+
+	private:
+		float SolveT( float x ) const;
+
+		bool m_bLinear;
+		float m_X1, m_Y1, m_X2, m_Y2;
+		float m_Sample[kSampleSize];
 	};
 
-	class MorphMotion
+	//
+	// Playback cursor which caches last found key frame index.
+	// Kept outside of the motion, so one motion can be shared by many instances.
+	//
+	struct KeyFrameCursor
 	{
-	public:
-		std::wstring m_Name;
-        std::wstring m_NameEnglish;
-		std::vector<MorphKeyFrame> m_KeyFrames;
-		std::vector<uint32_t> m_MorphIndices;
-		std::vector<Vector3> m_MorphVertices;
-
-		MorphMotion();
-		void InsertKeyFrame( const MorphKeyFrame& frame );
-		void SortKeyFrame();
-
-		float m_Weight, m_WeightPre;
-		void Interpolate( float t );
+		int32_t Index = -1;
 	};
 
+	// Find last key frame index whose frame is less than 't' (-1 if none)
+	int32_t FindPreviousFrameIndex( const int32_t* frames, int32_t numFrames, float t, KeyFrameCursor& cursor );
+
 	struct CameraFrame
 	{
 		static CameraFrame Default();
@@ -69,6 +65,7 @@ namespace Animation
 		int Frame;
 		CameraFrame Data;
 		Vector4 BezierCoeff[kInterpA+1];
+		BezierCurve Curve[kInterpA+1]; // baked from 'BezierCoeff' in InsertKeyFrame
 	};
 
 	class CameraMotion
@@ -78,6 +75,6 @@ namespace Animation
 
 		void InsertKeyFrame( const CameraKeyFrame& frame );
 		void SortKeyFrame();
-		CameraFrame Interpolate( float t );
+		CameraFrame Interpolate( float t, KeyFrameCursor& cursor ) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "stdafx.h"
+#include "LightCluster.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Math;
+
+namespace Lighting
+{
+    void LightCluster::Create( uint32_t TileCountX, uint32_t TileCountY, uint32_t SliceCount )
+    {
+        ASSERT( TileCountX > 0 && TileCountY > 0 && SliceCount > 0 );
+        m_TileCount[0] = TileCountX;
+        m_TileCount[1] = TileCountY;
+        m_SliceCount = SliceCount;
+        m_ScaleX = m_ScaleY = 0.f; // boxes are made again by the next build
+        m_ClusterRange.assign( GetClusterCount(), { 0, 0 } );
+        m_LightIndex.clear();
+    }
+
+    float LightCluster::GetSliceDepth( uint32_t Slice ) const
+    {
+        return m_NearZ * std::pow( m_FarZ / m_NearZ, float(Slice) / m_SliceCount );
+    }
+
+    uint32_t LightCluster::GetSlice( float Depth ) const
+    {
+        if (Depth <= m_NearZ)
+            return 0;
+        const float slice = std::log( Depth / m_NearZ ) / std::log( m_FarZ / m_NearZ ) * m_SliceCount;
+        return std::min( uint32_t(slice), m_SliceCount - 1 );
+    }
+
+    // Froxel corners are tile edges in NDC scaled by the depth of the slice planes
+    void LightCluster::UpdateBoxes( float ScaleX, float ScaleY, float NearZ, float FarZ )
+    {
+        if (ScaleX == m_ScaleX && ScaleY == m_ScaleY && NearZ == m_NearZ && FarZ == m_FarZ)
+            return;
+        m_ScaleX = ScaleX;
+        m_ScaleY = ScaleY;
+        m_NearZ = NearZ;
+        m_FarZ = FarZ;
+
+        const uint32_t numClusters = GetClusterCount();
+        m_BoxMin.resize( numClusters );
+        m_BoxMax.resize( numClusters );
+        for (uint32_t z = 0; z < m_SliceCount; z++)
+        {
+            const float d0 = GetSliceDepth( z ), d1 = GetSliceDepth( z + 1 );
+            for (uint32_t y = 0; y < m_TileCount[1]; y++)
+            {
+                // Tile rows go down the screen
+                const float y0 = 1.f - 2.f * (y + 1) / m_TileCount[1], y1 = 1.f - 2.f * y / m_TileCount[1];
+                const float minY = std::min( y0 * d0, y0 * d1 ) / ScaleY, maxY = std::max( y1 * d0, y1 * d1 ) / ScaleY;
+                for (uint32_t x = 0; x < m_TileCount[0]; x++)
+                {
+                    const float x0 = -1.f + 2.f * x / m_TileCount[0], x1 = -1.f + 2.f * (x + 1) / m_TileCount[0];
+                    const float minX = std::min( x0 * d0, x0 * d1 ) / ScaleX, maxX = std::max( x1 * d0, x1 * d1 ) / ScaleX;
+                    const uint32_t index = GetClusterIndex( x, y, z );
+                    m_BoxMin[index] = XMFLOAT4( minX, minY, -d1, 0.f );
+                    m_BoxMax[index] = XMFLOAT4( maxX, maxY, -d0, 0.f );
+                }
+            }
+        }
+    }
+
+    //
+    // Counted, offset then filled light by light, so each list keeps the
+    // order of the lights and the result does not depend on timing
+    //
+    void LightCluster::Build( const Matrix4& Proj, float NearZ, float FarZ, const ClusterLight* Lights, uint32_t NumLights )
+    {
+        ASSERT( NearZ > 0.f && FarZ > NearZ );
+        UpdateBoxes( Proj.GetX().GetX(), Proj.GetY().GetY(), NearZ, FarZ );
+
+        const uint32_t numClusters = GetClusterCount();
+        m_ClusterRange.assign( numClusters, { 0, 0 } );
+        m_Hits.clear();
+        m_HitOffset.resize( NumLights + 1 );
+
+        const float tilesX = float(m_TileCount[0]), tilesY = float(m_TileCount[1]);
+        auto Tile = []( float t, float count ) {
+            return uint32_t(std::min( std::max( t * count, 0.f ), count - 1.f ));
+        };
+        for (uint32_t i = 0; i < NumLights; i++)
+        {
+            m_HitOffset[i] = uint32_t(m_Hits.size());
+            const ClusterLight& light = Lights[i];
+            const float r = light.Radius;
+            const XMFLOAT3& c = light.CenterVS;
+            if (r <= 0.f)
+                continue;
+            // Part of the view box of the sphere between near and far
+            const float d0 = std::max( -c.z - r, NearZ ), d1 = std::min( -c.z + r, FarZ );
+            if (d0 > d1)
+                continue;
+
+            // Conservative NDC range, the nearer depth widens the side away from the axis
+            const float x0 = c.x - r, x1 = c.x + r, y0 = c.y - r, y1 = c.y + r;
+            const float minX = m_ScaleX * x0 / (x0 < 0.f ? d0 : d1), maxX = m_ScaleX * x1 / (x1 > 0.f ? d0 : d1);
+            const float minY = m_ScaleY * y0 / (y0 < 0.f ? d0 : d1), maxY = m_ScaleY * y1 / (y1 > 0.f ? d0 : d1);
+            if (minX > 1.f || maxX < -1.f || minY > 1.f || maxY < -1.f)
+                continue;
+            const uint32_t tx0 = Tile( (minX + 1.f) * 0.5f, tilesX ), tx1 = Tile( (maxX + 1.f) * 0.5f, tilesX );
+            const uint32_t ty0 = Tile( (1.f - maxY) * 0.5f, tilesY ), ty1 = Tile( (1.f - minY) * 0.5f, tilesY );
+            const uint32_t tz0 = GetSlice( d0 ), tz1 = GetSlice( d1 );
+
+            const XMVECTOR center = XMVectorSet( c.x, c.y, c.z, 0.f );
+            const XMVECTOR radiusSq = XMVectorReplicate( r * r );
+            const XMVECTOR zero = XMVectorZero();
+            for (uint32_t z = tz0; z <= tz1; z++)
+            {
+                for (uint32_t y = ty0; y <= ty1; y++)
+                {
+                    uint32_t index = GetClusterIndex( tx0, y, z );
+                    for (uint32_t x = tx0; x <= tx1; x++, index++)
+                    {
+                        // Distance from the sphere center to the box
+                        const XMVECTOR below = XMVectorSubtract( XMLoadFloat4( &m_BoxMin[index] ), center );
+                        const XMVECTOR above = XMVectorSubtract( center, XMLoadFloat4( &m_BoxMax[index] ) );
+                        const XMVECTOR d = XMVectorAdd( XMVectorMax( below, zero ), XMVectorMax( above, zero ) );
+                        if (XMVector3Greater( XMVector3Dot( d, d ), radiusSq ))
+                            continue;
+                        m_Hits.push_back( index );
+                        m_ClusterRange[index].Count++;
+                    }
+                }
+            }
+        }
+        m_HitOffset[NumLights] = uint32_t(m_Hits.size());
+
+        uint32_t offset = 0;
+        for (auto& range : m_ClusterRange)
+        {
+            range.Offset = offset;
+            offset += range.Count;
+            range.Count = 0;
+        }
+        m_LightIndex.resize( offset );
+        for (uint32_t i = 0; i < NumLights; i++)
+        {
+            for (uint32_t k = m_HitOffset[i]; k < m_HitOffset[i + 1]; k++)
+            {
+                Range& range = m_ClusterRange[m_Hits[k]];
+                m_LightIndex[range.Offset + range.Count++] = i;
+            }
+        }
+    }
+
+    //
+    // The lit part of a spot light is its cone capped by the range sphere.
+    // Narrow cones are bounded by the sphere through the apex and the rim,
+    // wide ones by the sphere around the rim
+    //
+    ClusterLight LightCluster::BoundSpot( const Vector3& PositionVS, const Vector3& DirectionVS, float Range, float Angle )
+    {
+        const float angle = XMConvertToRadians( Angle );
+        Vector3 center = PositionVS;
+        float radius = Range;
+        if (angle < XM_PIDIV2)
+        {
+            const float cosAngle = std::cos( angle );
+            const Vector3 dir = Normalize( DirectionVS );
+            if (angle <= XM_PIDIV4)
+            {
+                radius = Range / (2.f * cosAngle);
+                center = PositionVS + dir * radius;
+            }
+            else
+            {
+                radius = Range * std::sin( angle );
+                center = PositionVS + dir * (Range * cosAngle);
+            }
+        }
+        ClusterLight light;
+        XMStoreFloat3( &light.CenterVS, center );
+        light.Radius = radius;
+        return light;
+    }
+
+    ClusterConstants LightCluster::GetConstants( uint32_t Width, uint32_t Height ) const
+    {
+        ClusterConstants constants = {};
+        constants.TileCount[0] = m_TileCount[0];
+        constants.TileCount[1] = m_TileCount[1];
+        constants.SliceCount = m_SliceCount;
+        if (m_NearZ > 0.f)
+        {
+            constants.SliceScale = m_SliceCount / std::log( m_FarZ / m_NearZ );
+            constants.SliceBias = -std::log( m_NearZ ) * constants.SliceScale;
+        }
+        constants.ScreenToTile[0] = float(m_TileCount[0]) / Width;
+        constants.ScreenToTile[1] = float(m_TileCount[1]) / Height;
+        return constants;
+    }
+
+    void LightCluster::GetClusterBox( uint32_t Index, XMFLOAT3& Min, XMFLOAT3& Max ) const
+    {
+        Min = XMFLOAT3( m_BoxMin[Index].x, m_BoxMin[Index].y, m_BoxMin[Index].z );
+        Max = XMFLOAT3( m_BoxMax[Index].x, m_BoxMax[Index].y, m_BoxMax[Index].z );
+    }
+}
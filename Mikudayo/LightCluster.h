@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VectorMath.h"
+
+namespace Lighting
+{
+    // View space bounding sphere of a point or spot light
+    struct ClusterLight
+    {
+        XMFLOAT3 CenterVS;
+        float Radius;
+    };
+
+    struct ClusterConstants
+    {
+        uint32_t TileCount[2];
+        uint32_t SliceCount;
+        uint32_t Padding;
+        float SliceScale; // slice of view depth 'z' is log( z ) * SliceScale + SliceBias
+        float SliceBias;
+        float ScreenToTile[2]; // pixel to tile
+    };
+
+    //
+    // Light lists of view space clusters (froxels), binned on the CPU
+    //
+    // The view is split into screen tiles and exponential depth slices.
+    // Each light is first bounded by the range of clusters its sphere
+    // projects to, then tested against the view space box of each cluster
+    // in that range. Lists are compact, cluster 'c' owns
+    // 'm_LightIndex[Offset, Offset + Count)' from 'm_ClusterRange[c]', and
+    // lights are in the order given. A light of no radius is not binned
+    // (directional lights, lit everywhere).
+    //
+    class LightCluster
+    {
+    public:
+
+        struct Range
+        {
+            uint32_t Offset;
+            uint32_t Count;
+        };
+
+        void Create( uint32_t TileCountX, uint32_t TileCountY, uint32_t SliceCount );
+        // 'Proj' is a symmetric perspective projection, view looks down -z
+        void Build( const Math::Matrix4& Proj, float NearZ, float FarZ, const ClusterLight* Lights, uint32_t NumLights );
+
+        // Sphere around the cone of a spot light, 'Angle' in degrees from its axis
+        static ClusterLight BoundSpot( const Math::Vector3& PositionVS, const Math::Vector3& DirectionVS, float Range, float Angle );
+
+        uint32_t GetClusterIndex( uint32_t X, uint32_t Y, uint32_t Z ) const { return (Z * m_TileCount[1] + Y) * m_TileCount[0] + X; }
+        uint32_t GetClusterCount( void ) const { return m_TileCount[0] * m_TileCount[1] * m_SliceCount; }
+        const std::vector<Range>& GetClusterRange( void ) const { return m_ClusterRange; }
+        const std::vector<uint32_t>& GetLightIndex( void ) const { return m_LightIndex; }
+        ClusterConstants GetConstants( uint32_t Width, uint32_t Height ) const;
+        // View space box of a cluster
+        void GetClusterBox( uint32_t Index, XMFLOAT3& Min, XMFLOAT3& Max ) const;
+
+    protected:
+
+        void UpdateBoxes( float ScaleX, float ScaleY, float NearZ, float FarZ );
+        float GetSliceDepth( uint32_t Slice ) const;
+        uint32_t GetSlice( float Depth ) const;
+
+        uint32_t m_TileCount[2] = { 0, 0 };
+        uint32_t m_SliceCount = 0;
+        // Projection the boxes were made for
+        float m_ScaleX = 0.f, m_ScaleY = 0.f;
+        float m_NearZ = 0.f, m_FarZ = 0.f;
+        std::vector<XMFLOAT4> m_BoxMin; // per cluster, w unused
+        std::vector<XMFLOAT4> m_BoxMax;
+
+        std::vector<Range> m_ClusterRange;
+        std::vector<uint32_t> m_LightIndex;
+        // Clusters passing the box test, light 'i' owns [m_HitOffset[i], m_HitOffset[i + 1])
+        std::vector<uint32_t> m_Hits;
+        std::vector<uint32_t> m_HitOffset;
+    };
+}
@@ -2,6 +2,8 @@
 
 #include "RenderType.h"
 
+class GraphicsContext;
+
 class IMaterial
 {
 public:
@@ -11,6 +13,8 @@ public:
     virtual bool IsTransparent() const;
     virtual bool IsTwoSided() const;
     virtual void Bind( GraphicsContext& gfxContext );
+    // Main texture, to group draws by in a render list
+    virtual const void* GetTextureKey() const;
     virtual RenderPipelinePtr GetPipeline( RenderQueue Queue );
 };
 
@@ -38,6 +42,11 @@ inline void IMaterial::Bind( GraphicsContext& )
 {
 }
 
+inline const void* IMaterial::GetTextureKey() const
+{
+    return nullptr;
+}
+
 inline RenderPipelinePtr IMaterial::GetPipeline( RenderQueue )
 {
     return nullptr;
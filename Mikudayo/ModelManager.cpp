@@ -11,6 +11,7 @@
 
 namespace ModelManager {
     std::map<std::wstring, std::shared_ptr<IModel>> m_Models;
+    std::map<std::wstring, Animation::AnimationClipPtr> m_Motions;
 } // namespace ModelManager {
 
 void ModelManager::Initialize()
@@ -24,6 +25,7 @@ void ModelManager::Initialize()
 void ModelManager::Shutdown()
 {
     m_Models.clear();
+    m_Motions.clear();
     PmxModel::Shutdown();
     BaseModel::Shutdown();
     SkydomeModel::Shutdown();
@@ -60,7 +62,7 @@ SceneNodePtr ModelManager::Load( const ModelInfo& info )
         auto model = std::make_shared<PmxInstant>(*base);
         if (!model->Load(info.Transform))
             return nullptr;
-        model->LoadMotion( info.MotionFile );
+        model->LoadMotion( LoadMotion( info.MotionFile ) );
         return model;
     }
     if (type == kModelSkydome)
@@ -81,4 +83,18 @@ SceneNodePtr ModelManager::Load( const std::wstring& FileName )
     ModelInfo info;
     info.ModelFile = FileName;
     return Load( info );
+}
+
+Animation::AnimationClipPtr ModelManager::LoadMotion( const std::wstring& FileName )
+{
+    if (FileName.empty())
+        return nullptr;
+    auto it = m_Motions.find( FileName );
+    if (it != m_Motions.end())
+        return it->second;
+    // PMX model is converted to right handed (See, PmxModel::LoadFromFile)
+    Animation::AnimationClipPtr clip = Animation::AnimationClip::LoadFromFile( FileName, true );
+    if (clip)
+        m_Motions[FileName] = clip;
+    return clip;
 }
\ No newline at end of file
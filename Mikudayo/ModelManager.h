@@ -4,6 +4,7 @@
 #include <string>
 #include "IModel.h"
 #include "SceneNode.h"
+#include "AnimationClip.h"
 
 namespace ModelManager {
     void Initialize();
@@ -11,4 +12,7 @@ namespace ModelManager {
 
     SceneNodePtr Load( const ModelInfo& Info );
     SceneNodePtr Load( const std::wstring& FileName );
+
+    // Motion is parsed once per file, and shared by instances
+    Animation::AnimationClipPtr LoadMotion( const std::wstring& FileName );
 }
@@ -16,11 +16,11 @@ void Motion::LoadMotion( const std::wstring& path )
 	using namespace std;
 	using namespace Animation;
 	
-	Utility::ByteArray ba = Utility::ReadFileSync( path );
-	Utility::ByteStream bs(ba);
+	Utility::MappedByteArray ba = Utility::MapFileSync( path );
+	Utility::ByteReader reader( ba );
 
 	Vmd::VMD vmd;
-	vmd.Fill( bs, m_bRightHand );
+	vmd.Fill( reader, m_bRightHand );
 
 	for (auto& frame : vmd.CameraFrames)
 	{
@@ -48,7 +48,7 @@ void Motion::LoadMotion( const std::wstring& path )
 
 void Motion::Update( float kFrameTime )
 {
-	m_CameraFrame = m_CameraMotion.Interpolate( kFrameTime );
+	m_CameraFrame = m_CameraMotion.Interpolate( kFrameTime, m_CameraCursor );
 }
 
 void Motion::Animate( Math::MikuCamera& camera )
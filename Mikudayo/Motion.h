@@ -23,5 +23,6 @@ namespace Graphics
 		bool m_bRightHand;
 		Animation::CameraFrame m_CameraFrame;
 		Animation::CameraMotion m_CameraMotion;
+		Animation::KeyFrameCursor m_CameraCursor;
 	};
 }
\ No newline at end of file
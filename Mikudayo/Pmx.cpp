@@ -4,51 +4,83 @@
 #include "Encoding.h"
 #include "TextUtility.h"
 
+#include <atomic>
+
 namespace Pmx
 {
-	using Utility::bufferstream;
+	using Utility::ByteReader;
 	using Utility::sjis_to_utf;
 
-    std::wstring ReadText( bufferstream& is, bool bUtf16 )
+    std::wstring ReadText( ByteReader& is, bool bUtf16 )
     {
         uint32_t len = 0;
         Read( is, len );
-        std::vector<char> buf(len);
-        Read( is, buf );
+        // decode directly from file buffer
+        const char* text = is.Skip( len );
+        if (text == nullptr || len == 0)
+            return std::wstring();
         if (bUtf16)
         {
-            return std::wstring( (wchar_t*)buf.data(), (wchar_t*)(buf.data() + len) );
+        #if WCHAR_MAX <= 0xFFFF
+            std::wstring str( len / sizeof( wchar_t ), L'\0' );
+            memcpy( &str[0], text, str.size() * sizeof( wchar_t ) );
+            return str;
+        #else
+            // wchar_t holds a code point, join the surrogate pairs
+            std::vector<char16_t> units( len / sizeof( char16_t ) );
+            memcpy( units.data(), text, units.size() * sizeof( char16_t ) );
+            std::wstring str;
+            str.reserve( units.size() );
+            for (size_t i = 0; i < units.size(); i++)
+            {
+                uint32_t c = units[i];
+                if (0xD800 <= c && c < 0xDC00 && i + 1 < units.size()
+                    && 0xDC00 <= units[i + 1] && units[i + 1] < 0xE000)
+                    c = 0x10000 + ((c - 0xD800) << 10) + (units[++i] - 0xDC00);
+                str.push_back( static_cast<wchar_t>(c) );
+            }
+            return str;
+        #endif
         }
         else
         {
-            std::string str( buf.data(), buf.data() + len );
             std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8conv;
-            return utf8conv.from_bytes( str );
+            return utf8conv.from_bytes( text, text + len );
         }
     }
 
-    uint32_t ReadIndexUnsigned( bufferstream& is, uint8_t byteSize )
+    // Index buffer is the largest flat array in the file, widen it in one pass
+    void ReadIndexArray( ByteReader& is, uint32_t* indices, uint32_t count, uint8_t byteSize )
     {
-		uint8_t i8;
-		uint16_t i16;
-		uint32_t i32;
-
+        if (byteSize == 4)
+        {
+            is.ReadArray( indices, count );
+            return;
+        }
+        const char* src = is.Skip( size_t(count) * byteSize );
+        if (src == nullptr)
+            return;
         switch (byteSize)
         {
-		case 1:
-            Read( is, i8 );
-            return i8;
-		case 2:
-            Read( is, i16 );
-            return i16;
-		case 4:
-            Read( is, i32 );
-            return i32;
-		}
-        return 0;
+        case 1:
+            for (uint32_t i = 0; i < count; i++)
+                indices[i] = uint8_t(src[i]);
+            break;
+        case 2:
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint16_t i16;
+                memcpy( &i16, src + i * sizeof( i16 ), sizeof( i16 ) );
+                indices[i] = i16;
+            }
+            break;
+        default:
+            is.SetFail();
+            break;
+        }
     }
 
-    int32_t ReadIndex( bufferstream& is, uint8_t byteSize )
+    int32_t ReadIndex( ByteReader& is, uint8_t byteSize )
     {
 		int8_t i8;
 		int16_t i16;
@@ -66,21 +98,142 @@ namespace Pmx
             Read( is, i32 );
             return i32;
 		}
+        is.SetFail();
+        return 0;
+    }
+
+    bool IsValidIndexSize( uint8_t byteSize )
+    {
+        return byteSize == 1 || byteSize == 2 || byteSize == 4;
+    }
+
+    void SkipText( ByteReader& is )
+    {
+        uint32_t len = 0;
+        Read( is, len );
+        is.Skip( len );
+    }
+
+    size_t SkinUnitSize( uint8_t type, uint8_t boneByteSize )
+    {
+        switch (type)
+        {
+        case kBdef1: return boneByteSize;
+        case kBdef2: return boneByteSize * 2 + sizeof( float );
+        case kBdef4: return boneByteSize * 4 + sizeof( float ) * 4;
+        case kSdef: return boneByteSize * 2 + sizeof( float ) * 10;
+        case kQdef: return boneByteSize * 4 + sizeof( float ) * 4;
+        }
+        return 0;
+    }
+
+    size_t MorphElementSize( MorphType type, const uint8_t config[] )
+    {
+        switch (type)
+        {
+        case MorphType::kGroup: return config[kMorphIndex] + sizeof( float );
+        case MorphType::kVertex: return config[kVertIndex] + sizeof( XMFLOAT3 );
+        case MorphType::kBone: return config[kBoneIndex] + sizeof( XMFLOAT3 ) + sizeof( XMFLOAT4 );
+        case MorphType::kTexCoord:
+        case MorphType::kExtraUV1:
+        case MorphType::kExtraUV2:
+        case MorphType::kExtraUV3:
+        case MorphType::kExtraUV4: return config[kVertIndex] + sizeof( XMFLOAT4 );
+        case MorphType::kMaterial: return config[kMatIndex] + 1 + sizeof( float ) * 28;
+        case MorphType::kFlip: return config[kMorphIndex] + sizeof( float );
+        case MorphType::kImpulse: return config[kRigidBodyIndex] + 1 + sizeof( XMFLOAT3 ) * 2;
+        }
         return 0;
     }
 
-	void Header::Fill( bufferstream& is )
+    //
+    // Vertex and morph records have variable size, so each one can only be
+    // found by walking over all of previous ones. A scan pass skips over the
+    // records and keeps their offsets; decoding then runs in parallel, each
+    // record read through its own reader over exactly its bytes
+    //
+    void ScanVertices( ByteReader& is, uint32_t count, uint8_t numAddUV, uint8_t boneByteSize, std::vector<size_t>& offsets )
+    {
+        const size_t headSize = sizeof( XMFLOAT3 ) * 2 + sizeof( XMFLOAT2 ) + sizeof( XMFLOAT4 ) * numAddUV;
+        offsets.resize( count + 1 );
+        for (uint32_t i = 0; i < count && !is.Fail(); i++)
+        {
+            offsets[i] = is.Tell();
+            is.Skip( headSize );
+            uint8_t type = 0;
+            Read( is, type );
+            const size_t unitSize = SkinUnitSize( type, boneByteSize );
+            if (unitSize == 0)
+                is.SetFail();
+            is.Skip( unitSize + sizeof( float ) );
+        }
+        offsets[count] = is.Tell();
+    }
+
+    void ScanMorphs( ByteReader& is, uint32_t count, const uint8_t config[], std::vector<size_t>& offsets )
+    {
+        offsets.resize( count + 1 );
+        for (uint32_t i = 0; i < count && !is.Fail(); i++)
+        {
+            offsets[i] = is.Tell();
+            SkipText( is );
+            SkipText( is );
+            is.Skip( sizeof( MorphCategory ) );
+            MorphType type = MorphType::kGroup;
+            Read( is, type );
+            uint32_t numElement = ReadUint( is );
+            const size_t elementSize = MorphElementSize( type, config );
+            if (elementSize == 0)
+                is.SetFail();
+            is.Skip( numElement * elementSize );
+        }
+        offsets[count] = is.Tell();
+    }
+
+    // Records per task, a morph list is decoded in a few tasks, vertices in many
+    const int kRecordGrainSize = 64;
+
+    ParallelForFunc s_ParallelFor;
+
+    void SetParallelFor( const ParallelForFunc& Func )
+    {
+        s_ParallelFor = Func;
+    }
+
+    // A record failing to read fails 'is'
+    template <typename T, typename Func>
+    void DecodeRecords( ByteReader& is, const std::vector<size_t>& offsets, std::vector<T>& records, const Func& fill )
+    {
+        std::atomic<bool> bFail( false );
+        auto decode = [&]( int Begin, int End ) {
+            for (int i = Begin; i < End; i++)
+            {
+                ByteReader record( is.Data() + offsets[i], offsets[i + 1] - offsets[i] );
+                fill( record, records[i] );
+                if (record.Fail())
+                    bFail = true;
+            }
+        };
+        if (s_ParallelFor)
+            s_ParallelFor( 0, int(records.size()), kRecordGrainSize, decode );
+        else
+            decode( 0, int(records.size()) );
+        if (bFail)
+            is.SetFail();
+    }
+
+	void Header::Fill( ByteReader& is )
 	{
 		Read( is, Version );
     }
 
-    void Config::Fill( bufferstream& is )
+    void Config::Fill( ByteReader& is )
     {
         Read( is, Count );
         Read( is, Data, Count );
     }
 
-    void Description::Fill( bufferstream& is, bool bUtf16 )
+    void Description::Fill( ByteReader& is, bool bUtf16 )
     {
 		Name = ReadText( is, bUtf16 );
 		Comment = ReadText( is, bUtf16 );
@@ -88,7 +241,7 @@ namespace Pmx
 		CommentEnglish = ReadText( is, bUtf16 );
     }
 
-	void Vertex::Fill( bufferstream& is, bool bRH, uint8_t numAddUV, uint8_t boneByteSize )
+	void Vertex::Fill( ByteReader& is, bool bRH, uint8_t numAddUV, uint8_t boneByteSize )
 	{
 		ReadPosition( is, Pos, bRH );
 		ReadNormal( is, Normal, bRH );
@@ -115,19 +268,19 @@ namespace Pmx
         Read( is, EdgeScale );
 	}
 
-    void Bdef1Unit::Fill( bufferstream& is, uint8_t byteSize )
+    void Bdef1Unit::Fill( ByteReader& is, uint8_t byteSize )
     {
         BoneIndex = ReadIndex( is, byteSize );
     }
 
-    void Bdef2Unit::Fill( bufferstream& is, uint8_t byteSize )
+    void Bdef2Unit::Fill( ByteReader& is, uint8_t byteSize )
     {
         BoneIndex[0] = ReadIndex( is, byteSize );
         BoneIndex[1] = ReadIndex( is, byteSize );
         Read( is, Weight );
     }
 
-    void Bdef4Unit::Fill( bufferstream& is, uint8_t byteSize )
+    void Bdef4Unit::Fill( ByteReader& is, uint8_t byteSize )
     {
         BoneIndex[0] = ReadIndex( is, byteSize );
         BoneIndex[1] = ReadIndex( is, byteSize );
@@ -136,7 +289,7 @@ namespace Pmx
         Read( is, Weight );
     }
 
-    void SdefUnit::Fill( bufferstream& is, uint8_t byteSize )
+    void SdefUnit::Fill( ByteReader& is, uint8_t byteSize )
     {
         BoneIndex[0] = ReadIndex( is, byteSize );
         BoneIndex[1] = ReadIndex( is, byteSize );
@@ -146,7 +299,7 @@ namespace Pmx
         Read( is, R1 );
     }
 
-    void QdefUnit::Fill( bufferstream& is, uint8_t byteSize )
+    void QdefUnit::Fill( ByteReader& is, uint8_t byteSize )
     {
         BoneIndex[0] = ReadIndex( is, byteSize );
         BoneIndex[1] = ReadIndex( is, byteSize );
@@ -155,7 +308,7 @@ namespace Pmx
         Read( is, Weight );
     }
 
-	void Material::Fill( bufferstream& is, bool bUtf16, uint8_t textureIndexByteSize )
+	void Material::Fill( ByteReader& is, bool bUtf16, uint8_t textureIndexByteSize )
 	{
         Name = ReadText( is, bUtf16 );
         NameEnglish = ReadText( is, bUtf16 );
@@ -222,7 +375,7 @@ namespace Pmx
         bIK = false;
     }
 
-    void Bone::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t boneIndexByteSize )
+    void Bone::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t boneIndexByteSize )
 	{
         Name = ReadText( is, bUtf16 );
         NameEnglish = ReadText( is, bUtf16 );
@@ -230,6 +383,7 @@ namespace Pmx
 		ParentBoneIndex = ReadIndex( is, boneIndexByteSize );
 		Read( is, MoprhHierarchy );
 		Read( is, BitFlag );
+        bTransformAfterPhysics = (BitFlag & kTransformAfterPhysics) != 0;
 
         // bone has destination
         if (BitFlag & kHasDestinationOriginIndex)
@@ -280,13 +434,12 @@ namespace Pmx
         LimitedRadian = 0.f;
     }
 
-    void IK::Fill( bufferstream& is, bool bRH, uint8_t boneIndexByteSize )
+    void IK::Fill( ByteReader& is, bool bRH, uint8_t boneIndexByteSize )
     {
         BoneIndex = ReadIndex( is, boneIndexByteSize );
         Read( is, NumIteration );
         Read( is, LimitedRadian );
-        uint32_t NumLink;
-        Read( is, NumLink );
+        uint32_t NumLink = ReadCount( is, 2 );
         Link.resize( NumLink );
         for (auto& l : Link)
             l.Fill( is, bRH, boneIndexByteSize );
@@ -300,7 +453,7 @@ namespace Pmx
         MaxLimit = XMFLOAT3( 0.f, 0.f, 0.f );
     }
 
-    void IkLink::Fill( bufferstream& is, bool bRH, uint8_t boneIndexByteSize )
+    void IkLink::Fill( ByteReader& is, bool bRH, uint8_t boneIndexByteSize )
     {
         BoneIndex = ReadIndex( is, boneIndexByteSize );
         Read( is, bLimit );
@@ -310,19 +463,19 @@ namespace Pmx
         }
     }
 
-    void MorphGroup::Fill( bufferstream& is, uint8_t size )
+    void MorphGroup::Fill( ByteReader& is, uint8_t size )
     {
 		Index = ReadIndex( is, size );
 		Read( is, Weight );
     }
 
-	void MorphVertex::Fill( bufferstream& is, uint8_t size, bool bRH )
+	void MorphVertex::Fill( ByteReader& is, uint8_t size, bool bRH )
 	{
 		VertexIndex = ReadIndex( is, size );
 		ReadPosition( is, Position, bRH );
 	}
 
-    void MorphMaterial::Fill( bufferstream& is, uint8_t size )
+    void MorphMaterial::Fill( ByteReader& is, uint8_t size )
     {
 		MaterialIndex = ReadIndex( is, size );
         Read( is, OffsetOperation );
@@ -337,27 +490,27 @@ namespace Pmx
         Read( is, ToonWeight );
     }
 
-    void MorphBone::Fill( bufferstream& is, uint8_t size, bool bRH )
+    void MorphBone::Fill( ByteReader& is, uint8_t size, bool bRH )
     {
 		BoneIndex = ReadIndex( is, size );
         ReadPosition( is, Translation, bRH );
         ReadRotation( is, Rotation, bRH );
     }
 
-    void MorphUV::Fill( bufferstream& is, uint8_t offset, uint8_t size )
+    void MorphUV::Fill( ByteReader& is, uint8_t offset, uint8_t size )
     {
         Offset = offset;
         VertexIndex = ReadIndex( is, size );
         Read( is, Position );
     }
 
-    void MorphFlip::Fill( bufferstream& is, uint8_t size )
+    void MorphFlip::Fill( ByteReader& is, uint8_t size )
     {
         Index = ReadIndex( is, size );
         Read( is, Value );
     }
 
-    void MorphImpulse::Fill( bufferstream& is, uint8_t size, bool bRH )
+    void MorphImpulse::Fill( ByteReader& is, uint8_t size, bool bRH )
     {
         Index = ReadIndex( is, size );
         uint8_t isLocal;
@@ -367,14 +520,13 @@ namespace Pmx
         ReadRotation( is, AngularTorque, bRH );
     }
 
-    void Morph::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t config[] )
+    void Morph::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t config[] )
     {
 		Name = ReadText( is, bUtf16 );
         NameEnglish = ReadText( is, bUtf16 );
 		Read( is, Panel );
 		Read( is, Type );
-		uint32_t MorphCount;
-		Read( is, MorphCount );
+		uint32_t MorphCount = ReadCount( is, 5 );
         switch (Type)
         {
         case MorphType::kGroup:
@@ -397,6 +549,16 @@ namespace Pmx
             for (uint32_t i = 0; i < MorphCount; i++)
                 MaterialList[i].Fill( is, config[kMatIndex] );
             break;
+        case MorphType::kFlip:
+            FlipList.resize( MorphCount );
+            for (uint32_t i = 0; i < MorphCount; i++)
+                FlipList[i].Fill( is, config[kMorphIndex] );
+            break;
+        case MorphType::kImpulse:
+            ImpulseList.resize( MorphCount );
+            for (uint32_t i = 0; i < MorphCount; i++)
+                ImpulseList[i].Fill( is, config[kRigidBodyIndex], bRH );
+            break;
         case MorphType::kTexCoord:
         case MorphType::kExtraUV1:
         case MorphType::kExtraUV2:
@@ -414,7 +576,7 @@ namespace Pmx
         }
     }
 
-    void DisplayElement::Fill( bufferstream& is, uint8_t config[] )
+    void DisplayElement::Fill( ByteReader& is, uint8_t config[] )
     {
         Read( is, Type );
         if (Type == DisplayElementType::kBone)
@@ -425,19 +587,18 @@ namespace Pmx
             ASSERT( FALSE );
     }
 
-    void DisplayFrame::Fill( bufferstream& is, bool bUtf16, uint8_t config[] )
+    void DisplayFrame::Fill( ByteReader& is, bool bUtf16, uint8_t config[] )
     {
         Name = ReadText( is, bUtf16 );
         NameEnglish = ReadText( is, bUtf16 );
         Read( is, Type );
-		uint32_t Count;
-        Read( is, Count );
+		uint32_t Count = ReadCount( is, 2 );
         ElementList.resize( Count );
         for (uint32_t i = 0; i < Count; i++)
             ElementList[i].Fill( is, config );
     }
 
-	void RigidBody::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t boneIndexSize )
+	void RigidBody::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t boneIndexSize )
 	{
         Name = ReadText( is, bUtf16 );
         NameEnglish = ReadText( is, bUtf16 );
@@ -449,12 +610,12 @@ namespace Pmx
 		ReadPosition( is, Position, bRH );
 		ReadRotation( is, Rotation, bRH );
 		// TODO: how to handle nan, inf more better way ?
-		if (isnan(Rotation.x)) Rotation.x = 0.f;
-		if (isnan(Rotation.y)) Rotation.y = 0.f;
-		if (isnan(Rotation.z)) Rotation.z = 0.f;
-		ASSERT(!isnan(Rotation.x));
-		ASSERT(!isnan(Rotation.y));
-		ASSERT(!isnan(Rotation.z));
+		if (std::isnan(Rotation.x)) Rotation.x = 0.f;
+		if (std::isnan(Rotation.y)) Rotation.y = 0.f;
+		if (std::isnan(Rotation.z)) Rotation.z = 0.f;
+		ASSERT(!std::isnan(Rotation.x));
+		ASSERT(!std::isnan(Rotation.y));
+		ASSERT(!std::isnan(Rotation.z));
 		Read( is, Mass );
 		Read( is, LinearDamping );
 		Read( is, AngularDamping );
@@ -463,7 +624,7 @@ namespace Pmx
 		Read( is, RigidType );
 	}
 
-    void Joint::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
+    void Joint::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
     {
 		Name = ReadText( is, bUtf16 );
 		NameEnglish = ReadText( is, bUtf16 );
@@ -480,26 +641,27 @@ namespace Pmx
 		Read( is, AngularStiffness );
     }
 
-    void RigidBodyAnchor::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
+    void RigidBodyAnchor::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
     {
         (is), (bRH), (bUtf16), (rigidIndexSize);
         ASSERT( FALSE );
     }
 
-    void SoftBody::Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
+    void SoftBody::Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize )
     {
         (is), (bRH), (bUtf16), (rigidIndexSize);
         ASSERT( FALSE );
     }
 
-    void PMX::Fill( bufferstream& is, bool bRightHand )
+    void PMX::Fill( ByteReader& is, bool bRightHand )
 	{
         m_IsValid = false;
 
 		Read( is, m_Magic );
 
         // In PMX 1.0 magic is "pmx ", so judge by using ignore case compare
-		if (_strnicmp( m_Magic, "PMX ", 4 ))
+		if (!std::equal( m_Magic, m_Magic + 4, "PMX ", []( char a, char b ) {
+            return std::toupper( static_cast<unsigned char>(a) ) == b; } ))
 		{
 			std::cerr << "Invalid PMX file." << std::endl;
 			return;
@@ -508,69 +670,92 @@ namespace Pmx
 		m_Header.Fill( is );
         m_Config.Fill( is );
 
+        for (uint8_t i = kVertIndex; i <= kRigidBodyIndex; i++)
+        {
+            if (m_Config.Count <= i || !IsValidIndexSize( m_Config.Data[i] ))
+            {
+                std::cerr << "Invalid PMX file." << std::endl;
+                return;
+            }
+        }
+
         m_Description.Fill( is, isUtf16());
 
-		uint32_t NumVertex = ReadUint( is );
-		m_Vertices.resize( NumVertex );
-		for (uint32_t i = 0; i < NumVertex; i++)
-			m_Vertices[i].Fill( is, bRightHand, GetNumAddUV(), GetByteSize(kBoneIndex) );
+        std::vector<size_t> offsets;
+
+        // Minimum byte size of each element guards counts read from corrupt file
+		uint32_t NumVertex = ReadCount( is, 37 );
+        ScanVertices( is, NumVertex, GetNumAddUV(), GetByteSize( kBoneIndex ), offsets );
+        if (!is.Fail())
+        {
+            m_Vertices.resize( NumVertex );
+            DecodeRecords( is, offsets, m_Vertices, [&]( ByteReader& record, Vertex& vertex ) {
+                vertex.Fill( record, bRightHand, GetNumAddUV(), GetByteSize( kBoneIndex ) );
+            });
+        }
 
-		uint32_t NumIndices = ReadUint( is );
+		uint32_t NumIndices = ReadCount( is, GetByteSize( kVertIndex ) );
 		m_Indices.resize( NumIndices );
-        for (auto& i : m_Indices)
-            i = ReadIndexUnsigned( is, GetByteSize( kVertIndex ));
+        ReadIndexArray( is, m_Indices.data(), NumIndices, GetByteSize( kVertIndex ) );
 		if (bRightHand)
 		{
 			for (uint32_t i = 0; i < NumIndices; i += 3)
 				std::swap( m_Indices[i], m_Indices[i + 1] );
 		}
 
-        uint32_t NumTexture = ReadUint( is );
+        uint32_t NumTexture = ReadCount( is, 4 );
         m_Textures.resize( NumTexture );
         for (auto& t : m_Textures)
             t = ReadText( is, isUtf16() );
 
-		uint32_t NumMaterial = ReadUint( is );
+		uint32_t NumMaterial = ReadCount( is, 83 );
 		m_Materials.resize( NumMaterial );
 		for (uint32_t i = 0; i < NumMaterial; i++)
 			m_Materials[i].Fill( is, isUtf16(), GetByteSize( kTexIndex ) );
 
-		uint32_t NumBones = ReadUint( is );
+		uint32_t NumBones = ReadCount( is, 27 );
 		m_Bones.resize( NumBones );
 		for (uint32_t i = 0; i < NumBones; i++)
 			m_Bones[i].Fill( is, bRightHand, isUtf16(), GetByteSize( kBoneIndex ) );
 
-		uint32_t NumMorphs = ReadUint( is );
-        m_Morphs.resize( NumMorphs );
-        for (uint32_t i = 0; i < NumMorphs; i++)
-            m_Morphs[i].Fill( is, bRightHand, isUtf16(), m_Config.Data );
+		uint32_t NumMorphs = ReadCount( is, 14 );
+        ScanMorphs( is, NumMorphs, m_Config.Data, offsets );
+        if (!is.Fail())
+        {
+            m_Morphs.resize( NumMorphs );
+            DecodeRecords( is, offsets, m_Morphs, [&]( ByteReader& record, Morph& morph ) {
+                morph.Fill( record, bRightHand, isUtf16(), m_Config.Data );
+            });
+        }
 
-		uint32_t NumFrames = ReadUint( is );
+		uint32_t NumFrames = ReadCount( is, 13 );
         m_Frames.resize( NumFrames );
         for (uint32_t i = 0; i < NumFrames; i++)
             m_Frames[i].Fill( is, isUtf16(), m_Config.Data );
 
-        uint32_t NumRigidBody;
-        Read( is, NumRigidBody );
+        uint32_t NumRigidBody = ReadCount( is, 70 );
         m_RigidBodies.resize( NumRigidBody );
         for (uint32_t i = 0; i < NumRigidBody; i++)
             m_RigidBodies[i].Fill( is, bRightHand, isUtf16(), GetByteSize( kBoneIndex ) );
 
-        uint32_t NumJoint;
-        Read( is, NumJoint );
+        uint32_t NumJoint = ReadCount( is, 107 );
         m_Joints.resize( NumJoint );
         for (uint32_t i = 0; i < NumJoint; i++)
             m_Joints[i].Fill( is, bRightHand, isUtf16(), GetByteSize( kRigidBodyIndex ) );
 
-        if (is.peek() != ios::traits_type::eof())
+        if (!is.IsEOF())
         {
             ASSERT( m_Header.Version >= 2.1f );
             // Version >= 2.1f
-            uint32_t NumSoftBody;
-            Read( is, NumSoftBody );
+            uint32_t NumSoftBody = ReadCount( is, 4 );
             m_SoftBodies.resize( NumSoftBody );
             for (uint32_t i = 0; i < NumJoint; i++)
                 m_SoftBodies[i].Fill( is, bRightHand, isUtf16(), GetByteSize( kRigidBodyIndex ) );
+        }
+        if (is.Fail())
+        {
+            std::cerr << "Truncated or corrupt PMX file." << std::endl;
+            return;
         }
 		m_IsValid = true;
 	}
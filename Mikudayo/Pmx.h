@@ -15,6 +15,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <functional>
 #include <vector>
 #include <string>
 #include "FileUtility.h"
@@ -27,6 +28,14 @@ namespace Pmx
     using namespace Utility;
     using namespace std;
 
+    //
+    // Loop the records of a file are decoded with. 'Body' is called with sub
+    // ranges [Begin, End) of at most 'GrainSize' records, from any thread.
+    // Decoding is sequential until a loop is set
+    //
+    using ParallelForFunc = std::function<void( int Begin, int End, int GrainSize, const std::function<void( int Begin, int End )>& Body )>;
+    void SetParallelFor( const ParallelForFunc& Func );
+
     using MagicBuf = char[4];
     using NameBuf = char[20];
     using FrameBuf = char[50];
@@ -52,7 +61,7 @@ namespace Pmx
     struct Header
     {
         float Version; // (2.0/2.1)
-        void Fill( bufferstream& is );
+        void Fill( ByteReader& is );
     };
 
     struct Config
@@ -60,7 +69,7 @@ namespace Pmx
         uint8_t Count;
         enum { kMaxConfig = 8 };
         uint8_t Data[kMaxConfig];
-        void Fill( bufferstream& is );
+        void Fill( ByteReader& is );
     };
 
     struct Description
@@ -70,24 +79,24 @@ namespace Pmx
         wstring NameEnglish;
         wstring CommentEnglish;
 
-        void Fill( bufferstream& is, bool bUtf16 );
+        void Fill( ByteReader& is, bool bUtf16 );
     };
 
     struct Bdef1Unit {
         int32_t BoneIndex;
-        void Fill( bufferstream& is, uint8_t byteSize );
+        void Fill( ByteReader& is, uint8_t byteSize );
     };
 
     struct Bdef2Unit {
         int32_t BoneIndex[2];
         float Weight;
-        void Fill( bufferstream& is, uint8_t byteSize );
+        void Fill( ByteReader& is, uint8_t byteSize );
     };
 
     struct Bdef4Unit {
         int32_t BoneIndex[4];
         float Weight[4];
-        void Fill( bufferstream& is, uint8_t byteSize );
+        void Fill( ByteReader& is, uint8_t byteSize );
     };
 
     struct SdefUnit {
@@ -96,13 +105,13 @@ namespace Pmx
         float C[3];
         float R0[3];
         float R1[3];
-        void Fill( bufferstream& is, uint8_t byteSize );
+        void Fill( ByteReader& is, uint8_t byteSize );
     };
 
     struct QdefUnit {
         int32_t BoneIndex[4];
         float Weight[4];
-        void Fill( bufferstream& is, uint8_t byteSize );
+        void Fill( ByteReader& is, uint8_t byteSize );
     };
 
     enum ESkiningType : uint8_t {
@@ -117,6 +126,12 @@ namespace Pmx
         QdefUnit qdef;
     };
 
+    // Skin unit tagged with its type, laid out as PmxSkinningSO reads it
+    struct SkinTypeUnit {
+        uint32_t Type;
+        SkinUnit Unit;
+    };
+
     struct Vertex
     {
         enum { kMaxAddUV = 4 };
@@ -129,7 +144,7 @@ namespace Pmx
         ESkiningType SkinningType;
         float EdgeScale;
 
-        void Fill( bufferstream & is, bool bRH, uint8_t numAddUV, uint8_t boneByteSize );
+        void Fill( ByteReader& is, bool bRH, uint8_t numAddUV, uint8_t boneByteSize );
     };
 
 	enum EMaterialFlag : uint8_t {
@@ -172,7 +187,7 @@ namespace Pmx
         wstring Comment;
         uint32_t NumVertex;
 
-        void Fill( bufferstream & is, bool bUtf16, uint8_t textureByteSize );
+        void Fill( ByteReader& is, bool bUtf16, uint8_t textureByteSize );
     };
 
     struct IkLink
@@ -183,7 +198,7 @@ namespace Pmx
         XMFLOAT3 MaxLimit;
 
         IkLink();
-        void Fill( bufferstream& is, bool bRH, uint8_t boneIndexByteSize );
+        void Fill( ByteReader& is, bool bRH, uint8_t boneIndexByteSize );
     };
 
     struct IK
@@ -194,7 +209,7 @@ namespace Pmx
         std::vector<IkLink> Link;
 
         IK();
-        void Fill( bufferstream& is, bool bRH, uint8_t boneIndexByteSize );
+        void Fill( ByteReader& is, bool bRH, uint8_t boneIndexByteSize );
     };
 
     struct Bone
@@ -228,8 +243,10 @@ namespace Pmx
         bool bIK;
         IK Ik;
 
+        bool bTransformAfterPhysics = false;
+
         Bone();
-        void Fill( bufferstream & is, bool bRH, bool bUtf16, uint8_t boneIndexByteSize );
+        void Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t boneIndexByteSize );
     };
 
 	enum class MorphCategory : uint8_t
@@ -260,7 +277,7 @@ namespace Pmx
     {
         uint32_t Index;
         float Weight;
-        void Fill( bufferstream& is, uint8_t size );
+        void Fill( ByteReader& is, uint8_t size );
     };
 
     struct MorphVertex
@@ -268,7 +285,7 @@ namespace Pmx
         uint32_t VertexIndex;
         XMFLOAT3 Position;
 
-        void Fill( bufferstream& is, uint8_t size, bool bRH );
+        void Fill( ByteReader& is, uint8_t size, bool bRH );
     };
 
     struct MorphMaterial
@@ -285,7 +302,7 @@ namespace Pmx
         XMFLOAT4 SphereWeight;
         XMFLOAT4 ToonWeight;
 
-        void Fill( bufferstream& is, uint8_t size );
+        void Fill( ByteReader& is, uint8_t size );
     };
 
     struct MorphBone
@@ -294,7 +311,7 @@ namespace Pmx
         XMFLOAT3 Translation;
         XMFLOAT4 Rotation;
 
-        void Fill( bufferstream& is, uint8_t size, bool bRH );
+        void Fill( ByteReader& is, uint8_t size, bool bRH );
     };
 
     struct MorphUV
@@ -303,7 +320,7 @@ namespace Pmx
         XMFLOAT4 Position;
         uint8_t Offset;
 
-        void Fill( bufferstream& is, uint8_t offset, uint8_t size );
+        void Fill( ByteReader& is, uint8_t offset, uint8_t size );
     };
 
     struct MorphFlip
@@ -311,7 +328,7 @@ namespace Pmx
         uint32_t Index;
         float Value;
 
-        void Fill( bufferstream& is, uint8_t size );
+        void Fill( ByteReader& is, uint8_t size );
     };
 
     struct MorphImpulse
@@ -321,7 +338,7 @@ namespace Pmx
         XMFLOAT3 Velocity;
         XMFLOAT3 AngularTorque;
 
-        void Fill( bufferstream& is, uint8_t size, bool bRH );
+        void Fill( ByteReader& is, uint8_t size, bool bRH );
     };
 
     //
@@ -344,7 +361,7 @@ namespace Pmx
         vector<MorphFlip> FlipList;
         vector<MorphImpulse> ImpulseList;
 
-        void Fill( bufferstream& is, bool bUtf16, bool bRH, uint8_t config[] );
+        void Fill( ByteReader& is, bool bUtf16, bool bRH, uint8_t config[] );
     };
 
     enum class DisplayElementType  : uint8_t
@@ -358,7 +375,7 @@ namespace Pmx
         DisplayElementType Type;
         uint32_t Index;
 
-        void Fill( bufferstream& is, uint8_t config[] );
+        void Fill( ByteReader& is, uint8_t config[] );
     };
 
     struct DisplayFrame
@@ -368,7 +385,7 @@ namespace Pmx
         uint8_t Type;
         vector<DisplayElement> ElementList;
 
-        void Fill( bufferstream& is, bool bUtf16, uint8_t config[] );
+        void Fill( ByteReader& is, bool bUtf16, uint8_t config[] );
     };
 
     enum class RigidBodyShape : uint8_t
@@ -403,7 +420,7 @@ namespace Pmx
         float Friction;
         RigidBodyType RigidType;
 
-        void Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t boneIndexSize );
+        void Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t boneIndexSize );
     };
 
 	enum class JointType : uint8_t
@@ -432,7 +449,7 @@ namespace Pmx
         XMFLOAT3 LinearStiffness; // SpringMoveCoefficient (spring move)
         XMFLOAT3 AngularStiffness; // SpringRotationCoefficient (spring rotation)
 
-        void Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize );
+        void Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize );
     };
 
 	enum kSoftBodyFlag : uint8_t
@@ -449,7 +466,7 @@ namespace Pmx
 		int32_t RelatedVertex;
 		bool bNear;
 
-        void Fill( bufferstream& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize );
+        void Fill( ByteReader& is, bool bRH, bool bUtf16, uint8_t rigidIndexSize );
 	};
 
     struct SoftBody
@@ -494,7 +511,7 @@ namespace Pmx
         std::vector<RigidBodyAnchor> Anchors;
         std::vector<int32_t> PinVertices;
 
-        void Fill( bufferstream& is, bool bUtf16, bool bRH, uint8_t rigidIndexSize );
+        void Fill( ByteReader& is, bool bUtf16, bool bRH, uint8_t rigidIndexSize );
     };
 
     // Polygon Model eXtended
@@ -507,7 +524,7 @@ namespace Pmx
 
         // PMX model is defined in left handed coordinate
         // 'bRightHand' flag convert model to right handed coordinate
-        void Fill( bufferstream& is, bool bRightHand );
+        void Fill( ByteReader& is, bool bRightHand );
 
         bool IsValid( void ) const { return m_IsValid; }
         bool m_IsValid = false;
@@ -1,18 +1,18 @@
 ﻿#include "stdafx.h"
 #include "PmxModel.h"
 #include "PmxInstant.h"
-#include "Vmd.h"
-#include "KeyFrameAnimation.h"
+#include "PmxSimulation.h"
+#include "AnimationClip.h"
 #include "PrimitiveUtility.h"
+#include "SoftwareSkinning.h"
+#include "VertexMorph.h"
 #include "Visitor.h"
 #include "TaskManager.h"
 #include "GLMMath.h"
+#include "LinearColor.h"
 #include "Math/DualQuaternion.h"
 #include "Math/SimpleMath.h"
 #include "Bullet/Physics.h"
-#include "Bullet/RigidBody.h"
-#include "Bullet/Joint.h"
-#include "Bullet/LinearMath.h"
 
 using namespace Utility;
 using namespace Math;
@@ -34,17 +34,42 @@ namespace {
         return sizeof( T ) * vec.size();
     }
 
-	bool isnan(const XMFLOAT3& vec3) noexcept
-	{
-		using std::isnan;
-		return isnan(vec3.x) || isnan(vec3.y) || isnan(vec3.z);
-	}
+
+    // Material morph, operation 0 multiplies and 1 adds offset scaled by weight
+    XMVECTOR MorphMaterialVector( FXMVECTOR base, FXMVECTOR offset, uint8_t op, float weight )
+    {
+        if (op == 0)
+            return XMVectorMultiply( base, XMVectorLerp( XMVectorSplatOne(), offset, weight ) );
+        return XMVectorMultiplyAdd( offset, XMVectorReplicate( weight ), base );
+    }
+
+    void MorphMaterialValue( float& base, float offset, uint8_t op, float weight )
+    {
+        base = (op == 0) ? base * (1.f + (offset - 1.f) * weight) : base + offset * weight;
+    }
+
+    void MorphMaterialValue( XMFLOAT3& base, const XMFLOAT3& offset, uint8_t op, float weight )
+    {
+        const XMFLOAT3 o = Gamma::Convert( offset );
+        XMStoreFloat3( &base, MorphMaterialVector( XMLoadFloat3( &base ), XMLoadFloat3( &o ), op, weight ) );
+    }
+
+    void MorphMaterialValue( XMFLOAT4& base, const XMFLOAT4& offset, uint8_t op, float weight )
+    {
+        const XMFLOAT4 o = Gamma::Convert( offset );
+        XMStoreFloat4( &base, MorphMaterialVector( XMLoadFloat4( &base ), XMLoadFloat4( &o ), op, weight ) );
+    }
 }
 
 BoolVar s_bDrawBoundingSphere( "Application/Model/Draw Bounding Shphere", false );
 // If model is mixed with sky box, model's boundary is exculde by 's_ExcludeRange'
 BoolVar s_bExcludeSkyBox( "Application/Model/Exclude Sky Box", true );
 NumVar s_ExcludeRange( "Application/Model/Exclude Range", 1000.f, 500.f, 10000.f );
+// Skin on CPU worker threads and upload, instead of stream-out skinning shader
+BoolVar s_bSoftwareSkinning( "Application/Model/Software Skinning", false );
+// Chain local CCD and analytic knee, otherwise reference CCD
+BoolVar s_bFastIK( "Application/Model/Fast IK", true );
+
 
 struct PmxInstant::Context final
 {
@@ -54,61 +79,51 @@ struct PmxInstant::Context final
     bool IsDynamic( void ) const;
     bool IsSkinUpdate( void ) const;
 
+    void BindGeometry( GraphicsContext& gfxContext );
     void Clear( void );
+    void CollectMeshes( Visitor& visitor );
     void Draw( GraphicsContext& gfxContext, Visitor& visitor );
+    void DrawMesh( GraphicsContext& gfxContext, const PmxModel::Mesh& mesh );
     void DrawBone( void );
     bool LoadModel( const AffineTransform& transform );
-    bool LoadMotion( const std::wstring& FilePath );
-    void JoinWorld( btDynamicsWorld* world );
-    void LeaveWorld( btDynamicsWorld* world );
+    bool LoadMotion( const Animation::AnimationClipPtr& clip );
     void Skinning( GraphicsContext& gfxContext, Visitor& visitor );
     void SetPosition( const Vector3& postion );
-    void SetupSkeleton( const std::vector<PmxModel::Bone>& Bones );
+    void SetupBoneAttribute( void );
     void Update( float kFrameTime );
     void UpdateAfterPhysics( float kFrameTime );
 
     Math::BoundingBox GetBoundingBox() const;
+    Math::BoundingBox GetBoundingBox( const IMesh& mesh ) const;
     AffineTransform GetTransform() const;
     void SetTransform( const AffineTransform& transform );
-    const OrthogonalTransform GetTransform( int32_t i ) const;
-    void SetTransform( int32_t i, const OrthogonalTransform& transform );
-    void UpdateTransform( int32_t i );
 
 protected:
 
-    void LoadBoneMotion( const std::vector<Vmd::BoneFrame>& frames );
-    void PerformTransform( int32_t i );
-    void SoftwareSkinning();
-    void UpdateChildPose( int32_t idx );
-    void UpdateIK( const PmxModel::IKAttr& ik );
-    void UpdatePose();
+    void UpdateMaterialMorph( void );
+    void UpdateMaterialWeight( void );
+    void UpdateMeshBounds( void );
 
     PmxModel& m_Model;
     PmxInstant* m_Parent;
     bool m_bRightHand;
-    AffineTransform m_ModelTransform;
-
-    // Skinning
-    std::vector<Quaternion> localInherentOrientations;
-    std::vector<Vector3> localInherentTranslations;
-    std::vector<OrthogonalTransform> m_toRoot; // inverse initial pose
-    std::vector<OrthogonalTransform> m_LocalPose;
-    std::vector<OrthogonalTransform> m_LocalPoseDefault; // offset matrix
-    std::vector<OrthogonalTransform> m_Pose;
-    std::vector<OrthogonalTransform> m_Skinning; // final skinning transform
-    std::vector<OrthogonalTransform> m_SkinningPrev; // previous
+
+    // Morph, bone, IK and physics, see PmxSimulation
+    PmxSimulation m_Simulation;
+
+    std::vector<float> m_MaterialMorphWeight; // applied to 'm_MaterialCB'
+    std::vector<PmxModel::MaterialCB> m_MaterialCB; // only if model has material morph
 
     // Bone
-    std::vector<Animation::BoneMotion> m_BoneMotions;
     std::vector<AffineTransform> m_BoneAttribute;
 
-    std::map<std::wstring, uint32_t> m_MorphIndex;
-    std::vector<Animation::MorphMotion> m_MorphMotions;
-    std::vector<RigidBodyPtr> m_RigidBodies;
-    std::vector<JointPtr> m_Joints;
-    std::vector<Vector3> m_Delta; // tempolar space to store morphed position delta
+    std::vector<XMFLOAT2> m_TexCoord; // morphed UV, upload staging
+
+    std::vector<Math::BoundingBox> m_MeshBounds; // world space, per 'm_Model.m_Mesh'
+    bool m_bMeshBoundsDirty; // transform changed since bounds were taken
 
-    bool m_bVertexUpdated;
+    bool m_bSoftwareSkinned; // CPU skinned, waiting for upload
+    SoftwareSkinning m_SoftwareSkinning;
 
     VertexBuffer m_VertexMorphBuffer;
     VertexBuffer m_PositionBuffer;
@@ -120,8 +135,8 @@ protected:
 };
 
 PmxInstant::Context::Context( PmxModel& model, PmxInstant* parent ) :
-    m_Model( model ), m_bRightHand( true ), m_ModelTransform( kIdentity ), m_Parent( parent ), 
-    m_bVertexUpdated( true )
+    m_Model( model ), m_bRightHand( true ), m_Parent( parent ), m_Simulation( model ),
+    m_bSoftwareSkinned( false ), m_bMeshBoundsDirty( true )
 {
 }
 
@@ -132,16 +147,12 @@ PmxInstant::Context::~Context()
 
 bool PmxInstant::Context::IsDynamic( void ) const
 {
-    // If there's no motion data. Update is not needed.
-    if (m_BoneMotions.size() > 0)
-        return true;
-    return m_Model.m_RigidBodies.size() > 0;
+    return m_Simulation.IsDynamic();
 }
 
 void PmxInstant::Context::Clear()
 {
-    ASSERT( g_DynamicsWorld != nullptr );
-    LeaveWorld( g_DynamicsWorld );
+    Physics::RemoveIslandMember( &m_Simulation );
 
 	m_PositionBuffer.Destroy();
     m_PositionSkinBuffer.Destroy();
@@ -149,34 +160,62 @@ void PmxInstant::Context::Clear()
     m_NormalSkinBuffer.Destroy();
     m_TextureCoordBuffer.Destroy();
     m_EdgeScaleBuffer.Destroy();
+    m_VertexMorphBuffer.Destroy();
+    m_SoftwareSkinning.Clear();
+    m_Simulation.Clear();
+    m_TexCoord.clear();
+    m_MeshBounds.clear();
+    m_MaterialCB.clear();
 }
 
-void PmxInstant::Context::Draw( GraphicsContext& gfxContext, Visitor& visitor )
+void PmxInstant::Context::BindGeometry( GraphicsContext& gfxContext )
 {
 	gfxContext.SetVertexBuffer( 0, m_PositionSkinBuffer.VertexBufferView() );
 	gfxContext.SetVertexBuffer( 1, m_NormalSkinBuffer.VertexBufferView() );
 	gfxContext.SetVertexBuffer( 2, m_TextureCoordBuffer.VertexBufferView() );
 	gfxContext.SetVertexBuffer( 3, m_EdgeScaleBuffer.VertexBufferView() );
 	gfxContext.SetIndexBuffer( m_Model.m_IndexBuffer.IndexBufferView() );
+}
 
+void PmxInstant::Context::CollectMeshes( Visitor& visitor )
+{
     for (auto& mesh : m_Model.m_Mesh)
 	{
         if (!visitor.Visit( mesh, *m_Parent ))
             continue;
-        auto& material = m_Model.m_Materials[mesh.MaterialIndex];
-        if (!visitor.Visit( material ))
+        visitor.Visit( m_Model.m_Materials[mesh.MaterialIndex] );
+	}
+}
+
+void PmxInstant::Context::Draw( GraphicsContext& gfxContext, Visitor& visitor )
+{
+    BindGeometry( gfxContext );
+    for (auto& mesh : m_Model.m_Mesh)
+	{
+        if (!visitor.Visit( mesh, *m_Parent ))
             continue;
-        material.SetTexture( gfxContext );
-        gfxContext.SetDynamicConstantBufferView( 4, sizeof( material.CB ), &material.CB, { kBindVertex, kBindPixel } );
-        gfxContext.DrawIndexed( mesh.IndexCount, mesh.IndexOffset, 0 );
+        if (!visitor.Visit( m_Model.m_Materials[mesh.MaterialIndex] ))
+            continue;
+        DrawMesh( gfxContext, mesh );
 	}
 }
 
+void PmxInstant::Context::DrawMesh( GraphicsContext& gfxContext, const PmxModel::Mesh& mesh )
+{
+    auto& material = m_Model.m_Materials[mesh.MaterialIndex];
+    material.SetTexture( gfxContext );
+    const auto& cb = m_MaterialCB.empty() ? material.CB : m_MaterialCB[mesh.MaterialIndex];
+    gfxContext.SetDynamicConstantBufferView( 4, sizeof( cb ), &cb, { kBindVertex, kBindPixel } );
+    gfxContext.DrawIndexed( mesh.IndexCount, mesh.IndexOffset, 0 );
+}
+
 void PmxInstant::Context::DrawBone()
 {
+    const auto& skinning = m_Simulation.GetSkinning();
+    const AffineTransform modelTransform = m_Simulation.GetTransform();
 	auto numBones = m_BoneAttribute.size();
 	for (auto i = 0; i < numBones; i++)
-        PrimitiveUtility::Append( PrimitiveUtility::kBoneMesh, m_ModelTransform * m_Skinning[i] * m_BoneAttribute[i] );
+        PrimitiveUtility::Append( PrimitiveUtility::kBoneMesh, modelTransform * skinning[i] * m_BoneAttribute[i] );
 }
 
 bool PmxInstant::Context::LoadModel( const AffineTransform& transform )
@@ -194,171 +233,86 @@ bool PmxInstant::Context::LoadModel( const AffineTransform& transform )
     BufferCreate( m_PositionSkinBuffer, m_Position );
     BufferCreate( m_NormalSkinBuffer, m_Normal );
 
-	SetupSkeleton( m_Model.m_Bones );
-
-    m_Delta.resize( m_Model.m_Position.size() );
-    memset( m_Delta.data(), 0, GetVectorSize( m_Delta ) );
-    m_MorphMotions.resize( m_Model.m_Morphs.size() );
-	for ( auto i = 0; i < m_Model.m_Morphs.size(); i++ )
-	{
-		auto& morph = m_Model.m_Morphs[i];
-		m_MorphIndex[morph.Name] = i;
-        auto numVertices = morph.VertexList.size();
-        auto& motion = m_MorphMotions[i];
-        motion.m_Name = morph.Name;
-        motion.m_NameEnglish = morph.NameEnglish;
-        motion.m_MorphVertices.reserve( numVertices );
-		for (auto& vert : morph.VertexList)
-        {
-			motion.m_MorphIndices.push_back( vert.VertexIndex );
-			motion.m_MorphVertices.push_back( vert.Position );
-        }
-	}
-
-    for (auto& it : m_Model.m_RigidBodies)
-    {
-        auto body = std::make_shared<RigidBody>();
-        body->SetName( it.Name );
-        body->SetNameEnglish( it.NameEnglish );
-        body->SetBoneRef( BoneRef(m_Parent, it.BoneIndex) );
-        body->SetCollisionGroupID( it.CollisionGroupID );
-        body->SetCollisionMask( it.CollisionGroupMask );
-        body->SetShapeType( static_cast<ShapeType>(it.Shape) );
-        body->SetSize( it.Size );
-        body->SetPosition( it.Position );
-		ASSERT(!isnan(it.Rotation));
-        const Quaternion rot( it.Rotation.x, it.Rotation.y, it.Rotation.z );
-        body->SetRotation( rot );
-        body->SetMass( it.Mass );
-        body->SetLinearDamping( it.LinearDamping );
-        body->SetAngularDamping( it.AngularDamping );
-        body->SetRestitution( it.Restitution );
-        body->SetFriction( it.Friction );
-        body->SetObjectType( static_cast<ObjectType>(it.RigidType) );
-        m_RigidBodies.push_back( std::move(body) );
-    }
+	SetupBoneAttribute();
+    m_Simulation.Load( transform );
 
-    for (auto i = 0; i < m_RigidBodies.size(); i++)
-    {
-        m_RigidBodies[i]->SetIndex( i );
-        m_RigidBodies[i]->Build();
-    }
+    const auto& delta = m_Simulation.GetVertexMorph().GetDelta();
+    m_VertexMorphBuffer.Create( m_Model.m_Name + L"_MorphBuf", uint32_t(delta.size()), sizeof(Vector3), delta.data() );
 
-    for (auto& it : m_Model.m_Joints)
+    const auto& morphSchedule = m_Model.m_MorphSchedule;
+    if (morphSchedule.TexCoord.size() > 0)
     {
-        if (it.RigidBodyIndexB < 0 || it.RigidBodyIndexA < 0)
-            continue;
-        auto body = std::make_shared<Joint>();
-        body->SetName( it.Name );
-        body->SetNameEnglish( it.NameEnglish );
-        body->SetType( static_cast<JointType>(it.Type) );
-        body->SetRigidBodyA( m_RigidBodies[it.RigidBodyIndexA] );
-        body->SetRigidBodyB( m_RigidBodies[it.RigidBodyIndexB] );
-        body->SetPosition( it.Position );
-        const Quaternion rot( it.Rotation.x, it.Rotation.y, it.Rotation.z );
-        body->SetRotation( rot );
-        body->SetLinearLowerLimit( it.LinearLowerLimit );
-        body->SetLinearUpperLimit( it.LinearUpperLimit );
-        body->SetAngularLowerLimit( it.AngularLowerLimit );
-        body->SetAngularUpperLimit( it.AngularUpperLimit );
-        body->SetLinearStiffness( it.LinearStiffness );
-        body->SetAngularStiffness( it.AngularStiffness );
-        m_Joints.push_back( std::move( body ) );
+        // CommandContext::WriteBuffer reads in 16 byte units
+        m_TexCoord.resize( m_Model.m_TextureCoord.size() + 2 );
+        std::copy( m_Model.m_TextureCoord.begin(), m_Model.m_TextureCoord.end(), m_TexCoord.begin() );
     }
-
-    for (auto i = 0; i < m_Joints.size(); i++)
+    if (morphSchedule.Material.size() > 0)
     {
-        m_Joints[i]->SetIndex( i );
-        m_Joints[i]->Build();
+        m_MaterialMorphWeight.assign( morphSchedule.Material.size(), 0.f );
+        for (auto& material : m_Model.m_Materials)
+            m_MaterialCB.push_back( material.CB );
     }
 
-    // HACK: See BaseRigidBody for detail
-    SetTransform( transform );
-
-    ASSERT( g_DynamicsWorld != nullptr );
-    JoinWorld( g_DynamicsWorld );
-
+    Physics::AddIslandMember( &m_Simulation );
 
     return true;
 }
 
-bool PmxInstant::Context::LoadMotion( const std::wstring& motionPath )
+bool PmxInstant::Context::LoadMotion( const Animation::AnimationClipPtr& clip )
 {
-	using namespace std;
-	using namespace Animation;
-
-    if (motionPath.empty())
+    if (!m_Simulation.LoadMotion( clip ))
         return false;
-
-	Utility::ByteArray ba = Utility::ReadFileSync( motionPath );
-	Utility::ByteStream bs(ba);
-
-	Vmd::VMD vmd;
-	vmd.Fill( bs, m_bRightHand );
-    if (!vmd.IsValid()) {
-        wprintf( L"Fail to import motion %ws\n", motionPath.c_str() );
-        return false;
-    }
-
-    LoadBoneMotion( vmd.BoneFrames );
-
-	for (auto& frame : vmd.FaceFrames)
-	{
-		MorphKeyFrame key;
-		key.Frame = frame.Frame;
-		key.Weight = frame.Weight;
-        WARN_ONCE_IF(m_MorphIndex.count(frame.FaceName) <= 0, L"Can't find target morph on model: ");
-        if (m_MorphIndex.count(frame.FaceName) > 0)
-        {
-            auto& motion = m_MorphMotions[m_MorphIndex[frame.FaceName]];
-            motion.InsertKeyFrame( key );
-        }
-	}
-	for (auto& face : m_MorphMotions )
-		face.SortKeyFrame();
+    UpdateMaterialWeight();
     return true;
 }
 
-void PmxInstant::Context::JoinWorld( btDynamicsWorld* world )
-{
-    if (world)
-    {
-        for (auto& it : m_RigidBodies) {
-            it->UpdateTransform();
-            it->JoinWorld( world );
-        }
-        for (auto& it : m_Joints)
-            it->JoinWorld( world );
-    }
-}
-
-void PmxInstant::Context::LeaveWorld( btDynamicsWorld* world )
-{
-    if (world)
-    {
-        for (auto& it : m_Joints)
-            it->LeaveWorld( world );
-
-        for (auto& it : m_RigidBodies)
-            it->LeaveWorld( world );
-    }
-}
-
 // Skinning difference check, vertex update flag check
 bool PmxInstant::Context::IsSkinUpdate() const
 {
-    if (m_bVertexUpdated)
+    if (m_Simulation.IsVertexUpdated())
         return true;
     return IsDynamic();
 }
 
 void PmxInstant::Context::Skinning( GraphicsContext& gfxContext, Visitor& visitor )
 {
+    auto& texCoordMorph = m_Simulation.GetTexCoordMorph();
+    if (texCoordMorph.IsDirty())
+    {
+        const auto& base = m_Model.m_TextureCoord;
+        const auto& delta = texCoordMorph.GetDelta();
+        for (auto& range : texCoordMorph.GetDirtyRanges())
+        {
+            // Even index keeps source 16 byte aligned
+            const uint32_t begin = range.Begin & ~1u;
+            for (uint32_t i = begin; i < range.End; i++)
+                XMStoreFloat2( &m_TexCoord[i], XMVectorAdd( XMLoadFloat2( &base[i] ), delta[i] ) );
+            gfxContext.WriteBuffer( m_TextureCoordBuffer, begin * sizeof(XMFLOAT2), &m_TexCoord[begin], (range.End - begin) * sizeof(XMFLOAT2) );
+        }
+        texCoordMorph.ClearDirty();
+    }
+    if (m_bSoftwareSkinned)
+    {
+        const size_t numVertices = m_SoftwareSkinning.GetVertexCount();
+        gfxContext.WriteBuffer( m_PositionSkinBuffer, 0, m_SoftwareSkinning.GetPosition().data(), numVertices * sizeof( XMFLOAT3 ) );
+        gfxContext.WriteBuffer( m_NormalSkinBuffer, 0, m_SoftwareSkinning.GetNormal().data(), numVertices * sizeof( XMFLOAT3 ) );
+        m_bSoftwareSkinned = false;
+        m_Simulation.ClearVertexUpdated();
+        return;
+    }
     if (!IsSkinUpdate()) return;
-    if (m_bVertexUpdated)
-        m_VertexMorphBuffer.Create( m_Model.m_Name + L"_MorphBuf", uint32_t(m_Delta.size()), sizeof(Vector3), m_Delta.data() );
-    const auto numByte = GetVectorSize( m_Skinning );
-    gfxContext.SetDynamicConstantBufferView( 0, numByte, m_Skinning.data(), { kBindVertex } );
+    auto& vertexMorph = m_Simulation.GetVertexMorph();
+    if (vertexMorph.IsDirty())
+    {
+        // Only vertices touched by changed morphs
+        const auto& delta = vertexMorph.GetDelta();
+        for (auto& range : vertexMorph.GetDirtyRanges())
+            gfxContext.WriteBuffer( m_VertexMorphBuffer, range.Begin * sizeof(Vector3), &delta[range.Begin], (range.End - range.Begin) * sizeof(Vector3) );
+        vertexMorph.ClearDirty();
+    }
+    const auto& skinning = m_Simulation.GetSkinning();
+    const auto numByte = GetVectorSize( skinning );
+    gfxContext.SetDynamicConstantBufferView( 0, numByte, skinning.data(), { kBindVertex } );
 	gfxContext.SetVertexBuffer( 0, m_PositionBuffer.VertexBufferView() );
 	gfxContext.SetVertexBuffer( 1, m_NormalBuffer.VertexBufferView() );
     gfxContext.SetVertexBuffer( 2, m_VertexMorphBuffer.VertexBufferView() );
@@ -373,442 +327,140 @@ void PmxInstant::Context::Skinning( GraphicsContext& gfxContext, Visitor& visito
     D3D11_BUFFER_HANDLE clear[] = { nullptr, nullptr };
     gfxContext.SetStreamOutTargets( 2, clear, nullptr );
 
-    m_bVertexUpdated = false;
+    m_Simulation.ClearVertexUpdated();
 }
 
-void PmxInstant::Context::LoadBoneMotion( const std::vector<Vmd::BoneFrame>& frames )
+// Material morph weights out of the simulation, the constant buffers only change with them
+void PmxInstant::Context::UpdateMaterialWeight( void )
 {
-    if (frames.size() <= 0)
+    const auto& schedule = m_Model.m_MorphSchedule;
+    const auto& leafWeight = m_Simulation.GetMorphWeight();
+    if (schedule.Material.empty() || leafWeight.size() != m_Model.m_Morphs.size())
         return;
-    auto& bones = m_Model.m_Bones;
-    m_BoneMotions.resize( bones.size() );
-	for (auto& frame : frames)
-	{
-        auto it = m_Model.m_BoneIndex.find(frame.BoneName);
-        if (it == m_Model.m_BoneIndex.end())
-			continue;
-		Animation::BoneKeyFrame key;
-		key.Frame = frame.Frame;
-        // make offset motion to local translation, to remove add operation in pose
-		Vector3 BoneTranslate(bones[it->second].Translate);
-		key.Local.SetTranslation( Vector3(frame.Offset) + BoneTranslate );
-		key.Local.SetRotation( Quaternion( frame.Rotation ) );
-
-		//
-		// http://harigane.at.webry.info/201103/article_1.html
-		//
-		// X_x1, Y_x1, Z_x1, R_x1,
-		// X_y1, Y_y1, Z_y1, R_y1,
-		// X_x2, Y_x2, Z_x2, R_x2,
-		// X_y2, Y_y2, Z_y2, R_y2,
-		//
-		// ... (duplicated values)
-		//
-		auto interp = reinterpret_cast<const char*>(&frame.Interpolation[0]);
-		float scale = 1.0f / 127.0f;
-
-		for (auto i = 0; i < 4; i++)
-			key.BezierCoeff[i] = Vector4( interp[i], interp[i+4], interp[i+8], interp[i+12] ) * scale;
-
-		m_BoneMotions[it->second].InsertKeyFrame( key );
-	}
-
-	for (auto& bone : m_BoneMotions )
-		bone.SortKeyFrame();
-}
-
-// Use code from 'MMDAI'
-// Copyright (c) 2010-2014  hkrn
-void PmxInstant::Context::PerformTransform( int32_t i )
-{
-    Quaternion orientation( kIdentity );
-    if (m_Model.m_Bones[i].bInherentRotation) {
-        int32_t InherentRefIndex = m_Model.m_Bones[i].ParentInherentBoneIndex;
-        ASSERT( InherentRefIndex >= 0 );
-        if (InherentRefIndex < 0) 
-            return;
-        PmxModel::Bone* parentBoneRef = &m_Model.m_Bones[InherentRefIndex];
-        // If parent also Inherenet, then it has updated value. So, use cached one
-        if (parentBoneRef->bInherentRotation) {
-            orientation *= localInherentOrientations[InherentRefIndex];
-        }
-        else {
-            orientation *= m_LocalPose[InherentRefIndex].GetRotation();
-        }
-        if (!Near( m_Model.m_Bones[i].ParentInherentBoneCoefficent, 1.f, FLT_EPSILON )) {
-            orientation = Slerp( Quaternion( kIdentity ), orientation, m_Model.m_Bones[i].ParentInherentBoneCoefficent );
-        }
-        localInherentOrientations[i] = Normalize(orientation * m_LocalPose[i].GetRotation());
+    bool bMaterialChanged = false;
+    for (size_t k = 0; k < schedule.Material.size(); k++)
+    {
+        const float weight = leafWeight[schedule.Material[k]];
+        if (std::fabs( weight - m_MaterialMorphWeight[k] ) < 0.1e-5f)
+            continue;
+        m_MaterialMorphWeight[k] = weight;
+        bMaterialChanged = true;
     }
-    orientation *= m_LocalPose[i].GetRotation();
-    orientation = Normalize( orientation );
-    Vector3 translation( kZero );
-    if (m_Model.m_Bones[i].bInherentTranslation) {
-        int32_t InherentRefIndex = m_Model.m_Bones[i].ParentInherentBoneIndex;
-        ASSERT( InherentRefIndex >= 0 );
-        if (InherentRefIndex < 0) 
-            return;
-        PmxModel::Bone* parentBoneRef = &m_Model.m_Bones[InherentRefIndex];
-        if (parentBoneRef) {
-            if (parentBoneRef->bInherentTranslation) {
-                translation += localInherentTranslations[InherentRefIndex];
-            }
-            else {
-                translation += m_LocalPose[InherentRefIndex].GetTranslation();
+    if (bMaterialChanged)
+        UpdateMaterialMorph();
+}
+
+void PmxInstant::Context::UpdateMaterialMorph( void )
+{
+    const auto& schedule = m_Model.m_MorphSchedule;
+    const size_t numMaterials = m_MaterialCB.size();
+    for (size_t i = 0; i < numMaterials; i++)
+        m_MaterialCB[i] = m_Model.m_Materials[i].CB;
+
+    // Texture, sphere and toon factors are not in 'MaterialCB'
+    auto Apply = []( PmxModel::MaterialCB& cb, const Pmx::MorphMaterial& it, float weight ) {
+        const uint8_t op = it.OffsetOperation;
+        MorphMaterialValue( cb.Diffuse, it.Diffuse, op, weight );
+        MorphMaterialValue( cb.Specular, it.Specular, op, weight );
+        MorphMaterialValue( cb.SpecularPower, it.SpecularPower, op, weight );
+        MorphMaterialValue( cb.Ambient, it.Ambient, op, weight );
+        MorphMaterialValue( cb.EdgeColor, it.EdgeColor, op, weight );
+        MorphMaterialValue( cb.EdgeSize, it.EdgeSize, op, weight );
+    };
+    for (size_t k = 0; k < schedule.Material.size(); k++)
+    {
+        const float weight = m_MaterialMorphWeight[k];
+        if (weight == 0.f)
+            continue;
+        for (auto& it : m_Model.m_Morphs[schedule.Material[k]].MaterialList)
+        {
+            // Out of range index (-1) means every material
+            if (it.MaterialIndex < numMaterials)
+            {
+                Apply( m_MaterialCB[it.MaterialIndex], it, weight );
+                continue;
             }
+            for (auto& cb : m_MaterialCB)
+                Apply( cb, it, weight );
         }
-        if (!Near( m_Model.m_Bones[i].ParentInherentBoneCoefficent, 1.f, FLT_EPSILON )) {
-            translation *= Scalar(m_Model.m_Bones[i].ParentInherentBoneCoefficent);
-        }
-        localInherentTranslations[i] = translation;
     }
-    translation += m_LocalPose[i].GetTranslation();
-    m_LocalPose[i].SetRotation( orientation );
-    m_LocalPose[i].SetTranslation( translation );
-}
-
-// UNDONE: SKINNING NORMAL
-void PmxInstant::Context::SoftwareSkinning()
-{ 
-    std::vector<Vector3> position( m_Model.m_Position.size() );
-    TaskManager::parallel_for(0, position.size(), [&](size_t i) {
-        const auto& skin = m_Model.m_SkinningUnit[i];
-        const Vector3 pos( m_Model.m_Position[i] );
-        Vector3 skinned( kZero );
-        switch (skin.Type) {
-        case Pmx::kBdef1:
-            skinned = m_Skinning[skin.Unit.bdef1.BoneIndex] * pos;
-            break;
-        case Pmx::kBdef2:
-            skinned += m_Skinning[skin.Unit.bdef2.BoneIndex[0]] * pos * skin.Unit.bdef2.Weight;
-            skinned += m_Skinning[skin.Unit.bdef2.BoneIndex[1]] * pos * (1 - skin.Unit.bdef2.Weight );
-            break;
-        case Pmx::kBdef4:
-            for (int k = 0; k < 4; k++)
-                skinned += m_Skinning[skin.Unit.bdef4.BoneIndex[k]] * pos * skin.Unit.bdef4.Weight[k];
-            break;
-        case Pmx::kSdef:
-            auto o0 = m_Skinning[skin.Unit.sdef.BoneIndex[0]];
-            auto o1 = m_Skinning[skin.Unit.sdef.BoneIndex[1]];
-            float weight0 = skin.Unit.sdef.Weight; 
-            float weight1 = 1 - weight0;
-            DualQuaternion dq00( o0 ), dq10( o1 );
-            dq00 = Normalize( dq00 );
-            dq10 = Normalize( dq10 );
-            if (float(Dot( dq00.Real, dq10.Real )) < 0)
-                weight1 = -weight1;
-            DualQuaternion blended = dq00 * weight0 + dq10 * weight1;
-            blended = Normalize( blended );
-            skinned = blended.Transform( pos );
-            break;
-        };
-        position[i] = skinned;
-    });
-    m_PositionSkinBuffer.Create( m_Model.m_Name + L"_PosBuf", uint32_t(position.size()), sizeof(Vector3), position.data() );
 }
 
 void PmxInstant::Context::Update( float kFrameTime )
 {
-    if (m_MorphMotions.size() > 0)
-	{
-        memset( m_Delta.data(), 0, GetVectorSize(m_Delta) );
-		for (auto i = 0; i < m_MorphMotions.size(); i++)
-		{
-			auto& motion = m_MorphMotions[i];
-            if (motion.m_KeyFrames.size() == 0)
-                continue;
-			motion.Interpolate( kFrameTime );
-			if (std::fabsf( motion.m_WeightPre - motion.m_Weight ) < 0.1e-5)
-				continue;
-			m_bVertexUpdated = true;
-			auto weight = motion.m_Weight;
-			for (auto k = 0; k < motion.m_MorphVertices.size(); k++)
-			{
-                auto idx = motion.m_MorphIndices[k];
-				m_Delta[idx] += weight * motion.m_MorphVertices[k];
-			}
-		}
-	}
-    {
-        //
-        // in initialize m_LocalPoseDefault and in every motion data
-        // position is already translated by offset from parent
-        // so, local_pos = pos + offset
-        //
-        m_LocalPose = m_LocalPoseDefault;
-
-        const size_t numMotions = m_BoneMotions.size();
-        for (auto i = 0; i < numMotions; i++)
-            m_BoneMotions[i].Interpolate( kFrameTime, m_LocalPose[i] );
-        UpdatePose();
-        for (auto& ik : m_Model.m_IKs)
-            UpdateIK( ik );
-        const size_t numBones = m_Model.m_Bones.size();
-        for (auto i = 0; i < numBones; i++)
-            PerformTransform( i );
-        UpdatePose();
-    }
+    m_Simulation.SetFastIK( s_bFastIK );
+    m_Simulation.Update( kFrameTime, Physics::GetFrameIndex() );
+    UpdateMaterialWeight();
 }
 
 void PmxInstant::Context::UpdateAfterPhysics( float kFrameTime )
 {
     (kFrameTime);
 
-    for (auto& it : m_RigidBodies)
-        it->SyncLocalTransform();
-
-    const size_t numBones = m_Model.m_Bones.size();
-    for (auto i = 0; i < numBones; i++)
-        m_Skinning[i] = m_Pose[i] * m_toRoot[i];
-
-    // SoftwareSkinning();
-}
-
-Math::BoundingBox PmxInstant::Context::GetBoundingBox() const
-{
-	if (m_BoneMotions.size() > 0)
-        return m_ModelTransform * m_Skinning[m_Model.m_RootBoneIndex] * m_Model.m_BoundingBox;
-    return m_ModelTransform * m_Model.m_BoundingBox;
-}
+    m_Simulation.UpdateAfterPhysics( Physics::GetFrameIndex() );
 
-AffineTransform PmxInstant::Context::GetTransform() const
-{
-    return m_ModelTransform;
-}
-
-void PmxInstant::Context::SetTransform( const AffineTransform& transform )
-{
-    m_ModelTransform = transform;
+    if (s_bSoftwareSkinning && IsSkinUpdate())
+    {
+        // Output streams are only taken once the CPU path is chosen
+        if (!m_SoftwareSkinning.IsCreated())
+            m_SoftwareSkinning.Create( m_Model.GetSoftwareSkinning() );
+        m_SoftwareSkinning.Skin( m_Simulation.GetSkinning().data(), m_Simulation.GetVertexMorph().GetDelta().data() );
+        m_bSoftwareSkinned = true;
+    }
+    UpdateMeshBounds();
 }
 
-const OrthogonalTransform PmxInstant::Context::GetTransform( int32_t i ) const
+// Skinning settles in UpdateAfterPhysics, so every pass of the frame sees the same bounds
+void PmxInstant::Context::UpdateMeshBounds( void )
 {
-    ASSERT(i >= 0);
-    return OrthogonalTransform(m_ModelTransform) * m_Pose[i];
+    if (!m_bMeshBoundsDirty && !m_MeshBounds.empty() && !IsSkinUpdate())
+        return;
+    m_Model.m_SkinnedBounds.Update( m_Simulation.GetTransform(), m_Simulation.GetSkinning().data(), m_MeshBounds );
+    m_bMeshBoundsDirty = false;
 }
 
-void PmxInstant::Context::UpdateTransform( int32_t i )
+Math::BoundingBox PmxInstant::Context::GetBoundingBox() const
 {
-    auto parentIndex = m_Model.m_Bones[i].Parent;
-    if (parentIndex >= 0)
-        m_Pose[i] = m_Pose[parentIndex] * m_LocalPose[i];
+    if (m_MeshBounds.empty())
+        return m_Simulation.GetBoundingBox();
+    BoundingBox box;
+    for (auto& bound : m_MeshBounds)
+        if (bound.IsValid())
+            box.Merge( bound );
+    return box;
 }
 
-void PmxInstant::Context::SetTransform( int32_t i, const OrthogonalTransform& transform )
+Math::BoundingBox PmxInstant::Context::GetBoundingBox( const IMesh& mesh ) const
 {
-    m_Pose[i] = ~OrthogonalTransform(m_ModelTransform) * transform;
+    const auto* pmxMesh = dynamic_cast<const PmxModel::Mesh*>(&mesh);
+    const auto& meshes = m_Model.m_Mesh;
+    if (pmxMesh == nullptr || meshes.empty() || pmxMesh < meshes.data() || pmxMesh >= meshes.data() + meshes.size())
+        return BoundingBox();
+    const size_t index = pmxMesh - meshes.data();
+    return index < m_MeshBounds.size() ? m_MeshBounds[index] : BoundingBox();
 }
 
-void PmxInstant::Context::UpdateChildPose( int32_t idx )
+AffineTransform PmxInstant::Context::GetTransform() const
 {
-    auto parentIndex = m_Model.m_Bones[idx].Parent;
-    if (parentIndex >= 0)
-        m_Pose[idx] = m_Pose[parentIndex] * m_LocalPose[idx];
-    else
-        m_Pose[idx] = m_LocalPose[idx];
-
-	for (auto c : m_Model.m_Bones[idx].Child)
-		UpdateChildPose( c );
+    return m_Simulation.GetTransform();
 }
 
-//
-// Solve Constrainted IK
-// Cyclic-Coordinate-Descent（CCD）
-//
-// http://d.hatena.ne.jp/edvakf/20111102/1320268602
-//
-void PmxInstant::Context::UpdateIK(const PmxModel::IKAttr& ik)
-{
-	auto GetPosition = [&]( int32_t index ) -> Vector3
-	{
-		return Vector3(m_Pose[index].GetTranslation());
-	};
-
-	// "effector" (Fixed)
-	const auto ikBonePos = GetPosition( ik.BoneIndex );
-
-	for (int n = 0; n < ik.NumIteration; n++)
-	{
-		// "effected" bone listed in order
-		for (auto k = 0; k < ik.Link.size(); k++)
-		{
-            // TargetVector (link-target) is updated in each iteration
-            // toward IkVector (link-ik)
-            const auto ikTargetBonePos = GetPosition( ik.TargetBoneIndex );
-
-			if (Length(ikBonePos - ikTargetBonePos) < FLT_EPSILON)
-				return;
-
-			auto linkIndex = ik.Link[k].BoneIndex;
-			auto invLinkMtx = Invert( m_Pose[linkIndex] );
-
-			// transform to child bone's local coordinate.
-			auto ikTargetVec = Vector3( invLinkMtx * ikTargetBonePos );
-			auto ikBoneVec = Vector3( invLinkMtx * ikBonePos );
-
-        #if 1
-			auto axis = Cross( ikBoneVec, ikTargetVec );
-			auto axisLen = Length( axis );
-			auto sinTheta = axisLen / Length( ikTargetVec ) / Length( ikBoneVec );
-			if (sinTheta < 1.0e-5f)
-				continue;
-
-			// move angles in one iteration
-			auto maxAngle = (k + 1) * ik.LimitedRadian * 4;
-			auto theta = ASin( sinTheta );
-			if (Dot( ikTargetVec, ikBoneVec ) < 0.f)
-				theta = XM_PI - theta;
-			if (theta > maxAngle)
-				theta = maxAngle;
-
-			auto rotBase = m_LocalPose[linkIndex].GetRotation();
-			auto translate = m_LocalPose[linkIndex].GetTranslation();
-
-			// To apply base coordinate system which it is base on, inverted theta direction
-			Quaternion rotNext( axis, -theta );
-			auto rotFinish = rotBase * rotNext;
-
-			// Constraint IK, restrict rotation angle
-			if (ik.Link[k].bLimit)
-			{
-            #define EXPERIMENT_IK
-            #ifndef EXPERIMENT_IK
-                // c = cos(theta / 2)
-                auto c = XMVectorGetW( rotFinish );
-                // s = sin(theta / 2)
-                auto s = Sqrt( 1.0f - c*c );
-                rotFinish = Quaternion( Vector4( s, 0, 0, c ) );
-                if (!m_bRightHand)
-                {
-                    auto a = -std::asin( s );
-                    rotFinish = Quaternion( Vector4( std::sin( a ), 0, 0, std::cos( a ) ) );
-                }
-            #else
-                // Use code from 'MMD-Agent'
-                // when this is the first iteration, we force rotating to the maximum angle toward limited direction
-                // this will help convergence the whole IK step earlier for most of models, especially for legs
-                if (n == 0)
-                {
-                    if (theta < 0.0f)
-                        theta = -theta;
-                    rotFinish = rotBase * Quaternion( Vector3( 1.0f, 0.f, 0.f ), theta );
-				}
-				else
-				{
-					//
-					// Needed to stable IK result (esp. Ankle)
-					// The value obtained from the test
-					//
-					const Scalar PMDMinRotX = 0.10f;
-					auto next = rotNext.Euler();
-					auto base = rotBase.Euler();
-
-					auto sum = Clamp( next.GetX() + base.GetX(), PMDMinRotX, Scalar(XM_PI) );
-					next = Vector3( sum - base.GetX(), 0.f, 0.f );
-					rotFinish = rotBase * Quaternion( next.GetX(), next.GetY(), next.GetZ() );
-				}
-            #endif
-			}
-			m_LocalPose[linkIndex] = OrthogonalTransform( rotFinish, translate );
-			UpdateChildPose( linkIndex );
-        #else
-            // IK link's coordinate, rotate target vector V_T to V_Ik
-        #if 0
-			// Use code from 'ray'
-            // Copyright (c) 2015-2017  ray
-			Vector3 srcLocal = Normalize(ikTargetVec);
-			Vector3 dstLocal = Normalize(ikBoneVec);
-			float rotationDotProduct = Dot(dstLocal, srcLocal);
-            if (std::abs( rotationDotProduct - 1.f ) < FLT_EPSILON*100)
-                return;
-            float rotationAngle = ACos( rotationDotProduct );
-            rotationAngle = min( ik.LimitedRadian*(k + 1), rotationAngle );
-
-			if (rotationAngle < 0.0001f)
-				continue;
-
-			Vector3 rotationAxis = Cross(srcLocal, dstLocal);
-			rotationAxis = Normalize(rotationAxis);
-
-			Quaternion q0(rotationAxis, rotationAngle);
-        #else
-			auto axis = Cross( ikBoneVec, ikTargetVec );
-			auto axisLen = Length( axis );
-			auto sinTheta = axisLen / Length( ikTargetVec ) / Length( ikBoneVec );
-			if (sinTheta < 1.0e-3f)
-				continue;
-
-			// angle to move in one iteration
-			auto maxAngle = (k + 1) * ik.LimitedRadian * 4;
-			float rotationAngle = ASin( sinTheta );
-			if (Dot( ikTargetVec, ikBoneVec ) < 0.f)
-				rotationAngle = XM_PI - rotationAngle;
-            rotationAngle = min( ik.LimitedRadian*(k + 1), rotationAngle );
-
-			// To apply base coordinate system which it is base on, inverted theta direction
-			Quaternion q0( axis, -rotationAngle );
-        #endif
-
-			if (ik.Link[k].bLimit)
-			{
-                Vector3 euler = Convert2(glm::eulerAngles( Convert2( q0 ) ));
-                // due to rightHand min, max is swap needed
-                Vector3 MinLimit = ik.Link[k].MaxLimit;
-                MinLimit -= Vector3( Scalar( 0.005 ) );
-                euler = Clamp( euler, MinLimit, ik.Link[k].MinLimit );
-                q0 = Quaternion( euler.GetX(), euler.GetY(), euler.GetZ() );
-			}
-
-            auto& linkLocalPose = m_LocalPose[linkIndex];
-			Quaternion qq = q0 * linkLocalPose.GetRotation();
-			linkLocalPose = OrthogonalTransform( qq, linkLocalPose.GetTranslation() );
-			UpdateChildPose( linkIndex );
-        #endif
-        }
-	}
-}
-
-void PmxInstant::Context::UpdatePose()
+void PmxInstant::Context::SetTransform( const AffineTransform& transform )
 {
-    const size_t numBones = m_Model.m_Bones.size();
-    for (auto i = 0; i < numBones; i++)
-    {
-        auto parentIndex = m_Model.m_Bones[i].Parent;
-        if (parentIndex < numBones)
-            m_Pose[i] = m_Pose[parentIndex] * m_LocalPose[i];
-        else
-            m_Pose[i] = m_LocalPose[i];
-    }
+    m_Simulation.SetTransform( transform );
+    m_bMeshBoundsDirty = true;
 }
 
 void PmxInstant::Context::SetPosition( const Vector3& postion )
 {
-    m_ModelTransform = AffineTransform::MakeTranslation( postion );
+    m_Simulation.SetTransform( AffineTransform::MakeTranslation( postion ) );
+    m_bMeshBoundsDirty = true;
 }
 
-void PmxInstant::Context::SetupSkeleton( const std::vector<PmxModel::Bone>& Bones )
+// Bone primitive per bone, pointing to its destination
+void PmxInstant::Context::SetupBoneAttribute( void )
 {
-    auto bones = Bones;
-    const int32_t numBones = static_cast<int32_t>(bones.size());
-    m_Pose.resize( numBones );
-    m_LocalPoseDefault.resize( numBones );
-    m_toRoot.resize( numBones );
-    m_Skinning.resize( numBones );
-    for (auto i = 0; i < bones.size(); i++)
-        m_LocalPoseDefault[i].SetTranslation( bones[i].Translate );
-    m_LocalPose = m_LocalPoseDefault;
-    for (auto i = 0; i < numBones; i++)
-        m_Pose[i].SetTranslation( bones[i].Position );
-    for (auto i = 0; i < numBones; i++)
-        m_toRoot[i] = ~m_Pose[i];
-
-    // set default skinning matrix
-    m_Skinning.resize( numBones );
-
-    localInherentOrientations.resize( numBones );
-    localInherentTranslations.resize( numBones, Vector3(kZero) );
-
-	std::vector<Vector3> GlobalPosition( numBones );
+    const int32_t numBones = static_cast<int32_t>(m_Model.m_Bones.size());
 	m_BoneAttribute.resize( numBones );
 	for ( auto i = 0; i < numBones; i++ )
 	{
@@ -837,9 +489,9 @@ bool PmxInstant::Load( const AffineTransform& transform )
     return m_Context->LoadModel( transform );
 }
 
-bool PmxInstant::LoadMotion( const std::wstring& motion )
+bool PmxInstant::LoadMotion( const Animation::AnimationClipPtr& clip )
 {
-    return m_Context->LoadMotion( motion );
+    return m_Context->LoadMotion( clip );
 }
 
 bool PmxInstant::IsDynamic( void ) const
@@ -857,29 +509,29 @@ void PmxInstant::UpdateAfterPhysics( float deltaT )
     m_Context->UpdateAfterPhysics( deltaT );
 }
 
-const OrthogonalTransform PmxInstant::GetTransform( int32_t i ) const
+void PmxInstant::Accept( Visitor& visitor )
 {
-    return m_Context->GetTransform( i );
+    visitor.Visit( *this );
 }
 
-void PmxInstant::SetTransform( int32_t i, const OrthogonalTransform& transform )
+void PmxInstant::Render( GraphicsContext& Context, Visitor& visitor )
 {
-    m_Context->SetTransform( i, transform );
+    m_Context->Draw( Context, visitor );
 }
 
-void PmxInstant::UpdateLocalTransform( int32_t i )
+bool PmxInstant::CollectMeshes( Visitor& visitor )
 {
-    m_Context->UpdateTransform( i );
+    m_Context->CollectMeshes( visitor );
+    return true;
 }
 
-void PmxInstant::Accept( Visitor& visitor )
+// Packets of this node come from CollectMeshes, so 'mesh' is a PMX mesh
+void PmxInstant::RenderMesh( GraphicsContext& Context, IMesh& mesh, IMaterial& material, bool bBindGeometry )
 {
-    visitor.Visit( *this );
-}
-
-void PmxInstant::Render( GraphicsContext& Context, Visitor& visitor )
-{
-    m_Context->Draw( Context, visitor );
+    (material);
+    if (bBindGeometry)
+        m_Context->BindGeometry( Context );
+    m_Context->DrawMesh( Context, static_cast<PmxModel::Mesh&>(mesh) );
 }
 
 void PmxInstant::RenderBone( GraphicsContext& Context, Visitor& visitor )
@@ -898,6 +550,11 @@ Math::BoundingBox PmxInstant::GetBoundingBox() const
     return m_Context->GetBoundingBox();
 }
 
+Math::BoundingBox PmxInstant::GetBoundingBox( const IMesh& mesh ) const
+{
+    return m_Context->GetBoundingBox( mesh );
+}
+
 Math::AffineTransform PmxInstant::GetTransform() const
 {
     return m_Context->GetTransform();
@@ -906,31 +563,4 @@ Math::AffineTransform PmxInstant::GetTransform() const
 void PmxInstant::SetTransform( const Math::AffineTransform& transform )
 {
     m_Context->SetTransform( transform );
-}
-
-BoneRef::BoneRef( PmxInstant* inst, int32_t i ) : m_Instance( inst ), m_Index( i )
-{
-}
-
-const OrthogonalTransform BoneRef::GetTransform() const
-{
-    ASSERT( m_Instance != nullptr );
-    return m_Instance->GetTransform( m_Index );
-}
-
-void BoneRef::SetTransform( const btTransform& transform )
-{
-    AffineTransform local = Convert( transform );
-    const OrthogonalTransform localOrth( Quaternion( local.GetBasis() ), local.GetTranslation() );
-    SetTransform( localOrth );
-}
-
-void BoneRef::SetTransform( const OrthogonalTransform& transform )
-{
-    m_Instance->SetTransform( m_Index, transform );
-}
-
-void BoneRef::UpdateLocalTransform()
-{
-    m_Instance->UpdateLocalTransform( m_Index );
 }
\ No newline at end of file
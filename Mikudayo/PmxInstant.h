@@ -2,32 +2,20 @@
 
 #include "SceneNode.h"
 
+class IMaterial;
+class IMesh;
 class IModel;
 class Visitor;
-class btTransform;
-class PmxInstant;
 
-namespace Math
+namespace Animation
 {
-    class OrthogonalTransform;
-    class AffineTransform;
+    class AnimationClip;
 }
 
-class BoneRef 
+namespace Math
 {
-public:
-
-    BoneRef() {}
-    BoneRef( PmxInstant* inst, int32_t i );
-
-    const Math::OrthogonalTransform GetTransform() const;
-    void SetTransform( const Math::OrthogonalTransform& transform );
-    void SetTransform( const btTransform& trnasform );
-    void UpdateLocalTransform();
-
-    int32_t m_Index = 0; // valid check needed (-1)
-    PmxInstant* m_Instance = nullptr;
-};
+    class AffineTransform;
+}
 
 class PmxInstant : public SceneNode
 {
@@ -36,24 +24,23 @@ public:
     PmxInstant( IModel& model );
 
     bool Load( const Math::AffineTransform& transform );
-    bool LoadMotion( const std::wstring& motion );
+    bool LoadMotion( const std::shared_ptr<const Animation::AnimationClip>& clip );
 
     virtual bool IsDynamic( void ) const override;
 
     virtual void Accept( Visitor& visitor ) override;
     virtual void Render( GraphicsContext& Context, Visitor& visitor ) override;
+    virtual bool CollectMeshes( Visitor& visitor ) override;
+    virtual void RenderMesh( GraphicsContext& Context, IMesh& mesh, IMaterial& material, bool bBindGeometry ) override;
     virtual void RenderBone( GraphicsContext& Context, Visitor& visitor ) override;
     virtual void Update( float deltaT ) override;
     virtual void UpdateAfterPhysics( float deltaT ) override;
     virtual void Skinning( GraphicsContext& gfxContext, Visitor& visitor ) override;
     virtual Math::BoundingBox GetBoundingBox() const override;
+    virtual Math::BoundingBox GetBoundingBox( const IMesh& mesh ) const override;
     virtual Math::AffineTransform GetTransform() const override;
     virtual void SetTransform( const Math::AffineTransform& transform );
 
-    const Math::OrthogonalTransform GetTransform( int32_t i ) const;
-    void SetTransform( int32_t i, const Math::OrthogonalTransform& transform );
-    void UpdateLocalTransform( int32_t i );
-
 protected:
 
     struct Context;
@@ -214,6 +214,7 @@ bool PmxModel::Load( const ModelInfo& Info )
 
     if (!LoadFromFile( Info.ModelFile ))
         return false;
+    SetSkinnedBounds();
     if (!SetCustomShader( Info.Shader ))
         return false;
     if (!GenerateResource())
@@ -308,19 +309,32 @@ bool PmxModel::LoadFromFile( const std::wstring& FilePath )
     using Pmx::Vertex;
     using Path = boost::filesystem::path;
 
-    ByteArray ba = ReadFileSync( FilePath );
-    ByteStream bs( ba );
+    MappedByteArray ba = MapFileSync( FilePath );
+    m_TextureRoot = Path(FilePath).parent_path().generic_wstring();
+
+    const std::wstring CachePath = GetCachePath( FilePath );
+    const uint64_t HashCode = HashSource( ba->data(), ba->size() );
+    if (LoadCache( CachePath, HashCode ))
+    {
+        // Shader is chosen per load, so it isn't part of the cache
+        for (auto& mat : m_Materials)
+        {
+            mat.ShaderName = m_DefaultShader;
+            if (s_Techniques.count(m_DefaultShader))
+                mat.Techniques = s_Techniques[m_DefaultShader];
+        }
+        return true;
+    }
+
+    ByteReader reader( ba );
 
     Pmx::PMX pmx;
-    pmx.Fill( bs, true );
+    pmx.Fill( reader, true );
     if (!pmx.IsValid()) {
         wprintf( L"Fail to import model %ws\n", FilePath.c_str() );
         return false;
     }
 
-	m_Name = pmx.m_Description.Name;
-    m_TextureRoot = Path(FilePath).parent_path().generic_wstring();
-
     size_t vertexSize = pmx.m_Vertices.size();
 	m_Position.resize( vertexSize );
     m_Normal.resize( vertexSize );
@@ -393,71 +407,8 @@ bool PmxModel::LoadFromFile( const std::wstring& FilePath )
         m_MaterialIndex[mat.Name] = (uint32_t)m_MaterialIndex.size();
 	}
 
-    const auto& Bones = pmx.m_Bones;
-    size_t numBones = Bones.size();
-	m_Bones.resize( numBones );
-	for (auto i = 0; i < numBones; i++)
-	{
-        auto& src = Bones[i];
-        auto& dst = m_Bones[i];
-
-        dst.Name = src.Name;
-        dst.Parent = src.ParentBoneIndex;
-		if (src.ParentBoneIndex >= 0)
-			m_Bones[src.ParentBoneIndex].Child.push_back( i );
-		Vector3 origin = src.Position;
-		Vector3 parentOrigin = Vector3( 0.0f, 0.0f, 0.0f );
-		if( src.ParentBoneIndex >= 0)
-			parentOrigin = Bones[src.ParentBoneIndex].Position;
-		dst.Translate = origin - parentOrigin;
-        dst.Position = origin;
-        dst.DestinationIndex = src.DestinationOriginIndex;
-        dst.DestinationOffset = src.DestinationOriginOffset;
-        dst.bInherentRotation = src.bInherentRotation;
-        dst.bInherentTranslation = src.bInherentTranslation;
-        dst.ParentInherentBoneIndex = src.ParentInherentBoneIndex;
-        dst.ParentInherentBoneCoefficent = src.ParentInherentBoneCoefficent;
-		m_BoneIndex[src.Name] = i;
-	}
-
-    for (auto i = 0; i < numBones; i++)
-    {
-        if (!Bones[i].bIK)
-            continue;
-        auto& it = Bones[i].Ik;
-        IKAttr attr;
-        attr.BoneIndex = i;
-        attr.TargetBoneIndex = it.BoneIndex;
-        attr.LimitedRadian = it.LimitedRadian;
-        attr.NumIteration = it.NumIteration;
-
-        for (auto& ik : it.Link)
-        {
-            IKChild child;
-            child.BoneIndex = ik.BoneIndex;
-            child.bLimit = ik.bLimit;
-            child.MinLimit = ik.MinLimit;
-            child.MaxLimit = ik.MaxLimit;
-            attr.Link.push_back( child );
-        }
-        m_IKs.push_back( attr );
-    }
-
-    // Find root bone
-    ASSERT( numBones > 0 );
-    auto it = std::find_if( m_Bones.begin(), m_Bones.end(), [](const Bone& Bone){
-        return Bone.Name.compare( L"センター" ) == 0;
-    });
-    if (it == m_Bones.end())
-        it = m_Bones.begin();
-    m_RootBoneIndex = static_cast<uint32_t>(std::distance( m_Bones.begin(), it ));
-
-    m_Morphs = std::move( pmx.m_Morphs );
-
-    m_RigidBodies = std::move( pmx.m_RigidBodies );
-    m_Joints = std::move( pmx.m_Joints );
-
-    SetBoundingBox();
+    SetRig( pmx );
+    SaveCache( CachePath, HashCode );
 
     return true;
 }
@@ -480,6 +431,24 @@ bool PmxModel::SetBoundingBox()
     return true;
 }
 
+void PmxModel::SetSkinnedBounds( void )
+{
+    std::vector<SkinnedBounds::MeshRange> ranges;
+    ranges.reserve( m_Mesh.size() );
+    for (auto& mesh : m_Mesh)
+        ranges.push_back( { uint32_t(mesh.IndexOffset), mesh.IndexCount } );
+    m_SkinnedBounds.Build( m_Position, m_Indices, m_SkinningUnit, ranges, m_Morphs, m_Bones.size() );
+}
+
+// Instances update on worker threads, the first of them to skin on CPU builds it
+const SoftwareSkinning::Table& PmxModel::GetSoftwareSkinning( void )
+{
+    std::call_once( m_SoftwareSkinningFlag, [this]() {
+        m_SoftwareSkinning.Build( m_Position, m_Normal, m_SkinningUnit, m_Bones.size() );
+    });
+    return m_SoftwareSkinning;
+}
+
 bool PmxModel::SetCustomShader( const CustomShaderInfo& Data )
 {
     for (auto& matName : Data.MaterialNames)
@@ -538,6 +507,11 @@ bool PmxModel::Material::IsTwoSided() const
     return bTwoSided;
 }
 
+const void* PmxModel::Material::GetTextureKey() const
+{
+    return Textures[kTextureDiffuse];
+}
+
 RenderPipelinePtr PmxModel::Material::GetPipeline( RenderQueue Queue ) 
 {
     return Techniques[Queue];
@@ -1,12 +1,16 @@
-#pragma once
+﻿#pragma once
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include "IModel.h"
 #include "Mesh.h"
 #include "Material.h"
 #include "Pmx.h"
+#include "PmxRig.h"
 #include "RenderPass.h"
+#include "SkinnedBounds.h"
+#include "SoftwareSkinning.h"
 #include "Math/BoundingBox.h"
 #include "Math/BoundingFrustum.h"
 
@@ -16,7 +20,7 @@ namespace Pmx {
     extern std::vector<InputDesc> VertElem;
 }
 
-class PmxModel : public IModel
+class PmxModel : public IModel, public PmxRig
 {
 public:
 
@@ -64,6 +68,7 @@ public:
         bool IsShadowCaster() const override;
         bool IsTransparent() const override;
         bool IsTwoSided() const override;
+        const void* GetTextureKey() const override;
         RenderPipelinePtr GetPipeline( RenderQueue Queue ) override;
         void SetTexture( GraphicsContext& gfxContext ) const;
     };
@@ -77,73 +82,24 @@ public:
         bool IsIntersect( const BoundingFrustum& frustumWS ) const override;
 	};
 	
-	struct Bone
-    {
-        std::wstring Name;
-        Vector3 Translate; // Offset from parent
-        Vector3 Position;
-        int32_t DestinationIndex;
-        Vector3 DestinationOffset;
-        bool bInherentRotation = false;
-        bool bInherentTranslation = false;
-        int32_t ParentInherentBoneIndex = -1;
-        float ParentInherentBoneCoefficent = 0.f;
-		int32_t Parent;
-        std::vector<int32_t> Child;
-	};
-
-    struct IKChild
-    {
-        int32_t BoneIndex;
-        uint8_t bLimit;
-        XMFLOAT3 MinLimit;
-        XMFLOAT3 MaxLimit;
-    };
-
-    struct IKAttr
-    {
-        int32_t BoneIndex;
-        int32_t TargetBoneIndex;
-        int32_t NumIteration;
-        float LimitedRadian;
-        std::vector<IKChild> Link;
-    };
-
-    struct SkinTypeUnit
-    {
-        uint32_t Type;
-        Pmx::SkinUnit Unit;
-    };
+    using SkinTypeUnit = Pmx::SkinTypeUnit;
 
-    std::wstring m_Name;
     std::wstring m_TextureRoot;
     std::wstring m_DefaultShader;
     std::vector<uint32_t> m_Indices;
     std::vector<Material> m_Materials;
     std::vector<Mesh> m_Mesh;
 
-    // Bone
-    uint32_t m_RootBoneIndex; // model center
-    std::vector<Bone> m_Bones;
-    std::vector<IKAttr> m_IKs;
-
-    // Morph
-    std::vector<Pmx::Morph> m_Morphs;
-    // RigidBody
-    std::vector<Pmx::RigidBody> m_RigidBodies;
-    std::vector<Pmx::Joint> m_Joints;
-
     std::map<std::wstring, uint32_t> m_MaterialIndex;
-    std::map<std::wstring, uint32_t> m_BoneIndex;
     std::vector<XMFLOAT3> m_Position;
     std::vector<XMFLOAT3> m_Normal;
     std::vector<XMFLOAT2> m_TextureCoord;
     std::vector<SkinTypeUnit> m_SkinningUnit;
     std::vector<float> m_EdgeScale;
+    SkinnedBounds m_SkinnedBounds; // per mesh bounds under skinning
 
     IndexBuffer m_IndexBuffer;
     ByteAddressBuffer m_SkinningUnitbuffer;
-    Math::BoundingBox m_BoundingBox;
 
     static void Initialize();
     static void Shutdown();
@@ -153,14 +109,26 @@ public:
     void Clear() override;
     bool Load( const ModelInfo& Info ) override;
 
+    // Skinning table shared by instances, built the first time one skins on CPU
+    const SoftwareSkinning::Table& GetSoftwareSkinning( void );
+
 protected:
 
     std::wstring GetImagePath( const std::wstring& FilePath );
     Color GetMaterialToon( const std::wstring& FilePath );
     bool GenerateResource( void );
     bool LoadFromFile( const std::wstring& FilePath );
+    // Compiled model cache (PmxModelCache.cpp)
+    static std::wstring GetCachePath( const std::wstring& FilePath );
+    static uint64_t HashSource( const void* Data, size_t Size );
+    bool LoadCache( const std::wstring& CachePath, uint64_t HashCode );
+    void SaveCache( const std::wstring& CachePath, uint64_t HashCode );
     const ManagedTexture* LoadTexture( std::wstring ImageName, bool bSRGB );
     bool SetBoundingBox();
+    void SetSkinnedBounds( void );
     bool SetCustomShader( const CustomShaderInfo& Data );
     bool SetDefaultShader( const std::wstring& Name );
+
+    SoftwareSkinning::Table m_SoftwareSkinning;
+    std::once_flag m_SoftwareSkinningFlag;
 };
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "stdafx.h"
+#include "PmxModel.h"
+#include "FileUtility.h"
+#include "Hash.h"
+
+#include <fstream>
+#include <type_traits>
+#include <utility>
+#include <boost/filesystem.hpp>
+
+//
+// Compiled model cache
+//
+// Stores what PmxModel::LoadFromFile derives from a .pmx: decoded names,
+// split vertex streams, per-mesh bounding spheres, bone and IK tables.
+// Vertex streams are stored as flat arrays, so a warm start maps the
+// cache file and copies each stream with a single memcpy. Cache is keyed
+// by source path and invalidated by content hash of the source file.
+//
+
+BoolVar UseModelCache( "Application/Model/Use Model Cache", true );
+
+namespace {
+    const char kCacheMagic[4] = { 'P', 'M', 'X', 'C' };
+    const uint32_t kCacheVersion = 2;
+    const std::wstring kCacheFolder = L"ModelCache";
+
+    template <typename Archive> void Transfer( Archive& ar, PmxModel::TexturePath& path );
+    template <typename Archive> void Transfer( Archive& ar, PmxModel::Material& mat );
+    template <typename Archive> void Transfer( Archive& ar, PmxModel::Mesh& mesh );
+    template <typename Archive> void Transfer( Archive& ar, PmxModel::Bone& bone );
+    template <typename Archive> void Transfer( Archive& ar, PmxModel::IKAttr& ik );
+    template <typename Archive> void Transfer( Archive& ar, Pmx::Morph& morph );
+    template <typename Archive> void Transfer( Archive& ar, Pmx::RigidBody& body );
+    template <typename Archive> void Transfer( Archive& ar, Pmx::Joint& joint );
+
+    class CacheWriter
+    {
+    public:
+        CacheWriter( std::ostream& os ) : m_Stream( os )
+        {
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_trivially_copyable<T>::value>::type operator()( const T& v )
+        {
+            Utility::Write( m_Stream, v );
+        }
+
+        void operator()( const Math::Vector3& v )
+        {
+            XMFLOAT3 f;
+            XMStoreFloat3( &f, v );
+            (*this)( f );
+        }
+
+        void operator()( const Math::BoundingSphere& sphere )
+        {
+            XMFLOAT4 f;
+            XMStoreFloat4( &f, Math::Vector4( sphere.GetCenter(), sphere.GetRadius() ) );
+            (*this)( f );
+        }
+
+        void operator()( const std::wstring& str )
+        {
+            (*this)( uint32_t(str.size()) );
+            m_Stream.write( reinterpret_cast<const char*>(str.data()), str.size() * sizeof( wchar_t ) );
+        }
+
+        template <typename T>
+        void operator()( std::vector<T>& v )
+        {
+            (*this)( uint32_t(v.size()) );
+            WriteElements( v, std::is_trivially_copyable<T>() );
+        }
+
+    private:
+        template <typename T>
+        void WriteElements( std::vector<T>& v, std::true_type )
+        {
+            m_Stream.write( reinterpret_cast<const char*>(v.data()), v.size() * sizeof( T ) );
+        }
+
+        template <typename T>
+        void WriteElements( std::vector<T>& v, std::false_type )
+        {
+            for (auto& e : v)
+                Transfer( *this, e );
+        }
+
+        std::ostream& m_Stream;
+    };
+
+    class CacheReader
+    {
+    public:
+        CacheReader( Utility::ByteReader& reader ) : m_Reader( reader )
+        {
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_trivially_copyable<T>::value>::type operator()( T& v )
+        {
+            m_Reader.Read( v );
+        }
+
+        void operator()( Math::Vector3& v )
+        {
+            XMFLOAT3 f;
+            m_Reader.Read( f );
+            v = Math::Vector3( f );
+        }
+
+        void operator()( Math::BoundingSphere& sphere )
+        {
+            XMFLOAT4 f;
+            m_Reader.Read( f );
+            sphere = Math::BoundingSphere( Math::Vector4( f ) );
+        }
+
+        void operator()( std::wstring& str )
+        {
+            uint32_t len = Utility::ReadCount( m_Reader, sizeof( wchar_t ) );
+            str.resize( len );
+            m_Reader.ReadArray( &str[0], len );
+        }
+
+        // Non trivial element at least has a count or a string length
+        template <typename T>
+        void operator()( std::vector<T>& v )
+        {
+            const size_t minSize = std::is_trivially_copyable<T>::value ? sizeof( T ) : sizeof( uint32_t );
+            v.resize( Utility::ReadCount( m_Reader, minSize ) );
+            ReadElements( v, std::is_trivially_copyable<T>() );
+        }
+
+    private:
+        template <typename T>
+        void ReadElements( std::vector<T>& v, std::true_type )
+        {
+            m_Reader.ReadArray( v.data(), v.size() );
+        }
+
+        template <typename T>
+        void ReadElements( std::vector<T>& v, std::false_type )
+        {
+            for (auto& e : v)
+                Transfer( *this, e );
+        }
+
+        Utility::ByteReader& m_Reader;
+    };
+
+    template <typename Archive>
+    void Transfer( Archive& ar, PmxModel::TexturePath& path )
+    {
+        ar( path.bSRGB );
+        ar( path.Path );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, PmxModel::Material& mat )
+    {
+        ar( mat.Name );
+        ar( mat.TexturePathes );
+        ar( mat.CB );
+        ar( mat.bOutline );
+        ar( mat.bCastShadowMap );
+        ar( mat.bTwoSided );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, PmxModel::Mesh& mesh )
+    {
+        ar( mesh.MaterialIndex );
+        ar( mesh.IndexOffset );
+        ar( mesh.IndexCount );
+        ar( mesh.BoundSphere );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, PmxModel::Bone& bone )
+    {
+        ar( bone.Name );
+        ar( bone.Translate );
+        ar( bone.Position );
+        ar( bone.DestinationIndex );
+        ar( bone.DestinationOffset );
+        ar( bone.bInherentRotation );
+        ar( bone.bInherentTranslation );
+        ar( bone.ParentInherentBoneIndex );
+        ar( bone.ParentInherentBoneCoefficent );
+        ar( bone.Parent );
+        ar( bone.Child );
+        ar( bone.DeformLayer );
+        ar( bone.bAfterPhysics );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, PmxModel::IKAttr& ik )
+    {
+        ar( ik.BoneIndex );
+        ar( ik.TargetBoneIndex );
+        ar( ik.NumIteration );
+        ar( ik.LimitedRadian );
+        ar( ik.Link );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, Pmx::Morph& morph )
+    {
+        ar( morph.Name );
+        ar( morph.NameEnglish );
+        ar( morph.Panel );
+        ar( morph.Type );
+        ar( morph.MorphIndex );
+        ar( morph.MorphRate );
+        ar( morph.GroupList );
+        ar( morph.VertexList );
+        ar( morph.BoneList );
+        ar( morph.TexCoordList );
+        ar( morph.MaterialList );
+        ar( morph.FlipList );
+        ar( morph.ImpulseList );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, Pmx::RigidBody& body )
+    {
+        ar( body.Name );
+        ar( body.NameEnglish );
+        ar( body.BoneIndex );
+        ar( body.CollisionGroupID );
+        ar( body.CollisionGroupMask );
+        ar( body.Shape );
+        ar( body.Size );
+        ar( body.Position );
+        ar( body.Rotation );
+        ar( body.Mass );
+        ar( body.LinearDamping );
+        ar( body.AngularDamping );
+        ar( body.Restitution );
+        ar( body.Friction );
+        ar( body.RigidType );
+    }
+
+    template <typename Archive>
+    void Transfer( Archive& ar, Pmx::Joint& joint )
+    {
+        ar( joint.Name );
+        ar( joint.NameEnglish );
+        ar( joint.Type );
+        ar( joint.RigidBodyIndexA );
+        ar( joint.RigidBodyIndexB );
+        ar( joint.Position );
+        ar( joint.Rotation );
+        ar( joint.LinearLowerLimit );
+        ar( joint.LinearUpperLimit );
+        ar( joint.AngularLowerLimit );
+        ar( joint.AngularUpperLimit );
+        ar( joint.LinearStiffness );
+        ar( joint.AngularStiffness );
+    }
+
+    // Swaps each transferred member of two models
+    class CacheSwapper
+    {
+    public:
+        template <typename T>
+        void operator()( T& a, T& b )
+        {
+            std::swap( a, b );
+        }
+    };
+
+    // Archive is called with the same member of each model
+    template <typename Archive, typename... Models>
+    void TransferModel( Archive& ar, Models&... model )
+    {
+        ar( model.m_Name... );
+        ar( model.m_Indices... );
+        ar( model.m_Position... );
+        ar( model.m_Normal... );
+        ar( model.m_TextureCoord... );
+        ar( model.m_SkinningUnit... );
+        ar( model.m_EdgeScale... );
+        ar( model.m_Materials... );
+        ar( model.m_Mesh... );
+        ar( model.m_RootBoneIndex... );
+        ar( model.m_Bones... );
+        ar( model.m_IKs... );
+        ar( model.m_Morphs... );
+        ar( model.m_RigidBodies... );
+        ar( model.m_Joints... );
+    }
+}
+
+std::wstring PmxModel::GetCachePath( const std::wstring& FilePath )
+{
+    namespace fs = boost::filesystem;
+
+    // Models in different folders often share file name
+    const fs::path source = fs::absolute( FilePath );
+    const size_t pathHash = std::hash<std::wstring>()( source.generic_wstring() );
+
+    wchar_t tag[32];
+    swprintf_s( tag, L"_%016llx.cache", (unsigned long long)pathHash );
+    return (fs::path( kCacheFolder ) / (source.stem().wstring() + tag)).generic_wstring();
+}
+
+uint64_t PmxModel::HashSource( const void* Data, size_t Size )
+{
+    const uint64_t* words = static_cast<const uint64_t*>(Data);
+    const size_t numWords = Size / sizeof( uint64_t );
+    size_t hashCode = Utility::HashState( words, numWords );
+    uint64_t remain = 0;
+    memcpy( &remain, words + numWords, Size - numWords * sizeof( uint64_t ) );
+    hashCode = Utility::HashState( &remain, 1, hashCode );
+    return Utility::HashState( &Size, 1, hashCode );
+}
+
+bool PmxModel::LoadCache( const std::wstring& CachePath, uint64_t HashCode )
+{
+    if (!UseModelCache)
+        return false;
+
+    Utility::MappedByteArray ba = Utility::MapFileSync( CachePath );
+    if (ba->size() == 0)
+        return false;
+
+    Utility::ByteReader reader( ba );
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t refHashCode = 0;
+    reader.Read( magic );
+    reader.Read( version );
+    reader.Read( refHashCode );
+    if (memcmp( magic, kCacheMagic, sizeof( magic ) ) || version != kCacheVersion || refHashCode != HashCode)
+        return false;
+
+    // Read into a blank model, a truncated cache must leave nothing for
+    // LoadFromFile to append to
+    PmxModel cached;
+    CacheReader ar( reader );
+    TransferModel( ar, cached );
+    if (reader.Fail() || !reader.IsEOF())
+    {
+        wprintf( L"Discard corrupt model cache %ws\n", CachePath.c_str() );
+        return false;
+    }
+    CacheSwapper swapper;
+    TransferModel( swapper, *this, cached );
+
+    for (uint32_t i = 0; i < m_Materials.size(); i++)
+        m_MaterialIndex[m_Materials[i].Name] = (uint32_t)m_MaterialIndex.size();
+    m_NumVertices = static_cast<uint32_t>(m_Position.size());
+    SetBoundingBox();
+    BuildRig();
+
+    return true;
+}
+
+void PmxModel::SaveCache( const std::wstring& CachePath, uint64_t HashCode )
+{
+    namespace fs = boost::filesystem;
+
+    if (!UseModelCache)
+        return;
+
+    boost::system::error_code error;
+    fs::create_directories( fs::path( CachePath ).parent_path(), error );
+
+    std::ofstream outputFile( CachePath, std::ios::binary );
+    if (!outputFile.is_open())
+        return;
+
+    outputFile.write( kCacheMagic, sizeof( kCacheMagic ) );
+    Utility::Write( outputFile, kCacheVersion );
+    Utility::Write( outputFile, HashCode );
+
+    CacheWriter ar( outputFile );
+    TransferModel( ar, *this );
+}
@@ -0,0 +1,264 @@
+﻿#include "stdafx.h"
+#include "PmxRig.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+bool PmxRig::LoadRig( const std::wstring& FilePath )
+{
+    Utility::MappedByteArray ba = Utility::MapFileSync( FilePath );
+    Utility::ByteReader reader( ba );
+
+    Pmx::PMX pmx;
+    pmx.Fill( reader, true );
+    if (!pmx.IsValid()) {
+        wprintf( L"Fail to import model %ws\n", FilePath.c_str() );
+        return false;
+    }
+    SetRig( pmx );
+    return true;
+}
+
+void PmxRig::SetRig( Pmx::PMX& pmx )
+{
+    using Math::Vector3;
+
+    m_Name = pmx.m_Description.Name;
+    m_NumVertices = static_cast<uint32_t>(pmx.m_Vertices.size());
+
+    Math::BoundingBox box;
+    for (auto& vert : pmx.m_Vertices)
+        box.Merge( Vector3( vert.Pos ) );
+    m_BoundingBox = box;
+
+    const auto& Bones = pmx.m_Bones;
+    size_t numBones = Bones.size();
+    m_Bones.resize( numBones );
+    for (auto i = 0; i < numBones; i++)
+    {
+        auto& src = Bones[i];
+        auto& dst = m_Bones[i];
+
+        dst.Name = src.Name;
+        dst.Parent = src.ParentBoneIndex;
+        if (src.ParentBoneIndex >= 0)
+            m_Bones[src.ParentBoneIndex].Child.push_back( i );
+        Vector3 origin = src.Position;
+        Vector3 parentOrigin = Vector3( 0.0f, 0.0f, 0.0f );
+        if( src.ParentBoneIndex >= 0)
+            parentOrigin = Bones[src.ParentBoneIndex].Position;
+        dst.Translate = origin - parentOrigin;
+        dst.Position = origin;
+        dst.DestinationIndex = src.DestinationOriginIndex;
+        dst.DestinationOffset = src.DestinationOriginOffset;
+        dst.bInherentRotation = src.bInherentRotation;
+        dst.bInherentTranslation = src.bInherentTranslation;
+        dst.ParentInherentBoneIndex = src.ParentInherentBoneIndex;
+        dst.ParentInherentBoneCoefficent = src.ParentInherentBoneCoefficent;
+        dst.DeformLayer = src.MoprhHierarchy;
+        dst.bAfterPhysics = src.bTransformAfterPhysics;
+    }
+
+    for (auto i = 0; i < numBones; i++)
+    {
+        if (!Bones[i].bIK)
+            continue;
+        auto& it = Bones[i].Ik;
+        IKAttr attr;
+        attr.BoneIndex = i;
+        attr.TargetBoneIndex = it.BoneIndex;
+        attr.LimitedRadian = it.LimitedRadian;
+        attr.NumIteration = it.NumIteration;
+
+        for (auto& ik : it.Link)
+        {
+            IKChild child;
+            child.BoneIndex = ik.BoneIndex;
+            child.bLimit = ik.bLimit;
+            child.MinLimit = ik.MinLimit;
+            child.MaxLimit = ik.MaxLimit;
+            attr.Link.push_back( child );
+        }
+        m_IKs.push_back( attr );
+    }
+
+    // Find root bone
+    ASSERT( numBones > 0 );
+    auto it = std::find_if( m_Bones.begin(), m_Bones.end(), [](const Bone& Bone){
+        return Bone.Name.compare( L"センター" ) == 0;
+    });
+    if (it == m_Bones.end())
+        it = m_Bones.begin();
+    m_RootBoneIndex = static_cast<uint32_t>(std::distance( m_Bones.begin(), it ));
+
+    m_Morphs = std::move( pmx.m_Morphs );
+
+    m_RigidBodies = std::move( pmx.m_RigidBodies );
+    m_Joints = std::move( pmx.m_Joints );
+
+    BuildRig();
+}
+
+void PmxRig::BuildRig( void )
+{
+    m_BoneIndex.clear();
+    for (uint32_t i = 0; i < m_Bones.size(); i++)
+        m_BoneIndex[m_Bones[i].Name] = i;
+    SetBoneSchedule();
+    SetMorphSchedule();
+}
+
+void PmxRig::SetBoneSchedule( void )
+{
+    enum { kUnvisited, kVisiting, kDone };
+
+    const uint32_t numBones = static_cast<uint32_t>(m_Bones.size());
+    std::vector<int32_t> parent( numBones, -1 );
+    std::vector<uint32_t> depth( numBones, 0 ), layer( numBones, 0 );
+    std::vector<uint8_t> afterPhysics( numBones, 0 ), state( numBones, kUnvisited );
+    std::vector<uint32_t> chain;
+
+    // Resolve each bone after its parent. Broken parent or cycle makes a root
+    for (uint32_t i = 0; i < numBones; i++)
+    {
+        uint32_t b = i;
+        while (state[b] == kUnvisited)
+        {
+            state[b] = kVisiting;
+            chain.push_back( b );
+            const int32_t p = m_Bones[b].Parent;
+            if (p < 0 || uint32_t(p) >= numBones || state[p] == kVisiting)
+                break;
+            parent[b] = p;
+            b = p;
+        }
+        for (; !chain.empty(); chain.pop_back())
+        {
+            const uint32_t c = chain.back();
+            const int32_t p = parent[c];
+            depth[c] = p < 0 ? 0 : depth[p] + 1;
+            layer[c] = p < 0 ? m_Bones[c].DeformLayer : std::max( m_Bones[c].DeformLayer, layer[p] );
+            afterPhysics[c] = m_Bones[c].bAfterPhysics || (p >= 0 && afterPhysics[p]);
+            state[c] = kDone;
+        }
+    }
+
+    auto Group = [&]( uint32_t i ) { return std::make_tuple( afterPhysics[i], layer[i], depth[i] ); };
+
+    auto& schedule = m_BoneSchedule;
+    schedule = BoneSchedule();
+    schedule.Order.resize( numBones );
+    for (uint32_t i = 0; i < numBones; i++)
+        schedule.Order[i] = i;
+    std::sort( schedule.Order.begin(), schedule.Order.end(), [&]( uint32_t a, uint32_t b ) {
+        return std::tuple_cat( Group( a ), std::make_tuple( a ) ) < std::tuple_cat( Group( b ), std::make_tuple( b ) );
+    });
+
+    schedule.Parent.resize( numBones );
+    schedule.Slot.resize( numBones );
+    for (uint32_t k = 0; k < numBones; k++)
+    {
+        const uint32_t b = schedule.Order[k];
+        schedule.Slot[b] = k;
+        schedule.Parent[k] = parent[b];
+        // Same depth in same group can't depend on each other
+        if (k == 0 || Group( schedule.Order[k - 1] ) != Group( b ))
+            schedule.Batch.push_back( k );
+    }
+    schedule.Batch.push_back( numBones );
+    auto IsAfterPhysics = [&]( uint32_t i ) { return afterPhysics[i] != 0; };
+    schedule.AfterPhysics = static_cast<uint32_t>(std::find_if( schedule.Order.begin(), schedule.Order.end(), IsAfterPhysics ) - schedule.Order.begin());
+
+    // Inherent transform follows file order inside a deform layer
+    for (uint32_t i = 0; i < numBones; i++)
+        if (m_Bones[i].bInherentRotation || m_Bones[i].bInherentTranslation)
+            schedule.Inherent.push_back( i );
+    std::stable_sort( schedule.Inherent.begin(), schedule.Inherent.end(), [&]( uint32_t a, uint32_t b ) {
+        return std::make_tuple( afterPhysics[a], layer[a] ) < std::make_tuple( afterPhysics[b], layer[b] );
+    });
+    schedule.InherentAfterPhysics = static_cast<uint32_t>(std::find_if( schedule.Inherent.begin(), schedule.Inherent.end(), IsAfterPhysics ) - schedule.Inherent.begin());
+
+    std::vector<uint8_t> inherentPose( numBones, 0 );
+    for (uint32_t k = 0; k < numBones; k++)
+    {
+        const uint32_t b = schedule.Order[k];
+        const int32_t p = parent[b];
+        inherentPose[b] = m_Bones[b].bInherentRotation || m_Bones[b].bInherentTranslation || (p >= 0 && inherentPose[p]);
+        if (inherentPose[b])
+            schedule.InherentPose.push_back( k );
+    }
+
+    // Descendants of each bone in schedule order, replaces recursion over 'Child'
+    schedule.SubtreeOffset.assign( numBones + 1, 0 );
+    for (uint32_t b = 0; b < numBones; b++)
+        for (int32_t a = parent[b]; a >= 0; a = parent[a])
+            schedule.SubtreeOffset[a + 1]++;
+    for (uint32_t b = 0; b < numBones; b++)
+        schedule.SubtreeOffset[b + 1] += schedule.SubtreeOffset[b];
+    schedule.Subtree.resize( schedule.SubtreeOffset[numBones] );
+    std::vector<uint32_t> fill( schedule.SubtreeOffset.begin(), schedule.SubtreeOffset.end() - 1 );
+    for (uint32_t k = 0; k < numBones; k++)
+        for (int32_t a = parent[schedule.Order[k]]; a >= 0; a = parent[a])
+            schedule.Subtree[fill[a]++] = k;
+
+    for (auto& ik : m_IKs)
+        ik.BuildChain( parent );
+}
+
+void PmxRig::SetMorphSchedule( void )
+{
+    using Pmx::MorphType;
+
+    const uint32_t numMorphs = static_cast<uint32_t>(m_Morphs.size());
+    auto& schedule = m_MorphSchedule;
+    schedule = MorphSchedule();
+
+    // Nested group is not in the spec, but some models have it. Skip circular reference
+    std::vector<uint8_t> visiting( numMorphs, 0 );
+    std::function<void( uint32_t, float )> Expand = [&]( uint32_t i, float weight ) {
+        if (m_Morphs[i].Type != MorphType::kGroup)
+        {
+            schedule.Leaf.push_back( { i, weight } );
+            return;
+        }
+        if (visiting[i])
+            return;
+        visiting[i] = 1;
+        for (auto& child : m_Morphs[i].GroupList)
+            if (child.Index < numMorphs)
+                Expand( child.Index, weight * child.Weight );
+        visiting[i] = 0;
+    };
+
+    schedule.LeafOffset.push_back( 0 );
+    for (uint32_t i = 0; i < numMorphs; i++)
+    {
+        Expand( i, 1.f );
+        const auto first = schedule.Leaf.begin() + schedule.LeafOffset.back();
+        // Merge a morph reached through several paths
+        std::sort( first, schedule.Leaf.end(), []( const MorphLeaf& a, const MorphLeaf& b ) {
+            return a.Morph < b.Morph;
+        });
+        auto last = first;
+        for (auto it = first; it != schedule.Leaf.end(); ++it)
+        {
+            if (it != first && it->Morph == (last - 1)->Morph)
+                (last - 1)->Weight += it->Weight;
+            else
+                *last++ = *it;
+        }
+        schedule.Leaf.erase( last, schedule.Leaf.end() );
+        schedule.LeafOffset.push_back( static_cast<uint32_t>(schedule.Leaf.size()) );
+
+        const auto& morph = m_Morphs[i];
+        if (morph.Type == MorphType::kVertex && !morph.VertexList.empty())
+            schedule.Vertex.push_back( i );
+        else if (morph.Type == MorphType::kTexCoord && !morph.TexCoordList.empty())
+            schedule.TexCoord.push_back( i );
+        else if (morph.Type == MorphType::kBone && !morph.BoneList.empty())
+            schedule.Bone.push_back( i );
+        else if (morph.Type == MorphType::kMaterial && !morph.MaterialList.empty())
+            schedule.Material.push_back( i );
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Pmx.h"
+#include "IKSolver.h"
+#include "Math/BoundingBox.h"
+
+//
+// Part of a PMX model that animation and physics run on: bones, IK, morphs,
+// rigid bodies and joints. It holds no graphics resource, so it loads and
+// simulates without a device (See, PmxSimulation)
+//
+class PmxRig
+{
+public:
+
+    struct Bone
+    {
+        std::wstring Name;
+        Math::Vector3 Translate; // Offset from parent
+        Math::Vector3 Position;
+        int32_t DestinationIndex;
+        Math::Vector3 DestinationOffset;
+        bool bInherentRotation = false;
+        bool bInherentTranslation = false;
+        int32_t ParentInherentBoneIndex = -1;
+        float ParentInherentBoneCoefficent = 0.f;
+        int32_t Parent;
+        std::vector<int32_t> Child;
+        uint32_t DeformLayer = 0;
+        bool bAfterPhysics = false;
+    };
+
+    // Bone evaluation order, flattened so a pose pass is a linear sweep.
+    // Parents always precede children; deform layer and after physics flag
+    // are inherited from parent, so a child never runs before its parent.
+    struct BoneSchedule
+    {
+        std::vector<uint32_t> Order; // bone index, by (after physics, deform layer, depth)
+        std::vector<int32_t> Parent; // parent bone of Order[k], -1 for root
+        std::vector<uint32_t> Slot; // bone index to position in Order
+        std::vector<uint32_t> Batch; // runs of Order with no dependency inside, ends with Order.size()
+        std::vector<uint32_t> Inherent; // bone index having inherent transform, in deform layer order
+        uint32_t AfterPhysics = 0; // first position in Order evaluated after physics
+        uint32_t InherentAfterPhysics = 0; // first position in Inherent evaluated after physics
+        std::vector<uint32_t> InherentPose; // position in Order, inherent bones and their descendants
+        std::vector<uint32_t> SubtreeOffset; // bone index to range in Subtree
+        std::vector<uint32_t> Subtree; // position in Order of descendants
+    };
+
+    // Group morphs expanded into weighted non group morphs, so instance
+    // evaluates morphs without walking the group graph every frame
+    struct MorphLeaf
+    {
+        uint32_t Morph;
+        float Weight;
+    };
+
+    struct MorphSchedule
+    {
+        std::vector<MorphLeaf> Leaf;
+        std::vector<uint32_t> LeafOffset; // morph index to range in Leaf, ends with Leaf.size()
+        std::vector<uint32_t> Vertex; // non group morph index by type
+        std::vector<uint32_t> TexCoord;
+        std::vector<uint32_t> Bone;
+        std::vector<uint32_t> Material;
+    };
+
+    using IKChild = Animation::IKChild;
+    using IKAttr = Animation::IKAttr;
+
+    std::wstring m_Name;
+    uint32_t m_NumVertices = 0; // range of vertex and UV morphs
+    Math::BoundingBox m_BoundingBox;
+
+    // Bone
+    uint32_t m_RootBoneIndex = 0; // model center
+    std::vector<Bone> m_Bones;
+    std::vector<IKAttr> m_IKs;
+    std::map<std::wstring, uint32_t> m_BoneIndex;
+    BoneSchedule m_BoneSchedule;
+
+    // Morph
+    std::vector<Pmx::Morph> m_Morphs;
+    MorphSchedule m_MorphSchedule;
+    // RigidBody
+    std::vector<Pmx::RigidBody> m_RigidBodies;
+    std::vector<Pmx::Joint> m_Joints;
+
+    // Reads the rig alone, materials and textures are skipped
+    bool LoadRig( const std::wstring& FilePath );
+
+protected:
+
+    // Takes bones, morphs and physics out of 'pmx'
+    void SetRig( Pmx::PMX& pmx );
+    // Tables derived from bones and morphs, after they are set or read from the cache
+    void BuildRig( void );
+    void SetBoneSchedule( void );
+    void SetMorphSchedule( void );
+};
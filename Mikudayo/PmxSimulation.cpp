@@ -0,0 +1,553 @@
+#include "stdafx.h"
+#include "PmxSimulation.h"
+#include "Bullet/LinearMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Math;
+using namespace Physics;
+using Animation::IKSolver;
+
+namespace {
+    bool isnan( const XMFLOAT3& vec3 ) noexcept
+    {
+        using std::isnan;
+        return isnan( vec3.x ) || isnan( vec3.y ) || isnan( vec3.z );
+    }
+
+    // Frames bones take to blend from the animation into physics after a freeze
+    const uint64_t kPhysicsWakeFrames = 15;
+}
+
+PmxSimulation::PmxSimulation( const PmxRig& Rig ) :
+    m_Rig( Rig ), m_ModelTransform( kIdentity )
+{
+}
+
+void PmxSimulation::Load( const AffineTransform& Transform )
+{
+    SetupSkeleton();
+
+    m_VertexMorph.Build( m_Rig.m_Morphs, m_Rig.m_NumVertices );
+    m_LeafWeight.assign( m_Rig.m_Morphs.size(), 0.f );
+    if (m_Rig.m_MorphSchedule.TexCoord.size() > 0)
+        m_TexCoordMorph.Build( m_Rig.m_Morphs, m_Rig.m_NumVertices, Pmx::MorphType::kTexCoord );
+
+    for (auto& it : m_Rig.m_RigidBodies)
+    {
+        auto body = std::make_shared<RigidBody>();
+        body->SetName( it.Name );
+        body->SetNameEnglish( it.NameEnglish );
+        body->SetBoneRef( BoneRef( this, it.BoneIndex ) );
+        body->SetCollisionGroupID( it.CollisionGroupID );
+        body->SetCollisionMask( it.CollisionGroupMask );
+        body->SetShapeType( static_cast<ShapeType>(it.Shape) );
+        body->SetSize( it.Size );
+        body->SetPosition( it.Position );
+        ASSERT( !isnan( it.Rotation ) );
+        const Quaternion rot( it.Rotation.x, it.Rotation.y, it.Rotation.z );
+        body->SetRotation( rot );
+        body->SetMass( it.Mass );
+        body->SetLinearDamping( it.LinearDamping );
+        body->SetAngularDamping( it.AngularDamping );
+        body->SetRestitution( it.Restitution );
+        body->SetFriction( it.Friction );
+        body->SetObjectType( static_cast<ObjectType>(it.RigidType) );
+        m_RigidBodies.push_back( std::move( body ) );
+    }
+
+    for (auto i = 0; i < m_RigidBodies.size(); i++)
+    {
+        m_RigidBodies[i]->SetIndex( i );
+        m_RigidBodies[i]->Build();
+    }
+
+    for (auto& it : m_Rig.m_Joints)
+    {
+        if (it.RigidBodyIndexB < 0 || it.RigidBodyIndexA < 0)
+            continue;
+        auto body = std::make_shared<Joint>();
+        body->SetName( it.Name );
+        body->SetNameEnglish( it.NameEnglish );
+        body->SetType( static_cast<JointType>(it.Type) );
+        body->SetRigidBodyA( m_RigidBodies[it.RigidBodyIndexA] );
+        body->SetRigidBodyB( m_RigidBodies[it.RigidBodyIndexB] );
+        body->SetPosition( it.Position );
+        const Quaternion rot( it.Rotation.x, it.Rotation.y, it.Rotation.z );
+        body->SetRotation( rot );
+        body->SetLinearLowerLimit( it.LinearLowerLimit );
+        body->SetLinearUpperLimit( it.LinearUpperLimit );
+        body->SetAngularLowerLimit( it.AngularLowerLimit );
+        body->SetAngularUpperLimit( it.AngularUpperLimit );
+        body->SetLinearStiffness( it.LinearStiffness );
+        body->SetAngularStiffness( it.AngularStiffness );
+        m_Joints.push_back( std::move( body ) );
+    }
+
+    for (auto i = 0; i < m_Joints.size(); i++)
+    {
+        m_Joints[i]->SetIndex( i );
+        m_Joints[i]->Build();
+    }
+
+    // HACK: See BaseRigidBody for detail
+    SetTransform( Transform );
+
+    for (auto& it : m_RigidBodies)
+        it->UpdateTransform();
+}
+
+bool PmxSimulation::LoadMotion( const Animation::AnimationClipPtr& Clip )
+{
+    if (!Clip)
+        return false;
+    BindMotion( Clip );
+    return true;
+}
+
+void PmxSimulation::Clear( void )
+{
+    m_VertexMorph.Clear();
+    m_TexCoordMorph.Clear();
+}
+
+bool PmxSimulation::HasBoneMotion( void ) const
+{
+    return m_BoneTrack.size() > 0;
+}
+
+bool PmxSimulation::IsDynamic( void ) const
+{
+    // If there's no motion data. Update is not needed.
+    if (HasBoneMotion())
+        return true;
+    return m_Rig.m_RigidBodies.size() > 0;
+}
+
+void PmxSimulation::BindMotion( const Animation::AnimationClipPtr& clip )
+{
+    m_Clip = clip;
+    m_BoneTrack.clear();
+    m_MorphTrack.clear();
+    if (!m_Clip)
+        return;
+
+    // Keep empty if there's no bone motion. See, IsDynamic
+    if (m_Clip->m_BoneTracks.size() > 0)
+    {
+        const size_t numBones = m_Rig.m_Bones.size();
+        m_BoneTrack.resize( numBones );
+        m_BoneCursors.assign( numBones, Animation::KeyFrameCursor() );
+        for (auto i = 0; i < numBones; i++)
+            m_BoneTrack[i] = m_Clip->FindBoneTrack( m_Rig.m_Bones[i].Name );
+    }
+
+    const size_t numMorphs = m_Rig.m_Morphs.size();
+    m_MorphTrack.resize( numMorphs );
+    m_MorphCursors.assign( numMorphs, Animation::KeyFrameCursor() );
+    m_MorphWeight.assign( numMorphs, 0.f );
+    if (m_LeafWeight.size() == numMorphs)
+        UpdateMorph();
+    for (auto i = 0; i < numMorphs; i++)
+        m_MorphTrack[i] = m_Clip->FindMorphTrack( m_Rig.m_Morphs[i].Name );
+}
+
+// Weights of non group morphs, then only changed ones touch vertices
+void PmxSimulation::UpdateMorph( void )
+{
+    const auto& schedule = m_Rig.m_MorphSchedule;
+    std::fill( m_LeafWeight.begin(), m_LeafWeight.end(), 0.f );
+    for (uint32_t i = 0; i < m_MorphWeight.size(); i++)
+    {
+        const float weight = m_MorphWeight[i];
+        if (weight == 0.f)
+            continue;
+        for (auto k = schedule.LeafOffset[i]; k < schedule.LeafOffset[i + 1]; k++)
+            m_LeafWeight[schedule.Leaf[k].Morph] += weight * schedule.Leaf[k].Weight;
+    }
+
+    for (auto i : schedule.Vertex)
+    {
+        if (m_VertexMorph.SetWeight( i, m_LeafWeight[i] ))
+            m_bVertexUpdated = true;
+    }
+    for (auto i : schedule.TexCoord)
+        m_TexCoordMorph.SetWeight( i, m_LeafWeight[i] );
+}
+
+// Use code from 'MMDAI'
+// Copyright (c) 2010-2014  hkrn
+void PmxSimulation::PerformTransform( int32_t i )
+{
+    Quaternion orientation( kIdentity );
+    if (m_Rig.m_Bones[i].bInherentRotation) {
+        int32_t InherentRefIndex = m_Rig.m_Bones[i].ParentInherentBoneIndex;
+        ASSERT( InherentRefIndex >= 0 );
+        if (InherentRefIndex < 0)
+            return;
+        const PmxRig::Bone* parentBoneRef = &m_Rig.m_Bones[InherentRefIndex];
+        // If parent also Inherenet, then it has updated value. So, use cached one
+        if (parentBoneRef->bInherentRotation) {
+            orientation *= localInherentOrientations[InherentRefIndex];
+        }
+        else {
+            orientation *= m_LocalPose[InherentRefIndex].GetRotation();
+        }
+        if (!Near( m_Rig.m_Bones[i].ParentInherentBoneCoefficent, 1.f, FLT_EPSILON )) {
+            orientation = Slerp( Quaternion( kIdentity ), orientation, m_Rig.m_Bones[i].ParentInherentBoneCoefficent );
+        }
+        localInherentOrientations[i] = Normalize(orientation * m_LocalPose[i].GetRotation());
+    }
+    orientation *= m_LocalPose[i].GetRotation();
+    orientation = Normalize( orientation );
+    Vector3 translation( kZero );
+    if (m_Rig.m_Bones[i].bInherentTranslation) {
+        int32_t InherentRefIndex = m_Rig.m_Bones[i].ParentInherentBoneIndex;
+        ASSERT( InherentRefIndex >= 0 );
+        if (InherentRefIndex < 0)
+            return;
+        const PmxRig::Bone* parentBoneRef = &m_Rig.m_Bones[InherentRefIndex];
+        if (parentBoneRef) {
+            if (parentBoneRef->bInherentTranslation) {
+                translation += localInherentTranslations[InherentRefIndex];
+            }
+            else {
+                translation += m_LocalPose[InherentRefIndex].GetTranslation();
+            }
+        }
+        if (!Near( m_Rig.m_Bones[i].ParentInherentBoneCoefficent, 1.f, FLT_EPSILON )) {
+            translation *= Scalar(m_Rig.m_Bones[i].ParentInherentBoneCoefficent);
+        }
+        localInherentTranslations[i] = translation;
+    }
+    translation += m_LocalPose[i].GetTranslation();
+    m_LocalPose[i].SetRotation( orientation );
+    m_LocalPose[i].SetTranslation( translation );
+}
+
+void PmxSimulation::Update( float Frame, uint64_t Version )
+{
+    if (m_MorphTrack.size() > 0)
+    {
+        for (auto i = 0; i < m_MorphTrack.size(); i++)
+        {
+            if (m_MorphTrack[i] < 0)
+                continue;
+            m_MorphWeight[i] = m_Clip->InterpolateMorph( m_MorphTrack[i], Frame, m_MorphCursors[i] );
+        }
+        UpdateMorph();
+    }
+    {
+        //
+        // in initialize m_LocalPoseDefault and in every motion data
+        // position is already translated by offset from parent
+        // so, local_pos = pos + offset
+        //
+        m_LocalPose = m_LocalPoseDefault;
+
+        const size_t numTracks = m_BoneTrack.size();
+        for (auto i = 0; i < numTracks; i++)
+        {
+            if (m_BoneTrack[i] < 0)
+                continue;
+            Vector3 offset;
+            Quaternion rotation;
+            m_Clip->InterpolateBone( m_BoneTrack[i], Frame, m_BoneCursors[i], offset, rotation );
+            // make offset motion to local translation, to remove add operation in pose
+            m_LocalPose[i].SetTranslation( offset + m_LocalPoseDefault[i].GetTranslation() );
+            m_LocalPose[i].SetRotation( rotation );
+        }
+        // Bone morph is added on top of motion
+        for (auto i : m_Rig.m_MorphSchedule.Bone)
+        {
+            const float weight = m_LeafWeight[i];
+            if (weight == 0.f)
+                continue;
+            for (auto& it : m_Rig.m_Morphs[i].BoneList)
+            {
+                if (it.BoneIndex >= m_LocalPose.size())
+                    continue;
+                auto& local = m_LocalPose[it.BoneIndex];
+                const Quaternion rotation = Slerp( Quaternion( kIdentity ), Quaternion( it.Rotation ), weight );
+                local.SetTranslation( local.GetTranslation() + Vector3( it.Translation ) * weight );
+                local.SetRotation( Normalize( local.GetRotation() * rotation ) );
+            }
+        }
+        UpdatePose();
+        IKSolver solver( m_LocalPose, m_Pose, [this]( int32_t i ) { UpdateChildPose( i ); } );
+        for (auto& ik : m_Rig.m_IKs)
+        {
+            if (m_bFastIK)
+                solver.Solve( ik );
+            else
+                solver.SolveReference( ik );
+        }
+
+        // Only inherent bones and their descendants change after IK. The ones
+        // after physics wait for the bodies, see 'UpdateAfterPhysics'
+        const auto& schedule = m_Rig.m_BoneSchedule;
+        for (uint32_t n = 0; n < schedule.InherentAfterPhysics; n++)
+            PerformTransform( schedule.Inherent[n] );
+        for (auto k : schedule.InherentPose)
+        {
+            if (k >= schedule.AfterPhysics)
+                break;
+            ComposePose( k );
+        }
+        m_bAfterPhysicsPending = true;
+    }
+    PublishPhysicsInput( Version );
+}
+
+// Bone targets of this frame, aligned origins are already in from 'UpdateAfterPhysics'
+void PmxSimulation::PublishPhysicsInput( uint64_t Version )
+{
+    m_Version = Version;
+    if (m_RigidBodies.empty())
+        return;
+    auto& input = m_PhysicsInput.GetBack();
+    input.Kinematic.resize( m_RigidBodies.size() );
+    for (size_t i = 0; i < m_RigidBodies.size(); i++)
+    {
+        if (m_RigidBodies[i]->GetType() == kStaticObject)
+            input.Kinematic[i] = m_RigidBodies[i]->GetKinematicTarget();
+    }
+    m_PhysicsInput.Publish( Version );
+}
+
+// Physics thread
+void PmxSimulation::BeginStep( void )
+{
+    if (!m_PhysicsInput.Acquire())
+        return;
+    const auto& input = m_PhysicsInput.GetFront();
+    const size_t numBodies = m_RigidBodies.size();
+    for (size_t i = 0; i < numBodies && input.Kinematic.size() == numBodies; i++)
+    {
+        if (m_RigidBodies[i]->GetType() == kStaticObject)
+            m_RigidBodies[i]->SetKinematicTarget( input.Kinematic[i] );
+    }
+    for (size_t i = 0; i < numBodies && input.AlignedOrigin.size() == numBodies; i++)
+        m_RigidBodies[i]->AlignOrigin( input.AlignedOrigin[i] );
+}
+
+// Main thread, between steps
+void PmxSimulation::SetLod( LodLevel Lod )
+{
+    if (m_PhysicsLod == kLodFrozen && Lod != kLodFrozen)
+    {
+        // Start again from the animated pose at rest, bones blend into physics from there
+        for (auto& it : m_RigidBodies)
+        {
+            it->UpdateTransform();
+            it->GetBody()->setLinearVelocity( btVector3( 0, 0, 0 ) );
+            it->GetBody()->setAngularVelocity( btVector3( 0, 0, 0 ) );
+            it->GetBody()->clearForces();
+        }
+        m_WakeFrame = m_Version;
+    }
+    m_PhysicsLod = Lod;
+}
+
+void PmxSimulation::EndStep( void )
+{
+    auto& bodies = m_PhysicsOutput.GetBack();
+    bodies.resize( m_RigidBodies.size() );
+    for (size_t i = 0; i < m_RigidBodies.size(); i++)
+        bodies[i] = m_RigidBodies[i]->GetBody()->getCenterOfMassTransform();
+    m_PhysicsOutput.Publish( m_PhysicsInput.GetFrontVersion() );
+}
+
+void PmxSimulation::UpdateAfterPhysics( uint64_t Version )
+{
+    // Latest bodies physics published, the same ones again if no step finished since.
+    // Frozen, bones just follow the animation
+    m_PhysicsOutput.Acquire();
+    auto& input = m_PhysicsInput.GetBack();
+    input.AlignedOrigin.clear();
+    const auto& bodies = m_PhysicsOutput.GetFront();
+    if (m_PhysicsLod != kLodFrozen && m_PhysicsOutput.IsValid()
+        && m_PhysicsOutput.GetFrontVersion() >= m_WakeFrame && bodies.size() == m_RigidBodies.size())
+    {
+        const uint64_t wake = Version - m_WakeFrame;
+        const float weight = std::min( 1.f, float(wake) / kPhysicsWakeFrames );
+        input.AlignedOrigin.resize( m_RigidBodies.size() );
+        for (size_t i = 0; i < m_RigidBodies.size(); i++)
+            m_RigidBodies[i]->SyncLocalTransform( bodies[i], input.AlignedOrigin[i], weight );
+    }
+
+    // Bones after physics follow the poses the bodies just wrote, once per 'Update'
+    const auto& schedule = m_Rig.m_BoneSchedule;
+    const size_t numBones = m_Rig.m_Bones.size();
+    if (m_bAfterPhysicsPending)
+    {
+        for (size_t n = schedule.InherentAfterPhysics; n < schedule.Inherent.size(); n++)
+            PerformTransform( schedule.Inherent[n] );
+        for (uint32_t k = schedule.AfterPhysics; k < numBones; k++)
+            ComposePose( k );
+        m_bAfterPhysicsPending = false;
+    }
+    for (auto i = 0; i < numBones; i++)
+        m_Skinning[i] = m_Pose[i] * m_toRoot[i];
+}
+
+void PmxSimulation::JoinWorld( btDynamicsWorld* world )
+{
+    if (world)
+    {
+        for (auto& it : m_RigidBodies)
+            it->JoinWorld( world );
+        for (auto& it : m_Joints)
+            it->JoinWorld( world );
+    }
+}
+
+void PmxSimulation::LeaveWorld( btDynamicsWorld* world )
+{
+    if (world)
+    {
+        for (auto& it : m_Joints)
+            it->LeaveWorld( world );
+
+        for (auto& it : m_RigidBodies)
+            it->LeaveWorld( world );
+    }
+}
+
+bool PmxSimulation::GetAabb( btVector3& Min, btVector3& Max ) const
+{
+    if (m_RigidBodies.empty())
+        return false;
+    Min.setValue( BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT );
+    Max.setValue( -BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT );
+    for (auto& it : m_RigidBodies)
+    {
+        btVector3 bodyMin, bodyMax;
+        it->GetBody()->getAabb( bodyMin, bodyMax );
+        Min.setMin( bodyMin );
+        Max.setMax( bodyMax );
+    }
+    return true;
+}
+
+Math::BoundingBox PmxSimulation::GetBoundingBox( void ) const
+{
+    if (HasBoneMotion())
+        return m_ModelTransform * m_Skinning[m_Rig.m_RootBoneIndex] * m_Rig.m_BoundingBox;
+    return m_ModelTransform * m_Rig.m_BoundingBox;
+}
+
+AffineTransform PmxSimulation::GetTransform( void ) const
+{
+    return m_ModelTransform;
+}
+
+void PmxSimulation::SetTransform( const AffineTransform& transform )
+{
+    m_ModelTransform = transform;
+}
+
+const OrthogonalTransform PmxSimulation::GetTransform( int32_t i ) const
+{
+    ASSERT(i >= 0);
+    return OrthogonalTransform(m_ModelTransform) * m_Pose[i];
+}
+
+void PmxSimulation::SetTransform( int32_t i, const OrthogonalTransform& transform )
+{
+    m_Pose[i] = ~OrthogonalTransform(m_ModelTransform) * transform;
+}
+
+void PmxSimulation::UpdateLocalTransform( int32_t i )
+{
+    auto parentIndex = m_Rig.m_Bones[i].Parent;
+    if (parentIndex >= 0)
+        m_Pose[i] = m_Pose[parentIndex] * m_LocalPose[i];
+}
+
+void PmxSimulation::ComposePose( uint32_t slot )
+{
+    const auto& schedule = m_Rig.m_BoneSchedule;
+    const uint32_t i = schedule.Order[slot];
+    const int32_t parentIndex = schedule.Parent[slot];
+    if (parentIndex >= 0)
+        m_Pose[i] = m_Pose[parentIndex] * m_LocalPose[i];
+    else
+        m_Pose[i] = m_LocalPose[i];
+}
+
+void PmxSimulation::UpdateChildPose( int32_t idx )
+{
+    const auto& schedule = m_Rig.m_BoneSchedule;
+    ComposePose( schedule.Slot[idx] );
+    for (auto k = schedule.SubtreeOffset[idx]; k < schedule.SubtreeOffset[idx + 1]; k++)
+        ComposePose( schedule.Subtree[k] );
+}
+
+// Bones in a batch share depth, so the loop carries no dependency
+void PmxSimulation::UpdatePose( void )
+{
+    const auto& schedule = m_Rig.m_BoneSchedule;
+    const auto* order = schedule.Order.data();
+    const auto* parent = schedule.Parent.data();
+    for (size_t n = 0; n + 1 < schedule.Batch.size(); n++)
+    {
+        const uint32_t begin = schedule.Batch[n], end = schedule.Batch[n + 1];
+        if (parent[begin] < 0)
+        {
+            for (uint32_t k = begin; k < end; k++)
+                m_Pose[order[k]] = m_LocalPose[order[k]];
+            continue;
+        }
+        for (uint32_t k = begin; k < end; k++)
+            m_Pose[order[k]] = m_Pose[parent[k]] * m_LocalPose[order[k]];
+    }
+}
+
+void PmxSimulation::SetupSkeleton( void )
+{
+    const auto& bones = m_Rig.m_Bones;
+    const int32_t numBones = static_cast<int32_t>(bones.size());
+    m_Pose.resize( numBones );
+    m_LocalPoseDefault.resize( numBones );
+    m_toRoot.resize( numBones );
+    m_Skinning.resize( numBones );
+    for (auto i = 0; i < bones.size(); i++)
+        m_LocalPoseDefault[i].SetTranslation( bones[i].Translate );
+    m_LocalPose = m_LocalPoseDefault;
+    for (auto i = 0; i < numBones; i++)
+        m_Pose[i].SetTranslation( bones[i].Position );
+    for (auto i = 0; i < numBones; i++)
+        m_toRoot[i] = ~m_Pose[i];
+
+    localInherentOrientations.resize( numBones );
+    localInherentTranslations.resize( numBones, Vector3(kZero) );
+}
+
+BoneRef::BoneRef( ISkeleton* inst, int32_t i ) : m_Index( i ), m_Instance( inst )
+{
+}
+
+const OrthogonalTransform BoneRef::GetTransform() const
+{
+    ASSERT( m_Instance != nullptr );
+    return m_Instance->GetTransform( m_Index );
+}
+
+void BoneRef::SetTransform( const btTransform& transform )
+{
+    AffineTransform local = Convert( transform );
+    const OrthogonalTransform localOrth( Quaternion( local.GetBasis() ), local.GetTranslation() );
+    SetTransform( localOrth );
+}
+
+void BoneRef::SetTransform( const OrthogonalTransform& transform )
+{
+    m_Instance->SetTransform( m_Index, transform );
+}
+
+void BoneRef::UpdateLocalTransform()
+{
+    m_Instance->UpdateLocalTransform( m_Index );
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "ISkeleton.h"
+#include "PmxRig.h"
+#include "VertexMorph.h"
+#include "AnimationClip.h"
+#include "Bullet/IslandMember.h"
+#include "Bullet/SnapshotBuffer.h"
+#include "Bullet/RigidBody.h"
+#include "Bullet/Joint.h"
+
+//
+// Animation and physics of one PMX model: morph weights, bone pose with IK,
+// and rigid bodies following and driving the bones. Nothing here touches the
+// device, PmxInstant draws from it and the headless runner steps it alone.
+// The caller joins it to a dynamics world and hands out snapshot versions
+//
+class PmxSimulation final : public ISkeleton, public Physics::IIslandMember
+{
+public:
+
+    PmxSimulation( const PmxRig& Rig );
+
+    // Skeleton, morphs, rigid bodies and joints, with the model at 'Transform'
+    void Load( const Math::AffineTransform& Transform );
+    bool LoadMotion( const Animation::AnimationClipPtr& Clip );
+    void Clear( void );
+
+    bool HasBoneMotion( void ) const;
+    bool IsDynamic( void ) const;
+    // Chain local CCD and analytic knee, otherwise reference CCD
+    void SetFastIK( bool bFastIK ) { m_bFastIK = bFastIK; }
+
+    // Morph, bone and IK at 'Frame'. Bone targets are published as 'Version'
+    void Update( float Frame, uint64_t Version );
+    // Latest bodies into the bones, then skinning transforms. 'Version' is the
+    // one to be published next, bones blend in for a while after a wake up
+    void UpdateAfterPhysics( uint64_t Version );
+
+    // ISkeleton, in world space
+    const Math::OrthogonalTransform GetTransform( int32_t i ) const override;
+    void SetTransform( int32_t i, const Math::OrthogonalTransform& transform ) override;
+    void UpdateLocalTransform( int32_t i ) override;
+
+    // IIslandMember
+    void JoinWorld( btDynamicsWorld* world ) override;
+    void LeaveWorld( btDynamicsWorld* world ) override;
+    bool GetAabb( btVector3& Min, btVector3& Max ) const override;
+    Math::BoundingBox GetBoundingBox( void ) const override;
+    void SetLod( Physics::LodLevel Lod ) override;
+    void BeginStep( void ) override;
+    void EndStep( void ) override;
+
+    Math::AffineTransform GetTransform( void ) const;
+    void SetTransform( const Math::AffineTransform& transform );
+
+    // Model space
+    const std::vector<Math::OrthogonalTransform>& GetPose( void ) const { return m_Pose; }
+    const std::vector<Math::OrthogonalTransform>& GetSkinning( void ) const { return m_Skinning; }
+    // Non group morph weights, after group morph expansion
+    const std::vector<float>& GetMorphWeight( void ) const { return m_LeafWeight; }
+    VertexMorph& GetVertexMorph( void ) { return m_VertexMorph; }
+    VertexMorph& GetTexCoordMorph( void ) { return m_TexCoordMorph; }
+    // Set when a vertex morph weight changes, until the skinning clears it
+    bool IsVertexUpdated( void ) const { return m_bVertexUpdated; }
+    void ClearVertexUpdated( void ) { m_bVertexUpdated = false; }
+
+protected:
+
+    void BindMotion( const Animation::AnimationClipPtr& clip );
+    void PublishPhysicsInput( uint64_t Version );
+    void ComposePose( uint32_t slot );
+    void PerformTransform( int32_t i );
+    void SetupSkeleton( void );
+    void UpdateMorph( void );
+    void UpdateChildPose( int32_t idx );
+    void UpdatePose( void );
+
+    const PmxRig& m_Rig;
+    Math::AffineTransform m_ModelTransform;
+    bool m_bFastIK = true;
+
+    // Skinning
+    std::vector<Math::Quaternion> localInherentOrientations;
+    std::vector<Math::Vector3> localInherentTranslations;
+    std::vector<Math::OrthogonalTransform> m_toRoot; // inverse initial pose
+    std::vector<Math::OrthogonalTransform> m_LocalPose;
+    std::vector<Math::OrthogonalTransform> m_LocalPoseDefault; // offset matrix
+    std::vector<Math::OrthogonalTransform> m_Pose;
+    std::vector<Math::OrthogonalTransform> m_Skinning; // final skinning transform
+    bool m_bAfterPhysicsPending = false; // inherent transforms after physics are not applied yet
+
+    // Motion (shared key frames, per instance track binding and playback state)
+    Animation::AnimationClipPtr m_Clip;
+    std::vector<int32_t> m_BoneTrack; // bone index to clip track (-1: not animated)
+    std::vector<Animation::KeyFrameCursor> m_BoneCursors;
+    std::vector<int32_t> m_MorphTrack; // morph index to clip track (-1: not animated)
+    std::vector<Animation::KeyFrameCursor> m_MorphCursors;
+    std::vector<float> m_MorphWeight;
+    std::vector<float> m_LeafWeight; // after group morph expansion
+    VertexMorph m_VertexMorph; // morphed position delta
+    VertexMorph m_TexCoordMorph; // morphed UV delta
+    bool m_bVertexUpdated = true;
+
+    std::vector<RigidBodyPtr> m_RigidBodies;
+    std::vector<JointPtr> m_Joints;
+
+    // Exchange with the physics thread, per rigid body
+    struct PhysicsInput
+    {
+        std::vector<btTransform> Kinematic; // bone driven target
+        std::vector<btVector3> AlignedOrigin; // empty until physics published bodies
+    };
+    Physics::SnapshotBuffer<PhysicsInput> m_PhysicsInput;
+    Physics::SnapshotBuffer<std::vector<btTransform>> m_PhysicsOutput; // center of mass
+    Physics::LodLevel m_PhysicsLod = Physics::kLodFull;
+    uint64_t m_Version = 0; // last published bone snapshot
+    uint64_t m_WakeFrame = 0; // bodies published before this are from before the freeze
+};
@@ -0,0 +1,312 @@
+#include "stdafx.h"
+#include "RenderList.h"
+#include "SceneNode.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "Visitor.h"
+#include "Camera.h"
+#include "Math/BoundingBox.h"
+#include "Math/BoundingFrustum.h"
+#include "TaskManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Math;
+
+namespace {
+    // Below this, a comparison sort beats eight counting passes
+    const size_t kRadixThreshold = 64;
+
+    class NodeListPass : public Visitor
+    {
+    public:
+        NodeListPass( std::vector<SceneNode*>& nodes ) : m_Nodes( nodes ) {}
+        bool Visit( SceneNode& node ) override {
+            m_Nodes.push_back( &node );
+            return true;
+        }
+        std::vector<SceneNode*>& m_Nodes;
+    };
+
+    uint32_t FoldPointer( const void* ptr, uint32_t bits )
+    {
+        const uint64_t hash = (uint64_t(uintptr_t(ptr)) >> 4) * 0x9E3779B97F4A7C15ull;
+        return uint32_t(hash >> (64 - bits));
+    }
+
+    // Order of the bits as unsigned is the order of the floats
+    uint32_t SortableFloat( float value )
+    {
+        uint32_t bits;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+
+    //
+    // Culls each node and mesh once and sorts its materials into queues, the
+    // same way the passes would pick them while walking the scene. Nodes are
+    // visited one by one, not their children (See, RenderList::Build)
+    //
+    class CollectPass : public Visitor
+    {
+    public:
+
+        CollectPass( RenderList::QueueList& queues, const BaseCamera& camera, uint32_t queueMask ) :
+            m_Queues( queues ), m_Frustum( camera.GetWorldSpaceFrustum() ),
+            m_Eye( camera.GetPosition() ), m_Forward( camera.GetForwardVec() ), m_QueueMask( queueMask )
+        {
+        }
+
+        bool Visit( SceneNode& node ) override;
+        bool Visit( IMesh& mesh, SceneNode& node ) override;
+        bool Visit( IMaterial& material ) override;
+
+    protected:
+
+        float GetDepth( const Vector3& position ) const { return Dot( position - m_Eye, m_Forward ); }
+        bool IsListed( RenderQueue Queue ) const { return (m_QueueMask >> Queue) & 1; }
+        void AddDraw( RenderQueue Queue, IMaterial& material, uint64_t key );
+        void AddOpaque( RenderQueue Queue, IMaterial& material, const void* texture );
+
+        RenderList::QueueList& m_Queues;
+        const BoundingFrustum& m_Frustum;
+        Vector3 m_Eye;
+        Vector3 m_Forward;
+        uint32_t m_QueueMask;
+
+        SceneNode* m_Node = nullptr;
+        float m_NodeDepth = 0.f;
+        uint32_t m_Sequence = 0; // transparent draws of the node so far
+        IMesh* m_Mesh = nullptr;
+        float m_MeshDepth = 0.f;
+    };
+
+    bool CollectPass::Visit( SceneNode& node )
+    {
+        if (IsListed( kRenderQueueSkinning ))
+            m_Queues[kRenderQueueSkinning].push_back( { 0, &node, nullptr, nullptr } );
+        // Drawn with the scene reflected in it (See, Forward::MirrorPass)
+        if (node.GetType() == kSceneMirror)
+            return true;
+        // BoundingBox default constructor (Skydome)
+        const BoundingBox box = node.GetBoundingBox();
+        if (box.IsValid() && !m_Frustum.IntersectBox( box ))
+            return true;
+
+        m_Node = &node;
+        m_NodeDepth = GetDepth( box.IsValid() ? box.GetCenter() : node.GetTransform().GetTranslation() );
+        m_Sequence = 0;
+        if (node.CollectMeshes( *this ))
+            return true;
+
+        const uint64_t key = RenderList::MakeOpaqueKey( nullptr, nullptr, nullptr, m_NodeDepth );
+        for (auto queue : { kRenderQueueDepth, kRenderQueueShadow, kRenderQueueOpaque, kRenderQueueOutline, kRenderQueueSkydome })
+        {
+            if (IsListed( queue ))
+                m_Queues[queue].push_back( { key, &node, nullptr, nullptr } );
+        }
+        return true;
+    }
+
+    // Same test as RenderPass::Enable( IMesh&, SceneNode& )
+    bool CollectPass::Visit( IMesh& mesh, SceneNode& node )
+    {
+        const BoundingBox box = node.GetBoundingBox( mesh );
+        bool bVisible = true;
+        if (box.IsValid())
+            bVisible = m_Frustum.IntersectBox( box );
+        else if (!node.IsDynamic())
+            bVisible = mesh.IsIntersect( m_Frustum );
+        m_Mesh = &mesh;
+        m_MeshDepth = box.IsValid() ? GetDepth( box.GetCenter() ) : m_NodeDepth;
+        return bVisible;
+    }
+
+    // Listed only, nothing to draw now
+    bool CollectPass::Visit( IMaterial& material )
+    {
+        const void* texture = material.GetTextureKey();
+        AddOpaque( kRenderQueueDepth, material, texture );
+        AddOpaque( kRenderQueueSkydome, material, texture );
+        if (material.IsShadowCaster())
+            AddOpaque( kRenderQueueShadow, material, texture );
+        if (material.IsOutline())
+            AddOpaque( kRenderQueueOutline, material, texture );
+
+        // Forward pass chooses the pipeline by material, see Forward::DefaultPass
+        const bool bTwoSided = material.IsTwoSided();
+        if (material.IsTransparent())
+        {
+            AddDraw( kRenderQueueTransparent, material, RenderList::MakeTransparentKey( m_NodeDepth, m_Sequence++ ) );
+        }
+        else if (IsListed( kRenderQueueOpaque ))
+        {
+            RenderPipelinePtr pso = material.GetPipeline( bTwoSided ? kRenderQueueOpaqueTwoSided : kRenderQueueOpaque );
+            AddDraw( kRenderQueueOpaque, material, RenderList::MakeOpaqueKey( pso.get(), texture, &material, m_MeshDepth ) );
+        }
+        return false;
+    }
+
+    void CollectPass::AddDraw( RenderQueue Queue, IMaterial& material, uint64_t key )
+    {
+        if (IsListed( Queue ))
+            m_Queues[Queue].push_back( { key, m_Node, m_Mesh, &material } );
+    }
+
+    void CollectPass::AddOpaque( RenderQueue Queue, IMaterial& material, const void* texture )
+    {
+        if (!IsListed( Queue ))
+            return;
+        RenderPipelinePtr pso = material.GetPipeline( Queue );
+        if (pso)
+            AddDraw( Queue, material, RenderList::MakeOpaqueKey( pso.get(), texture, &material, m_MeshDepth ) );
+    }
+}
+
+void RenderList::Clear( void )
+{
+    for (auto& queue : m_Queues)
+        queue.clear();
+}
+
+//
+// Chunks are runs of nodes in visit order, so appending them in chunk order
+// gives the queues a serial walk would
+//
+void RenderList::Build( SceneNode& root, const BaseCamera& camera, uint32_t numChunks, uint32_t queueMask )
+{
+    Clear();
+    m_Nodes.clear();
+    NodeListPass nodeListPass( m_Nodes );
+    root.Accept( nodeListPass );
+
+    const size_t numNodes = m_Nodes.size();
+    numChunks = static_cast<uint32_t>(std::min<size_t>( numChunks, numNodes ));
+    if (numChunks <= 1)
+    {
+        CollectPass collectPass( m_Queues, camera, queueMask );
+        for (auto node : m_Nodes)
+            collectPass.Visit( *node );
+        Sort();
+        return;
+    }
+
+    if (m_Chunks.size() < numChunks)
+        m_Chunks.resize( numChunks );
+    TaskManager::parallel_for( size_t(0), size_t(numChunks), [&]( size_t chunk ) {
+        QueueList& queues = m_Chunks[chunk];
+        for (auto& queue : queues)
+            queue.clear();
+        CollectPass collectPass( queues, camera, queueMask );
+        const size_t begin = numNodes * chunk / numChunks, end = numNodes * (chunk + 1) / numChunks;
+        for (size_t i = begin; i < end; i++)
+            collectPass.Visit( *m_Nodes[i] );
+    });
+    TaskManager::parallel_for( size_t(0), size_t(kRenderQueueMax), [&]( size_t queue ) {
+        Merge( uint32_t(queue), numChunks );
+    });
+    Sort( true );
+}
+
+void RenderList::Merge( uint32_t Queue, uint32_t numChunks )
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < numChunks; i++)
+        count += m_Chunks[i][Queue].size();
+    PacketList& packets = m_Queues[Queue];
+    packets.reserve( count );
+    for (uint32_t i = 0; i < numChunks; i++)
+        packets.insert( packets.end(), m_Chunks[i][Queue].begin(), m_Chunks[i][Queue].end() );
+}
+
+void RenderList::Add( RenderQueue Queue, const DrawPacket& Packet )
+{
+    m_Queues[Queue].push_back( Packet );
+}
+
+void RenderList::Sort( bool bParallel )
+{
+    auto SortQueue = [this]( size_t i ) {
+        // Skinning keeps the scene order, it has no key
+        if (i != kRenderQueueSkinning)
+            RadixSort( m_Queues[i], m_Scratch[i] );
+    };
+    if (bParallel)
+    {
+        TaskManager::parallel_for( size_t(0), size_t(kRenderQueueMax), SortQueue );
+        return;
+    }
+    for (size_t i = 0; i < kRenderQueueMax; i++)
+        SortQueue( i );
+}
+
+size_t RenderList::GetPacketCount( void ) const
+{
+    size_t count = 0;
+    for (auto& queue : m_Queues)
+        count += queue.size();
+    return count;
+}
+
+//
+// Pipeline (12 bits), texture (12), material (16) then depth (24).
+// Negative depth is behind the eye but still overlaps the frustum
+//
+uint64_t RenderList::MakeOpaqueKey( const void* Pipeline, const void* Texture, const void* Material, float Depth )
+{
+    return (uint64_t(FoldPointer( Pipeline, 12 )) << 52)
+        | (uint64_t(FoldPointer( Texture, 12 )) << 40)
+        | (uint64_t(FoldPointer( Material, 16 )) << 24)
+        | (SortableFloat( Depth ) >> 8);
+}
+
+// Far first, then in the order the node listed them
+uint64_t RenderList::MakeTransparentKey( float Depth, uint32_t Sequence )
+{
+    return (uint64_t(~SortableFloat( Depth )) << 32) | Sequence;
+}
+
+void RadixSort( std::vector<DrawPacket>& Packets, std::vector<DrawPacket>& Scratch )
+{
+    const size_t n = Packets.size();
+    if (n < kRadixThreshold)
+    {
+        std::stable_sort( Packets.begin(), Packets.end(), []( const DrawPacket& a, const DrawPacket& b ) {
+            return a.SortKey < b.SortKey;
+        });
+        return;
+    }
+
+    uint32_t count[8][256] = {};
+    for (auto& packet : Packets)
+    {
+        const uint64_t key = packet.SortKey;
+        for (int d = 0; d < 8; d++)
+            count[d][(key >> (d * 8)) & 0xFF]++;
+    }
+
+    Scratch.resize( n );
+    DrawPacket* src = Packets.data();
+    DrawPacket* dst = Scratch.data();
+    for (int d = 0; d < 8; d++)
+    {
+        const int shift = d * 8;
+        uint32_t* offset = count[d];
+        // Every key has the same digit, this pass would not move anything
+        if (offset[(src[0].SortKey >> shift) & 0xFF] == n)
+            continue;
+        uint32_t sum = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            const uint32_t c = offset[b];
+            offset[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[offset[(src[i].SortKey >> shift) & 0xFF]++] = src[i];
+        std::swap( src, dst );
+    }
+    if (src != Packets.data())
+        Packets.swap( Scratch );
+}
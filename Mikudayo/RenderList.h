@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "RenderType.h"
+
+class SceneNode;
+class IMesh;
+class IMaterial;
+
+namespace Math
+{
+    class BaseCamera;
+}
+
+// A draw of a render list. Null 'Mesh' is the whole node drawn by its own
+// Render, for a node that does not list its meshes (See, SceneNode::CollectMeshes)
+struct DrawPacket
+{
+    uint64_t SortKey;
+    SceneNode* Node;
+    IMesh* Mesh;
+    IMaterial* Material;
+};
+
+//
+// Draws of a frame, gathered by one walk of the scene and sorted per queue
+//
+// Each node and mesh is culled once against the camera, then passes replay
+// the queues instead of walking the scene again (See, Scene::Render).
+// Opaque queues sort by pipeline, texture, material and front to back.
+// Transparent queue sorts back to front by node, keeping the material order
+// of a model, as MMD models rely on it.
+//
+// Nodes may be split into chunks collected in parallel, each into its own
+// queues. Chunks are merged in scene order before the stable sort, so the
+// result is the same for any number of chunks.
+//
+// A list may keep only some queues, e.g. the casters of a shadow cascade
+// culled against its light camera (See, Scene::RenderShadow).
+//
+class RenderList
+{
+public:
+
+    using PacketList = std::vector<DrawPacket>;
+    using QueueList = std::array<PacketList, kRenderQueueMax>;
+
+    void Clear( void );
+    static const uint32_t kAllQueues = ~0u;
+
+    // Walks 'root' and sorts the queues, nodes are collected in 'numChunks' parallel runs.
+    // Bit 'q' of 'queueMask' keeps queue 'q'
+    void Build( SceneNode& root, const Math::BaseCamera& camera, uint32_t numChunks = 1, uint32_t queueMask = kAllQueues );
+    void Add( RenderQueue Queue, const DrawPacket& Packet );
+    void Sort( bool bParallel = false );
+
+    const PacketList& Get( RenderQueue Queue ) const { return m_Queues[Queue]; }
+    size_t GetPacketCount( void ) const;
+
+    // Ids are folded pointers, a collision only costs a state change
+    static uint64_t MakeOpaqueKey( const void* Pipeline, const void* Texture, const void* Material, float Depth );
+    static uint64_t MakeTransparentKey( float Depth, uint32_t Sequence );
+
+protected:
+
+    void Merge( uint32_t Queue, uint32_t numChunks );
+
+    QueueList m_Queues;
+    QueueList m_Scratch;
+    std::vector<SceneNode*> m_Nodes; // in visit order
+    std::vector<QueueList> m_Chunks; // kept to reuse their capacity
+};
+
+// Stable LSD radix sort by 'SortKey', 'Scratch' is reused between calls
+void RadixSort( std::vector<DrawPacket>& Packets, std::vector<DrawPacket>& Scratch );
@@ -4,6 +4,7 @@
 #include "SceneNode.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "RenderList.h"
 #include "Math/BoundingFrustum.h"
 
 using namespace Math;
@@ -27,7 +28,13 @@ bool RenderPass::Enable( IMesh& mesh )
 bool RenderPass::Enable( IMesh& mesh, SceneNode& node )
 {
     bool bEnable = true;
-    if (!node.IsDynamic())
+    const Math::BoundingBox& box = node.GetBoundingBox( mesh );
+    if (box.IsValid())
+    {
+        if (m_RenderArgs)
+            bEnable = m_RenderArgs->m_Camera.GetWorldSpaceFrustum().IntersectBox( box );
+    }
+    else if (!node.IsDynamic())
         bEnable = Enable( mesh );
     return bEnable;
 }
@@ -56,6 +63,47 @@ void RenderPass::SetRenderQueue( RenderQueue queue )
     m_RenderQueue = queue;
 }
 
+//
+// Packets come sorted, so a node or a material repeats in runs. Model matrix
+// and geometry are bound when the node changes, pipeline when the material does
+//
+void RenderPass::Render( const std::vector<DrawPacket>& packets )
+{
+    if (m_RenderArgs == nullptr)
+        return;
+    GraphicsContext& context = m_RenderArgs->gfxContext;
+    SceneNode* node = nullptr;
+    SceneNode* geometry = nullptr; // node whose geometry is bound
+    IMaterial* material = nullptr;
+    bool bMaterial = false;
+    for (auto& packet : packets)
+    {
+        if (packet.Mesh == nullptr)
+        {
+            // Binds its own state
+            Visit( *packet.Node );
+            node = geometry = nullptr;
+            material = nullptr;
+            continue;
+        }
+        if (packet.Node != node)
+        {
+            node = packet.Node;
+            Matrix4 modelMatrix = node->GetTransform();
+            context.SetDynamicConstantBufferView( 2, sizeof( modelMatrix ), &modelMatrix, { kBindVertex } );
+        }
+        if (packet.Material != material)
+        {
+            material = packet.Material;
+            bMaterial = Visit( *material );
+        }
+        if (!bMaterial)
+            continue;
+        node->RenderMesh( context, *packet.Mesh, *material, geometry != node );
+        geometry = node;
+    }
+}
+
 bool RenderPass::Visit( IMesh& mesh )
 {
     if (!Enable( mesh ))
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "Visitor.h"
 #include "RenderType.h"
 
@@ -7,6 +8,7 @@ class RenderArgs;
 class SceneNode;
 class IMesh;
 class IMaterial;
+struct DrawPacket;
 
 class RenderPass : public Visitor
 {
@@ -16,6 +18,8 @@ public:
 
     void SetRenderArgs( RenderArgs& args );
     void SetRenderQueue( RenderQueue queue );
+    // Draws a queue of a render list, as visiting the scene would
+    void Render( const std::vector<DrawPacket>& packets );
 
     virtual bool Enable( SceneNode& node );
     virtual bool Enable( IMaterial& material );
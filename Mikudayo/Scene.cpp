@@ -1,44 +1,195 @@
 #include "stdafx.h"
 #include "Scene.h"
+#include "RenderArgs.h"
 #include "RenderPass.h"
+#include "TaskManager.h"
 
-class UpdatePass : public Visitor
-{
-public:
-    UpdatePass( float DeltaT ) : m_DeltaT( DeltaT ) {}
-    bool Visit( SceneNode& node ) override {
-        node.Update( m_DeltaT );
-        return true;
+#include <algorithm>
+#include <unordered_map>
+
+BoolVar s_bParallelUpdate( "Application/Scene/Parallel Update", true );
+// Passes replay a culled and sorted draw list, instead of walking the scene each
+BoolVar s_bRenderList( "Application/Scene/Render List", true );
+BoolVar s_bParallelRenderList( "Application/Scene/Parallel Render List", true );
+
+namespace {
+    // Render list queues a pass of 'Queue' replays, none if it walks the scene
+    uint32_t GetListQueues( RenderQueue Queue, RenderQueue (&List)[2] )
+    {
+        switch (Queue)
+        {
+        case kRenderQueueOpaque:
+            // Forward pass picks opaque or transparent pipeline per material
+            List[0] = kRenderQueueOpaque;
+            List[1] = kRenderQueueTransparent;
+            return 2;
+        case kRenderQueueSkinning:
+        case kRenderQueueDepth:
+        case kRenderQueueShadow:
+        case kRenderQueueTransparent:
+        case kRenderQueueOutline:
+        case kRenderQueueSkydome:
+            List[0] = Queue;
+            return 1;
+        default:
+            return 0;
+        }
     }
-    float m_DeltaT;
-};
+}
 
-class UpdatePassAfterPhysics : public Visitor
+class CollectPass : public Visitor
 {
 public:
-    UpdatePassAfterPhysics( float DeltaT ) : m_DeltaT( DeltaT ) {}
+    CollectPass( std::vector<SceneNode*>& Nodes ) : m_Nodes( Nodes ) {}
     bool Visit( SceneNode& node ) override {
-        node.UpdateAfterPhysics( m_DeltaT );
+        m_Nodes.push_back( &node );
         return true;
     }
-    float m_DeltaT;
+    std::vector<SceneNode*>& m_Nodes;
 };
 
+void Scene::AddDependency( SceneNodePtr node, SceneNodePtr dependsOn )
+{
+    ASSERT( node && dependsOn && node != dependsOn );
+    m_Dependencies.emplace_back( node, dependsOn );
+    m_UpdateGraphVersion = ~0ull;
+}
+
 void Scene::UpdateScene( float Delta )
 {
-    UpdatePass updatePass( Delta );
-    Accept( updatePass );
+    m_bRenderList = false;
+    PrepareUpdateGraph();
+    RunUpdateGraph( [Delta]( SceneNode& node ) { node.Update( Delta ); } );
 }
 
 void Scene::UpdateSceneAfterPhysics( float Delta )
 {
-    UpdatePassAfterPhysics updatePass( Delta );
-    Accept( updatePass );
+    m_bRenderList = false;
+    PrepareUpdateGraph();
+    RunUpdateGraph( [Delta]( SceneNode& node ) { node.UpdateAfterPhysics( Delta ); } );
+}
+
+void Scene::BuildRenderList( const Math::BaseCamera& camera )
+{
+    m_bRenderList = s_bRenderList;
+    if (m_bRenderList)
+        m_RenderList.Build( *this, camera, s_bParallelRenderList ? TaskManager::GetMaxNumThreads() : 1 );
+    else
+        m_RenderList.Clear();
 }
 
 void Scene::Render( RenderPass& renderPass, RenderArgs& args )
 {
     renderPass.SetRenderArgs( args );
-    Accept( renderPass );
+    RenderQueue queues[2];
+    const uint32_t numQueues = m_bRenderList ? GetListQueues( renderPass.m_RenderQueue, queues ) : 0;
+    if (numQueues == 0)
+    {
+        Accept( renderPass );
+        return;
+    }
+    for (uint32_t i = 0; i < numQueues; i++)
+        renderPass.Render( m_RenderList.Get( queues[i] ) );
 }
 
+void Scene::RenderShadow( RenderPass& renderPass, RenderArgs& args )
+{
+    renderPass.SetRenderArgs( args );
+    if (!m_bRenderList)
+    {
+        // Walking culls against the light camera of 'args' too
+        Accept( renderPass );
+        return;
+    }
+    m_ShadowList.Build( *this, args.m_Camera, s_bParallelRenderList ? TaskManager::GetMaxNumThreads() : 1,
+        1u << renderPass.m_RenderQueue );
+    renderPass.Render( m_ShadowList.Get( renderPass.m_RenderQueue ) );
+}
+
+//
+// Wave of a node is one past the deepest wave of what it depends on.
+// Nodes keep their visit order inside a wave, so the result is the same every frame
+//
+void Scene::BuildUpdateGraph( void )
+{
+    std::vector<SceneNode*> nodes;
+    CollectPass collectPass( nodes );
+    Accept( collectPass );
+
+    std::unordered_map<SceneNode*, uint32_t> index;
+    for (uint32_t i = 0; i < nodes.size(); i++)
+        index.emplace( nodes[i], i );
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (auto& dep : m_Dependencies)
+    {
+        auto node = index.find( dep.first.get() );
+        auto dependsOn = index.find( dep.second.get() );
+        if (node != index.end() && dependsOn != index.end())
+            edges.emplace_back( node->second, dependsOn->second );
+    }
+
+    const uint32_t numNodes = static_cast<uint32_t>(nodes.size());
+    std::vector<uint32_t> wave( numNodes, 0 );
+    bool bChanged = true;
+    for (uint32_t pass = 0; bChanged && pass <= numNodes; pass++)
+    {
+        bChanged = false;
+        for (auto& e : edges)
+        {
+            if (wave[e.first] > wave[e.second])
+                continue;
+            wave[e.first] = wave[e.second] + 1;
+            bChanged = true;
+        }
+    }
+    // Circular dependency, update in visit order on a single wave each
+    WARN_ONCE_IF( bChanged, "Circular scene update dependency, updated in visit order" );
+    if (bChanged)
+    {
+        for (uint32_t i = 0; i < numNodes; i++)
+            wave[i] = i;
+    }
+
+    std::vector<uint32_t> order( numNodes );
+    for (uint32_t i = 0; i < numNodes; i++)
+        order[i] = i;
+    std::stable_sort( order.begin(), order.end(), [&wave]( uint32_t a, uint32_t b ) {
+        return wave[a] < wave[b];
+    });
+
+    m_UpdateOrder.resize( numNodes );
+    m_UpdateWave.clear();
+    for (uint32_t k = 0; k < numNodes; k++)
+    {
+        m_UpdateOrder[k] = nodes[order[k]];
+        if (k == 0 || wave[order[k]] != wave[order[k - 1]])
+            m_UpdateWave.push_back( k );
+    }
+    m_UpdateWave.push_back( numNodes );
+}
+
+void Scene::PrepareUpdateGraph( void )
+{
+    const uint64_t version = SceneNode::GetStructureVersion();
+    if (m_UpdateGraphVersion == version)
+        return;
+    BuildUpdateGraph();
+    m_UpdateGraphVersion = version;
+}
+
+void Scene::RunUpdateGraph( const UpdateFunc& func )
+{
+    for (size_t n = 0; n + 1 < m_UpdateWave.size(); n++)
+    {
+        const uint32_t begin = m_UpdateWave[n], end = m_UpdateWave[n + 1];
+        if (!s_bParallelUpdate || end - begin == 1)
+        {
+            for (uint32_t k = begin; k < end; k++)
+                func( *m_UpdateOrder[k] );
+            continue;
+        }
+        TaskManager::parallel_for( begin, end, [&]( size_t k ) {
+            func( *m_UpdateOrder[k] );
+        });
+    }
+}
@@ -1,15 +1,47 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <vector>
 #include "SceneNode.h"
+#include "RenderList.h"
 
 using ScenePtr = std::shared_ptr<class Scene>;
 class Scene : public SceneNode
 {
 public:
 
+    // 'node' is updated after 'dependsOn' (e.g. an accessory attached to a bone of a model)
+    void AddDependency( SceneNodePtr node, SceneNodePtr dependsOn );
+
     void UpdateScene( float Delta );
     void UpdateSceneAfterPhysics( float Delta );
+    // Culls and sorts the draws of the frame once, after the updates. Passes
+    // drawing the camera view then replay it instead of walking the scene
+    void BuildRenderList( const Math::BaseCamera& camera );
     void Render( RenderPass& renderPass, RenderArgs& args );
+    // Draws the casters of a shadow cascade, culled against 'args.m_Camera' (the
+    // light camera) rather than the view, which would drop casters off screen
+    void RenderShadow( RenderPass& renderPass, RenderArgs& args );
+    const RenderList& GetRenderList( void ) const { return m_RenderList; }
+
+protected:
+
+    using UpdateFunc = std::function<void( SceneNode& )>;
+
+    void BuildUpdateGraph( void );
+    void PrepareUpdateGraph( void );
+    void RunUpdateGraph( const UpdateFunc& func );
+
+    std::vector<std::pair<SceneNodePtr, SceneNodePtr>> m_Dependencies;
+
+    // Nodes grouped by wave, nodes in a wave have no dependency among them.
+    // Kept until a node gains a child or a dependency is added
+    uint64_t m_UpdateGraphVersion = ~0ull; // SceneNode::GetStructureVersion of the graph
+    std::vector<SceneNode*> m_UpdateOrder;
+    std::vector<uint32_t> m_UpdateWave; // offset into 'm_UpdateOrder', last one is the end
 
+    RenderList m_RenderList;
+    RenderList m_ShadowList; // casters of the cascade drawn last
+    bool m_bRenderList = false; // built since the last update
 };
@@ -2,8 +2,14 @@
 #include "SceneNode.h"
 #include "Visitor.h"
 
+#include <atomic>
+
 using namespace Math;
 
+namespace {
+    std::atomic<uint64_t> s_StructureVersion( 0 );
+}
+
 SceneNode::SceneNode() : m_RenderArgs(nullptr), m_NodeType(kSceneNormal)
 {
 }
@@ -18,6 +24,12 @@ void SceneNode::Accept( Visitor& visitor )
 void SceneNode::AddChild( SceneNodePtr pNode )
 {
     m_Children.push_back( pNode );
+    s_StructureVersion++;
+}
+
+uint64_t SceneNode::GetStructureVersion( void )
+{
+    return s_StructureVersion;
 }
 
 void SceneNode::Render( GraphicsContext& gfxContext, Visitor& visitor )
@@ -35,6 +47,17 @@ void SceneNode::Skinning( GraphicsContext& gfxContext, Visitor& visitor )
     (gfxContext), (visitor);
 }
 
+bool SceneNode::CollectMeshes( Visitor& visitor )
+{
+    (visitor);
+    return false;
+}
+
+void SceneNode::RenderMesh( GraphicsContext& gfxContext, IMesh& mesh, IMaterial& material, bool bBindGeometry )
+{
+    (gfxContext), (mesh), (material), (bBindGeometry);
+}
+
 void SceneNode::Update( float deltaT )
 {
     (deltaT);
@@ -60,6 +83,11 @@ BoundingBox SceneNode::GetBoundingBox() const
     return BoundingBox();
 }
 
+BoundingBox SceneNode::GetBoundingBox( const IMesh& ) const
+{
+    return BoundingBox();
+}
+
 AffineTransform SceneNode::GetTransform() const
 {
     return AffineTransform(kIdentity);
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
+#include "Math/BoundingBox.h"
 
 class GraphicsContext;
+class IMaterial;
+class IMesh;
 class RenderArgs;
 class RenderPass;
 class Visitor;
@@ -26,13 +31,22 @@ public:
 
     virtual void Accept( Visitor& visitor );
     virtual void AddChild( SceneNodePtr pNode );
+    // Changes whenever a node anywhere gains a child, so a walk cached by a scene can tell it is stale
+    static uint64_t GetStructureVersion( void );
     virtual void Render( GraphicsContext& gfxContext, Visitor& visitor );
     virtual void RenderBone( GraphicsContext& Context, Visitor& visitor );
     virtual void Skinning( GraphicsContext& gfxContext, Visitor& visitor );
+    // Visits mesh and material pairs as Render does, without drawing.
+    // False if the node draws only through Render (See, RenderList)
+    virtual bool CollectMeshes( Visitor& visitor );
+    // Draws a mesh listed by CollectMeshes, 'bBindGeometry' when another node drew last
+    virtual void RenderMesh( GraphicsContext& gfxContext, IMesh& mesh, IMaterial& material, bool bBindGeometry );
     virtual void Update( float deltaT );
     virtual void UpdateAfterPhysics( float deltaT );
 
     virtual Math::BoundingBox GetBoundingBox() const;
+    // World space bounds of one of this node's meshes, invalid if unknown
+    virtual Math::BoundingBox GetBoundingBox( const IMesh& mesh ) const;
     virtual SceneNodeType GetType() const;
     virtual void SetType( SceneNodeType type );
     virtual Math::AffineTransform GetTransform() const;
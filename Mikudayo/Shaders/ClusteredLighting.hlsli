@@ -0,0 +1,44 @@
+// Needs CommonInclude.hlsli
+// Slots are clear of the reflector textures (t60, t61) and material (b4) of the forward shaders
+
+// See, Lighting::ClusterConstants
+cbuffer ClusterConstants : register(b7)
+{
+    uint2 TileCount;
+    uint SliceCount;
+    uint Padding;
+    float SliceScale;
+    float SliceBias;
+    float2 ScreenToTile;
+}
+
+StructuredBuffer<Light> ClusterLights : register(t66);
+// Offset and count into ClusterLightIndex, per cluster
+StructuredBuffer<uint2> ClusterRange : register(t67);
+StructuredBuffer<uint> ClusterLightIndex : register(t68);
+
+//
+// Point and spot lights of the cluster at pixel 'PixelPos', 'P' and 'N' in
+// view space. See, Lighting::LightCluster
+//
+LightingResult DoClusteredLighting( float2 PixelPos, float specularPower, float3 P, float3 N )
+{
+    float3 V = normalize( -P );
+    uint2 tile = min( uint2( PixelPos * ScreenToTile ), TileCount - 1 );
+    uint slice = (uint)clamp( log( max( -P.z, 1e-4 ) ) * SliceScale + SliceBias, 0, SliceCount - 1 );
+    uint2 range = ClusterRange[(slice * TileCount.y + tile.y) * TileCount.x + tile.x];
+
+    LightingResult sum = (LightingResult)0;
+    for (uint i = 0; i < range.y; i++)
+    {
+        Light light = ClusterLights[ClusterLightIndex[range.x + i]];
+        LightingResult lit;
+        if (light.Type == SpotLight)
+            lit = DoSpotLight( light, specularPower, V, P, N );
+        else
+            lit = DoPointLight( light, specularPower, V, P, N );
+        sum.Diffuse += lit.Diffuse;
+        sum.Specular += lit.Specular;
+    }
+    return sum;
+}
@@ -0,0 +1,37 @@
+#include "CommonInclude.hlsli"
+#include "ClusteredLighting.hlsli"
+
+struct PixelShaderOutput
+{
+    float3 Diffuse : SV_Target0;   // Diffuse Albedo (R11G11B10_FLOAT)
+    float3 Specular : SV_Target1;   // Specular Color (R11G11B10_FLOAT)
+};
+
+// The normal from the screen space texture.
+Texture2D<float3> NormalTextureVS : register(t0);
+// The specular power from the screen space texture.
+Texture2D<float> SpecularPowerTextureVS : register(t1);
+// The depth from the screen space texture.
+Texture2D<float> DepthTextureVS : register(t2);
+
+// Point and spot lights of the pixel's cluster in one pass
+PixelShaderOutput main( float4 PosHS : SV_Position )
+{
+    PixelShaderOutput Out;
+
+    int2 texCoord = PosHS.xy;
+    float depth = DepthTextureVS.Load( int3( texCoord, 0 ) );
+    float3 P = ScreenToView( float4( texCoord, depth, 1.0f ) ).xyz;
+
+    // Unpack the normal
+    float3 N = NormalTextureVS.Load( int3( texCoord, 0 ) ) * 2 - 1;
+    // Unpack the specular power
+    float specularPower = SpecularPowerTextureVS.Load( int3( texCoord, 0 ) ) * 255.0;
+
+    LightingResult sum = DoClusteredLighting( PosHS.xy, specularPower, P, N );
+
+    Out.Diffuse = sum.Diffuse.rgb;
+    Out.Specular = sum.Specular.rgb;
+
+    return Out;
+}
@@ -1,5 +1,6 @@
 #include "CommonInclude.hlsli"
 #include "MikuHeader.hlsli"
+#include "ShadowCascade.hlsli"
 
 // Per-pixel color data passed through the pixel shader.
 struct PixelShaderInput
@@ -35,29 +36,41 @@ Texture2D<float3> DiffuseTextureVS : register(t4);
 // The specular color from the screen space texture.
 Texture2D<float3> SpecularTextureVS : register(t5);
 Texture2D<float3> NormalTextureVS : register(t6);
-Texture2D<float> ShadowTexture : register(t7);
+// Cascades of ShadowCameraCascade, one per slice
+Texture2DArray<float> ShadowTexture : register(t7);
 
-float GetShadow( float3 ShadowCoord )
+float GetShadow( float3 ShadowCoord0 )
 {
+    const float Dilation = 2.0;
+    float3 texShadowSize;
+    ShadowTexture.GetDimensions( texShadowSize.x, texShadowSize.y, texShadowSize.z );
+    float2 texelSize = 1.0 / texShadowSize.xy;
+
+    // Same selection as Shadow.hlsli, a texel of room for the kernel
+    float3 ShadowCoord;
+    uint cascadeIdx = SelectCascade( ShadowCoord0, texelSize * (Dilation + 1), ShadowCoord );
+    if (cascadeIdx >= CascadeCount)
+        return 1.0;
+    float slice = cascadeIdx;
+
 #define SINGLE_SAMPLE
 #ifdef SINGLE_SAMPLE
-    float result = ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z );
+    float result = ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy, slice ), ShadowCoord.z );
 #else
-    const float Dilation = 2.0;
-    float d1 = Dilation * ShadowTexelSize.x * 0.125;
-    float d2 = Dilation * ShadowTexelSize.x * 0.875;
-    float d3 = Dilation * ShadowTexelSize.x * 0.625;
-    float d4 = Dilation * ShadowTexelSize.x * 0.375;
+    float d1 = Dilation * texelSize.x * 0.125;
+    float d2 = Dilation * texelSize.x * 0.875;
+    float d3 = Dilation * texelSize.x * 0.625;
+    float d4 = Dilation * texelSize.x * 0.375;
     float result = (
-        2.0 * ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d2, d1), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d1, -d2), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(d2, -d1), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(d1, d2), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d4, d3), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d3, -d4), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(d4, -d3), ShadowCoord.z ) +
-        ShadowTexture.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(d3, d4), ShadowCoord.z )
+        2.0 * ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy, slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(-d2, d1), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(-d1, -d2), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(d2, -d1), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(d1, d2), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(-d4, d3), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(-d3, -d4), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(d4, -d3), slice ), ShadowCoord.z ) +
+        ShadowTexture.SampleCmpLevelZero( shadowSampler, float3( ShadowCoord.xy + float2(d3, d4), slice ), ShadowCoord.z )
         ) / 10.0;
 #endif
     return result * result;
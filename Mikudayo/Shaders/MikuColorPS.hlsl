@@ -1,4 +1,5 @@
 #include "CommonInclude.hlsli"
+#include "ClusteredLighting.hlsli"
 #include "MikuColorVS.hlsli"
 #include "Shadow.hlsli"
 #define Toon 3
@@ -67,11 +68,13 @@ PixelShaderOutput main(PixelShaderInput input)
     float4 shadowColor = float4(saturate(input.ambient), color.a);
     float4 emissive = input.emissive;
     uint2 pixelPos = input.positionHS.xy;
+    float3 albedo = mat.diffuse;
 
     if (mat.bUseTexture) {
         float4 texColor = texDiffuse.Sample( sampler0, input.texCoord );
         color *= texColor;
         shadowColor *= texColor;
+        albedo *= texColor.rgb;
     }
 
     if (mat.sphereOperation != kSphereNone) {
@@ -115,6 +118,13 @@ PixelShaderOutput main(PixelShaderInput input)
     }
     comp = min(comp, texSSAO[pixelPos]);
     color = lerp( shadowColor, color, comp );
+#if !REFLECTED
+    // Point and spot lights, not shadowed. The reflected view has no clusters
+    float3 positionVS = mul( view, float4( input.positionWS, 1 ) ).xyz;
+    float3 normalVS = mul( (float3x3)view, normal );
+    LightingResult lit = DoClusteredLighting( input.positionHS.xy, SpecularPower, positionVS, normalVS );
+    color.rgb += lit.Diffuse.rgb * albedo + lit.Specular.rgb * MaterialSpecular;
+#endif
     output.color = color;
     output.emissive = color * emissive;
     return output;
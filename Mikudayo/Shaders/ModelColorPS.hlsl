@@ -79,7 +79,7 @@ Texture2D<float4> texReflection	    : register(t6);
 Texture2D<float> ShadowTexture      : register(t7);
 
 Texture2D<float> texSSAO			: register(t64);
-Texture2D<float> texShadow			: register(t65);
+Texture2DArray<float> texShadow		: register(t65);
 
 SamplerState sampler0 : register(s0);
 SamplerState sampler1 : register(s1);
@@ -68,7 +68,7 @@ StreamOut main(VertexInput input, uint id : SV_VertexID )
         const uint2 boneID = SkinUnit.Load2( baseOffset + 4 );
         const float weight1 = 1 - asfloat(SkinUnit.Load( baseOffset + 12 ));
 	    float3 p0 = TransformBonePosition( position, boneID.x );
-	    float3 p1 = TransformBonePosition( input.position, boneID.y );
+	    float3 p1 = TransformBonePosition( position, boneID.y );
 	    float3 n0 = TransformBoneNormal( input.normal, boneID.x );
 	    float3 n1 = TransformBoneNormal( input.normal, boneID.y );
         output.position = lerp( p0, p1, weight1 );
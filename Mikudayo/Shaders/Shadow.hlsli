@@ -1,5 +1,6 @@
 #include "ShadowDefine.hlsli"
 #include "PCFKernels.hlsli"
+#include "ShadowCascade.hlsli"
 
 Texture2DArray<float> texShadow : register(t65);
 SamplerComparisonState samplerShadow : register(s2);
@@ -478,16 +479,21 @@ float GetShadow( float4 ShadowPosH, float3 PosH )
     float2 ShadowTexelSize = 1.0 / texShadowSize;
 
     // Complete projection by doing division by w.
-    float3 ShadowPos = ShadowPosH.xyz / ShadowPosH.w;
+    float3 ShadowPos0 = ShadowPosH.xyz / ShadowPosH.w;
+    float3 shadowPosDX0 = ddx_fine( ShadowPos0 );
+    float3 shadowPosDY0 = ddy_fine( ShadowPos0 );
 
-    float2 TransTexCoord = ShadowPos.xy;
-    if (!any( saturate( TransTexCoord ) != TransTexCoord ))
+    // Nearest cascade holding the pixel with its filter kernel
+    float2 margin = ShadowTexelSize * (FilterSize_ * 0.5 + 1);
+    float3 ShadowPos;
+    uint cascadeIdx = SelectCascade( ShadowPos0, margin, ShadowPos );
+
+    if (cascadeIdx < CascadeCount)
     {
         ShadowPos = saturate( ShadowPos );
-        float3 shadowPosDX = ddx_fine( ShadowPos );
-        float3 shadowPosDY = ddy_fine( ShadowPos );
+        float3 shadowPosDX = shadowPosDX0 * CascadeScale[cascadeIdx].xyz;
+        float3 shadowPosDY = shadowPosDY0 * CascadeScale[cascadeIdx].xyz;
 
-        uint cascadeIdx = 0;
 #if ShadowMode_ == ShadowModeSingle_
         Result = SampleSingle( ShadowPos, cascadeIdx );
 #elif ShadowMode_ == ShadowModeWeighted_
@@ -0,0 +1,28 @@
+// See, ShadowCameraCascade::GetScaleOffset
+cbuffer ShadowCascadeConstants : register(b6)
+{
+    // Shadow coordinates of cascade 'i' from those of the first
+    float4 CascadeScale[4];
+    float4 CascadeOffset[4];
+    uint CascadeCount;
+}
+
+//
+// Nearest cascade holding 'ShadowPos0', coordinates of the first cascade,
+// with 'Margin' around it and inside its depth. Past the depth range of a
+// cascade its casters are clipped away. Returns 'CascadeCount' if none
+//
+uint SelectCascade( float3 ShadowPos0, float2 Margin, out float3 ShadowPos )
+{
+    ShadowPos = ShadowPos0;
+    for (uint i = 0; i < CascadeCount; i++)
+    {
+        float3 pos = ShadowPos0 * CascadeScale[i].xyz + CascadeOffset[i].xyz;
+        if (all( abs( pos.xy - 0.5 ) <= 0.5 - Margin ) && abs( pos.z - 0.5 ) <= 0.5)
+        {
+            ShadowPos = pos;
+            return i;
+        }
+    }
+    return CascadeCount;
+}
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "ShadowCameraCascade.h"
+#include "Clipping.h"
+#include "SceneNode.h"
+#include "Math/BoundingFrustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace Math;
+
+namespace {
+    // Cascade extent changes by this fraction of its view bounding sphere diameter
+    const float kExtentSteps = 16.f;
+    // Depth range the splits cover changes by 2^(1/kDepthSteps)
+    const float kDepthSteps = 4.f;
+}
+
+void ShadowCameraCascade::Create( uint32_t NumCascades, uint32_t Resolution, float Lambda )
+{
+    ASSERT( NumCascades > 0 && NumCascades <= kMaxCascades );
+    ASSERT( Resolution > 1 );
+    m_NumCascades = NumCascades;
+    m_Resolution = Resolution;
+    m_Lambda = Lambda;
+}
+
+//
+// Practical split scheme, logarithmic splits keep the texel to pixel ratio
+// even but leave the first cascade tiny, uniform ones waste the near view
+//
+void ShadowCameraCascade::ComputeSplits( float NearZ, float FarZ, uint32_t Count, float Lambda, float* Splits )
+{
+    ASSERT( NearZ > 0.f && FarZ > NearZ && Count > 0 );
+    Splits[0] = NearZ;
+    for (uint32_t i = 1; i < Count; i++)
+    {
+        const float t = float(i) / Count;
+        const float logSplit = NearZ * std::pow( FarZ / NearZ, t );
+        const float uniformSplit = NearZ + (FarZ - NearZ) * t;
+        Splits[i] = Lambda * logSplit + (1.f - Lambda) * uniformSplit;
+    }
+    Splits[Count] = FarZ;
+}
+
+void ShadowCameraCascade::UpdateMatrix( const SceneNode& Scene, const Vector3& LightDirection, const BaseCamera& Camera )
+{
+    BoundingBox sceneAABox;
+    for (auto& node : Scene)
+    {
+        auto box = node->GetBoundingBox();
+        if (box.IsValid())
+            sceneAABox.Merge( box );
+    }
+    UpdateMatrix( sceneAABox, LightDirection, Camera );
+}
+
+void ShadowCameraCascade::UpdateMatrix( const BoundingBox& SceneBox, const Vector3& LightDirection, const BaseCamera& Camera )
+{
+    const Vector3 lightDir = Normalize( LightDirection );
+    const Vector3 eyePos = Camera.GetPosition();
+    const Vector3 viewDir = Camera.GetForwardVec();
+
+    //
+    // Splits only cover the view depth the scene is in. The range snaps out
+    // to a ladder of depths from the near clip, or the splits, and with them
+    // the extent and texel size of every cascade, would follow each move of
+    // the camera
+    //
+    const float nearClip = Camera.GetNearClip(), farClip = Camera.GetFarClip();
+    float nearZ = nearClip, farZ = farClip;
+    if (SceneBox.IsValid())
+    {
+        float minDepth = farClip, maxDepth = nearClip;
+        for (auto& corner : SceneBox.GetCorners())
+        {
+            const float depth = Dot( corner - eyePos, viewDir );
+            minDepth = std::min( minDepth, depth );
+            maxDepth = std::max( maxDepth, depth );
+        }
+        minDepth = std::max( minDepth, nearClip );
+        maxDepth = std::min( maxDepth, farClip );
+        if (maxDepth > minDepth)
+        {
+            const float lo = std::floor( std::log2( minDepth / nearClip ) * kDepthSteps );
+            const float hi = std::ceil( std::log2( maxDepth / nearClip ) * kDepthSteps );
+            nearZ = std::max( nearClip * std::exp2( lo / kDepthSteps ), nearClip );
+            farZ = std::min( nearClip * std::exp2( hi / kDepthSteps ), farClip );
+        }
+    }
+    ComputeSplits( nearZ, farZ, m_NumCascades, m_Lambda, m_Splits );
+
+    //
+    // Split corners slide along the frustum edges, at the view depth of the
+    // split. Which end of an edge is the near one depends on reverse Z, so
+    // it is found by depth, keeping the corner order of the view frustum
+    //
+    const BoundingFrustum& frustum = Camera.GetWorldSpaceFrustum();
+    for (uint32_t i = 0; i < m_NumCascades; i++)
+    {
+        BoundingFrustum& split = m_SplitFrustum[i];
+        split = frustum;
+        for (uint32_t k = 0; k < 4; k++)
+        {
+            const Vector3 a = frustum.m_FrustumCorners[k], b = frustum.m_FrustumCorners[k + 4];
+            const float da = Dot( a - eyePos, viewDir ), db = Dot( b - eyePos, viewDir );
+            auto AtDepth = [&]( float depth ) { return a + (b - a) * ((depth - da) / (db - da)); };
+            const bool bNearFirst = da < db;
+            split.m_FrustumCorners[k] = AtDepth( bNearFirst ? m_Splits[i] : m_Splits[i + 1] );
+            split.m_FrustumCorners[k + 4] = AtDepth( bNearFirst ? m_Splits[i + 1] : m_Splits[i] );
+        }
+    }
+
+    // Fixed light view, turning the camera must not turn the shadow map
+    const Vector3 up = std::abs( float(lightDir.GetY()) ) < 0.99f ? Vector3( kYUnitVector ) : Vector3( kZUnitVector );
+    const Matrix4 lightView = MatrixLookDirection( Vector3( kZero ), -lightDir, up );
+    for (uint32_t i = 0; i < m_NumCascades; i++)
+        UpdateCascade( i, lightView, lightDir, SceneBox );
+}
+
+void ShadowCameraCascade::UpdateCascade( uint32_t Index, const Matrix4& LightView, const Vector3& LightDirection, const BoundingBox& SceneBox )
+{
+    const BoundingFrustum& split = m_SplitFrustum[Index];
+    VecPoint points;
+    if (SceneBox.IsValid())
+        calcFocusedLightVolumePoints( points, LightDirection, split, SceneBox );
+    // No scene in the split, fit the split itself to keep a valid matrix
+    if (points.empty())
+        points.assign( split.m_FrustumCorners, split.m_FrustumCorners + 8 );
+
+    // The bounding sphere of the split is the same for any camera rotation
+    Vector3 center( kZero );
+    for (auto& corner : split.m_FrustumCorners)
+        center = center + corner;
+    center = center * 0.125f;
+    float radius = 0.f;
+    for (auto& corner : split.m_FrustumCorners)
+        radius = std::max( radius, float(Length( corner - center )) );
+    const float step = std::max( 2.f * radius / kExtentSteps, FLT_MIN );
+
+    BoundingBox box;
+    for (auto& point : points)
+        box.Merge( LightView.Transform( point ) );
+
+    //
+    // Extent is rounded up to a step and leaves one texel of room, then the
+    // lower corner snaps down to a texel. A world point keeps its texel
+    // until the extent steps
+    //
+    const float expand = float(m_Resolution) / (m_Resolution - 1);
+    float lo[] = { box.GetMin().GetX(), box.GetMin().GetY() };
+    float hi[] = { box.GetMax().GetX(), box.GetMax().GetY() };
+    float texelSize = 0.f;
+    for (int k = 0; k < 2; k++)
+    {
+        const float extent = std::max( std::ceil( (hi[k] - lo[k]) * expand / step ), 1.f ) * step;
+        const float texel = extent / m_Resolution;
+        lo[k] = std::floor( lo[k] / texel ) * texel;
+        hi[k] = lo[k] + extent;
+        texelSize = std::max( texelSize, texel );
+    }
+    // A texel of depth around, casters on the scene bounds stay inside
+    const float minZ = box.GetMin().GetZ() - texelSize, maxZ = box.GetMax().GetZ() + texelSize;
+    const BoundingBox fit( Vector3( lo[0], lo[1], minZ ), Vector3( hi[0], hi[1], maxZ ) );
+
+    BaseShadowCamera& cascade = m_Cascades[Index];
+    cascade.UpdateViewProjMatrix( LightView, MatrixScaleTranslateToFit( fit, cascade.GetReverseZ() ) );
+}
+
+//
+// Cascades share the light view and are orthographic, so one maps to the
+// other by a scale and an offset per axis
+//
+void ShadowCameraCascade::GetScaleOffset( uint32_t Index, Vector3& Scale, Vector3& Offset ) const
+{
+    const Matrix4 toCascade = m_Cascades[Index].GetShadowMatrix() * Invert( m_Cascades[0].GetShadowMatrix() );
+    Scale = Vector3( toCascade.GetX().GetX(), toCascade.GetY().GetY(), toCascade.GetZ().GetZ() );
+    Offset = Vector3( toCascade.GetW() );
+}
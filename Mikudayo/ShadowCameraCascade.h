@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include "Camera.h"
+#include "BaseShadowCamera.h"
+
+class SceneNode;
+namespace Math
+{
+    //
+    // Cascaded shadow maps of a directional light
+    //
+    // The view depth the scene covers is split into cascades, nearer ones
+    // shorter (See, ComputeSplits). Each cascade is an orthographic light
+    // camera fitted to its part of the view clipped by the scene bounds and
+    // extruded toward the light (See, calcFocusedLightVolumePoints), so it
+    // holds every caster that can shade what it covers. Casters of a
+    // cascade are culled against its own world space frustum.
+    //
+    // Light view keeps a fixed orientation and origin. Split depths snap to
+    // a ladder, the extent of a cascade only changes in steps of its view
+    // bounding sphere, and its corner is snapped to whole shadow map texels,
+    // so shadow edges do not shimmer as the camera moves or turns.
+    //
+    class ShadowCameraCascade
+    {
+    public:
+
+        static const uint32_t kMaxCascades = 4;
+
+        ShadowCameraCascade() {}
+
+        // 'Resolution' is the texel width of a cascade map, 'Lambda' blends uniform (0) and logarithmic (1) splits
+        void Create( uint32_t NumCascades, uint32_t Resolution, float Lambda = 0.8f );
+        void SetLambda( float Lambda ) { m_Lambda = Lambda; }
+
+        void UpdateMatrix( const SceneNode& Scene, const Vector3& LightDirection, const BaseCamera& Camera );
+        void UpdateMatrix( const BoundingBox& SceneBox, const Vector3& LightDirection, const BaseCamera& Camera );
+
+        // View depth of the 'Count + 1' split planes, from 'NearZ' to 'FarZ'
+        static void ComputeSplits( float NearZ, float FarZ, uint32_t Count, float Lambda, float* Splits );
+
+        uint32_t GetCascadeCount( void ) const { return m_NumCascades; }
+        const BaseShadowCamera& GetCascade( uint32_t Index ) const { return m_Cascades[Index]; }
+        // View depth where cascade 'Index' ends, the next one starts
+        float GetSplit( uint32_t Index ) const { return m_Splits[Index + 1]; }
+        // Part of the view frustum cascade 'Index' covers, only the corners are set
+        const BoundingFrustum& GetSplitFrustum( uint32_t Index ) const { return m_SplitFrustum[Index]; }
+        // Shadow texture coordinates of cascade 'Index' are 'Scale * Coord + Offset' of those of the first
+        void GetScaleOffset( uint32_t Index, Vector3& Scale, Vector3& Offset ) const;
+
+    protected:
+
+        void UpdateCascade( uint32_t Index, const Matrix4& LightView, const Vector3& LightDirection, const BoundingBox& SceneBox );
+
+        uint32_t m_NumCascades = 1;
+        uint32_t m_Resolution = 2048;
+        float m_Lambda = 0.8f;
+        float m_Splits[kMaxCascades + 1] = {};
+        BoundingFrustum m_SplitFrustum[kMaxCascades];
+        BaseShadowCamera m_Cascades[kMaxCascades];
+    };
+}
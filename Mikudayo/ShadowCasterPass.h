@@ -3,6 +3,8 @@
 #include "RenderPass.h"
 
 class IMaterial;
+// Culls against the camera of its render args, the light camera of the
+// cascade drawn (See, Scene::RenderShadow)
 class ShadowCasterPass : public RenderPass
 {
 public:
@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "SkinnedBounds.h"
+
+using namespace Math;
+
+void SkinnedBounds::Build( const std::vector<XMFLOAT3>& Position, const std::vector<uint32_t>& Indices,
+    const std::vector<Pmx::SkinTypeUnit>& Units, const std::vector<MeshRange>& Meshes,
+    const std::vector<Pmx::Morph>& Morphs, size_t NumBones )
+{
+    ASSERT( Position.size() == Units.size() );
+
+    Clear();
+    const size_t numVertices = Position.size();
+    if (NumBones == 0)
+        return;
+
+    // Morph weights are taken to be in [0, 1], each morph moves a vertex at most its offset
+    std::vector<float> margin( numVertices, 0.f );
+    for (auto& morph : Morphs)
+    {
+        if (morph.Type != Pmx::MorphType::kVertex)
+            continue;
+        for (auto& mv : morph.VertexList)
+            if (mv.VertexIndex < numVertices)
+                margin[mv.VertexIndex] += XMVectorGetX( XMVector3Length( XMLoadFloat3( &mv.Position ) ) );
+    }
+
+    auto BoneIndex = [NumBones]( int32_t index ) -> uint32_t {
+        return (index < 0 || size_t(index) >= NumBones) ? 0 : uint32_t(index);
+    };
+
+    std::vector<BoundingBox> boxes( NumBones );
+    std::vector<uint32_t> touched; // bones having a box in the current mesh
+    std::vector<uint32_t> visited( numVertices, ~0u ); // last mesh a vertex was boxed in
+    m_MeshOffset.reserve( Meshes.size() + 1 );
+    for (uint32_t m = 0; m < Meshes.size(); m++)
+    {
+        m_MeshOffset.push_back( static_cast<uint32_t>(m_BoneIndex.size()) );
+
+        auto Add = [&]( uint32_t bone, const Vector3& minVec, const Vector3& maxVec ) {
+            if (!boxes[bone].IsValid())
+                touched.push_back( bone );
+            boxes[bone].Merge( minVec );
+            boxes[bone].Merge( maxVec );
+        };
+
+        const auto& range = Meshes[m];
+        const uint32_t end = std::min<uint32_t>( range.IndexOffset + range.IndexCount, uint32_t(Indices.size()) );
+        for (uint32_t i = range.IndexOffset; i < end; i++)
+        {
+            const uint32_t v = Indices[i];
+            if (v >= numVertices || visited[v] == m)
+                continue;
+            visited[v] = m;
+
+            const Vector3 pos( Position[v] );
+            const Vector3 pad( Scalar( margin[v] ) );
+            const Vector3 minVec = pos - pad, maxVec = pos + pad;
+            const auto& skin = Units[v];
+            switch (skin.Type)
+            {
+            case Pmx::kBdef1:
+                Add( BoneIndex( skin.Unit.bdef1.BoneIndex ), minVec, maxVec );
+                break;
+            case Pmx::kBdef2:
+            case Pmx::kSdef:
+                // Bdef2Unit and SdefUnit share leading layout
+                if (skin.Unit.bdef2.Weight > 0.f)
+                    Add( BoneIndex( skin.Unit.bdef2.BoneIndex[0] ), minVec, maxVec );
+                if (skin.Unit.bdef2.Weight < 1.f)
+                    Add( BoneIndex( skin.Unit.bdef2.BoneIndex[1] ), minVec, maxVec );
+                break;
+            case Pmx::kBdef4:
+            case Pmx::kQdef:
+                for (int k = 0; k < 4; k++)
+                    if (skin.Unit.bdef4.Weight[k] > 0.f)
+                        Add( BoneIndex( skin.Unit.bdef4.BoneIndex[k] ), minVec, maxVec );
+                break;
+            default:
+                // Left in bind pose by skinning, follow the root
+                Add( 0, minVec, maxVec );
+                break;
+            }
+        }
+
+        std::sort( touched.begin(), touched.end() );
+        for (auto bone : touched)
+        {
+            const BoundingBox& box = boxes[bone];
+            XMFLOAT3 center, extent;
+            XMStoreFloat3( &center, (box.GetMax() + box.GetMin()) * 0.5f );
+            XMStoreFloat3( &extent, (box.GetMax() - box.GetMin()) * 0.5f );
+            m_BoneIndex.push_back( bone );
+            m_Center.push_back( center );
+            m_Extent.push_back( extent );
+            boxes[bone] = BoundingBox();
+        }
+        touched.clear();
+    }
+    m_MeshOffset.push_back( static_cast<uint32_t>(m_BoneIndex.size()) );
+}
+
+void SkinnedBounds::Clear( void )
+{
+    m_MeshOffset.clear();
+    m_BoneIndex.clear();
+    m_Center.clear();
+    m_Extent.clear();
+}
+
+void SkinnedBounds::Update( const AffineTransform& Model, const OrthogonalTransform* Bones,
+    std::vector<BoundingBox>& Bounds ) const
+{
+    const size_t numMeshes = GetMeshCount();
+    Bounds.resize( numMeshes );
+    for (size_t m = 0; m < numMeshes; m++)
+    {
+        BoundingBox bound;
+        for (uint32_t k = m_MeshOffset[m]; k < m_MeshOffset[m + 1]; k++)
+        {
+            // Box of a box: center goes through the transform, extent through its absolute basis
+            const AffineTransform xform = Model * AffineTransform( Bones[m_BoneIndex[k]] );
+            const Matrix3& basis = xform.GetBasis();
+            const Vector3 center = xform * Vector3( m_Center[k] );
+            const XMFLOAT3& e = m_Extent[k];
+            const Vector3 extent = Abs( basis.GetX() ) * e.x + Abs( basis.GetY() ) * e.y + Abs( basis.GetZ() ) * e.z;
+            bound.Merge( center - extent );
+            bound.Merge( center + extent );
+        }
+        Bounds[m] = bound;
+    }
+}
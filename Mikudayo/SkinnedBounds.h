@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include "VectorMath.h"
+#include "Math/BoundingBox.h"
+#include "Pmx.h"
+
+//
+// Per mesh bounds of a skinned model, from the current skinning transforms
+//
+// When built, vertices of each mesh are boxed per influencing bone in bind
+// pose, padded by how far vertex morphs can move them. A linear blend skinned
+// vertex lies in the convex hull of its bone transformed positions, so the
+// union of the transformed bone boxes contains the mesh. SDEF and QDEF blend
+// rotations and may bulge slightly past it; that is not padded for.
+//
+class SkinnedBounds
+{
+public:
+
+    struct MeshRange
+    {
+        uint32_t IndexOffset;
+        uint32_t IndexCount;
+    };
+
+    void Build( const std::vector<XMFLOAT3>& Position, const std::vector<uint32_t>& Indices,
+        const std::vector<Pmx::SkinTypeUnit>& Units, const std::vector<MeshRange>& Meshes,
+        const std::vector<Pmx::Morph>& Morphs, size_t NumBones );
+    void Clear( void );
+
+    // World space box of every mesh, 'Bones' are model space skinning transforms
+    void Update( const Math::AffineTransform& Model, const Math::OrthogonalTransform* Bones,
+        std::vector<Math::BoundingBox>& Bounds ) const;
+
+    size_t GetMeshCount( void ) const { return m_MeshOffset.empty() ? 0 : m_MeshOffset.size() - 1; }
+    size_t GetBoxCount( void ) const { return m_BoneIndex.size(); }
+
+protected:
+
+    // Bind pose boxes, mesh 'm' owns [m_MeshOffset[m], m_MeshOffset[m + 1])
+    std::vector<uint32_t> m_MeshOffset;
+    std::vector<uint32_t> m_BoneIndex;
+    std::vector<XMFLOAT3> m_Center;
+    std::vector<XMFLOAT3> m_Extent;
+};
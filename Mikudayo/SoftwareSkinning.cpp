@@ -0,0 +1,265 @@
+#include "stdafx.h"
+#include "SoftwareSkinning.h"
+#include "TaskManager.h"
+#include "Math/DualQuaternion.h"
+
+using namespace Math;
+
+namespace {
+    const uint32_t kBatchSize = 2048;
+
+    // CommandContext::WriteBuffer copies in 16 byte units, keep the tail readable
+    const uint32_t kOutputPadding = 2;
+
+    template <int N>
+    INLINE XMMATRIX BlendMatrix( const XMMATRIX* bones, const uint32_t* index, const float* weight )
+    {
+        XMMATRIX m;
+        const XMVECTOR w0 = XMVectorReplicate( weight[0] );
+        const XMMATRIX& b0 = bones[index[0]];
+        for (int r = 0; r < 4; r++)
+            m.r[r] = XMVectorMultiply( b0.r[r], w0 );
+        for (int k = 1; k < N; k++)
+        {
+            const XMVECTOR w = XMVectorReplicate( weight[k] );
+            const XMMATRIX& b = bones[index[k]];
+            for (int r = 0; r < 4; r++)
+                m.r[r] = XMVectorMultiplyAdd( b.r[r], w, m.r[r] );
+        }
+        return m;
+    }
+
+    // Seek shortest rotation against the first bone, then normalize
+    template <int N>
+    INLINE void BlendDualQuaternion( const XMVECTOR* bones, const uint32_t* index, const float* weight,
+        XMVECTOR& real, XMVECTOR& dual )
+    {
+        const XMVECTOR r0 = bones[index[0] * 2];
+        const XMVECTOR w0 = XMVectorReplicate( weight[0] );
+        real = XMVectorMultiply( r0, w0 );
+        dual = XMVectorMultiply( bones[index[0] * 2 + 1], w0 );
+        for (int k = 1; k < N; k++)
+        {
+            const XMVECTOR rk = bones[index[k] * 2];
+            const XMVECTOR w = XMVectorReplicate( weight[k] );
+            const XMVECTOR flip = XMVectorLess( XMVector4Dot( r0, rk ), XMVectorZero() );
+            const XMVECTOR sw = XMVectorSelect( w, XMVectorNegate( w ), flip );
+            real = XMVectorMultiplyAdd( rk, sw, real );
+            dual = XMVectorMultiplyAdd( bones[index[k] * 2 + 1], sw, dual );
+        }
+        const XMVECTOR invLength = XMVectorReciprocal( XMVector4Length( real ) );
+        real = XMVectorMultiply( real, invLength );
+        dual = XMVectorMultiply( dual, invLength );
+    }
+
+    // v + 2 * cross(r.xyz, cross(r.xyz, v) + r.w * v)
+    INLINE XMVECTOR RotateDual( FXMVECTOR v, FXMVECTOR real )
+    {
+        const XMVECTOR t = XMVectorMultiplyAdd( XMVectorSplatW( real ), v, XMVector3Cross( real, v ) );
+        return XMVectorMultiplyAdd( XMVector3Cross( real, t ), g_XMTwo, v );
+    }
+
+    // Rotation plus 2 * (r.w * d.xyz - d.w * r.xyz + cross(r.xyz, d.xyz))
+    INLINE XMVECTOR TransformDual( FXMVECTOR v, FXMVECTOR real, FXMVECTOR dual )
+    {
+        XMVECTOR t = XMVectorMultiply( XMVectorSplatW( real ), dual );
+        t = XMVectorNegativeMultiplySubtract( XMVectorSplatW( dual ), real, t );
+        t = XMVectorAdd( t, XMVector3Cross( real, dual ) );
+        return XMVectorMultiplyAdd( t, g_XMTwo, RotateDual( v, real ) );
+    }
+
+    INLINE XMVECTOR LoadPosition( const XMFLOAT3& position, const Vector3* delta, uint32_t index )
+    {
+        const XMVECTOR p = XMLoadFloat3( &position );
+        return delta ? XMVectorAdd( p, delta[index] ) : p;
+    }
+}
+
+void SoftwareSkinning::Table::Build( const std::vector<XMFLOAT3>& Position, const std::vector<XMFLOAT3>& Normal,
+    const std::vector<Pmx::SkinTypeUnit>& Units, size_t NumBones )
+{
+    ASSERT( Position.size() == Normal.size() && Position.size() == Units.size() );
+
+    Clear();
+    m_NumVertices = static_cast<uint32_t>(Position.size());
+    m_NumBones = NumBones;
+
+    auto BoneIndex = [NumBones]( int32_t index ) -> uint32_t {
+        return (index < 0 || size_t(index) >= NumBones) ? 0 : uint32_t(index);
+    };
+
+    m_Vertices.reserve( m_NumVertices );
+    m_Influences.reserve( m_NumVertices );
+    for (uint32_t type = 0; type < Pmx::kMaxType; type++)
+    {
+        const uint32_t first = static_cast<uint32_t>(m_Vertices.size());
+        for (uint32_t i = 0; i < m_NumVertices; i++)
+        {
+            const auto& skin = Units[i];
+            if (skin.Type != type)
+                continue;
+            Influence inf = {};
+            switch (skin.Type)
+            {
+            case Pmx::kBdef1:
+                inf.BoneIndex[0] = BoneIndex( skin.Unit.bdef1.BoneIndex );
+                inf.Weight[0] = 1.f;
+                break;
+            case Pmx::kBdef2:
+            case Pmx::kSdef:
+                // Bdef2Unit and SdefUnit share leading layout
+                for (int k = 0; k < 2; k++)
+                    inf.BoneIndex[k] = BoneIndex( skin.Unit.bdef2.BoneIndex[k] );
+                inf.Weight[0] = skin.Unit.bdef2.Weight;
+                inf.Weight[1] = 1.f - skin.Unit.bdef2.Weight;
+                break;
+            case Pmx::kBdef4:
+            case Pmx::kQdef:
+                for (int k = 0; k < 4; k++)
+                {
+                    inf.BoneIndex[k] = BoneIndex( skin.Unit.bdef4.BoneIndex[k] );
+                    inf.Weight[k] = skin.Unit.bdef4.Weight[k];
+                }
+                break;
+            }
+            m_Vertices.push_back( { Position[i], Normal[i], i } );
+            m_Influences.push_back( inf );
+        }
+        const uint32_t last = static_cast<uint32_t>(m_Vertices.size());
+        for (uint32_t begin = first; begin < last; begin += kBatchSize)
+            m_Batches.push_back( { Pmx::ESkiningType(type), begin, std::min<uint32_t>( begin + kBatchSize, last ) } );
+        if (last > first && (type == Pmx::kSdef || type == Pmx::kQdef))
+            m_bDualQuaternion = true;
+    }
+    // Unknown skin type is left in rest pose
+    if (m_Vertices.size() < m_NumVertices)
+    {
+        for (uint32_t i = 0; i < m_NumVertices; i++)
+        {
+            if (Units[i].Type >= Pmx::kMaxType)
+                m_Rest.push_back( { Position[i], Normal[i], i } );
+        }
+    }
+}
+
+void SoftwareSkinning::Table::Clear( void )
+{
+    m_NumVertices = 0;
+    m_NumBones = 0;
+    m_bDualQuaternion = false;
+    m_Vertices.clear();
+    m_Influences.clear();
+    m_Batches.clear();
+    m_Rest.clear();
+}
+
+void SoftwareSkinning::Create( const Table& Skinning )
+{
+    Clear();
+    m_Table = &Skinning;
+
+    const uint32_t numVertices = Skinning.m_NumVertices;
+    m_Position.resize( numVertices + kOutputPadding );
+    m_Normal.resize( numVertices + kOutputPadding );
+    for (auto* vertices : { &Skinning.m_Vertices, &Skinning.m_Rest })
+    {
+        for (auto& vert : *vertices)
+        {
+            m_Position[vert.Index] = vert.Position;
+            m_Normal[vert.Index] = vert.Normal;
+        }
+    }
+
+    // Keep at least one bone, invalid index points it
+    m_BoneMatrix.resize( std::max<size_t>( Skinning.m_NumBones, 1 ), XMMatrixIdentity() );
+    if (Skinning.m_bDualQuaternion)
+    {
+        m_BoneDual.resize( m_BoneMatrix.size() * 2, XMVectorZero() );
+        for (size_t i = 0; i < m_BoneMatrix.size(); i++)
+            m_BoneDual[i * 2] = XMQuaternionIdentity();
+    }
+}
+
+void SoftwareSkinning::Clear( void )
+{
+    m_Table = nullptr;
+    m_BoneMatrix.clear();
+    m_BoneDual.clear();
+    m_Position.clear();
+    m_Normal.clear();
+}
+
+void SoftwareSkinning::Skin( const OrthogonalTransform* Bones, const Vector3* Delta )
+{
+    if (m_Table == nullptr || m_Table->m_Batches.empty())
+        return;
+    PrepareBones( Bones );
+    const auto& batches = m_Table->m_Batches;
+    TaskManager::parallel_for( 0, batches.size(), [&]( size_t i ) {
+        SkinBatch( batches[i], Delta );
+    });
+}
+
+void SoftwareSkinning::PrepareBones( const OrthogonalTransform* Bones )
+{
+    const size_t numBones = m_Table->m_NumBones;
+    for (size_t i = 0; i < numBones; i++)
+    {
+        XMMATRIX m = XMMatrixRotationQuaternion( Bones[i].GetRotation() );
+        m.r[3] = XMVectorSetW( Bones[i].GetTranslation(), 1.f );
+        m_BoneMatrix[i] = m;
+    }
+    if (!m_Table->m_bDualQuaternion)
+        return;
+    for (size_t i = 0; i < numBones; i++)
+    {
+        const DualQuaternion dq( Bones[i] );
+        m_BoneDual[i * 2] = dq.Real;
+        m_BoneDual[i * 2 + 1] = dq.Dual;
+    }
+}
+
+void SoftwareSkinning::SkinBatch( const Batch& batch, const Vector3* Delta )
+{
+    switch (batch.Type)
+    {
+    case Pmx::kBdef1: SkinLinear<1>( batch, Delta ); break;
+    case Pmx::kBdef2: SkinLinear<2>( batch, Delta ); break;
+    case Pmx::kBdef4: SkinLinear<4>( batch, Delta ); break;
+    case Pmx::kSdef: SkinDualQuaternion<2>( batch, Delta ); break;
+    case Pmx::kQdef: SkinDualQuaternion<4>( batch, Delta ); break;
+    }
+}
+
+template <int N>
+void SoftwareSkinning::SkinLinear( const Batch& batch, const Vector3* Delta )
+{
+    const XMMATRIX* bones = m_BoneMatrix.data();
+    for (uint32_t i = batch.Begin; i < batch.End; i++)
+    {
+        const Table::Vertex& vert = m_Table->m_Vertices[i];
+        const Table::Influence& inf = m_Table->m_Influences[i];
+        const XMMATRIX m = BlendMatrix<N>( bones, inf.BoneIndex, inf.Weight );
+        const XMVECTOR p = LoadPosition( vert.Position, Delta, vert.Index );
+        const XMVECTOR n = XMLoadFloat3( &vert.Normal );
+        XMStoreFloat3( &m_Position[vert.Index], XMVector3Transform( p, m ) );
+        XMStoreFloat3( &m_Normal[vert.Index], XMVector3TransformNormal( n, m ) );
+    }
+}
+
+template <int N>
+void SoftwareSkinning::SkinDualQuaternion( const Batch& batch, const Vector3* Delta )
+{
+    const XMVECTOR* bones = m_BoneDual.data();
+    for (uint32_t i = batch.Begin; i < batch.End; i++)
+    {
+        const Table::Vertex& vert = m_Table->m_Vertices[i];
+        const Table::Influence& inf = m_Table->m_Influences[i];
+        XMVECTOR real, dual;
+        BlendDualQuaternion<N>( bones, inf.BoneIndex, inf.Weight, real, dual );
+        const XMVECTOR p = LoadPosition( vert.Position, Delta, vert.Index );
+        const XMVECTOR n = XMLoadFloat3( &vert.Normal );
+        XMStoreFloat3( &m_Position[vert.Index], TransformDual( p, real, dual ) );
+        XMStoreFloat3( &m_Normal[vert.Index], RotateDual( n, real ) );
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include "VectorMath.h"
+#include "Pmx.h"
+
+//
+// CPU skinning backend, an alternative to the stream-out 'PmxSkinningSO' path
+//
+// Vertices are bucketed by skin type in a table built once per model and
+// shared by its instances, so each batch runs a branch-free kernel. Each
+// instance only keeps its bone data and output streams, allocated once and
+// reused every frame. Math follows PmxSkinningSO.hlsl, including SDEF
+// handled as two bone DQBS.
+//
+class SoftwareSkinning
+{
+public:
+
+    // Rest pose and influences of a model, sorted by skin type
+    class Table
+    {
+    public:
+
+        void Build( const std::vector<XMFLOAT3>& Position, const std::vector<XMFLOAT3>& Normal,
+            const std::vector<Pmx::SkinTypeUnit>& Units, size_t NumBones );
+        void Clear( void );
+
+        uint32_t GetVertexCount( void ) const { return m_NumVertices; }
+
+    protected:
+
+        friend class SoftwareSkinning;
+
+        struct Vertex
+        {
+            XMFLOAT3 Position;
+            XMFLOAT3 Normal;
+            uint32_t Index;
+        };
+
+        // Bdef1, Bdef2 and Sdef use first two, Bdef4 and Qdef use all of them
+        struct Influence
+        {
+            uint32_t BoneIndex[4];
+            float Weight[4];
+        };
+
+        struct Batch
+        {
+            Pmx::ESkiningType Type;
+            uint32_t Begin;
+            uint32_t End;
+        };
+
+        uint32_t m_NumVertices = 0;
+        size_t m_NumBones = 0;
+        bool m_bDualQuaternion = false;
+
+        std::vector<Vertex> m_Vertices;
+        std::vector<Influence> m_Influences;
+        std::vector<Batch> m_Batches;
+        std::vector<Vertex> m_Rest; // unknown skin type, never skinned
+    };
+
+    // Output starts in rest pose, 'Skinning' must outlive this
+    void Create( const Table& Skinning );
+    void Clear( void );
+
+    // 'Delta' is a per vertex morph offset, it can be null
+    void Skin( const Math::OrthogonalTransform* Bones, const Math::Vector3* Delta );
+
+    bool IsCreated( void ) const { return m_Table != nullptr; }
+    uint32_t GetVertexCount( void ) const { return m_Table ? m_Table->m_NumVertices : 0; }
+    const std::vector<XMFLOAT3>& GetPosition( void ) const { return m_Position; }
+    const std::vector<XMFLOAT3>& GetNormal( void ) const { return m_Normal; }
+
+protected:
+
+    using Batch = Table::Batch;
+
+    void PrepareBones( const Math::OrthogonalTransform* Bones );
+    void SkinBatch( const Batch& batch, const Math::Vector3* Delta );
+    template <int N> void SkinLinear( const Batch& batch, const Math::Vector3* Delta );
+    template <int N> void SkinDualQuaternion( const Batch& batch, const Math::Vector3* Delta );
+
+    const Table* m_Table = nullptr;
+
+    // Per frame bone data
+    std::vector<XMMATRIX> m_BoneMatrix;
+    std::vector<XMVECTOR> m_BoneDual; // real, dual pair
+
+    std::vector<XMFLOAT3> m_Position;
+    std::vector<XMFLOAT3> m_Normal;
+};
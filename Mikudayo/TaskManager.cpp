@@ -1,11 +1,27 @@
 #include "stdafx.h"
 #include "TaskManager.h"
+#include "Bullet/TaskScheduler.h"
 #include <ppl.h>
 #include <concrtrm.h>
+#include <algorithm>
 
-namespace TaskManager
-{
-    uint32_t GetMaxNumThreads();
+namespace {
+    // Bullet keeps per thread state for up to BT_MAX_THREAD_COUNT threads,
+    // which holds for the fixed size pool of TaskManager
+    class TaskManagerScheduler : public Physics::ITaskScheduler
+    {
+    public:
+        const char* GetName( void ) const override { return "TaskManager"; }
+        uint32_t GetNumThreads( void ) const override { return TaskManager::GetMaxNumThreads(); }
+        void ParallelFor( int Begin, int End, int GrainSize, const ParallelForBody& Body ) override
+        {
+            TaskManager::parallel_for_range( Begin, End, GrainSize, [&]( int First, int Last ) {
+                Body.forLoop( First, Last );
+            });
+        }
+    };
+
+    TaskManagerScheduler s_TaskManagerScheduler;
 }
 
 void TaskManager::Initialize()
@@ -23,7 +39,29 @@ void TaskManager::Shutdown()
 {
 }
 
+void TaskManager::parallel_for_range( int Begin, int End, int GrainSize, const std::function<void( int Begin, int End )>& func )
+{
+    if (Begin >= End)
+        return;
+    GrainSize = std::max( GrainSize, 1 );
+    const int numChunks = (End - Begin + GrainSize - 1) / GrainSize;
+    if (numChunks == 1)
+    {
+        func( Begin, End );
+        return;
+    }
+    parallel_for( 0, size_t(numChunks), [&]( size_t chunk ) {
+        const int first = Begin + int(chunk) * GrainSize;
+        func( first, std::min( first + GrainSize, End ) );
+    });
+}
+
 uint32_t TaskManager::GetMaxNumThreads()
 {
     return concurrency::GetProcessorCount();
-}
\ No newline at end of file
+}
+
+Physics::ITaskScheduler* Physics::GetTaskManagerScheduler( void )
+{
+    return &s_TaskManagerScheduler;
+}
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <ppl.h>
+#include <functional>
 
 namespace TaskManager {
     void Initialize();
     void Shutdown();
+    uint32_t GetMaxNumThreads();
+
+    // 'func' is called with sub range [Begin, End) of at most 'GrainSize' items
+    void parallel_for_range( int Begin, int End, int GrainSize, const std::function<void( int Begin, int End )>& func );
 
     template <typename Func>
     void parallel_for(size_t Begin, size_t End, const Func& func)
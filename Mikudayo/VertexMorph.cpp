@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "VertexMorph.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Math;
+
+namespace {
+    // Same threshold as weight comparison of motion update
+    const float kWeightEpsilon = 0.1e-5f;
+
+    // Vertex indices closer than this are uploaded as a single range
+    const uint32_t kRangeGap = 32;
+
+    // Incremental update accumulates rounding error, rebuild from weights after this many changes
+    const uint32_t kRebuildInterval = 4096;
+
+    void MergeRanges( std::vector<VertexMorph::Range>& ranges )
+    {
+        if (ranges.empty())
+            return;
+        std::sort( ranges.begin(), ranges.end(), []( const VertexMorph::Range& a, const VertexMorph::Range& b ) {
+            return a.Begin < b.Begin;
+        });
+        size_t n = 0;
+        for (size_t i = 1; i < ranges.size(); i++)
+        {
+            if (ranges[i].Begin <= ranges[n].End + kRangeGap)
+                ranges[n].End = std::max( ranges[n].End, ranges[i].End );
+            else
+                ranges[++n] = ranges[i];
+        }
+        ranges.resize( n + 1 );
+    }
+}
+
+void VertexMorph::Build( const std::vector<Pmx::Morph>& Morphs, size_t NumVertices, Pmx::MorphType Type )
+{
+    ASSERT( Type == Pmx::MorphType::kVertex || Type == Pmx::MorphType::kTexCoord );
+    Clear();
+    m_Delta.resize( NumVertices, Vector3( kZero ) );
+    m_Weight.resize( Morphs.size(), 0.f );
+    m_OffsetIndex.push_back( 0 );
+    m_RangeIndex.push_back( 0 );
+
+    std::vector<Range> ranges;
+    for (auto& morph : Morphs)
+    {
+        ranges.clear();
+        auto AddOffset = [&]( uint32_t index, const XMFLOAT3& position ) {
+            if (index >= NumVertices)
+                return;
+            m_Offsets.push_back( { index, position } );
+            ranges.push_back( { index, index + 1 } );
+        };
+        if (morph.Type == Type && Type == Pmx::MorphType::kVertex)
+        {
+            for (auto& vert : morph.VertexList)
+                AddOffset( vert.VertexIndex, vert.Position );
+        }
+        else if (morph.Type == Type && Type == Pmx::MorphType::kTexCoord)
+        {
+            for (auto& uv : morph.TexCoordList)
+                AddOffset( uv.VertexIndex, XMFLOAT3( uv.Position.x, uv.Position.y, 0.f ) );
+        }
+        MergeRanges( ranges );
+        m_Ranges.insert( m_Ranges.end(), ranges.begin(), ranges.end() );
+        m_OffsetIndex.push_back( static_cast<uint32_t>(m_Offsets.size()) );
+        m_RangeIndex.push_back( static_cast<uint32_t>(m_Ranges.size()) );
+    }
+}
+
+void VertexMorph::Clear( void )
+{
+    m_Offsets.clear();
+    m_OffsetIndex.clear();
+    m_Ranges.clear();
+    m_RangeIndex.clear();
+    m_Weight.clear();
+    m_Delta.clear();
+    m_Dirty.clear();
+    m_NumIncremental = 0;
+}
+
+bool VertexMorph::SetWeight( uint32_t Morph, float Weight )
+{
+    ASSERT( Morph < m_Weight.size() );
+    const float diff = Weight - m_Weight[Morph];
+    if (std::fabs( diff ) < kWeightEpsilon)
+        return false;
+    m_Weight[Morph] = Weight;
+
+    const uint32_t begin = m_OffsetIndex[Morph], end = m_OffsetIndex[Morph + 1];
+    if (begin == end)
+        return false;
+    if (++m_NumIncremental >= kRebuildInterval)
+    {
+        Rebuild();
+        return true;
+    }
+    const Scalar scale( diff );
+    for (uint32_t i = begin; i < end; i++)
+        m_Delta[m_Offsets[i].VertexIndex] += scale * Vector3( m_Offsets[i].Position );
+    m_Dirty.insert( m_Dirty.end(), m_Ranges.begin() + m_RangeIndex[Morph], m_Ranges.begin() + m_RangeIndex[Morph + 1] );
+    // Bounded even if nobody consumes them (e.g. CPU skinning)
+    if (m_Dirty.size() > m_Ranges.size())
+        MergeRanges( m_Dirty );
+    return true;
+}
+
+bool VertexMorph::Reset( void )
+{
+    bool bChanged = false;
+    for (uint32_t i = 0; i < m_Weight.size(); i++)
+        bChanged |= SetWeight( i, 0.f );
+    return bChanged;
+}
+
+const std::vector<VertexMorph::Range>& VertexMorph::GetDirtyRanges( void )
+{
+    MergeRanges( m_Dirty );
+    return m_Dirty;
+}
+
+// Accumulate from zero, only the vertices some morph touches can be non zero
+void VertexMorph::Rebuild( void )
+{
+    m_NumIncremental = 0;
+    for (auto& range : m_Ranges)
+        std::fill( m_Delta.begin() + range.Begin, m_Delta.begin() + range.End, Vector3( kZero ) );
+    for (uint32_t morph = 0; morph < m_Weight.size(); morph++)
+    {
+        if (m_Weight[morph] == 0.f)
+            continue;
+        const Scalar scale( m_Weight[morph] );
+        for (uint32_t i = m_OffsetIndex[morph]; i < m_OffsetIndex[morph + 1]; i++)
+            m_Delta[m_Offsets[i].VertexIndex] += scale * Vector3( m_Offsets[i].Position );
+    }
+    m_Dirty.insert( m_Dirty.end(), m_Ranges.begin(), m_Ranges.end() );
+}
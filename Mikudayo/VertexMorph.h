@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include "VectorMath.h"
+#include "Pmx.h"
+
+//
+// Vertex morph accumulator
+//
+// Keeps weight applied to each morph, and adds only the weight difference
+// to the vertices the morph touches. Touched vertex ranges are collected so
+// that only they are uploaded. Cost follows the size of changed morphs, not
+// the vertex count of the model.
+// Position morph (kVertex) and UV morph (kTexCoord, in xy) are supported.
+//
+class VertexMorph
+{
+public:
+
+    struct Range
+    {
+        uint32_t Begin;
+        uint32_t End;
+    };
+
+    void Build( const std::vector<Pmx::Morph>& Morphs, size_t NumVertices, Pmx::MorphType Type = Pmx::MorphType::kVertex );
+    void Clear( void );
+
+    // Returns true if any vertex is changed
+    bool SetWeight( uint32_t Morph, float Weight );
+    bool Reset( void );
+
+    float GetWeight( uint32_t Morph ) const { return m_Weight[Morph]; }
+    const std::vector<Math::Vector3>& GetDelta( void ) const { return m_Delta; }
+
+    bool IsDirty( void ) const { return !m_Dirty.empty(); }
+    // Sorted and merged, valid until next change
+    const std::vector<Range>& GetDirtyRanges( void );
+    void ClearDirty( void ) { m_Dirty.clear(); }
+
+protected:
+
+    struct Offset
+    {
+        uint32_t VertexIndex;
+        XMFLOAT3 Position;
+    };
+
+    void Rebuild( void );
+
+    std::vector<Offset> m_Offsets; // grouped by morph
+    std::vector<uint32_t> m_OffsetIndex; // per morph offset into 'm_Offsets', last one is the end
+    std::vector<Range> m_Ranges; // touched vertex ranges grouped by morph
+    std::vector<uint32_t> m_RangeIndex;
+    std::vector<float> m_Weight; // applied to 'm_Delta'
+
+    std::vector<Math::Vector3> m_Delta;
+    std::vector<Range> m_Dirty;
+    uint32_t m_NumIncremental = 0;
+};
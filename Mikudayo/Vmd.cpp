@@ -15,27 +15,57 @@ namespace Vmd
 {
 	using namespace Utility;
 
-	void BoneFrame::Fill( bufferstream& is, bool bRH )
+	// Byte size of each frame record in file
+	enum {
+		kBoneFrameSize = 111,
+		kFaceFrameSize = 23,
+		kCameraFrameSize = 61,
+		kLightFrameSize = 28,
+		kSelfShadowFrameSize = 9,
+		kIkFrameSize = 9,
+	};
+
+	uint32_t NameTable::Intern( const char* buffer, size_t size )
+	{
+		// name field is not null terminated if it is full
+		std::string name( buffer, strnlen( buffer, size ) );
+
+		// Frames of same bone are usually stored in a row
+		if (!Names.empty() && name == m_LastName)
+			return m_LastIndex;
+
+		auto it = m_Index.find( name );
+		if (it == m_Index.end())
+		{
+			it = m_Index.emplace( name, uint32_t(Names.size()) ).first;
+			Names.push_back( sjis_to_utf( name ) );
+		}
+		m_LastName = std::move( name );
+		m_LastIndex = it->second;
+		return m_LastIndex;
+	}
+
+	void BoneFrame::Fill( ByteReader& is, bool bRH, NameTable& names )
 	{
 		NameFieldBuf buffer;
 		Read( is, buffer );
-		BoneName = sjis_to_utf( buffer );
+		NameIndex = names.Intern( buffer, sizeof( buffer ) );
 		Read( is, Frame );
 		ReadPosition( is, Offset, bRH );
 		ReadRotation( is, Rotation, bRH );
 		Read( is, Interpolation );
 	}
 
-	void FaceFrame::Fill( bufferstream& is )
+	void FaceFrame::Fill( ByteReader& is, NameTable& names )
 	{
 		NameFieldBuf buffer;
 		Read( is, buffer );
-		FaceName = sjis_to_utf( buffer );
+		NameIndex = names.Intern( buffer, sizeof( buffer ) );
 		Read( is, Frame );
 		Read( is, Weight );
 	}
 
-	void CameraFrame::Fill( bufferstream& is, bool bRH )
+	void CameraFrame::Fill( ByteReader& is, bool bRH )
 	{
 		Read( is, Frame );
 		Read( is, Distance );
@@ -46,28 +76,27 @@ namespace Vmd
 		Read( is, TurnOffPerspective );
 	}
 
-	void SelfShadowFrame::Fill( bufferstream & is)
+	void SelfShadowFrame::Fill( ByteReader& is)
 	{
 		Read( is, Frame );
 		Read( is, Mode );
 		Read( is, Distance);
 	}
 
-	void LightFrame::Fill( bufferstream & is, bool bRH )
+	void LightFrame::Fill( ByteReader& is, bool bRH )
 	{
 		Read( is, Frame );
 		Read( is, Color );
 		ReadPosition( is, Position, bRH );
 	}
 
-	void IkFrame::Fill( bufferstream & is )
+	void IkFrame::Fill( ByteReader& is )
 	{
 		Read( is, Frame );
 		Read( is, Visible );
-		int32_t numIK;
-		Read( is, numIK );
+		uint32_t numIK = ReadCount( is, sizeof( NameBuf ) + 1 );
 		IkEnable.resize( numIK );
-		for (auto i = 0; i < numIK; i++)
+		for (uint32_t i = 0; i < numIK; i++)
 		{
 			NameBuf buffer;
 			Read( is, buffer );
@@ -76,7 +105,7 @@ namespace Vmd
 		}
 	}
 
-	void VMD::Fill( bufferstream& is, bool bRH )
+	void VMD::Fill( ByteReader& is, bool bRH )
 	{
         m_IsValid = false;
 
@@ -97,51 +126,66 @@ namespace Vmd
 		Read( is, nameBuf );
 		Name = Utility::sjis_to_utf( nameBuf );
 
+		NameTable names;
+
 		// Bone frames
-		int32_t BoneFrameNum;
-		Read( is, BoneFrameNum );
+		uint32_t BoneFrameNum = ReadCount( is, kBoneFrameSize );
 		BoneFrames.resize( BoneFrameNum );
-		for (int i = 0; i < BoneFrameNum; i++)
-			BoneFrames[i].Fill( is, bRH );
+		for (uint32_t i = 0; i < BoneFrameNum; i++)
+			BoneFrames[i].Fill( is, bRH, names );
 
 		// Face frames
-		int32_t FaceFrameNum;
-		Read( is, FaceFrameNum );
+		uint32_t FaceFrameNum = ReadCount( is, kFaceFrameSize );
 		FaceFrames.resize( FaceFrameNum );
-		for (int i = 0; i < FaceFrameNum; i++)
-			FaceFrames[i].Fill( is );
+		for (uint32_t i = 0; i < FaceFrameNum; i++)
+			FaceFrames[i].Fill( is, names );
+
+		Names = std::move( names.Names );
+
+		// Older files end before camera, light or self shadow sections
 
 		// camera frames
-		int32_t CameraFrameNum;
-		Read( is, CameraFrameNum );
-		CameraFrames.resize( CameraFrameNum );
-		for (int i = 0; i < CameraFrameNum; i++)
-			CameraFrames[i].Fill( is, bRH );
+		if (!is.IsEOF())
+		{
+			uint32_t CameraFrameNum = ReadCount( is, kCameraFrameSize );
+			CameraFrames.resize( CameraFrameNum );
+			for (uint32_t i = 0; i < CameraFrameNum; i++)
+				CameraFrames[i].Fill( is, bRH );
+		}
 
 		// light frames
-		int32_t LightFrameNum;
-		Read( is, LightFrameNum );
-		LightFrames.resize( LightFrameNum );
-		for (auto i = 0; i < LightFrameNum; i++)
-			LightFrames[i].Fill( is, bRH );
-
-		int32_t SelfShadowFrameNum;
-		Read( is, SelfShadowFrameNum );
-		SelfShadowFrames.resize( SelfShadowFrameNum );
-		for (auto i = 0; i < SelfShadowFrameNum; i++)
-			SelfShadowFrames[i].Fill( is );
+		if (!is.IsEOF())
+		{
+			uint32_t LightFrameNum = ReadCount( is, kLightFrameSize );
+			LightFrames.resize( LightFrameNum );
+			for (uint32_t i = 0; i < LightFrameNum; i++)
+				LightFrames[i].Fill( is, bRH );
+		}
+
+		if (!is.IsEOF())
+		{
+			uint32_t SelfShadowFrameNum = ReadCount( is, kSelfShadowFrameSize );
+			SelfShadowFrames.resize( SelfShadowFrameNum );
+			for (uint32_t i = 0; i < SelfShadowFrameNum; i++)
+				SelfShadowFrames[i].Fill( is );
+		}
 
 		// Ik frames
-		if (is.peek() != std::ios::traits_type::eof())
+		if (!is.IsEOF())
 		{
-			int32_t IkNum;
-			Read( is, IkNum );
+			uint32_t IkNum = ReadCount( is, kIkFrameSize );
 			IKFrames.resize( IkNum );
-			for (auto i = 0; i < IkNum; i++)
+			for (uint32_t i = 0; i < IkNum; i++)
 				IKFrames[i].Fill( is );
 		}
 
-		if (is.peek() != std::ios::traits_type::eof())
+		if (is.Fail())
+		{
+			std::cerr << "Truncated VMD file." << std::endl;
+			return;
+		}
+
+		if (!is.IsEOF())
 			std::cerr << "vmd stream has unknown data." << std::endl;
 
         m_IsValid = true;
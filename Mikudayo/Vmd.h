@@ -7,15 +7,14 @@
 //
 #pragma once
 
-#include <iosfwd>
 #include <DirectXMath.h>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 namespace Utility
 {
-	using StorageType = std::istream::char_type;
-	using bufferstream = std::basic_istream<StorageType, char_traits<StorageType>>;
+	class ByteReader;
 }
 
 namespace Vmd
@@ -27,23 +26,40 @@ namespace Vmd
 	using NameFieldBuf = char[15];
 	using NameBuf = char[20];
 
+	//
+	// Motion has tens of thousands of frames, but only a few hundred names.
+	// So, raw name is interned and each distinct name is decoded once
+	//
+	class NameTable
+	{
+	public:
+		uint32_t Intern( const char* buffer, size_t size );
+
+		std::vector<std::wstring> Names;
+
+	private:
+		std::string m_LastName;
+		uint32_t m_LastIndex = 0;
+		std::unordered_map<std::string, uint32_t> m_Index;
+	};
+
 	struct BoneFrame
 	{
-		std::wstring BoneName;
+		uint32_t NameIndex; // index of VMD::Names
 		int32_t Frame;
 		XMFLOAT3 Offset; // Bone location relative offset
 		XMFLOAT4 Rotation; // Quaternion
 		char Interpolation[4][4][4];
 
-		void Fill( bufferstream& is, bool bRH );
+		void Fill( ByteReader& is, bool bRH, NameTable& names );
 	};
 
 	struct FaceFrame
 	{
-		std::wstring FaceName;
+		uint32_t NameIndex; // index of VMD::Names
 		float Weight;
 		uint32_t Frame;
-		void Fill( bufferstream& is );
+		void Fill( ByteReader& is, NameTable& names );
 	};
 
 	struct CameraFrame
@@ -56,7 +72,7 @@ namespace Vmd
 		uint32_t ViewAngle;
 		uint8_t TurnOffPerspective; // 0:On, 1:Off
 
-		void Fill( bufferstream& is, bool bRH );
+		void Fill( ByteReader& is, bool bRH );
 	};
 
 	struct LightFrame
@@ -65,7 +81,7 @@ namespace Vmd
 		XMFLOAT3 Color;
 		XMFLOAT3 Position;
 
-		void Fill( bufferstream& is, bool bRH );
+		void Fill( ByteReader& is, bool bRH );
 	};
 
 	struct SelfShadowFrame
@@ -74,7 +90,7 @@ namespace Vmd
 		uint8_t Mode; // 00-02
 		float Distance; // 0.1 - (dist * 0.00001)
 
-		void Fill( bufferstream& is );
+		void Fill( ByteReader& is );
 	};
 
 	struct IkEnable
@@ -89,7 +105,7 @@ namespace Vmd
 		uint8_t Visible;
 		std::vector<IkEnable> IkEnable;
 
-		void Fill( bufferstream& is );
+		void Fill( ByteReader& is );
 	};
 
 	class VMD
@@ -97,6 +113,7 @@ namespace Vmd
 	public:
 		std::wstring Name;
 		int Version;
+		std::vector<std::wstring> Names; // bone and face names
 		std::vector<BoneFrame> BoneFrames;
 		std::vector<FaceFrame> FaceFrames;
 		std::vector<CameraFrame> CameraFrames;
@@ -105,7 +122,7 @@ namespace Vmd
 		std::vector<IkFrame> IKFrames;
 
         VMD() : m_IsValid(false) {}
-		void Fill( bufferstream& is, bool bRH );
+		void Fill( ByteReader& is, bool bRH );
         bool IsValid() const { return m_IsValid; }
         bool m_IsValid;
 	};
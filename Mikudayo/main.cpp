@@ -5,6 +5,7 @@
 #include "Bullet/PrimitiveBatch.h"
 #include "Bullet/LinearMath.h"
 #include "ModelManager.h"
+#include "Pmx.h"
 #include "RenderArgs.h"
 #include "Scene.h"
 #include "Motion.h"
@@ -13,6 +14,7 @@
 #include "ShadowCamera.h"
 #include "ShadowCameraUniform.h"
 #include "ShadowCameraLiSPSM.h"
+#include "ShadowCameraCascade.h"
 #include "ShadowCasterPass.h"
 #include "CameraController.h"
 #include "MikuCameraController.h"
@@ -20,6 +22,7 @@
 #include "RenderBonePass.h"
 #include "SkinningPass.h"
 #include "ForwardLighting.h"
+#include "DeferredLighting.h"
 #include "MotionBlur.h"
 #include "DepthOfField.h"
 #include "TaskManager.h"
@@ -57,6 +60,7 @@ private:
     Camera m_Camera;
     MikuCamera m_SecondCamera;
     ShadowCameraLiSPSM m_SunShadow;
+    ShadowCameraCascade m_SunCascade;
     std::unique_ptr<CameraController> m_CameraController;
     std::unique_ptr<MikuCameraController> m_SecondCameraController;
 	Motion m_Motion;
@@ -98,15 +102,22 @@ NumVar m_SunColorG("Application/Lighting/Sun Color G", 204.f, 0.0f, 255.0f, 1.0f
 NumVar m_SunColorB("Application/Lighting/Sun Color B", 228.f, 0.0f, 255.0f, 1.0f );
 
 BoolVar s_bDrawBone( "Application/Model/Draw Bone", false );
+// A LiSPSM map for the whole view otherwise
+BoolVar s_bCascadedShadow( "Application/Shadow/Cascaded", true );
+NumVar s_CascadeLambda( "Application/Shadow/Cascade Split Lambda", 0.8f, 0.0f, 1.0f, 0.05f );
 
 void Mikudayo::Startup( void )
 {
     TaskManager::Initialize();
+    Pmx::SetParallelFor( TaskManager::parallel_for_range );
     TextureManager::Initialize( L"Textures" );
     Physics::Initialize();
     PrimitiveUtility::Initialize();
     ModelManager::Initialize();
     Forward::Initialize();
+    Lighting::Initialize();
+    // Point and spot lights over the stage, shaded per cluster in the color pass
+    Lighting::CreateRandomLights( Vector3( -50.f, 0.f, -50.f ), Vector3( 50.f, 40.f, 50.f ) );
 
     const Vector3 eye = Vector3(0.0f, 20.0f, 25.0f);
     const Vector3 at = Vector3( 0.0, 15.f, 0.f );
@@ -115,6 +126,7 @@ void Mikudayo::Startup( void )
     m_CameraController.reset(new CameraController(m_Camera, Vector3(kYUnitVector)));
     m_SecondCamera.SetEyeAtUp( eye, at, Vector3(kYUnitVector) );
     m_SecondCameraController.reset(new MikuCameraController(m_SecondCamera, Vector3(kYUnitVector)));
+    m_SunCascade.Create( ShadowCameraCascade::kMaxCascades, g_ShadowBuffer.GetWidth() );
 
     m_Scene = std::make_shared<Scene>();
     const std::wstring cameraMotion = L"Motion/クラブマジェスティカメラモーション.vmd";
@@ -158,6 +170,7 @@ void Mikudayo::Cleanup( void )
     for (auto& model : m_Primitives)
         model->Destroy();
     m_Primitives.clear();
+    Lighting::Shutdown();
     Forward::Shutdown();
     Physics::Shutdown();
     TaskManager::Shutdown();
@@ -168,7 +181,7 @@ const BaseCamera& Mikudayo::GetCamera()
     if (m_CameraType == kCameraVirtual)
         return m_Camera;
     else if (m_CameraType == kCameraShadow)
-        return m_SunShadow;
+        return s_bCascadedShadow ? m_SunCascade.GetCascade( 0 ) : m_SunShadow;
     else
         return m_SecondCamera;
 }
@@ -196,7 +209,13 @@ void Mikudayo::Update( float deltaT )
     m_SunColor = Vector3( m_SunColorR, m_SunColorG, m_SunColorB );
 
     // To debug shadow map, shadow generate is sole on main camera
-    m_SunShadow.UpdateMatrix( *m_Scene, m_SunDirection, GetGraphicsCamera() );
+    if (s_bCascadedShadow)
+    {
+        m_SunCascade.SetLambda( s_CascadeLambda );
+        m_SunCascade.UpdateMatrix( *m_Scene, m_SunDirection, GetGraphicsCamera() );
+    }
+    else
+        m_SunShadow.UpdateMatrix( *m_Scene, m_SunDirection, GetGraphicsCamera() );
 
     m_CameraPosition = GetCamera().GetPosition();
     m_ViewMatrix = GetCamera().GetViewMatrix();
@@ -226,10 +245,12 @@ void Mikudayo::Update( float deltaT )
     if (!EngineProfiling::IsPaused())
         m_Frame = m_Frame + deltaT * 30.f;
     {
-        // Update order is modified to hide physics update cost
-        Physics::Wait();
+        // Update order is modified to hide physics update cost. Physics works on
+        // bone snapshots, it waits only if the step is behind the latency limit
+        Physics::Sync();
         m_Scene->UpdateSceneAfterPhysics( m_Frame );
         m_Scene->UpdateScene( m_Frame );
+        Physics::UpdateLodCamera( GetCamera() );
         Physics::Update( deltaT );
         m_Motion.Update( m_Frame );
     }
@@ -253,7 +274,7 @@ void Mikudayo::RenderScene( void )
     vsConstants.view = m_ViewMatrix;
     vsConstants.projection = m_ProjMatrix;
     vsConstants.cameraPosition = m_CameraPosition;
-    vsConstants.viewToShadow = m_SunShadow.GetShadowMatrix();
+    vsConstants.viewToShadow = s_bCascadedShadow ? m_SunCascade.GetCascade( 0 ).GetShadowMatrix() : m_SunShadow.GetShadowMatrix();
 
     struct PSConstants
     {
@@ -266,6 +287,35 @@ void Mikudayo::RenderScene( void )
     psConstants.ShadowTexelSize[0] = 1.0f / g_ShadowBuffer.GetWidth();
 	gfxContext.SetDynamicConstantBufferView( 5, sizeof(psConstants), &psConstants, { kBindVertex, kBindPixel } );
 
+    // See, Shadow.hlsli
+    struct CascadeConstants
+    {
+        Vector4 Scale[ShadowCameraCascade::kMaxCascades];
+        Vector4 Offset[ShadowCameraCascade::kMaxCascades];
+        uint32_t Count;
+    } cascadeConstants = {};
+    const uint32_t numCascades = s_bCascadedShadow ? m_SunCascade.GetCascadeCount() : 1;
+    cascadeConstants.Count = numCascades;
+    for (uint32_t i = 0; i < numCascades; i++)
+    {
+        Vector3 scale( kIdentity ), offset( kZero );
+        if (s_bCascadedShadow)
+            m_SunCascade.GetScaleOffset( i, scale, offset );
+        cascadeConstants.Scale[i] = Vector4( scale, 0.f );
+        cascadeConstants.Offset[i] = Vector4( offset, 0.f );
+    }
+	gfxContext.SetDynamicConstantBufferView( 6, sizeof(cascadeConstants), &cascadeConstants, { kBindPixel } );
+
+    {
+        ScopedTimer _prof( L"Light Cluster", gfxContext );
+        Lighting::UpdateLights( gfxContext, GetCamera() );
+        Lighting::SetClusteredLights( gfxContext, g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight() );
+    }
+
+    {
+        ScopedTimer _prof( L"Render List" );
+        m_Scene->BuildRenderList( GetCamera() );
+    }
     m_Scene->Render( m_RenderSkinPass, args );
     D3D11_SAMPLER_HANDLE Sampler[] = { SamplerAnisoWrap, SamplerAnisoClamp, SamplerShadow, SamplerPointClamp };
     gfxContext.SetDynamicSamplers( 0, _countof(Sampler), Sampler, { kBindPixel } );
@@ -283,13 +333,19 @@ void Mikudayo::RenderScene( void )
     SSAO::Render(gfxContext, GetGraphicsCamera());
     {   
         ScopedTimer _prof( L"Render Shadow Map", gfxContext );
-        struct { Matrix4 View, Proj; } ShadowConstant;
-        ShadowConstant.View = m_SunShadow.GetViewMatrix();
-        ShadowConstant.Proj = m_SunShadow.GetProjMatrix();
-        gfxContext.SetDynamicConstantBufferView( 0, sizeof(ShadowConstant), &ShadowConstant, { kBindVertex } );
-        g_ShadowBuffer.BeginRendering( gfxContext );
-        m_Scene->Render( m_ShadowCasterPass, args );
-        g_ShadowBuffer.EndRendering( gfxContext );
+        // Each cascade draws its own casters, culled against its light camera
+        for (uint32_t i = 0; i < numCascades; i++)
+        {
+            const BaseCamera& shadowCamera = s_bCascadedShadow ? m_SunCascade.GetCascade( i ) : m_SunShadow;
+            struct { Matrix4 View, Proj; } ShadowConstant;
+            ShadowConstant.View = shadowCamera.GetViewMatrix();
+            ShadowConstant.Proj = shadowCamera.GetProjMatrix();
+            gfxContext.SetDynamicConstantBufferView( 0, sizeof(ShadowConstant), &ShadowConstant, { kBindVertex } );
+            RenderArgs shadowArgs = { gfxContext, ShadowConstant.View, ShadowConstant.Proj, m_MainViewport, shadowCamera };
+            g_ShadowBuffer.BeginRendering( gfxContext, i );
+            m_Scene->RenderShadow( m_ShadowCasterPass, shadowArgs );
+            g_ShadowBuffer.EndRendering( gfxContext );
+        }
     }
 
     m_ExtraTextures[0] = g_SSAOFullScreen.GetSRV();
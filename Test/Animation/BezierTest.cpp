@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <random>
+
+#include "KeyFrameAnimation.h"
+
+using namespace Math;
+using namespace Animation;
+
+namespace {
+    // Exact solution of y for given x (double precision bisection)
+    float BezierExact( const XMFLOAT4& c, float p )
+    {
+        auto ft = [&]( double t, double a1, double a2 ) {
+            double s = 1.0 - t;
+            return 3*s*s*t*a1 + 3*s*t*t*a2 + t*t*t;
+        };
+        double low = 0.0, high = 1.0;
+        for (int i = 0; i < 60; i++) {
+            double mid = (low + high) / 2;
+            if (ft( mid, c.x, c.z ) < p)
+                low = mid;
+            else
+                high = mid;
+        }
+        return float( ft( (low + high) / 2, c.y, c.w ) );
+    }
+
+    // VMD stores control points in 0-127
+    Vector4 RandomControlPoint( std::mt19937& rng )
+    {
+        std::uniform_int_distribution<int> dist( 0, 127 );
+        return Vector4( float(dist( rng )), float(dist( rng )), float(dist( rng )), float(dist( rng )) ) / 127.f;
+    }
+}
+
+TEST(BezierCurveTest, Linear)
+{
+    BezierCurve linear( Vector4( 20, 20, 107, 107 ) / 127.f );
+    for (int i = 0; i <= 100; i++)
+    {
+        float p = i / 100.f;
+        EXPECT_FLOAT_EQ( linear.Evaluate( p ), p );
+    }
+}
+
+TEST(BezierCurveTest, Accuracy)
+{
+    std::mt19937 rng( 1 );
+    for (int n = 0; n < 10000; n++)
+    {
+        Vector4 C = RandomControlPoint( rng );
+        XMFLOAT4 coeff;
+        XMStoreFloat4( &coeff, C );
+        BezierCurve curve( C );
+        for (int i = 0; i <= 64; i++)
+        {
+            float p = i / 64.f;
+            float baked = curve.Evaluate( p );
+            EXPECT_NEAR( baked, BezierExact( coeff, p ), 1e-4f );
+            // 15 step bisection loses precision where dx/dt is near zero (ex. x1 = 1, x2 = 0)
+            EXPECT_NEAR( baked, Bezier( C, p ), 1e-2f );
+        }
+    }
+}
+
+TEST(BezierCurveTest, DISABLED_Benchmark)
+{
+    const int kNumCurves = 1024;
+    const int kNumEvaluations = 1 << 22;
+
+    std::mt19937 rng( 1 );
+    std::vector<Vector4> coeffs;
+    std::vector<BezierCurve> curves;
+    for (int i = 0; i < kNumCurves; i++)
+    {
+        coeffs.push_back( RandomControlPoint( rng ) );
+        curves.emplace_back( coeffs.back() );
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+    volatile float sink = 0.f;
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < kNumEvaluations; i++)
+        sink = sink + Bezier( coeffs[i % kNumCurves], (i % 997) / 997.f );
+    auto t1 = Clock::now();
+    for (int i = 0; i < kNumEvaluations; i++)
+        sink = sink + curves[i % kNumCurves].Evaluate( (i % 997) / 997.f );
+    auto t2 = Clock::now();
+
+    double bisection = std::chrono::duration<double>( t1 - t0 ).count();
+    double baked = std::chrono::duration<double>( t2 - t1 ).count();
+    std::cout << "Bezier (bisection) : " << kNumEvaluations / bisection / 1e6 << " M eval/s" << std::endl;
+    std::cout << "BezierCurve (baked): " << kNumEvaluations / baked / 1e6 << " M eval/s" << std::endl;
+}
@@ -0,0 +1,257 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <functional>
+
+#include "Pmx.h"
+#include "AnimationClip.h"
+#include "IKSolver.h"
+
+using namespace Math;
+using namespace Animation;
+
+namespace {
+    //
+    // Leg shaped skeleton
+    //   0: root, 1: thigh, 2: knee, 3: ankle, 4: toe, 5: IK goal (child of root)
+    //
+    struct Leg
+    {
+        std::vector<int32_t> Parent;
+        std::vector<OrthogonalTransform> LocalPose;
+        std::vector<OrthogonalTransform> Pose;
+        IKAttr ik;
+    };
+
+    // Parent is always listed before its children
+    void UpdatePose( Leg& leg, int32_t from = 0 )
+    {
+        for (size_t i = from; i < leg.LocalPose.size(); i++)
+            leg.Pose[i] = leg.Parent[i] < 0 ? leg.LocalPose[i] : leg.Pose[leg.Parent[i]] * leg.LocalPose[i];
+    }
+
+    Leg MakeLeg( void )
+    {
+        Leg leg;
+        leg.Parent = { -1, 0, 1, 2, 3, 0 };
+        const Vector3 offset[] = {
+            Vector3( 0.f, 10.f, 0.f ),
+            Vector3( 1.f, 0.f, 0.f ),
+            Vector3( 0.f, -4.f, -0.1f ),
+            Vector3( 0.f, -4.f, 0.2f ),
+            Vector3( 0.f, -0.5f, -1.f ),
+            Vector3( 1.f, -8.f, 0.f ),
+        };
+        for (auto& t : offset)
+            leg.LocalPose.emplace_back( Quaternion( kIdentity ), t );
+        leg.Pose.resize( leg.LocalPose.size() );
+        UpdatePose( leg );
+
+        leg.ik.BoneIndex = 5;
+        leg.ik.TargetBoneIndex = 3;
+        leg.ik.NumIteration = 40;
+        leg.ik.LimitedRadian = 2.f;
+        leg.ik.Link.push_back( { 2, 1, XMFLOAT3( -XM_PI, 0.f, 0.f ), XMFLOAT3( -0.008f, 0.f, 0.f ) } );
+        leg.ik.Link.push_back( { 1, 0 } );
+        leg.ik.BuildChain( leg.Parent );
+        return leg;
+    }
+
+    IKSolver MakeSolver( Leg& leg )
+    {
+        return IKSolver( leg.LocalPose, leg.Pose, [&leg]( int32_t i ) { UpdatePose( leg, i ); } );
+    }
+
+    void SetGoal( Leg& leg, const Vector3& position )
+    {
+        leg.LocalPose[5].SetTranslation( position - Vector3( leg.LocalPose[0].GetTranslation() ) );
+        UpdatePose( leg );
+    }
+
+    Vector3 Position( const Leg& leg, int32_t i )
+    {
+        return leg.Pose[i].GetTranslation();
+    }
+}
+
+TEST(IKSolverTest, BuildChain)
+{
+    Leg leg = MakeLeg();
+    EXPECT_EQ( leg.ik.Chain, std::vector<int32_t>( { 1, 2, 3 } ) );
+    EXPECT_EQ( leg.ik.ChainParent, std::vector<int32_t>( { 0, 1, 2 } ) );
+    EXPECT_EQ( leg.ik.LinkChain, std::vector<uint32_t>( { 1, 0 } ) );
+    EXPECT_TRUE( leg.ik.bTwoBone );
+
+    // A link which is not an ancestor of the effector
+    leg.ik.Link[1].BoneIndex = 5;
+    leg.ik.BuildChain( leg.Parent );
+    EXPECT_TRUE( leg.ik.Chain.empty() );
+    EXPECT_FALSE( leg.ik.bTwoBone );
+}
+
+TEST(IKSolverTest, TwoBoneReachesGoal)
+{
+    const Vector3 goals[] = {
+        Vector3( 1.f, 3.f, 0.f ),
+        Vector3( 2.f, 4.f, 3.f ),
+        Vector3( -1.f, 6.f, -2.f ),
+        Vector3( 1.f, 9.f, 5.f ),
+    };
+    // Rest knee, knee bent by the motion, and bent with a twist
+    const Quaternion kneeRotations[] = {
+        Quaternion( kIdentity ),
+        Quaternion( 0.6f, 0.f, 0.f ),
+        Quaternion( 0.6f, 0.2f, 0.f ),
+    };
+    for (auto& kneeRotation : kneeRotations)
+    {
+        for (auto& goal : goals)
+        {
+            Leg leg = MakeLeg();
+            leg.LocalPose[2].SetRotation( kneeRotation );
+            SetGoal( leg, goal );
+            MakeSolver( leg ).Solve( leg.ik );
+            EXPECT_THAT( Position( leg, 3 ), MatcherNearFast( 1e-3f, goal ) );
+
+            // Knee turns on its own hinge from the animated rotation, summed angle within CCD limit
+            const Quaternion knee = leg.LocalPose[2].GetRotation();
+            const Vector3 hinge = (~kneeRotation * knee).Euler();
+            EXPECT_NEAR( 0.f, float(hinge.GetY()), 1e-4f );
+            EXPECT_NEAR( 0.f, float(hinge.GetZ()), 1e-4f );
+            EXPECT_GE( float(knee.Euler().GetX()), 0.1f - 1e-4f );
+            EXPECT_NEAR( float(knee.Euler().GetX()), float(kneeRotation.Euler().GetX()) + float(hinge.GetX()), 1e-4f );
+
+            // Subtree below the chain follows
+            EXPECT_THAT( Position( leg, 4 ), MatcherNearFast( 1e-4f, leg.Pose[3] * Vector3( 0.f, -0.5f, -1.f ) ) );
+        }
+    }
+}
+
+TEST(IKSolverTest, ChainLocalMatchesReference)
+{
+    // Out of reach, both solvers run every iteration
+    Leg fast = MakeLeg(), reference = MakeLeg();
+    fast.ik.bTwoBone = false;
+    SetGoal( fast, Vector3( 6.f, 2.f, 4.f ) );
+    SetGoal( reference, Vector3( 6.f, 2.f, 4.f ) );
+
+    MakeSolver( fast ).Solve( fast.ik );
+    MakeSolver( reference ).SolveReference( reference.ik );
+    for (size_t i = 0; i < fast.Pose.size(); i++)
+        EXPECT_THAT( Position( fast, int32_t(i) ), MatcherNearFast( 1e-4f, Position( reference, int32_t(i) ) ) ) << "bone " << i;
+}
+
+TEST(IKSolverTest, ToleranceStopsIteration)
+{
+    Leg leg = MakeLeg();
+    leg.ik.bTwoBone = false;
+    // Within tolerance, but not within FLT_EPSILON
+    SetGoal( leg, Position( leg, 3 ) + Vector3( 5e-5f, 0.f, 0.f ) );
+    const auto before = leg.LocalPose;
+    MakeSolver( leg ).Solve( leg.ik );
+    for (size_t i = 0; i < before.size(); i++)
+        EXPECT_THAT( Vector3( leg.LocalPose[i].GetRotation() ), MatcherNearFast( 1e-6f, Vector3( before[i].GetRotation() ) ) );
+}
+
+TEST(IKSolverTest, DISABLED_Benchmark)
+{
+    const bool bRightHand = true;
+    const std::wstring ModelPath = ResourcePath( L"../Mikudayo/Model/つみ式ミクさんv1.1/ミクさん.pmx" );
+    const std::wstring MotionPath = ResourcePath( L"../Mikudayo/Motion/クラブマジェスティ.vmd" );
+
+    Utility::ByteArray ba = Utility::ReadFileSync( ModelPath );
+    Utility::ByteReader reader( ba );
+    Pmx::PMX pmx;
+    pmx.Fill( reader, bRightHand );
+    ASSERT_TRUE( pmx.IsValid() );
+    auto clip = AnimationClip::LoadFromFile( MotionPath, bRightHand );
+    ASSERT_TRUE( clip );
+
+    const size_t numBones = pmx.m_Bones.size();
+    std::vector<int32_t> parent( numBones ), track( numBones );
+    std::vector<Vector3> translate( numBones );
+    std::vector<IKAttr> iks;
+    for (size_t i = 0; i < numBones; i++)
+    {
+        const auto& bone = pmx.m_Bones[i];
+        parent[i] = bone.ParentBoneIndex;
+        track[i] = clip->FindBoneTrack( bone.Name );
+        translate[i] = Vector3( bone.Position );
+        if (bone.ParentBoneIndex >= 0)
+            translate[i] -= Vector3( pmx.m_Bones[bone.ParentBoneIndex].Position );
+        if (!bone.bIK)
+            continue;
+        IKAttr attr;
+        attr.BoneIndex = int32_t(i);
+        attr.TargetBoneIndex = bone.Ik.BoneIndex;
+        attr.NumIteration = bone.Ik.NumIteration;
+        attr.LimitedRadian = bone.Ik.LimitedRadian;
+        for (auto& link : bone.Ik.Link)
+            attr.Link.push_back( { link.BoneIndex, link.bLimit, link.MinLimit, link.MaxLimit } );
+        iks.push_back( attr );
+    }
+    for (auto& ik : iks)
+        ik.BuildChain( parent );
+
+    std::vector<std::vector<int32_t>> children( numBones );
+    for (size_t i = 0; i < numBones; i++)
+        if (parent[i] >= 0)
+            children[parent[i]].push_back( int32_t(i) );
+
+    // Updates bone 'i' and its descendants, as the instance does
+    std::vector<OrthogonalTransform> local( numBones ), pose( numBones );
+    std::function<void( std::vector<OrthogonalTransform>&, std::vector<OrthogonalTransform>&, int32_t )> UpdateSubtree;
+    UpdateSubtree = [&]( std::vector<OrthogonalTransform>& L, std::vector<OrthogonalTransform>& P, int32_t i ) {
+        P[i] = parent[i] < 0 ? L[i] : P[parent[i]] * L[i];
+        for (auto c : children[i])
+            UpdateSubtree( L, P, c );
+    };
+
+    using Clock = std::chrono::high_resolution_clock;
+    std::vector<KeyFrameCursor> cursors( numBones );
+    double elapsed[2] = {}, error[2] = {}, poseDiff = 0.0;
+    const int32_t lastFrame = clip->GetLastFrame();
+    for (int32_t frame = 0; frame <= lastFrame; frame++)
+    {
+        for (size_t i = 0; i < numBones; i++)
+        {
+            Vector3 offset( kZero );
+            Quaternion rotation( kIdentity );
+            if (track[i] >= 0)
+                clip->InterpolateBone( track[i], float(frame), cursors[i], offset, rotation );
+            local[i] = OrthogonalTransform( rotation, translate[i] + offset );
+        }
+        for (size_t i = 0; i < numBones; i++)
+            if (parent[i] < 0)
+                UpdateSubtree( local, pose, int32_t(i) );
+
+        std::vector<OrthogonalTransform> L[2] = { local, local }, P[2] = { pose, pose };
+        for (int k = 0; k < 2; k++)
+        {
+            auto& LocalPose = L[k];
+            auto& Pose = P[k];
+            IKSolver solver( LocalPose, Pose, [&]( int32_t i ) { UpdateSubtree( LocalPose, Pose, i ); } );
+            auto start = Clock::now();
+            for (auto& ik : iks)
+            {
+                if (k == 0)
+                    solver.Solve( ik );
+                else
+                    solver.SolveReference( ik );
+            }
+            elapsed[k] += std::chrono::duration<double>( Clock::now() - start ).count();
+            for (auto& ik : iks)
+                error[k] += float(Length( Vector3( Pose[ik.BoneIndex].GetTranslation() ) - Vector3( Pose[ik.TargetBoneIndex].GetTranslation() ) ));
+        }
+        for (size_t i = 0; i < numBones; i++)
+            poseDiff = std::max<double>( poseDiff, float(Length( Vector3( P[0][i].GetTranslation() ) - Vector3( P[1][i].GetTranslation() ) )) );
+    }
+
+    const double numSolve = double(lastFrame + 1) * iks.size();
+    const char* label[] = { "Solve", "SolveReference" };
+    for (int k = 0; k < 2; k++)
+        std::cout << label[k] << ": " << elapsed[k] / (lastFrame + 1) * 1e6 << " us/frame, "
+            << "mean effector error " << error[k] / numSolve << std::endl;
+    std::cout << "max bone position difference " << poseDiff << std::endl;
+}
@@ -0,0 +1,115 @@
+﻿#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <random>
+
+#include "AnimationClip.h"
+#include "Vmd.h"
+
+using namespace Math;
+using namespace Animation;
+
+namespace {
+    const std::wstring MotionPath = ResourcePath( L"../Mikudayo/Motion/クラブマジェスティ.vmd" );
+
+    AnimationClipPtr RandomClip( std::mt19937& rng, int numFrames )
+    {
+        std::uniform_int_distribution<int> step( 1, 10 );
+        std::uniform_real_distribution<float> pos( -10.f, 10.f );
+
+        Vmd::VMD vmd;
+        vmd.Names.push_back( L"bone" );
+        int frame = 0;
+        for (int i = 0; i < numFrames; i++)
+        {
+            Vmd::BoneFrame key = {};
+            key.NameIndex = 0;
+            key.Frame = frame;
+            key.Offset = XMFLOAT3( pos( rng ), pos( rng ), pos( rng ) );
+            key.Rotation = XMFLOAT4( 0.f, 0.f, 0.f, 1.f );
+            auto interp = reinterpret_cast<char*>(&key.Interpolation[0]);
+            for (int k = 0; k < 4; k++)
+            {
+                interp[k] = interp[k+4] = 20;
+                interp[k+8] = interp[k+12] = 107;
+            }
+            vmd.BoneFrames.push_back( key );
+            frame += step( rng );
+        }
+        std::shuffle( vmd.BoneFrames.begin(), vmd.BoneFrames.end(), rng );
+        return AnimationClip::Create( vmd );
+    }
+
+    AnimationClipPtr LoadClip( const std::wstring& path )
+    {
+        Utility::ByteArray ba = Utility::ReadFileSync( path );
+        Utility::ByteReader reader( ba );
+        Vmd::VMD vmd;
+        vmd.Fill( reader, true );
+        return AnimationClip::Create( vmd );
+    }
+}
+
+TEST(KeyFrameCursorTest, SameAsBinarySearch)
+{
+    std::mt19937 rng( 7 );
+    std::uniform_int_distribution<int> seek( 0, 20 );
+    for (int n = 0; n < 100; n++)
+    {
+        AnimationClipPtr clip = RandomClip( rng, 1 + n );
+        ASSERT_EQ( clip->m_BoneTracks.size(), 1u );
+        std::uniform_real_distribution<float> time( -2.f, clip->GetLastFrame() + 2.f );
+
+        KeyFrameCursor cursor;
+        float t = 0.f;
+        for (int i = 0; i < 1000; i++)
+        {
+            // Mostly playback, sometimes seek
+            t = (seek( rng ) == 0) ? time( rng ) : t + 0.5f;
+            Vector3 cached, searched;
+            Quaternion rotation;
+            KeyFrameCursor fresh;
+            clip->InterpolateBone( 0, t, cursor, cached, rotation );
+            clip->InterpolateBone( 0, t, fresh, searched, rotation );
+            EXPECT_THAT( cached, MatcherNearFast( 1e-6f, searched ) );
+        }
+    }
+}
+
+TEST(KeyFrameCursorTest, DISABLED_Benchmark)
+{
+    const int kNumInstance = 16;
+    const float kFrameStep = 30.f / 60.f; // 60 fps playback of 30 fps motion
+
+    const AnimationClipPtr clip = LoadClip( MotionPath );
+    const uint32_t numTracks = uint32_t(clip->m_BoneTracks.size());
+    const int lastFrame = clip->GetLastFrame();
+    ASSERT_GT( numTracks, 0u );
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto Replay = [&]( bool bUseCursor ) {
+        std::vector<std::vector<KeyFrameCursor>> cursors( kNumInstance, std::vector<KeyFrameCursor>( numTracks ) );
+        Vector3 translation;
+        Quaternion rotation;
+        auto start = Clock::now();
+        for (float t = 0.f; t <= lastFrame; t += kFrameStep)
+        {
+            for (auto& instance : cursors)
+            {
+                for (uint32_t i = 0; i < numTracks; i++)
+                {
+                    KeyFrameCursor fresh;
+                    clip->InterpolateBone( i, t, bUseCursor ? instance[i] : fresh, translation, rotation );
+                }
+            }
+        }
+        return std::chrono::duration<double>( Clock::now() - start ).count();
+    };
+
+    double search = Replay( false );
+    double cached = Replay( true );
+    std::cout << kNumInstance << " instances, " << numTracks << " bones, " << lastFrame << " frames" << std::endl;
+    std::cout << "Binary search: " << search * 1000.0 << " ms" << std::endl;
+    std::cout << "Cursor       : " << cached * 1000.0 << " ms" << std::endl;
+}
@@ -0,0 +1,81 @@
+﻿#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <set>
+
+#include "Vmd.h"
+
+namespace {
+    const std::wstring MotionPath[] = {
+        ResourcePath( L"../Mikudayo/Motion/クラブマジェスティ.vmd" ),
+        ResourcePath( L"../Mikudayo/Motion/クラブマジェスティカメラモーション.vmd" ),
+    };
+}
+
+TEST(VmdTest, InternName)
+{
+    Vmd::NameTable table;
+    const char center[15] = "\x83\x5a\x83\x93\x83\x5e\x81\x5b"; // センター (Shift-JIS)
+    const char full[15] = { 'a','b','c','d','e','f','g','h','i','j','k','l','m','n','o' };
+
+    EXPECT_EQ( table.Intern( center, sizeof( center ) ), 0u );
+    EXPECT_EQ( table.Intern( full, sizeof( full ) ), 1u );
+    EXPECT_EQ( table.Intern( center, sizeof( center ) ), 0u );
+    ASSERT_EQ( table.Names.size(), 2u );
+    EXPECT_EQ( table.Names[0], L"センター" );
+    EXPECT_EQ( table.Names[1], L"abcdefghijklmno" );
+}
+
+TEST(VmdTest, ParseMotion)
+{
+    Utility::ByteArray ba = Utility::ReadFileSync( MotionPath[0] );
+    Utility::ByteReader reader( ba );
+    Vmd::VMD vmd;
+    vmd.Fill( reader, true );
+    ASSERT_TRUE( vmd.IsValid() );
+
+    std::set<std::wstring> unique( vmd.Names.begin(), vmd.Names.end() );
+    EXPECT_EQ( unique.size(), vmd.Names.size() );
+    EXPECT_EQ( unique.count( L"センター" ), 1u );
+    for (auto& frame : vmd.BoneFrames)
+        ASSERT_LT( frame.NameIndex, vmd.Names.size() );
+    for (auto& frame : vmd.FaceFrames)
+        ASSERT_LT( frame.NameIndex, vmd.Names.size() );
+}
+
+TEST(VmdTest, TruncatedMotion)
+{
+    Utility::ByteArray ba = Utility::ReadFileSync( MotionPath[0] );
+    ASSERT_GT( ba->size(), 1000u );
+
+    // Cut in the middle of bone frames
+    Utility::ByteReader reader( ba->data(), 1000 );
+    Vmd::VMD vmd;
+    vmd.Fill( reader, true );
+    EXPECT_TRUE( reader.Fail() );
+    EXPECT_FALSE( vmd.IsValid() );
+}
+
+TEST(VmdTest, DISABLED_Benchmark)
+{
+    const int kNumRepeat = 20;
+
+    using Clock = std::chrono::high_resolution_clock;
+    for (auto& path : MotionPath)
+    {
+        Utility::ByteArray ba = Utility::ReadFileSync( path );
+        size_t numFrames = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < kNumRepeat; i++)
+        {
+            Utility::ByteReader reader( ba );
+            Vmd::VMD vmd;
+            vmd.Fill( reader, true );
+            numFrames += vmd.BoneFrames.size() + vmd.FaceFrames.size() + vmd.CameraFrames.size();
+        }
+        double elapsed = std::chrono::duration<double>( Clock::now() - start ).count();
+        std::wcout << path << std::endl;
+        std::cout << "  " << numFrames / elapsed / 1e6 << " M frames/s, " << ba->size() * kNumRepeat / elapsed / 1e6 << " MB/s" << std::endl;
+    }
+}
@@ -0,0 +1,241 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <atomic>
+#include <chrono>
+#include "Pmx.h"
+#include "TaskManager.h"
+#include "Bullet/MultiThread.h"
+#include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+
+using namespace Physics;
+
+namespace {
+    //
+    // Piles of boxes on a ground, each pile is an island of its own
+    //
+    struct PileWorld
+    {
+        PileWorld( int numPiles, int boxPerPile )
+        {
+            Config = std::make_unique<btSoftBodyRigidBodyCollisionConfiguration>();
+            Broadphase = std::make_unique<btDbvtBroadphase>();
+            Dispatcher = std::make_unique<CollisionDispatcherMt>( Config.get() );
+            btConstraintSolver* solvers[4];
+            for (auto& solver : solvers)
+                solver = new btSequentialImpulseConstraintSolver();
+            Solver = std::make_unique<ConstraintSolverPool>( solvers, 4 );
+            World = std::make_unique<SoftRigidDynamicsWorldMt>( Dispatcher.get(), Broadphase.get(), Solver.get(), Config.get() );
+            World->setGravity( btVector3( 0, -98.f, 0 ) );
+
+            Ground = std::make_unique<btStaticPlaneShape>( btVector3( 0, 1, 0 ), 0.f );
+            Box = std::make_unique<btBoxShape>( btVector3( 1, 1, 1 ) );
+            AddBody( Ground.get(), 0.f, btVector3( 0, 0, 0 ) );
+            for (int p = 0; p < numPiles; p++)
+            {
+                for (int k = 0; k < boxPerPile; k++)
+                {
+                    // Slightly off center so the pile topples
+                    const btVector3 position( p * 10.f + k * 0.3f, 1.f + k * 2.1f, (p % 3) * 0.2f );
+                    Bodies.push_back( AddBody( Box.get(), 1.f, position ) );
+                }
+            }
+        }
+
+        ~PileWorld()
+        {
+            for (int i = World->getNumCollisionObjects() - 1; i >= 0; i--)
+            {
+                btRigidBody* body = btRigidBody::upcast( World->getCollisionObjectArray()[i] );
+                World->removeRigidBody( body );
+                delete body->getMotionState();
+                delete body;
+            }
+        }
+
+        btRigidBody* AddBody( btCollisionShape* shape, float mass, const btVector3& position )
+        {
+            btVector3 inertia( 0, 0, 0 );
+            if (mass > 0.f)
+                shape->calculateLocalInertia( mass, inertia );
+            auto motionState = new btDefaultMotionState( btTransform( btQuaternion::getIdentity(), position ) );
+            auto body = new btRigidBody( btRigidBody::btRigidBodyConstructionInfo( mass, motionState, shape, inertia ) );
+            World->addRigidBody( body );
+            return body;
+        }
+
+        std::unique_ptr<btDefaultCollisionConfiguration> Config;
+        std::unique_ptr<btBroadphaseInterface> Broadphase;
+        std::unique_ptr<btCollisionDispatcher> Dispatcher;
+        std::unique_ptr<btConstraintSolver> Solver;
+        std::unique_ptr<btSoftRigidDynamicsWorld> World;
+        std::unique_ptr<btCollisionShape> Ground;
+        std::unique_ptr<btCollisionShape> Box;
+        std::vector<btRigidBody*> Bodies;
+    };
+}
+
+TEST(MultiThreadTest, ParallelForCoversRange)
+{
+    ITaskScheduler* schedulers[] = { GetSequentialTaskScheduler(), GetTaskManagerScheduler() };
+    for (auto scheduler : schedulers)
+    {
+        SetTaskScheduler( scheduler );
+        for (int grain : { 1, 7, 50, 5000 })
+        {
+            const int begin = 3, end = 1000;
+            std::vector<std::atomic<int>> count( end );
+            for (auto& c : count)
+                c = 0;
+            ParallelFor( begin, end, grain, [&]( int Begin, int End ) {
+                // Sequential one runs the whole range at once
+                if (scheduler != GetSequentialTaskScheduler())
+                    EXPECT_LE( End - Begin, grain );
+                for (int i = Begin; i < End; i++)
+                    count[i]++;
+            });
+            for (int i = 0; i < end; i++)
+                EXPECT_EQ( count[i], i < begin ? 0 : 1 ) << scheduler->GetName() << " grain " << grain << " index " << i;
+        }
+    }
+    SetTaskScheduler( nullptr );
+    EXPECT_EQ( GetTaskScheduler(), GetSequentialTaskScheduler() );
+}
+
+TEST(MultiThreadTest, MatchSequential)
+{
+    const int numPiles = 16, boxPerPile = 6;
+    PileWorld sequential( numPiles, boxPerPile ), parallel( numPiles, boxPerPile );
+    for (int frame = 0; frame < 240; frame++)
+    {
+        SetTaskScheduler( GetSequentialTaskScheduler() );
+        sequential.World->stepSimulation( 1 / 60.f, 1 );
+        SetTaskScheduler( GetTaskManagerScheduler() );
+        parallel.World->stepSimulation( 1 / 60.f, 1 );
+    }
+    SetTaskScheduler( nullptr );
+
+    // Islands are solved independently and contacts are kept in pair order
+    for (size_t i = 0; i < sequential.Bodies.size(); i++)
+    {
+        const btTransform& a = sequential.Bodies[i]->getWorldTransform();
+        const btTransform& b = parallel.Bodies[i]->getWorldTransform();
+        EXPECT_NEAR( (a.getOrigin() - b.getOrigin()).length(), 0.f, 1e-4f ) << "body " << i;
+        EXPECT_NEAR( std::fabs( a.getRotation().dot( b.getRotation() ) ), 1.f, 1e-4f ) << "body " << i;
+    }
+}
+
+TEST(MultiThreadTest, DISABLED_Benchmark)
+{
+    const bool bRightHand = false;
+    const std::wstring ModelPath = ResourcePath( L"../Mikudayo/Model/つみ式ミクさんv1.1/ミクさん.pmx" );
+
+    Utility::ByteArray ba = Utility::ReadFileSync( ModelPath );
+    Utility::ByteReader reader( ba );
+    Pmx::PMX pmx;
+    pmx.Fill( reader, bRightHand );
+    ASSERT_TRUE( pmx.IsValid() );
+
+    // Copies of the model's rigid bodies and joints in a row, set up as Physics::Initialize does.
+    // Bone connected bodies are kinematic and stay in bind pose, the rest falls and swings
+    auto Run = [&]( int numModels, ITaskScheduler* scheduler, int numSteps ) {
+        btDefaultCollisionConstructionInfo cci;
+        cci.m_defaultMaxPersistentManifoldPoolSize = 80000;
+        cci.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+        btSoftBodyRigidBodyCollisionConfiguration config( cci );
+        btDbvtBroadphase broadphase;
+        CollisionDispatcherMt dispatcher( &config );
+        btConstraintSolver* solvers[BT_MAX_THREAD_COUNT];
+        const int numSolvers = btMin( int(BT_MAX_THREAD_COUNT), int(TaskManager::GetMaxNumThreads()) + 1 );
+        for (int i = 0; i < numSolvers; i++)
+            solvers[i] = new btSequentialImpulseConstraintSolver();
+        ConstraintSolverPool solver( solvers, numSolvers );
+        auto world = std::make_unique<SoftRigidDynamicsWorldMt>( &dispatcher, &broadphase, &solver, &config );
+        world->setGravity( btVector3( 0, -98.f, 0 ) );
+
+        std::vector<std::unique_ptr<btCollisionShape>> shapes;
+        std::vector<std::unique_ptr<btDefaultMotionState>> motionStates;
+        std::vector<std::unique_ptr<btRigidBody>> bodies;
+        std::vector<std::unique_ptr<btTypedConstraint>> constraints;
+        for (int n = 0; n < numModels; n++)
+        {
+            const btVector3 offset( n * 30.f, 0, 0 );
+            const size_t base = bodies.size();
+            for (auto& rigid : pmx.m_RigidBodies)
+            {
+                const btVector3 size( rigid.Size.x, rigid.Size.y, rigid.Size.z );
+                if (rigid.Shape == Pmx::RigidBodyShape::kSphere)
+                    shapes.emplace_back( new btSphereShape( size.x() ) );
+                else if (rigid.Shape == Pmx::RigidBodyShape::kBox)
+                    shapes.emplace_back( new btBoxShape( size ) );
+                else
+                    shapes.emplace_back( new btCapsuleShape( size.x(), size.y() ) );
+                const bool bKinematic = rigid.RigidType == Pmx::RigidBodyType::kBoneConnected;
+                const btScalar mass = bKinematic ? 0.f : rigid.Mass;
+                btVector3 inertia( 0, 0, 0 );
+                if (mass > 0.f)
+                    shapes.back()->calculateLocalInertia( mass, inertia );
+                btMatrix3x3 basis;
+                basis.setEulerZYX( rigid.Rotation.x, rigid.Rotation.y, rigid.Rotation.z );
+                const btVector3 position( rigid.Position.x, rigid.Position.y, rigid.Position.z );
+                motionStates.emplace_back( new btDefaultMotionState( btTransform( basis, position + offset ) ) );
+                btRigidBody::btRigidBodyConstructionInfo info( mass, motionStates.back().get(), shapes.back().get(), inertia );
+                info.m_linearDamping = rigid.LinearDamping;
+                info.m_angularDamping = rigid.AngularDamping;
+                info.m_restitution = rigid.Restitution;
+                info.m_friction = rigid.Friction;
+                bodies.emplace_back( new btRigidBody( info ) );
+                if (bKinematic)
+                {
+                    bodies.back()->setCollisionFlags( bodies.back()->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT );
+                    bodies.back()->setActivationState( DISABLE_DEACTIVATION );
+                }
+                world->addRigidBody( bodies.back().get(), 1 << rigid.CollisionGroupID, rigid.CollisionGroupMask );
+            }
+            for (auto& joint : pmx.m_Joints)
+            {
+                if (joint.RigidBodyIndexA < 0 || joint.RigidBodyIndexB < 0)
+                    continue;
+                btRigidBody& bodyA = *bodies[base + joint.RigidBodyIndexA];
+                btRigidBody& bodyB = *bodies[base + joint.RigidBodyIndexB];
+                btMatrix3x3 basis;
+                basis.setEulerZYX( joint.Rotation.x, joint.Rotation.y, joint.Rotation.z );
+                const btTransform transform( basis, btVector3( joint.Position.x, joint.Position.y, joint.Position.z ) + offset );
+                auto constraint = new btGeneric6DofSpringConstraint( bodyA, bodyB,
+                    bodyA.getCenterOfMassTransform().inverse() * transform,
+                    bodyB.getCenterOfMassTransform().inverse() * transform, true );
+                constraint->setLinearLowerLimit( btVector3( joint.LinearLowerLimit.x, joint.LinearLowerLimit.y, joint.LinearLowerLimit.z ) );
+                constraint->setLinearUpperLimit( btVector3( joint.LinearUpperLimit.x, joint.LinearUpperLimit.y, joint.LinearUpperLimit.z ) );
+                constraint->setAngularLowerLimit( btVector3( joint.AngularLowerLimit.x, joint.AngularLowerLimit.y, joint.AngularLowerLimit.z ) );
+                constraint->setAngularUpperLimit( btVector3( joint.AngularUpperLimit.x, joint.AngularUpperLimit.y, joint.AngularUpperLimit.z ) );
+                constraints.emplace_back( constraint );
+                world->addConstraint( constraint, true );
+            }
+        }
+
+        SetTaskScheduler( scheduler );
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int step = 0; step < numSteps; step++)
+            world->stepSimulation( 1 / 60.f, 1 );
+        const double elapsed = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count();
+        SetTaskScheduler( nullptr );
+
+        for (auto& constraint : constraints)
+            world->removeConstraint( constraint.get() );
+        for (auto& body : bodies)
+            world->removeRigidBody( body.get() );
+        return elapsed / numSteps * 1e3;
+    };
+
+    const int numSteps = 600;
+    std::cout << pmx.m_RigidBodies.size() << " rigid bodies, " << pmx.m_Joints.size() << " joints per model, "
+        << TaskManager::GetMaxNumThreads() << " threads" << std::endl;
+    for (int numModels = 1; numModels <= 16; numModels *= 2)
+    {
+        const double sequential = Run( numModels, GetSequentialTaskScheduler(), numSteps );
+        const double parallel = Run( numModels, GetTaskManagerScheduler(), numSteps );
+        std::cout << numModels << " models: sequential " << sequential << " ms/step, "
+            << GetTaskManagerScheduler()->GetName() << " " << parallel << " ms/step, "
+            << "speedup " << sequential / parallel << "x" << std::endl;
+    }
+}
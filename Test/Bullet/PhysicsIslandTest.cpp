@@ -0,0 +1,56 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include "Bullet/PhysicsIsland.h"
+
+using namespace Physics;
+
+namespace {
+    // Unit cube at 'x' on the x axis
+    IslandBound MakeBound( float x, int32_t island = -1 )
+    {
+        return { btVector3( x, 0, 0 ), btVector3( x + 1, 1, 1 ), island };
+    }
+}
+
+TEST(PhysicsIslandTest, AabbDistance)
+{
+    const btVector3 zero( 0, 0, 0 ), one( 1, 1, 1 );
+    EXPECT_FLOAT_EQ( AabbDistance( zero, one, btVector3( 0.5f, 0.5f, 0.5f ), btVector3( 2, 2, 2 ) ), 0.f );
+    EXPECT_FLOAT_EQ( AabbDistance( zero, one, btVector3( 3, 0, 0 ), btVector3( 4, 1, 1 ) ), 2.f );
+    EXPECT_FLOAT_EQ( AabbDistance( btVector3( 3, 0, 0 ), btVector3( 4, 1, 1 ), zero, one ), 2.f );
+    // Corner to corner
+    EXPECT_FLOAT_EQ( AabbDistance( zero, one, btVector3( 4, 5, 1 ), btVector3( 5, 6, 2 ) ), 5.f );
+}
+
+TEST(PhysicsIslandTest, Merge)
+{
+    // 0-1 within distance, 1-2 chains 2 to them, 3 is far
+    std::vector<IslandBound> bounds = { MakeBound( 0 ), MakeBound( 3 ), MakeBound( 6 ), MakeBound( 20 ) };
+    auto cluster = ClusterIslands( bounds, 2.f, 3.f );
+    EXPECT_EQ( cluster, std::vector<uint32_t>( { 0, 0, 0, 3 } ) );
+
+    cluster = ClusterIslands( bounds, 1.f, 1.5f );
+    EXPECT_EQ( cluster, std::vector<uint32_t>( { 0, 1, 2, 3 } ) );
+
+    EXPECT_TRUE( ClusterIslands( {}, 1.f, 1.5f ).empty() );
+}
+
+TEST(PhysicsIslandTest, SplitHysteresis)
+{
+    // Gap of 2.5 is past merge distance, but within split distance
+    std::vector<IslandBound> bounds = { MakeBound( 0 ), MakeBound( 3.5f ) };
+    EXPECT_EQ( ClusterIslands( bounds, 2.f, 3.f ), std::vector<uint32_t>( { 0, 1 } ) );
+
+    // Already joined, stays together
+    bounds[0].Island = bounds[1].Island = 4;
+    EXPECT_EQ( ClusterIslands( bounds, 2.f, 3.f ), std::vector<uint32_t>( { 0, 0 } ) );
+
+    // Different islands are not joined by the split distance
+    bounds[1].Island = 5;
+    EXPECT_EQ( ClusterIslands( bounds, 2.f, 3.f ), std::vector<uint32_t>( { 0, 1 } ) );
+
+    // Far enough, splits
+    bounds[1] = MakeBound( 5, 4 );
+    EXPECT_EQ( ClusterIslands( bounds, 2.f, 3.f ), std::vector<uint32_t>( { 0, 1 } ) );
+}
@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include "Bullet/PhysicsLod.h"
+
+using namespace Physics;
+
+namespace {
+    const LodSettings kSettings = { 100.f, 400.f, 3, 0.f };
+
+    LodLevel UpdateOne( LodPolicy& policy, std::vector<LodState>& states, bool bVisible, float distance, float stepTime = 0.f, const LodSettings& settings = kSettings )
+    {
+        policy.Update( settings, stepTime, { { bVisible, distance } }, states );
+        return states[0].Level;
+    }
+}
+
+TEST(PhysicsLodTest, Distance)
+{
+    LodPolicy policy;
+    std::vector<LodState> states;
+    EXPECT_EQ( UpdateOne( policy, states, true, 10.f ), kLodFull );
+    EXPECT_EQ( UpdateOne( policy, states, true, 150.f ), kLodReduced );
+    EXPECT_EQ( UpdateOne( policy, states, true, 500.f ), kLodFrozen );
+
+    // Comes back only when clearly closer
+    EXPECT_EQ( UpdateOne( policy, states, true, 390.f ), kLodFrozen );
+    EXPECT_EQ( UpdateOne( policy, states, true, 350.f ), kLodReduced );
+    EXPECT_EQ( UpdateOne( policy, states, true, 95.f ), kLodReduced );
+    EXPECT_EQ( UpdateOne( policy, states, true, 85.f ), kLodFull );
+}
+
+TEST(PhysicsLodTest, FreezeOffScreen)
+{
+    LodPolicy policy;
+    std::vector<LodState> states;
+    // Frozen after the delay, not at the first hidden frame
+    for (uint32_t frame = 0; frame < kSettings.FreezeDelay; frame++)
+        EXPECT_EQ( UpdateOne( policy, states, false, 10.f ), kLodFull ) << "frame " << frame;
+    EXPECT_EQ( UpdateOne( policy, states, false, 10.f ), kLodFrozen );
+    EXPECT_EQ( UpdateOne( policy, states, false, 10.f ), kLodFrozen );
+
+    // Wakes up as soon as it is visible
+    EXPECT_EQ( UpdateOne( policy, states, true, 10.f ), kLodFull );
+    EXPECT_EQ( states[0].HiddenFrames, 0u );
+}
+
+TEST(PhysicsLodTest, Budget)
+{
+    LodSettings settings = kSettings;
+    settings.Budget = 4.f;
+    LodPolicy policy;
+    std::vector<LodState> states;
+
+    // Over budget, distances shrink until the model is reduced
+    int frames = 0;
+    while (UpdateOne( policy, states, true, 50.f, 6.f, settings ) == kLodFull)
+        ASSERT_LT( ++frames, 100 );
+    EXPECT_LT( policy.GetScale(), 0.5f );
+    const float scale = policy.GetScale();
+
+    // Within budget, but not well under, stays as it is
+    UpdateOne( policy, states, true, 50.f, 3.5f, settings );
+    EXPECT_EQ( policy.GetScale(), scale );
+
+    // Well under, grows back to full
+    for (int i = 0; i < 200; i++)
+        UpdateOne( policy, states, true, 50.f, 1.f, settings );
+    EXPECT_EQ( policy.GetScale(), 1.f );
+    EXPECT_EQ( states[0].Level, kLodFull );
+
+    // No budget, no scaling
+    UpdateOne( policy, states, true, 50.f, 100.f );
+    EXPECT_EQ( policy.GetScale(), 1.f );
+}
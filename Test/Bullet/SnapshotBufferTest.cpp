@@ -0,0 +1,65 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <array>
+#include <thread>
+#include "Bullet/SnapshotBuffer.h"
+
+using namespace Physics;
+
+TEST(SnapshotBufferTest, Publish)
+{
+    SnapshotBuffer<int> buffer;
+    EXPECT_FALSE( buffer.Acquire() );
+    EXPECT_FALSE( buffer.IsValid() );
+
+    buffer.GetBack() = 10;
+    buffer.Publish( 1 );
+    // Not acquired yet, front is unchanged
+    EXPECT_FALSE( buffer.IsValid() );
+    EXPECT_TRUE( buffer.Acquire() );
+    EXPECT_EQ( buffer.GetFront(), 10 );
+    EXPECT_EQ( buffer.GetFrontVersion(), 1u );
+    EXPECT_FALSE( buffer.Acquire() );
+    EXPECT_EQ( buffer.GetFront(), 10 );
+
+    // Reader takes the newest one, older is dropped
+    buffer.GetBack() = 20;
+    buffer.Publish( 2 );
+    buffer.GetBack() = 30;
+    buffer.Publish( 3 );
+    EXPECT_TRUE( buffer.Acquire() );
+    EXPECT_EQ( buffer.GetFront(), 30 );
+    EXPECT_EQ( buffer.GetFrontVersion(), 3u );
+    EXPECT_FALSE( buffer.Acquire() );
+}
+
+TEST(SnapshotBufferTest, Concurrent)
+{
+    using Snapshot = std::array<uint64_t, 64>;
+    SnapshotBuffer<Snapshot> buffer;
+    const uint64_t numPublish = 200000;
+
+    std::thread producer( [&] {
+        for (uint64_t version = 1; version <= numPublish; version++)
+        {
+            buffer.GetBack().fill( version );
+            buffer.Publish( version );
+        }
+    });
+
+    // Never torn, and never goes back
+    uint64_t last = 0;
+    while (last < numPublish)
+    {
+        if (!buffer.Acquire())
+            continue;
+        const uint64_t version = buffer.GetFrontVersion();
+        ASSERT_GT( version, last );
+        for (auto value : buffer.GetFront())
+            ASSERT_EQ( value, version );
+        last = version;
+    }
+    producer.join();
+    EXPECT_EQ( last, numPublish );
+}
@@ -0,0 +1,216 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <random>
+
+#include "Camera.h"
+#include "LightCluster.h"
+
+using namespace Math;
+using namespace Lighting;
+
+namespace {
+    const uint32_t kWidth = 1920, kHeight = 1080;
+
+    std::vector<ClusterLight> MakeLights( uint32_t numLights, float maxRadius, uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( 0.f, 1.f );
+        std::vector<ClusterLight> lights;
+        for (uint32_t i = 0; i < numLights; i++)
+        {
+            // Mostly in view, some around and behind the eye
+            const float d = unit( rng ) * 300.f - 20.f;
+            const Vector3 center( (unit( rng ) * 2.f - 1.f) * d, (unit( rng ) * 2.f - 1.f) * d * 0.6f, -d );
+            ClusterLight light;
+            XMStoreFloat3( &light.CenterVS, center );
+            light.Radius = unit( rng ) * maxRadius;
+            lights.push_back( light );
+        }
+        return lights;
+    }
+
+    void Build( LightCluster& cluster, const Camera& camera, const std::vector<ClusterLight>& lights )
+    {
+        cluster.Build( camera.GetProjMatrix(), camera.GetNearClip(), camera.GetFarClip(), lights.data(), uint32_t(lights.size()) );
+    }
+
+    // Same lookup as DeferredClusteredPS
+    uint32_t GetCluster( const LightCluster& cluster, const Matrix4& proj, const Vector3& P )
+    {
+        XMFLOAT3 p;
+        XMStoreFloat3( &p, P );
+        const ClusterConstants c = cluster.GetConstants( kWidth, kHeight );
+        const float ndcX = proj.GetX().GetX() * p.x / -p.z, ndcY = proj.GetY().GetY() * p.y / -p.z;
+        const float px = (ndcX + 1.f) * 0.5f * kWidth, py = (1.f - ndcY) * 0.5f * kHeight;
+        const uint32_t x = std::min( uint32_t(px * c.ScreenToTile[0]), c.TileCount[0] - 1 );
+        const uint32_t y = std::min( uint32_t(py * c.ScreenToTile[1]), c.TileCount[1] - 1 );
+        const float slice = std::log( -p.z ) * c.SliceScale + c.SliceBias;
+        const uint32_t z = uint32_t(std::min( std::max( slice, 0.f ), float(c.SliceCount - 1) ));
+        return cluster.GetClusterIndex( x, y, z );
+    }
+
+    bool IsListed( const LightCluster& cluster, uint32_t index, uint32_t light )
+    {
+        const auto& range = cluster.GetClusterRange()[index];
+        const auto& list = cluster.GetLightIndex();
+        return std::binary_search( list.begin() + range.Offset, list.begin() + range.Offset + range.Count, light );
+    }
+
+    bool IntersectBox( const ClusterLight& light, const XMFLOAT3& lo, const XMFLOAT3& hi )
+    {
+        const float c[] = { light.CenterVS.x, light.CenterVS.y, light.CenterVS.z };
+        const float a[] = { lo.x, lo.y, lo.z }, b[] = { hi.x, hi.y, hi.z };
+        float distSq = 0.f;
+        for (int k = 0; k < 3; k++)
+        {
+            const float d = std::max( a[k] - c[k], 0.f ) + std::max( c[k] - b[k], 0.f );
+            distSq += d * d;
+        }
+        return distSq <= light.Radius * light.Radius;
+    }
+}
+
+// Listed lights touch the box of the cluster, in order. That every lit
+// cluster is listed is ContainLitPoints
+TEST(LightClusterTest, ListedInBox)
+{
+    Camera camera;
+    std::vector<ClusterLight> lights = MakeLights( 500, 40.f, 1 );
+    lights[0].Radius = 0.f; // directional, not binned
+    LightCluster cluster;
+    cluster.Create( 16, 9, 24 );
+    Build( cluster, camera, lights );
+
+    const auto& ranges = cluster.GetClusterRange();
+    const auto& list = cluster.GetLightIndex();
+    ASSERT_EQ( ranges.size(), cluster.GetClusterCount() );
+    uint32_t offset = 0;
+    for (uint32_t c = 0; c < ranges.size(); c++)
+    {
+        ASSERT_EQ( ranges[c].Offset, offset );
+        offset += ranges[c].Count;
+        XMFLOAT3 lo, hi;
+        cluster.GetClusterBox( c, lo, hi );
+        for (uint32_t k = ranges[c].Offset; k < offset; k++)
+        {
+            EXPECT_NE( list[k], 0u );
+            EXPECT_TRUE( IntersectBox( lights[list[k]], lo, hi ) ) << "cluster " << c << " light " << list[k];
+            if (k > ranges[c].Offset)
+                EXPECT_LT( list[k - 1], list[k] );
+        }
+    }
+    EXPECT_EQ( offset, list.size() );
+}
+
+TEST(LightClusterTest, ContainLitPoints)
+{
+    Camera camera;
+    const std::vector<ClusterLight> lights = MakeLights( 200, 30.f, 2 );
+    LightCluster cluster;
+    cluster.Create( 16, 9, 24 );
+    Build( cluster, camera, lights );
+    const Matrix4 proj = camera.GetProjMatrix();
+
+    std::mt19937 rng( 3 );
+    std::uniform_real_distribution<float> unit( -1.f, 1.f );
+    uint32_t numTested = 0;
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        const ClusterLight& light = lights[i];
+        for (int n = 0; n < 100; n++)
+        {
+            const Vector3 offset = Vector3( unit( rng ), unit( rng ), unit( rng ) ) * light.Radius * 0.577f;
+            const Vector3 P = Vector3( light.CenterVS ) + offset;
+            // Only points on screen are shaded
+            XMFLOAT3 p;
+            XMStoreFloat3( &p, P );
+            const float d = -p.z;
+            if (d < camera.GetNearClip() || d > camera.GetFarClip())
+                continue;
+            const float ndcX = proj.GetX().GetX() * p.x / d, ndcY = proj.GetY().GetY() * p.y / d;
+            if (std::abs( ndcX ) >= 1.f || std::abs( ndcY ) >= 1.f)
+                continue;
+            EXPECT_TRUE( IsListed( cluster, GetCluster( cluster, proj, P ), i ) ) << "light " << i;
+            numTested++;
+        }
+    }
+    EXPECT_GT( numTested, 1000u );
+}
+
+TEST(LightClusterTest, BoundSpot)
+{
+    std::mt19937 rng( 4 );
+    std::uniform_real_distribution<float> unit( 0.f, 1.f );
+    const Vector3 position( 3.f, -2.f, -10.f );
+    const Vector3 direction = Normalize( Vector3( 1.f, -1.f, -2.f ) );
+    const Vector3 side = Normalize( Cross( direction, Vector3( kYUnitVector ) ) );
+    const Vector3 up = Cross( side, direction );
+    for (float angle : { 1.f, 20.f, 45.f, 60.f, 89.f })
+    {
+        const float range = 25.f;
+        const ClusterLight bound = LightCluster::BoundSpot( position, direction, range, angle );
+        EXPECT_LE( bound.Radius, range + 1e-3f );
+        for (int n = 0; n < 1000; n++)
+        {
+            // Point in the lit sector, apex and rim included
+            const float phi = XMConvertToRadians( angle ) * (n % 10 == 0 ? 1.f : unit( rng ));
+            const float theta = unit( rng ) * XM_2PI;
+            const float r = range * (n % 7 == 0 ? 1.f : unit( rng ));
+            const Vector3 dir = direction * std::cos( phi ) + (side * std::cos( theta ) + up * std::sin( theta )) * std::sin( phi );
+            const Vector3 P = position + dir * r;
+            const float dist = Length( P - Vector3( bound.CenterVS ) );
+            EXPECT_LE( dist, bound.Radius * 1.0001f + 1e-4f ) << "angle " << angle;
+        }
+    }
+    // Wider than a half space, the whole range sphere
+    const ClusterLight wide = LightCluster::BoundSpot( position, direction, 10.f, 120.f );
+    EXPECT_FLOAT_EQ( wide.Radius, 10.f );
+}
+
+TEST(LightClusterTest, Rebuild)
+{
+    Camera camera;
+    const std::vector<ClusterLight> lights = MakeLights( 100, 40.f, 5 );
+    LightCluster cluster;
+    cluster.Create( 16, 9, 24 );
+    Build( cluster, camera, lights );
+    const auto ranges = cluster.GetClusterRange();
+    const auto list = cluster.GetLightIndex();
+
+    // Same input, same lists
+    Build( cluster, camera, lights );
+    EXPECT_EQ( cluster.GetLightIndex(), list );
+    for (size_t c = 0; c < ranges.size(); c++)
+    {
+        EXPECT_EQ( cluster.GetClusterRange()[c].Offset, ranges[c].Offset );
+        EXPECT_EQ( cluster.GetClusterRange()[c].Count, ranges[c].Count );
+    }
+
+    // No light, empty lists
+    cluster.Build( camera.GetProjMatrix(), camera.GetNearClip(), camera.GetFarClip(), nullptr, 0 );
+    EXPECT_TRUE( cluster.GetLightIndex().empty() );
+    for (auto& range : cluster.GetClusterRange())
+        EXPECT_EQ( range.Count, 0u );
+}
+
+TEST(LightClusterTest, DISABLED_Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int kNumRepeat = 100;
+    for (uint32_t numLights : { 128, 1024, 4096 })
+    {
+        Camera camera;
+        const std::vector<ClusterLight> lights = MakeLights( numLights, 20.f, 6 );
+        LightCluster cluster;
+        cluster.Create( 16, 9, 24 );
+        Build( cluster, camera, lights );
+        auto start = Clock::now();
+        for (int i = 0; i < kNumRepeat; i++)
+            Build( cluster, camera, lights );
+        double elapsed = std::chrono::duration<double, std::milli>( Clock::now() - start ).count() / kNumRepeat;
+        std::cout << numLights << " lights, " << cluster.GetLightIndex().size() << " indices, "
+            << elapsed << " ms/build" << std::endl;
+    }
+}
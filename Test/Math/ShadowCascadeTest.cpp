@@ -0,0 +1,232 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Camera.h"
+#include "ShadowCameraCascade.h"
+
+using namespace Math;
+
+namespace {
+    const uint32_t kResolution = 2048;
+    const Vector3 kLightDir( 0.5f, -0.4f, -1.0f );
+    const Vector3 kEye( 0.f, 20.f, 25.f ), kAt( 0.f, 15.f, 0.f );
+
+    // Scene of a stage, deeper than the camera sees, and up to a high light
+    BoundingBox StageBox( void )
+    {
+        return BoundingBox( Vector3( -200.f, 0.f, -300.f ), Vector3( 200.f, 80.f, 100.f ) );
+    }
+
+    void SetCamera( Camera& camera, const Vector3& eye, const Vector3& at )
+    {
+        camera.SetEyeAtUp( eye, at, Vector3( kYUnitVector ) );
+        camera.SetPerspectiveMatrix( XM_PIDIV4, 9.f / 16.f, 1.f, 1000.f );
+        camera.Update();
+    }
+
+    // Shadow texture coordinates of 'P' in cascade 'i'
+    Vector3 GetCoord( const ShadowCameraCascade& shadow, uint32_t i, const Vector3& P )
+    {
+        return shadow.GetCascade( i ).GetShadowMatrix().Transform( P );
+    }
+
+    bool IsInside( const Vector3& coord, float eps = 1e-4f )
+    {
+        const float c[] = { coord.GetX(), coord.GetY(), coord.GetZ() };
+        for (float v : c)
+        {
+            if (v < -eps || v > 1.f + eps)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST(ShadowCascadeTest, Splits)
+{
+    float splits[ShadowCameraCascade::kMaxCascades + 1];
+    for (float lambda : { 0.f, 0.5f, 0.8f, 1.f })
+    {
+        ShadowCameraCascade::ComputeSplits( 1.f, 1000.f, 4, lambda, splits );
+        EXPECT_FLOAT_EQ( splits[0], 1.f );
+        EXPECT_FLOAT_EQ( splits[4], 1000.f );
+        for (uint32_t i = 0; i < 4; i++)
+            EXPECT_LT( splits[i], splits[i + 1] );
+    }
+    ShadowCameraCascade::ComputeSplits( 1.f, 1000.f, 3, 1.f, splits );
+    EXPECT_NEAR( splits[1], 10.f, 1e-3f );
+    EXPECT_NEAR( splits[2], 100.f, 1e-2f );
+    ShadowCameraCascade::ComputeSplits( 1.f, 1000.f, 3, 0.f, splits );
+    EXPECT_NEAR( splits[1], 334.f, 1e-2f );
+}
+
+// Depth range of the splits snaps out to the ladder, the far end of the
+// stage, about 323 deep, to 2^8.5. Walking toward it keeps the splits
+TEST(ShadowCascadeTest, SnapDepthRange)
+{
+    Camera camera;
+    SetCamera( camera, kEye, kAt );
+    ShadowCameraCascade shadow;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    shadow.UpdateMatrix( StageBox(), kLightDir, camera );
+    const uint32_t last = shadow.GetCascadeCount() - 1;
+    EXPECT_NEAR( shadow.GetSplit( last ), std::exp2( 8.5f ), 1e-2f );
+
+    for (float dz : { 1.f, 5.f, 10.f })
+    {
+        const Vector3 move( 0.f, 0.f, -dz );
+        Camera movedCamera;
+        SetCamera( movedCamera, kEye + move, kAt + move );
+        ShadowCameraCascade moved;
+        moved.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+        moved.UpdateMatrix( StageBox(), kLightDir, movedCamera );
+        for (uint32_t i = 0; i <= last; i++)
+            EXPECT_EQ( moved.GetSplit( i ), shadow.GetSplit( i ) ) << "move " << dz << " cascade " << i;
+    }
+}
+
+// Each cascade covers the view it is split for, inside the scene
+TEST(ShadowCascadeTest, CoverSplit)
+{
+    const BoundingBox sceneBox = StageBox();
+    Camera camera;
+    SetCamera( camera, kEye, kAt );
+    ShadowCameraCascade shadow;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    shadow.UpdateMatrix( sceneBox, kLightDir, camera );
+
+    std::mt19937 rng( 1 );
+    std::uniform_real_distribution<float> unit( 0.f, 1.f );
+    const Matrix4 clipToWorld = Invert( camera.GetViewProjMatrix() );
+    uint32_t numTested = 0;
+    for (int n = 0; n < 10000; n++)
+    {
+        // Random point in the view, by its clip space
+        const Vector3 ndc( unit( rng ) * 2.f - 1.f, unit( rng ) * 2.f - 1.f, unit( rng ) );
+        const Vector3 P = clipToWorld.Transform( ndc );
+        const Vector3 lo = sceneBox.GetMin(), hi = sceneBox.GetMax();
+        if (!XMVector3GreaterOrEqual( P, lo ) || !XMVector3LessOrEqual( P, hi ))
+            continue;
+        const float depth = Dot( P - camera.GetPosition(), camera.GetForwardVec() );
+        for (uint32_t i = 0; i < shadow.GetCascadeCount(); i++)
+        {
+            const float nearZ = i == 0 ? camera.GetNearClip() : shadow.GetSplit( i - 1 );
+            if (depth < nearZ || depth > shadow.GetSplit( i ))
+                continue;
+            EXPECT_TRUE( IsInside( GetCoord( shadow, i, P ) ) ) << "cascade " << i << " depth " << depth;
+            numTested++;
+        }
+    }
+    EXPECT_GT( numTested, 100u );
+}
+
+// Casters between the light and a covered point are inside the cascade,
+// even off screen, and are not culled by its light frustum
+TEST(ShadowCascadeTest, CullCasters)
+{
+    const BoundingBox sceneBox = StageBox();
+    Camera camera;
+    SetCamera( camera, kEye, kAt );
+    ShadowCameraCascade shadow;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    shadow.UpdateMatrix( sceneBox, kLightDir, camera );
+
+    // A point in the view of the first cascade, and a caster toward the light behind the eye
+    const Vector3 receiver = camera.GetPosition() + camera.GetForwardVec() * 10.f;
+    const Vector3 caster = receiver - Normalize( kLightDir ) * 80.f;
+    ASSERT_LT( 10.f, shadow.GetSplit( 0 ) );
+    ASSERT_TRUE( IsInside( GetCoord( shadow, 0, receiver ) ) );
+    const BoundingBox casterBox( caster - Vector3( 1.f ), caster + Vector3( 1.f ) );
+    EXPECT_FALSE( camera.GetWorldSpaceFrustum().IntersectBox( casterBox ) );
+    EXPECT_TRUE( shadow.GetCascade( 0 ).GetWorldSpaceFrustum().IntersectBox( casterBox ) );
+    EXPECT_TRUE( IsInside( GetCoord( shadow, 0, caster ) ) );
+
+    // Off to the side of the near view, no caster of the first cascade
+    const Vector3 side = Normalize( Cross( camera.GetForwardVec(), Vector3( kYUnitVector ) ) );
+    const Vector3 away = camera.GetPosition() + side * 180.f + camera.GetForwardVec() * 2.f;
+    const BoundingBox awayBox( away - Vector3( 1.f ), away + Vector3( 1.f ) );
+    EXPECT_TRUE( sceneBox.GetMax().GetX() > away.GetX() );
+    EXPECT_FALSE( shadow.GetCascade( 0 ).GetWorldSpaceFrustum().IntersectBox( awayBox ) );
+}
+
+// Moving the camera keeps world points on whole texels. The view sees past
+// the stage, and the depth range the splits cover snaps, so a small move
+// keeps the splits and the extent of the cascades
+TEST(ShadowCascadeTest, TexelSnap)
+{
+    const BoundingBox sceneBox = StageBox();
+    const Vector3 P( 1.3f, 2.1f, -4.7f );
+    const Vector3 move( 0.013f, 0.007f, 0.011f );
+    Camera camera, movedCamera;
+    SetCamera( camera, kEye, kAt );
+    SetCamera( movedCamera, kEye + move, kAt + move );
+    ShadowCameraCascade shadow, moved;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    moved.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    shadow.UpdateMatrix( sceneBox, kLightDir, camera );
+    moved.UpdateMatrix( sceneBox, kLightDir, movedCamera );
+
+    for (uint32_t i = 0; i < shadow.GetCascadeCount(); i++)
+    {
+        EXPECT_EQ( moved.GetSplit( i ), shadow.GetSplit( i ) ) << "cascade " << i;
+
+        const Matrix4& proj = shadow.GetCascade( i ).GetProjMatrix();
+        const Matrix4& movedProj = moved.GetCascade( i ).GetProjMatrix();
+        const float scaleX = proj.GetX().GetX(), scaleY = proj.GetY().GetY();
+        EXPECT_NEAR( movedProj.GetX().GetX(), scaleX, std::abs( scaleX ) * 1e-5f ) << "cascade " << i;
+        EXPECT_NEAR( movedProj.GetY().GetY(), scaleY, std::abs( scaleY ) * 1e-5f ) << "cascade " << i;
+
+        const Vector3 coord = GetCoord( shadow, i, P ), movedCoord = GetCoord( moved, i, P );
+        const float texelsX = (movedCoord.GetX() - coord.GetX()) * kResolution;
+        const float texelsY = (movedCoord.GetY() - coord.GetY()) * kResolution;
+        EXPECT_NEAR( texelsX, std::round( texelsX ), 1e-2f ) << "cascade " << i;
+        EXPECT_NEAR( texelsY, std::round( texelsY ), 1e-2f ) << "cascade " << i;
+    }
+}
+
+// The shader finds every cascade from the coordinates of the first
+TEST(ShadowCascadeTest, ScaleOffset)
+{
+    Camera camera;
+    SetCamera( camera, kEye, kAt );
+    ShadowCameraCascade shadow;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    shadow.UpdateMatrix( StageBox(), kLightDir, camera );
+
+    std::mt19937 rng( 2 );
+    std::uniform_real_distribution<float> unit( -50.f, 50.f );
+    for (uint32_t i = 0; i < shadow.GetCascadeCount(); i++)
+    {
+        Vector3 scale, offset;
+        shadow.GetScaleOffset( i, scale, offset );
+        for (int n = 0; n < 100; n++)
+        {
+            const Vector3 P( unit( rng ), unit( rng ) + 50.f, unit( rng ) );
+            const Vector3 expected = GetCoord( shadow, i, P );
+            const Vector3 coord = GetCoord( shadow, 0, P ) * scale + offset;
+            EXPECT_NEAR( coord.GetX(), expected.GetX(), 1e-3f );
+            EXPECT_NEAR( coord.GetY(), expected.GetY(), 1e-3f );
+            EXPECT_NEAR( coord.GetZ(), expected.GetZ(), 1e-3f );
+        }
+    }
+}
+
+TEST(ShadowCascadeTest, DISABLED_Benchmark)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const int kNumRepeat = 1000;
+    const BoundingBox sceneBox = StageBox();
+    Camera camera;
+    SetCamera( camera, kEye, kAt );
+    ShadowCameraCascade shadow;
+    shadow.Create( ShadowCameraCascade::kMaxCascades, kResolution );
+    auto start = Clock::now();
+    for (int i = 0; i < kNumRepeat; i++)
+        shadow.UpdateMatrix( sceneBox, kLightDir, camera );
+    double elapsed = std::chrono::duration<double, std::micro>( Clock::now() - start ).count() / kNumRepeat;
+    std::cout << shadow.GetCascadeCount() << " cascades, " << elapsed << " us/update" << std::endl;
+}
@@ -13,10 +13,10 @@ TEST(PMXModelTest2, ParsePMX)
     const std::wstring PmxModel = L"resource/onda_mod_SHIMAKAZE_v090.pmx";
     const std::wstring PmxModelPath = ResourcePath( PmxModel );
     Utility::ByteArray ba = Utility::ReadFileSync( PmxModelPath );
-    Utility::ByteStream bs( ba );
+    Utility::ByteReader reader( ba );
 
     Pmx::PMX pmx;
-    pmx.Fill( bs, bRightHand );
+    pmx.Fill( reader, bRightHand );
     EXPECT_TRUE( pmx.IsValid() );
 
     // Compare with PMX viewers result
@@ -0,0 +1,109 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "PmxRig.h"
+
+namespace {
+    // Opens the table build to the tests
+    struct ScheduledRig : public PmxRig
+    {
+        using PmxRig::BuildRig;
+    };
+
+    PmxRig::Bone MakeBone( int32_t parent, uint32_t layer = 0, bool bAfterPhysics = false )
+    {
+        PmxRig::Bone bone;
+        bone.Parent = parent;
+        bone.DeformLayer = layer;
+        bone.bAfterPhysics = bAfterPhysics;
+        return bone;
+    }
+
+    const PmxRig::BoneSchedule& BuildSchedule( ScheduledRig& rig, const std::vector<PmxRig::Bone>& bones )
+    {
+        rig.m_Bones = bones;
+        rig.BuildRig();
+        return rig.m_BoneSchedule;
+    }
+
+    // Every bone is placed once, after its parent
+    void ExpectParentFirst( const PmxRig::BoneSchedule& schedule, size_t numBones )
+    {
+        ASSERT_EQ( numBones, schedule.Order.size() );
+        for (uint32_t k = 0; k < numBones; k++)
+        {
+            EXPECT_EQ( k, schedule.Slot[schedule.Order[k]] );
+            if (schedule.Parent[k] >= 0)
+                EXPECT_LT( schedule.Slot[schedule.Parent[k]], k ) << schedule.Order[k];
+        }
+    }
+}
+
+// A parent cycle is cut at one bone, which becomes a root. Out of range parent makes a root
+TEST(BoneScheduleTest, CycleCut)
+{
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, { MakeBone( 2 ), MakeBone( 0 ), MakeBone( 1 ), MakeBone( 5 ), MakeBone( 3 ) } );
+    ExpectParentFirst( schedule, 5 );
+
+    int numCycleRoots = 0;
+    for (uint32_t b = 0; b < 3; b++)
+        numCycleRoots += schedule.Parent[schedule.Slot[b]] < 0;
+    EXPECT_EQ( 1, numCycleRoots );
+    EXPECT_EQ( -1, schedule.Parent[schedule.Slot[3]] );
+    EXPECT_EQ( 3, schedule.Parent[schedule.Slot[4]] );
+}
+
+// Sorted by (after physics, deform layer, depth), both flags inherited from parent
+TEST(BoneScheduleTest, Ordering)
+{
+    std::vector<PmxRig::Bone> bones = {
+        MakeBone( -1 ), MakeBone( 0, 2 ), MakeBone( 1, 0 ),
+        MakeBone( -1, 0, true ), MakeBone( 3 ), MakeBone( 0 ) };
+    bones[2].bInherentRotation = true;
+    bones[2].ParentInherentBoneIndex = 0;
+    bones[4].bInherentRotation = true;
+    bones[4].ParentInherentBoneIndex = 0;
+
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, bones );
+    ExpectParentFirst( schedule, bones.size() );
+
+    EXPECT_THAT( schedule.Order, ElementsAre( 0, 5, 1, 2, 3, 4 ) );
+    EXPECT_THAT( schedule.Batch, ElementsAre( 0, 1, 2, 3, 4, 5, 6 ) );
+    EXPECT_EQ( 4, schedule.AfterPhysics );
+    EXPECT_THAT( schedule.Inherent, ElementsAre( 2, 4 ) );
+    EXPECT_EQ( 1, schedule.InherentAfterPhysics );
+    EXPECT_THAT( schedule.InherentPose, ElementsAre( 3, 5 ) );
+}
+
+// Subtree range of a bone holds its descendants, in schedule order
+TEST(BoneScheduleTest, SubtreeRange)
+{
+    const std::vector<PmxRig::Bone> bones = {
+        MakeBone( -1 ), MakeBone( 0 ), MakeBone( 0 ), MakeBone( 1 ), MakeBone( 3 ), MakeBone( -1 ) };
+    const std::vector<std::vector<uint32_t>> descendants = { { 1, 2, 3, 4 }, { 3, 4 }, {}, { 4 }, {}, {} };
+
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, bones );
+    ExpectParentFirst( schedule, bones.size() );
+    ASSERT_EQ( bones.size() + 1, schedule.SubtreeOffset.size() );
+
+    for (uint32_t b = 0; b < bones.size(); b++)
+    {
+        std::vector<uint32_t> subtree;
+        for (uint32_t n = schedule.SubtreeOffset[b]; n < schedule.SubtreeOffset[b + 1]; n++)
+        {
+            const uint32_t k = schedule.Subtree[n];
+            EXPECT_GT( k, schedule.Slot[b] );
+            if (!subtree.empty())
+                EXPECT_GT( k, schedule.Slot[subtree.back()] );
+            subtree.push_back( schedule.Order[k] );
+        }
+        std::sort( subtree.begin(), subtree.end() );
+        EXPECT_EQ( descendants[b], subtree ) << b;
+    }
+}
@@ -1,3 +1,75 @@
 #pragma once
 
 #include "../Common.h"
+
+#include <random>
+#include <vector>
+
+#include "Pmx.h"
+
+//
+// Random bones and vertices skinned by them, 'types' are the skin types picked
+// from. Weights of a vertex sum to one
+//
+struct RandomSkin
+{
+    std::vector<Math::OrthogonalTransform> Bones;
+    std::vector<XMFLOAT3> Position;
+    std::vector<XMFLOAT3> Normal;
+    std::vector<Pmx::SkinTypeUnit> Units;
+};
+
+inline RandomSkin MakeRandomSkin( uint32_t numVertices, uint32_t numBones, const std::vector<uint32_t>& types, uint32_t seed )
+{
+    using namespace Math;
+    std::mt19937 rng( seed );
+    std::uniform_real_distribution<float> unit( -1.f, 1.f );
+    std::uniform_real_distribution<float> weight( 0.f, 1.f );
+    std::uniform_int_distribution<int32_t> bone( 0, numBones - 1 );
+    std::uniform_int_distribution<size_t> type( 0, types.size() - 1 );
+
+    RandomSkin skin;
+    for (uint32_t i = 0; i < numBones; i++)
+    {
+        Quaternion q = Normalize( Quaternion( Vector4( unit( rng ), unit( rng ), unit( rng ), unit( rng ) ) ) );
+        skin.Bones.emplace_back( q, Vector3( unit( rng ), unit( rng ), unit( rng ) ) * 10.f );
+    }
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        skin.Position.push_back( XMFLOAT3( unit( rng ) * 20.f, unit( rng ) * 20.f, unit( rng ) * 20.f ) );
+        XMFLOAT3 n;
+        XMStoreFloat3( &n, Normalize( Vector3( unit( rng ), unit( rng ), unit( rng ) ) ) );
+        skin.Normal.push_back( n );
+
+        Pmx::SkinTypeUnit unitSkin = {};
+        unitSkin.Type = types[type( rng )];
+        switch (unitSkin.Type)
+        {
+        case Pmx::kBdef1:
+            unitSkin.Unit.bdef1.BoneIndex = bone( rng );
+            break;
+        case Pmx::kBdef2:
+        case Pmx::kSdef:
+            unitSkin.Unit.bdef2.BoneIndex[0] = bone( rng );
+            unitSkin.Unit.bdef2.BoneIndex[1] = bone( rng );
+            unitSkin.Unit.bdef2.Weight = weight( rng );
+            break;
+        case Pmx::kBdef4:
+        case Pmx::kQdef:
+        {
+            float sum = 0.f;
+            for (int k = 0; k < 4; k++)
+            {
+                unitSkin.Unit.bdef4.BoneIndex[k] = bone( rng );
+                unitSkin.Unit.bdef4.Weight[k] = weight( rng );
+                sum += unitSkin.Unit.bdef4.Weight[k];
+            }
+            for (int k = 0; k < 4; k++)
+                unitSkin.Unit.bdef4.Weight[k] /= sum;
+            break;
+        }
+        }
+        skin.Units.push_back( unitSkin );
+    }
+    return skin;
+}
@@ -0,0 +1,78 @@
+﻿#include "stdafx.h"
+#include "Common.h"
+#include "Pmx.h"
+#include <chrono>
+#include <Windows.h>
+#include <Psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+namespace {
+    const std::wstring kModelPath = ResourcePath( L"resource/観客_右利き_サイリウム有AL.pmx" );
+
+    size_t PrivateBytes()
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters = {};
+        GetProcessMemoryInfo( GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof( counters ) );
+        return counters.PrivateUsage;
+    }
+
+    size_t WorkingSetBytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) );
+        return counters.WorkingSetSize;
+    }
+
+    size_t Growth( size_t current, size_t base )
+    {
+        return current > base ? current - base : 0;
+    }
+}
+
+TEST(FileReadTest, MapSync)
+{
+    Utility::ByteArray ba = Utility::ReadFileSync( kModelPath );
+    Utility::MappedByteArray mapped = Utility::MapFileSync( kModelPath );
+    ASSERT_EQ( mapped->size(), ba->size() );
+    EXPECT_TRUE( mapped->IsMapped() );
+    EXPECT_EQ( memcmp( mapped->data(), ba->data(), ba->size() ), 0 );
+
+    Utility::MappedByteArray missing = Utility::MapFileSync( ResourcePath( L"resource/missing.pmx" ) );
+    EXPECT_EQ( missing->size(), 0 );
+}
+
+TEST(FileReadTest, DISABLED_Benchmark)
+{
+    const int kNumRepeat = 10;
+    const std::wstring StagePath = ResourcePath( L"../Mikudayo/Stage/黒白チェスステージ/黒白チェスステージ.pmx" );
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto run = [&]( const char* label, auto load )
+    {
+        double elapsed = 0.0;
+        size_t privateBytes = 0, workingSet = 0, fileSize = 0;
+        for (int i = 0; i < kNumRepeat; i++)
+        {
+            const size_t privateBase = PrivateBytes(), workingSetBase = WorkingSetBytes();
+            auto start = Clock::now();
+            auto ba = load( StagePath );
+            Utility::ByteReader reader( ba );
+            Pmx::PMX pmx;
+            pmx.Fill( reader, true );
+            elapsed += std::chrono::duration<double>( Clock::now() - start ).count();
+            ASSERT_TRUE( pmx.IsValid() );
+
+            // Measured while file contents and parsed model are both alive
+            const size_t privateGrowth = Growth( PrivateBytes(), privateBase );
+            const size_t workingSetGrowth = Growth( WorkingSetBytes(), workingSetBase );
+            if (privateGrowth > privateBytes) privateBytes = privateGrowth;
+            if (workingSetGrowth > workingSet) workingSet = workingSetGrowth;
+            fileSize = ba->size();
+        }
+        std::cout << label << ": " << fileSize / 1e6 << " MB, " << elapsed / kNumRepeat * 1e3 << " ms/load, "
+            << "peak private " << privateBytes / 1e6 << " MB, peak working set " << workingSet / 1e6 << " MB" << std::endl;
+    };
+    run( "ReadFileSync", Utility::ReadFileSync );
+    run( "MapFileSync", Utility::MapFileSync );
+}
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "Common.h"
+#include "PmxModel.h"
+
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+namespace {
+    class CacheModel : public PmxModel
+    {
+    public:
+        using PmxModel::LoadCache;
+        using PmxModel::SaveCache;
+    };
+
+    // A triangle of one material and one bone
+    void MakeTriangle( PmxModel& model )
+    {
+        model.m_Name = L"Triangle";
+        model.m_Indices = { 0, 1, 2 };
+        model.m_Position = { XMFLOAT3( 0.f, 0.f, 0.f ), XMFLOAT3( 1.f, 0.f, 0.f ), XMFLOAT3( 0.f, 1.f, 0.f ) };
+        model.m_Normal.assign( 3, XMFLOAT3( 0.f, 0.f, -1.f ) );
+        model.m_TextureCoord.assign( 3, XMFLOAT2( 0.f, 0.f ) );
+        Pmx::SkinTypeUnit skin = {};
+        skin.Type = Pmx::kBdef1;
+        skin.Unit.bdef1.BoneIndex = 0;
+        model.m_SkinningUnit.assign( 3, skin );
+        model.m_EdgeScale.assign( 3, 1.f );
+
+        PmxModel::Material material = {};
+        material.Name = L"Face";
+        model.m_Materials.push_back( material );
+        PmxModel::Mesh mesh;
+        mesh.MaterialIndex = 0;
+        mesh.IndexOffset = 0;
+        mesh.IndexCount = 3;
+        mesh.BoundSphere = Math::BoundingSphere( Math::Vector3( 0.5f, 0.5f, 0.f ), 1.f );
+        model.m_Mesh.push_back( mesh );
+
+        PmxModel::Bone bone;
+        bone.Name = L"Center";
+        bone.Translate = bone.Position = bone.DestinationOffset = Math::Vector3( kZero );
+        bone.DestinationIndex = -1;
+        bone.Parent = -1;
+        model.m_Bones.push_back( bone );
+    }
+}
+
+// A cache cut anywhere is discarded, and leaves the model as it was, so
+// the source file can be read on top of it
+TEST(ModelCacheTest, TruncatedCache)
+{
+    namespace fs = boost::filesystem;
+    const uint64_t hashCode = 0x1234;
+    const std::wstring cachePath = (fs::temp_directory_path() / L"ModelCacheTest.cache").generic_wstring();
+    const std::wstring truncatedPath = (fs::temp_directory_path() / L"ModelCacheTest_Truncated.cache").generic_wstring();
+
+    CacheModel source;
+    MakeTriangle( source );
+    source.SaveCache( cachePath, hashCode );
+
+    CacheModel loaded;
+    ASSERT_TRUE( loaded.LoadCache( cachePath, hashCode ) );
+    EXPECT_EQ( loaded.m_Indices, source.m_Indices );
+    EXPECT_EQ( loaded.m_Materials.size(), 1u );
+    EXPECT_EQ( loaded.m_Mesh.size(), 1u );
+    EXPECT_EQ( loaded.m_Bones.size(), 1u );
+
+    Utility::ByteArray ba = Utility::ReadFileSync( cachePath );
+    ASSERT_GT( ba->size(), 16u );
+    for (size_t size : { size_t(16), ba->size() / 2, ba->size() - 1 })
+    {
+        {
+            std::ofstream os( fs::path( truncatedPath ).wstring(), std::ios::binary | std::ios::trunc );
+            os.write( reinterpret_cast<const char*>(ba->data()), size );
+        }
+        CacheModel model;
+        EXPECT_FALSE( model.LoadCache( truncatedPath, hashCode ) ) << size;
+        EXPECT_TRUE( model.m_Indices.empty() ) << size;
+        EXPECT_TRUE( model.m_Position.empty() ) << size;
+        EXPECT_TRUE( model.m_Materials.empty() ) << size;
+        EXPECT_TRUE( model.m_Mesh.empty() ) << size;
+        EXPECT_TRUE( model.m_Bones.empty() ) << size;
+        EXPECT_TRUE( model.m_Name.empty() ) << size;
+    }
+    fs::remove( cachePath );
+    fs::remove( truncatedPath );
+}
@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <utility>
+
+#include "PmxRig.h"
+
+namespace {
+    using Leaf = std::pair<uint32_t, float>;
+
+    // Opens the table build to the tests
+    struct ScheduledRig : public PmxRig
+    {
+        using PmxRig::BuildRig;
+    };
+
+    Pmx::Morph MakeVertexMorph( void )
+    {
+        Pmx::Morph morph;
+        morph.Type = Pmx::MorphType::kVertex;
+        morph.VertexList.push_back( Pmx::MorphVertex() );
+        return morph;
+    }
+
+    Pmx::Morph MakeGroupMorph( const std::vector<Leaf>& children )
+    {
+        Pmx::Morph morph;
+        morph.Type = Pmx::MorphType::kGroup;
+        for (auto& child : children)
+            morph.GroupList.push_back( { child.first, child.second } );
+        return morph;
+    }
+
+    const PmxRig::MorphSchedule& BuildSchedule( ScheduledRig& rig, const std::vector<Pmx::Morph>& morphs )
+    {
+        rig.m_Morphs = morphs;
+        rig.BuildRig();
+        return rig.m_MorphSchedule;
+    }
+
+    std::vector<Leaf> Leaves( const PmxRig::MorphSchedule& schedule, uint32_t i )
+    {
+        std::vector<Leaf> leaves;
+        for (uint32_t n = schedule.LeafOffset[i]; n < schedule.LeafOffset[i + 1]; n++)
+            leaves.emplace_back( schedule.Leaf[n].Morph, schedule.Leaf[n].Weight );
+        return leaves;
+    }
+}
+
+// A group expands into its members, weighted. A non group morph is its own leaf
+TEST(MorphScheduleTest, FlattenGroup)
+{
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, {
+        MakeVertexMorph(), MakeVertexMorph(), MakeGroupMorph( { { 0, 0.5f }, { 1, 2.f } } ) } );
+
+    ASSERT_EQ( 4, schedule.LeafOffset.size() );
+    EXPECT_THAT( Leaves( schedule, 0 ), ElementsAre( Leaf( 0, 1.f ) ) );
+    EXPECT_THAT( Leaves( schedule, 1 ), ElementsAre( Leaf( 1, 1.f ) ) );
+    EXPECT_THAT( Leaves( schedule, 2 ), ElementsAre( Leaf( 0, 0.5f ), Leaf( 1, 2.f ) ) );
+    EXPECT_THAT( schedule.Vertex, ElementsAre( 0, 1 ) );
+}
+
+// Nested group multiplies the weights down. A cycle stops at the group seen
+// on the path, out of range members are skipped
+TEST(MorphScheduleTest, NestedAndCircularGroup)
+{
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, {
+        MakeVertexMorph(), MakeVertexMorph(),
+        MakeGroupMorph( { { 0, 0.5f }, { 1, 2.f } } ),
+        MakeGroupMorph( { { 2, 0.5f } } ),
+        MakeGroupMorph( { { 5, 1.f } } ),
+        MakeGroupMorph( { { 4, 1.f }, { 0, 0.25f }, { 99, 1.f } } ) } );
+
+    EXPECT_THAT( Leaves( schedule, 3 ), ElementsAre( Leaf( 0, 0.25f ), Leaf( 1, 1.f ) ) );
+    EXPECT_THAT( Leaves( schedule, 4 ), ElementsAre( Leaf( 0, 0.25f ) ) );
+    EXPECT_THAT( Leaves( schedule, 5 ), ElementsAre( Leaf( 0, 0.25f ) ) );
+}
+
+// A leaf reached through several paths is one entry, the weights summed
+TEST(MorphScheduleTest, MergeDuplicateLeaf)
+{
+    ScheduledRig rig;
+    const auto& schedule = BuildSchedule( rig, {
+        MakeVertexMorph(), MakeVertexMorph(),
+        MakeGroupMorph( { { 0, 0.5f }, { 1, 2.f } } ),
+        MakeGroupMorph( { { 1, 1.f }, { 0, 0.5f }, { 2, 1.f }, { 0, 0.25f } } ) } );
+
+    EXPECT_THAT( Leaves( schedule, 3 ), ElementsAre( Leaf( 0, 1.25f ), Leaf( 1, 3.f ) ) );
+}
@@ -0,0 +1,58 @@
+﻿#include "stdafx.h"
+#include "Common.h"
+#include "Pmx.h"
+#include "TaskManager.h"
+
+namespace {
+    const std::wstring kModelPath = ResourcePath( L"resource/観客_右利き_サイリウム有AL.pmx" );
+}
+
+// A file cut anywhere fails the reader, and leaves no valid model
+TEST(PMXModelTest, TruncatedPMX)
+{
+    Utility::ByteArray ba = Utility::ReadFileSync( kModelPath );
+    ASSERT_EQ( ba->size(), 10047 );
+
+    for (size_t size : { size_t(4), size_t(100), ba->size() / 2, ba->size() - 1 })
+    {
+        Utility::ByteReader reader( ba->data(), size );
+        Pmx::PMX pmx;
+        pmx.Fill( reader, false );
+        EXPECT_TRUE( reader.Fail() ) << size;
+        EXPECT_FALSE( pmx.IsValid() ) << size;
+    }
+}
+
+// Records decoded over the task pool match the ones decoded in order
+TEST(PMXModelTest, ParallelDecode)
+{
+    Utility::ByteArray ba = Utility::ReadFileSync( kModelPath );
+    auto Load = [&]( Pmx::PMX& pmx ) {
+        Utility::ByteReader reader( ba->data(), ba->size() );
+        pmx.Fill( reader, false );
+        EXPECT_FALSE( reader.Fail() );
+    };
+    Pmx::PMX sequential, parallel;
+    Load( sequential );
+    Pmx::SetParallelFor( TaskManager::parallel_for_range );
+    Load( parallel );
+    Pmx::SetParallelFor( nullptr );
+    ASSERT_TRUE( parallel.IsValid() );
+
+    ASSERT_EQ( sequential.m_Vertices.size(), parallel.m_Vertices.size() );
+    for (size_t i = 0; i < sequential.m_Vertices.size(); i++)
+    {
+        const Pmx::Vertex& a = sequential.m_Vertices[i];
+        const Pmx::Vertex& b = parallel.m_Vertices[i];
+        EXPECT_EQ( 0, memcmp( &a.Pos, &b.Pos, sizeof( a.Pos ) ) ) << i;
+        EXPECT_EQ( 0, memcmp( &a.Normal, &b.Normal, sizeof( a.Normal ) ) ) << i;
+        EXPECT_EQ( 0, memcmp( &a.UV, &b.UV, sizeof( a.UV ) ) ) << i;
+        EXPECT_EQ( a.SkinningType, b.SkinningType ) << i;
+    }
+    ASSERT_EQ( sequential.m_Morphs.size(), parallel.m_Morphs.size() );
+    for (size_t i = 0; i < sequential.m_Morphs.size(); i++)
+    {
+        EXPECT_EQ( sequential.m_Morphs[i].Name, parallel.m_Morphs[i].Name ) << i;
+        EXPECT_EQ( sequential.m_Morphs[i].VertexList.size(), parallel.m_Morphs[i].VertexList.size() ) << i;
+    }
+}
@@ -25,10 +25,10 @@ TEST(PMXModelTest, ParsePMX)
 
     bool bRightHand = false;
     Utility::ByteArray ba = Utility::ReadFileSync( PmxModelPath );
-    Utility::ByteStream bs( ba );
+    Utility::ByteReader reader( ba );
 
     Pmx::PMX pmx;
-    pmx.Fill( bs, bRightHand );
+    pmx.Fill( reader, bRightHand );
     EXPECT_TRUE( pmx.IsValid() );
 
     // Compare with PMX viewers result
@@ -0,0 +1,158 @@
+#include "stdafx.h"
+#include "Common.h"
+
+#include <random>
+
+#include "VectorMath.h"
+#include "SoftwareSkinning.h"
+#include "SkinnedBounds.h"
+
+using namespace Math;
+
+namespace {
+    const float kEpsilon = 1e-3f;
+
+    bool IsInside( const BoundingBox& box, const Vector3& pos )
+    {
+        XMFLOAT3 p, lo, hi;
+        XMStoreFloat3( &p, pos );
+        XMStoreFloat3( &lo, box.GetMin() );
+        XMStoreFloat3( &hi, box.GetMax() );
+        return lo.x - kEpsilon <= p.x && p.x <= hi.x + kEpsilon
+            && lo.y - kEpsilon <= p.y && p.y <= hi.y + kEpsilon
+            && lo.z - kEpsilon <= p.z && p.z <= hi.z + kEpsilon;
+    }
+
+    // Linear blend skinned vertices only, SDEF and QDEF are not bounded exactly
+    const std::vector<uint32_t> kLinearTypes = { Pmx::kBdef1, Pmx::kBdef2, Pmx::kBdef4 };
+
+    // Triangle list, meshes share vertices like materials of a model do
+    void MakeMeshes( uint32_t numVertices, uint32_t numMeshes, uint32_t seed,
+        std::vector<uint32_t>& indices, std::vector<SkinnedBounds::MeshRange>& meshes )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_int_distribution<uint32_t> vertex( 0, numVertices - 1 );
+        const uint32_t indexPerMesh = numVertices / numMeshes * 3;
+        for (uint32_t m = 0; m < numMeshes; m++)
+        {
+            meshes.push_back( { uint32_t(indices.size()), indexPerMesh } );
+            for (uint32_t i = 0; i < indexPerMesh; i++)
+                indices.push_back( vertex( rng ) );
+        }
+    }
+
+    Pmx::Morph MakeMorph( uint32_t numVertices, uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( -1.f, 1.f );
+        Pmx::Morph morph = {};
+        morph.Type = Pmx::MorphType::kVertex;
+        for (uint32_t i = 0; i < numVertices; i += 2)
+            morph.VertexList.push_back( { i, XMFLOAT3( unit( rng ) * 3.f, unit( rng ) * 3.f, unit( rng ) * 3.f ) } );
+        return morph;
+    }
+
+    // Every skinned vertex of a mesh is inside its bound
+    void VerifyBounds( const RandomSkin& skin, const std::vector<uint32_t>& indices, const std::vector<SkinnedBounds::MeshRange>& meshes,
+        const std::vector<Pmx::Morph>& morphs, const AffineTransform& model, float morphWeight )
+    {
+        std::vector<Vector3> delta( skin.Position.size(), Vector3( kZero ) );
+        for (auto& morph : morphs)
+            for (auto& mv : morph.VertexList)
+                delta[mv.VertexIndex] += Vector3( mv.Position ) * morphWeight;
+
+        SoftwareSkinning::Table table;
+        table.Build( skin.Position, skin.Normal, skin.Units, skin.Bones.size() );
+        SoftwareSkinning skinning;
+        skinning.Create( table );
+        skinning.Skin( skin.Bones.data(), delta.data() );
+
+        SkinnedBounds bounds;
+        bounds.Build( skin.Position, indices, skin.Units, meshes, morphs, skin.Bones.size() );
+        std::vector<BoundingBox> meshBounds;
+        bounds.Update( model, skin.Bones.data(), meshBounds );
+        ASSERT_EQ( meshBounds.size(), meshes.size() );
+
+        for (size_t m = 0; m < meshes.size(); m++)
+        {
+            ASSERT_TRUE( meshBounds[m].IsValid() );
+            for (uint32_t i = 0; i < meshes[m].IndexCount; i++)
+            {
+                const uint32_t v = indices[meshes[m].IndexOffset + i];
+                const Vector3 pos = model * Vector3( skinning.GetPosition()[v] );
+                EXPECT_TRUE( IsInside( meshBounds[m], pos ) ) << "mesh " << m << " vertex " << v;
+            }
+        }
+    }
+}
+
+TEST(SkinnedBoundsTest, ContainSkinnedMesh)
+{
+    const RandomSkin skin = MakeRandomSkin( 3000, 32, kLinearTypes, 1 );
+    std::vector<uint32_t> indices;
+    std::vector<SkinnedBounds::MeshRange> meshes;
+    MakeMeshes( 3000, 4, 1, indices, meshes );
+    VerifyBounds( skin, indices, meshes, {}, AffineTransform( kIdentity ), 0.f );
+
+    const AffineTransform model = AffineTransform( Quaternion( Vector3( kYUnitVector ), 0.7f ), Vector3( 5.f, -3.f, 40.f ) )
+        * AffineTransform::MakeScale( 1.5f );
+    VerifyBounds( skin, indices, meshes, {}, model, 0.f );
+}
+
+TEST(SkinnedBoundsTest, ContainVertexMorph)
+{
+    const RandomSkin skin = MakeRandomSkin( 3000, 32, kLinearTypes, 2 );
+    std::vector<uint32_t> indices;
+    std::vector<SkinnedBounds::MeshRange> meshes;
+    MakeMeshes( 3000, 4, 2, indices, meshes );
+    const std::vector<Pmx::Morph> morphs = { MakeMorph( 3000, 3 ) };
+    VerifyBounds( skin, indices, meshes, morphs, AffineTransform( kIdentity ), 1.f );
+    VerifyBounds( skin, indices, meshes, morphs, AffineTransform( kIdentity ), 0.5f );
+}
+
+TEST(SkinnedBoundsTest, FollowRotatedBone)
+{
+    // A stick along x on one bone, turned to y, bound stays a thin box along y
+    std::vector<XMFLOAT3> position = { XMFLOAT3( 0.f, 0.f, 0.f ), XMFLOAT3( 10.f, 0.f, 0.f ) };
+    std::vector<Pmx::SkinTypeUnit> units( 2 );
+    for (auto& skin : units)
+    {
+        skin.Type = Pmx::kBdef1;
+        skin.Unit.bdef1.BoneIndex = 1;
+    }
+    std::vector<uint32_t> indices = { 0, 1, 1 };
+    std::vector<SkinnedBounds::MeshRange> meshes = { { 0, 3 } };
+
+    SkinnedBounds bounds;
+    bounds.Build( position, indices, units, meshes, {}, 2 );
+    EXPECT_EQ( bounds.GetMeshCount(), 1 );
+    EXPECT_EQ( bounds.GetBoxCount(), 1 );
+
+    std::vector<OrthogonalTransform> bones = {
+        OrthogonalTransform( kIdentity ),
+        OrthogonalTransform( Quaternion( Vector3( kZUnitVector ), XM_PIDIV2 ), Vector3( 0.f, 0.f, 0.f ) )
+    };
+    std::vector<BoundingBox> meshBounds;
+    bounds.Update( AffineTransform( kIdentity ), bones.data(), meshBounds );
+    ASSERT_EQ( meshBounds.size(), 1 );
+    EXPECT_THAT( meshBounds[0].GetMin(), MatcherNearFast( 1e-4f, Vector3( 0.f, 0.f, 0.f ) ) );
+    EXPECT_THAT( meshBounds[0].GetMax(), MatcherNearFast( 1e-4f, Vector3( 0.f, 10.f, 0.f ) ) );
+}
+
+TEST(SkinnedBoundsTest, EmptyMesh)
+{
+    std::vector<XMFLOAT3> position = { XMFLOAT3( 1.f, 2.f, 3.f ) };
+    std::vector<Pmx::SkinTypeUnit> units( 1 );
+    units[0].Type = Pmx::kBdef1;
+    std::vector<uint32_t> indices = { 0, 0, 0 };
+    std::vector<SkinnedBounds::MeshRange> meshes = { { 0, 0 }, { 0, 3 } };
+
+    SkinnedBounds bounds;
+    bounds.Build( position, indices, units, meshes, {}, 1 );
+    std::vector<OrthogonalTransform> bones( 1, OrthogonalTransform( kIdentity ) );
+    std::vector<BoundingBox> meshBounds;
+    bounds.Update( AffineTransform( kIdentity ), bones.data(), meshBounds );
+    ASSERT_EQ( meshBounds.size(), 2 );
+    EXPECT_FALSE( meshBounds[0].IsValid() );
+    EXPECT_TRUE( meshBounds[1].IsValid() );
+}
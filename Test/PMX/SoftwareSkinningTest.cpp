@@ -0,0 +1,170 @@
+#include "stdafx.h"
+#include "Common.h"
+
+#include <random>
+
+#include "VectorMath.h"
+#include "Math/DualQuaternion.h"
+#include "SoftwareSkinning.h"
+
+using namespace Math;
+
+namespace {
+    // Per vertex reference, follows PmxSkinningSO.hlsl
+    void ReferenceSkin( const Pmx::SkinTypeUnit& skin, const std::vector<OrthogonalTransform>& bones,
+        Vector3 pos, Vector3 normal, Vector3& outPos, Vector3& outNormal )
+    {
+        auto Blend = [&]( const int32_t* index, const float* weight, int n ) {
+            outPos = Vector3( kZero );
+            outNormal = Vector3( kZero );
+            for (int k = 0; k < n; k++)
+            {
+                outPos += bones[index[k]] * pos * weight[k];
+                outNormal += bones[index[k]].GetRotation() * normal * weight[k];
+            }
+        };
+        auto BlendDQ = [&]( const int32_t* index, const float* weight, int n ) {
+            DualQuaternion dq0( bones[index[0]] );
+            DualQuaternion blended = dq0 * weight[0];
+            for (int k = 1; k < n; k++)
+            {
+                DualQuaternion dq( bones[index[k]] );
+                float w = weight[k];
+                if (float(Dot( dq0.Real, dq.Real )) < 0)
+                    w = -w;
+                blended = blended + dq * w;
+            }
+            blended = Normalize( blended );
+            outPos = blended.Transform( pos );
+            outNormal = blended.Rotate( normal );
+        };
+
+        switch (skin.Type)
+        {
+        case Pmx::kBdef1:
+        {
+            const float weight[] = { 1.f };
+            Blend( &skin.Unit.bdef1.BoneIndex, weight, 1 );
+            break;
+        }
+        case Pmx::kBdef2:
+        {
+            const float weight[] = { skin.Unit.bdef2.Weight, 1.f - skin.Unit.bdef2.Weight };
+            Blend( skin.Unit.bdef2.BoneIndex, weight, 2 );
+            break;
+        }
+        case Pmx::kBdef4:
+            Blend( skin.Unit.bdef4.BoneIndex, skin.Unit.bdef4.Weight, 4 );
+            break;
+        case Pmx::kSdef:
+        {
+            const float weight[] = { skin.Unit.sdef.Weight, 1.f - skin.Unit.sdef.Weight };
+            BlendDQ( skin.Unit.sdef.BoneIndex, weight, 2 );
+            break;
+        }
+        case Pmx::kQdef:
+            BlendDQ( skin.Unit.qdef.BoneIndex, skin.Unit.qdef.Weight, 4 );
+            break;
+        }
+    }
+
+    const std::vector<uint32_t> kAllTypes = { Pmx::kBdef1, Pmx::kBdef2, Pmx::kBdef4, Pmx::kSdef, Pmx::kQdef };
+
+    std::vector<Vector3> MakeDelta( size_t numVertices, uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( -1.f, 1.f );
+        std::vector<Vector3> delta;
+        for (size_t i = 0; i < numVertices; i++)
+            delta.push_back( Vector3( unit( rng ), unit( rng ), unit( rng ) ) );
+        return delta;
+    }
+
+    void Verify( const RandomSkin& skin, const SoftwareSkinning& skinning, const Vector3* delta )
+    {
+        ASSERT_EQ( skinning.GetVertexCount(), skin.Position.size() );
+        for (size_t i = 0; i < skin.Position.size(); i++)
+        {
+            Vector3 pos( skin.Position[i] ), normal( skin.Normal[i] );
+            if (delta)
+                pos += delta[i];
+            Vector3 refPos, refNormal;
+            ReferenceSkin( skin.Units[i], skin.Bones, pos, normal, refPos, refNormal );
+            EXPECT_THAT( Vector3( skinning.GetPosition()[i] ), MatcherNearFast( 1e-3f, refPos ) ) << "type " << skin.Units[i].Type;
+            EXPECT_THAT( Vector3( skinning.GetNormal()[i] ), MatcherNearFast( 1e-4f, refNormal ) ) << "type " << skin.Units[i].Type;
+        }
+    }
+}
+
+TEST(SoftwareSkinningTest, RestPose)
+{
+    const RandomSkin skin = MakeRandomSkin( 100, 8, kAllTypes, 1 );
+    std::vector<OrthogonalTransform> identity( skin.Bones.size(), OrthogonalTransform( kIdentity ) );
+
+    SoftwareSkinning::Table table;
+    table.Build( skin.Position, skin.Normal, skin.Units, identity.size() );
+    SoftwareSkinning skinning;
+    skinning.Create( table );
+    skinning.Skin( identity.data(), nullptr );
+    for (size_t i = 0; i < skin.Position.size(); i++)
+    {
+        EXPECT_THAT( Vector3( skinning.GetPosition()[i] ), MatcherNearFast( 1e-4f, Vector3( skin.Position[i] ) ) );
+        EXPECT_THAT( Vector3( skinning.GetNormal()[i] ), MatcherNearFast( 1e-4f, Vector3( skin.Normal[i] ) ) );
+    }
+}
+
+TEST(SoftwareSkinningTest, MatchReference)
+{
+    // Enough vertices to split each skin type into several batches
+    const RandomSkin skin = MakeRandomSkin( 20000, 64, kAllTypes, 2 );
+    const std::vector<Vector3> delta = MakeDelta( skin.Position.size(), 5 );
+
+    SoftwareSkinning::Table table;
+    table.Build( skin.Position, skin.Normal, skin.Units, skin.Bones.size() );
+    SoftwareSkinning skinning;
+    skinning.Create( table );
+    skinning.Skin( skin.Bones.data(), nullptr );
+    Verify( skin, skinning, nullptr );
+
+    // Output buffers are reused across frames
+    const XMFLOAT3* position = skinning.GetPosition().data();
+    skinning.Skin( skin.Bones.data(), delta.data() );
+    EXPECT_EQ( position, skinning.GetPosition().data() );
+    Verify( skin, skinning, delta.data() );
+}
+
+// Instances share the table, each skins into its own streams
+TEST(SoftwareSkinningTest, SharedTable)
+{
+    const RandomSkin skin = MakeRandomSkin( 1000, 16, kAllTypes, 4 );
+    std::vector<OrthogonalTransform> identity( skin.Bones.size(), OrthogonalTransform( kIdentity ) );
+
+    SoftwareSkinning::Table table;
+    table.Build( skin.Position, skin.Normal, skin.Units, skin.Bones.size() );
+    SoftwareSkinning posed, rest;
+    posed.Create( table );
+    rest.Create( table );
+    posed.Skin( skin.Bones.data(), nullptr );
+    rest.Skin( identity.data(), nullptr );
+
+    Verify( skin, posed, nullptr );
+    for (size_t i = 0; i < skin.Position.size(); i++)
+        EXPECT_THAT( Vector3( rest.GetPosition()[i] ), MatcherNearFast( 1e-4f, Vector3( skin.Position[i] ) ) );
+}
+
+TEST(SoftwareSkinningTest, InvalidBoneIndex)
+{
+    RandomSkin skin = MakeRandomSkin( 1, 2, kAllTypes, 3 );
+    skin.Units[0].Type = Pmx::kBdef1;
+    skin.Units[0].Unit.bdef1.BoneIndex = -1;
+
+    SoftwareSkinning::Table table;
+    table.Build( skin.Position, skin.Normal, skin.Units, skin.Bones.size() );
+    SoftwareSkinning skinning;
+    skinning.Create( table );
+    skinning.Skin( skin.Bones.data(), nullptr );
+
+    // Falls back to the first bone
+    Vector3 expected = skin.Bones[0] * Vector3( skin.Position[0] );
+    EXPECT_THAT( Vector3( skinning.GetPosition()[0] ), MatcherNearFast( 1e-4f, expected ) );
+}
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <random>
+
+#include "VectorMath.h"
+#include "VertexMorph.h"
+
+using namespace Math;
+
+namespace {
+    std::vector<Pmx::Morph> MakeMorphs( uint32_t numVertices, uint32_t numMorphs, uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( -1.f, 1.f );
+        std::uniform_int_distribution<uint32_t> vertex( 0, numVertices - 1 );
+        std::uniform_int_distribution<uint32_t> count( 1, 200 );
+
+        std::vector<Pmx::Morph> morphs( numMorphs );
+        for (uint32_t i = 0; i < numMorphs; i++)
+        {
+            auto& morph = morphs[i];
+            morph.Type = (i % 5 == 4) ? Pmx::MorphType::kBone : Pmx::MorphType::kVertex;
+            // Clustered around a base vertex like a face morph
+            const uint32_t base = vertex( rng ), n = count( rng );
+            for (uint32_t k = 0; k < n; k++)
+            {
+                Pmx::MorphVertex vert;
+                vert.VertexIndex = (base + vertex( rng ) % 400) % numVertices;
+                vert.Position = XMFLOAT3( unit( rng ), unit( rng ), unit( rng ) );
+                morph.VertexList.push_back( vert );
+            }
+        }
+        return morphs;
+    }
+
+    std::vector<Vector3> ReferenceDelta( const std::vector<Pmx::Morph>& morphs, const std::vector<float>& weight, uint32_t numVertices )
+    {
+        std::vector<Vector3> delta( numVertices, Vector3( kZero ) );
+        for (size_t i = 0; i < morphs.size(); i++)
+        {
+            if (morphs[i].Type != Pmx::MorphType::kVertex)
+                continue;
+            for (auto& vert : morphs[i].VertexList)
+                delta[vert.VertexIndex] += weight[i] * Vector3( vert.Position );
+        }
+        return delta;
+    }
+}
+
+TEST(VertexMorphTest, MatchReference)
+{
+    const uint32_t numVertices = 5000;
+    const std::vector<Pmx::Morph> morphs = MakeMorphs( numVertices, 30, 1 );
+    std::vector<float> weights( morphs.size(), 0.f );
+    VertexMorph morph;
+    morph.Build( morphs, numVertices );
+
+    // Mirror of GPU buffer, written only through dirty ranges
+    std::vector<Vector3> uploaded( numVertices, Vector3( kZero ) );
+
+    std::mt19937 rng( 2 );
+    std::uniform_int_distribution<uint32_t> pick( 0, uint32_t(morphs.size()) - 1 );
+    std::uniform_real_distribution<float> weight( 0.f, 1.f );
+    // Long enough to pass several rebuilds
+    for (int frame = 0; frame < 10000; frame++)
+    {
+        for (int n = 0; n < 3; n++)
+        {
+            const uint32_t i = pick( rng );
+            weights[i] = (frame % 4 == 0) ? 0.f : weight( rng );
+            morph.SetWeight( i, weights[i] );
+        }
+        if (frame % 5 != 0)
+            continue;
+        const auto& delta = morph.GetDelta();
+        for (auto& range : morph.GetDirtyRanges())
+            std::copy( delta.begin() + range.Begin, delta.begin() + range.End, uploaded.begin() + range.Begin );
+        morph.ClearDirty();
+
+        const auto reference = ReferenceDelta( morphs, weights, numVertices );
+        for (uint32_t v = 0; v < numVertices; v++)
+            ASSERT_THAT( uploaded[v], MatcherNearFast( 1e-4f, reference[v] ) ) << "frame " << frame << " vertex " << v;
+    }
+}
+
+TEST(VertexMorphTest, DirtyRange)
+{
+    std::vector<Pmx::Morph> morphs = MakeMorphs( 1000, 2, 3 );
+    morphs[1].Type = Pmx::MorphType::kVertex;
+    morphs[1].VertexList.resize( 2 );
+    morphs[1].VertexList[0].VertexIndex = 10;
+    morphs[1].VertexList[1].VertexIndex = 900;
+
+    VertexMorph morph;
+    morph.Build( morphs, 1000 );
+    EXPECT_FALSE( morph.IsDirty() );
+
+    // Below threshold
+    EXPECT_FALSE( morph.SetWeight( 1, 1e-7f ) );
+    EXPECT_FALSE( morph.IsDirty() );
+
+    // Distant vertices are not merged into one range
+    EXPECT_TRUE( morph.SetWeight( 1, 0.5f ) );
+    const auto& ranges = morph.GetDirtyRanges();
+    ASSERT_EQ( ranges.size(), 2u );
+    EXPECT_EQ( ranges[0].Begin, 10u );
+    EXPECT_EQ( ranges[0].End, 11u );
+    EXPECT_EQ( ranges[1].Begin, 900u );
+    EXPECT_EQ( ranges[1].End, 901u );
+    morph.ClearDirty();
+
+    // Same weight again does not touch anything
+    EXPECT_FALSE( morph.SetWeight( 1, 0.5f ) );
+    EXPECT_FALSE( morph.IsDirty() );
+
+    EXPECT_TRUE( morph.Reset() );
+    EXPECT_THAT( morph.GetDelta()[10], MatcherNearFast( 1e-6f, Vector3( kZero ) ) );
+    EXPECT_EQ( morph.GetWeight( 1 ), 0.f );
+}
+
+TEST(VertexMorphTest, TexCoord)
+{
+    std::vector<Pmx::Morph> morphs( 2 );
+    morphs[0].Type = Pmx::MorphType::kVertex;
+    morphs[0].VertexList.resize( 1 );
+    morphs[0].VertexList[0].VertexIndex = 3;
+    morphs[0].VertexList[0].Position = XMFLOAT3( 1.f, 1.f, 1.f );
+    morphs[1].Type = Pmx::MorphType::kTexCoord;
+    morphs[1].TexCoordList.resize( 1 );
+    morphs[1].TexCoordList[0].VertexIndex = 5;
+    morphs[1].TexCoordList[0].Position = XMFLOAT4( 0.5f, -0.25f, 1.f, 1.f );
+
+    // Only UV morph is taken, zw is ignored
+    VertexMorph morph;
+    morph.Build( morphs, 8, Pmx::MorphType::kTexCoord );
+    EXPECT_FALSE( morph.SetWeight( 0, 1.f ) );
+    EXPECT_TRUE( morph.SetWeight( 1, 0.5f ) );
+    EXPECT_THAT( morph.GetDelta()[3], MatcherNearFast( 1e-6f, Vector3( kZero ) ) );
+    EXPECT_THAT( morph.GetDelta()[5], MatcherNearFast( 1e-6f, Vector3( 0.25f, -0.125f, 0.f ) ) );
+}
@@ -0,0 +1,295 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <chrono>
+#include <random>
+
+#include "Camera.h"
+#include "Math/BoundingBox.h"
+#include "Math/BoundingFrustum.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "RenderList.h"
+#include "SceneNode.h"
+#include "TaskManager.h"
+#include "Visitor.h"
+
+using namespace Math;
+
+namespace {
+    // Pipelines are only compared by address here
+    char s_Pipeline[kRenderQueueMax];
+    RenderPipelinePtr FakePipeline( RenderQueue Queue )
+    {
+        return RenderPipelinePtr( RenderPipelinePtr(), reinterpret_cast<GraphicsPSO*>(&s_Pipeline[Queue]) );
+    }
+
+    struct FakeMesh : public IMesh
+    {
+        bool bVisible = true;
+        bool IsIntersect( const BoundingFrustum& ) const override { return bVisible; }
+    };
+
+    struct FakeMaterial : public IMaterial
+    {
+        bool bTransparent = false;
+        bool bShadowCaster = false;
+        bool bOutline = false;
+        int Texture = 0;
+        bool IsOutline() const override { return bOutline; }
+        bool IsShadowCaster() const override { return bShadowCaster; }
+        bool IsTransparent() const override { return bTransparent; }
+        const void* GetTextureKey() const override { return &Texture; }
+        RenderPipelinePtr GetPipeline( RenderQueue Queue ) override {
+            if (Queue == kRenderQueueSkydome || (Queue == kRenderQueueOutline && !bOutline))
+                return nullptr;
+            return FakePipeline( Queue );
+        }
+    };
+
+    // Unit box at 'position' with one mesh per material, or drawn whole by Render if not 'bList'
+    class FakeNode : public SceneNode
+    {
+    public:
+        FakeNode( const Vector3& position, size_t numMeshes, bool bList = true ) :
+            m_Position( position ), m_Meshes( numMeshes ), m_Materials( numMeshes ), m_bList( bList )
+        {
+        }
+        bool CollectMeshes( Visitor& visitor ) override
+        {
+            if (!m_bList)
+                return false;
+            for (size_t i = 0; i < m_Meshes.size(); i++)
+            {
+                if (!visitor.Visit( m_Meshes[i], *this ))
+                    continue;
+                visitor.Visit( m_Shared ? *m_Shared : m_Materials[i] );
+            }
+            return true;
+        }
+        BoundingBox GetBoundingBox() const override
+        {
+            return BoundingBox( m_Position - Vector3( 1.f, 1.f, 1.f ), m_Position + Vector3( 1.f, 1.f, 1.f ) );
+        }
+        AffineTransform GetTransform() const override { return AffineTransform( m_Position ); }
+
+        Vector3 m_Position;
+        std::vector<FakeMesh> m_Meshes;
+        std::vector<FakeMaterial> m_Materials;
+        FakeMaterial* m_Shared = nullptr; // drawn with, instead of m_Materials
+        bool m_bList;
+    };
+
+    // Eye at z = 10 looking at the origin
+    void SetCamera( Camera& camera )
+    {
+        camera.SetEyeAtUp( Vector3( 0.f, 0.f, 10.f ), Vector3( kZero ), Vector3( kYUnitVector ) );
+        camera.Update();
+    }
+
+    template <typename T>
+    size_t CountNode( const RenderList::PacketList& packets, const T& node )
+    {
+        return std::count_if( packets.begin(), packets.end(), [&]( const DrawPacket& p ) { return p.Node == node.get(); } );
+    }
+}
+
+TEST(RenderListTest, RadixSortStable)
+{
+    std::mt19937_64 rng( 1 );
+    for (size_t n : { 0, 1, 10, 63, 64, 1000, 20000 })
+    {
+        std::vector<FakeMesh> meshes( n );
+        std::vector<DrawPacket> packets( n ), scratch;
+        for (size_t i = 0; i < n; i++)
+        {
+            // Few distinct keys with shared digits, so passes are skipped and ties are common
+            const uint64_t key = (rng() % 7) << 56 | (rng() % 3) << 8 | 0x00F0000000000000ull;
+            packets[i] = { key, nullptr, &meshes[i], nullptr };
+        }
+        std::vector<DrawPacket> expected = packets;
+        std::stable_sort( expected.begin(), expected.end(), []( const DrawPacket& a, const DrawPacket& b ) {
+            return a.SortKey < b.SortKey;
+        });
+        RadixSort( packets, scratch );
+        ASSERT_EQ( packets.size(), n );
+        for (size_t i = 0; i < n; i++)
+        {
+            EXPECT_EQ( packets[i].SortKey, expected[i].SortKey );
+            EXPECT_EQ( packets[i].Mesh, expected[i].Mesh );
+        }
+    }
+}
+
+TEST(RenderListTest, SortKey)
+{
+    int a = 0, b = 0;
+    // Same state, front to back, also behind the eye
+    EXPECT_LT( RenderList::MakeOpaqueKey( &a, &a, &a, -5.f ), RenderList::MakeOpaqueKey( &a, &a, &a, 1.f ) );
+    EXPECT_LT( RenderList::MakeOpaqueKey( &a, &a, &a, 1.f ), RenderList::MakeOpaqueKey( &a, &a, &a, 100.f ) );
+    // State dominates depth
+    const bool bPipelineOrder = RenderList::MakeOpaqueKey( &a, &a, &a, 0.f ) < RenderList::MakeOpaqueKey( &b, &a, &a, 0.f );
+    EXPECT_EQ( bPipelineOrder, RenderList::MakeOpaqueKey( &a, &a, &a, 1000.f ) < RenderList::MakeOpaqueKey( &b, &a, &a, 1.f ) );
+    // Transparent, back to front then listed order
+    EXPECT_LT( RenderList::MakeTransparentKey( 100.f, 5 ), RenderList::MakeTransparentKey( 1.f, 0 ) );
+    EXPECT_LT( RenderList::MakeTransparentKey( 1.f, 0 ), RenderList::MakeTransparentKey( 1.f, 1 ) );
+}
+
+TEST(RenderListTest, Build)
+{
+    auto root = std::make_shared<SceneNode>();
+    auto nearNode = std::make_shared<FakeNode>( Vector3( 0.f, 0.f, 0.f ), 3 );
+    auto farNode = std::make_shared<FakeNode>( Vector3( 0.f, 0.f, -20.f ), 2 );
+    auto behindNode = std::make_shared<FakeNode>( Vector3( 0.f, 0.f, 50.f ), 2 );
+    auto wholeNode = std::make_shared<FakeNode>( Vector3( 2.f, 0.f, 0.f ), 1, false );
+    auto mirrorNode = std::make_shared<FakeNode>( Vector3( -2.f, 0.f, 0.f ), 1 );
+    mirrorNode->SetType( kSceneMirror );
+    for (auto node : { nearNode, farNode, behindNode, wholeNode, mirrorNode })
+        root->AddChild( node );
+
+    // near: opaque caster with outline, transparent, culled mesh
+    nearNode->m_Materials[0].bShadowCaster = true;
+    nearNode->m_Materials[0].bOutline = true;
+    nearNode->m_Materials[1].bTransparent = true;
+    nearNode->m_Meshes[2].bVisible = false;
+    // far: two transparent, drawn in their order
+    farNode->m_Materials[0].bTransparent = true;
+    farNode->m_Materials[1].bTransparent = true;
+
+    Camera camera;
+    SetCamera( camera );
+    RenderList list;
+    list.Build( *root, camera );
+
+    // Every node skins, culled or not
+    EXPECT_EQ( list.Get( kRenderQueueSkinning ).size(), 6 );
+
+    const auto& opaque = list.Get( kRenderQueueOpaque );
+    EXPECT_EQ( CountNode( opaque, nearNode ), 1 );
+    EXPECT_EQ( CountNode( opaque, farNode ), 0 );
+    EXPECT_EQ( CountNode( opaque, behindNode ), 0 );
+    EXPECT_EQ( CountNode( opaque, mirrorNode ), 0 );
+    ASSERT_EQ( CountNode( opaque, wholeNode ), 1 );
+    for (auto& packet : opaque)
+        EXPECT_EQ( packet.Mesh == nullptr, packet.Node == wholeNode.get() );
+
+    const auto& transparent = list.Get( kRenderQueueTransparent );
+    ASSERT_EQ( transparent.size(), 3 );
+    EXPECT_EQ( transparent[0].Mesh, &farNode->m_Meshes[0] );
+    EXPECT_EQ( transparent[1].Mesh, &farNode->m_Meshes[1] );
+    EXPECT_EQ( transparent[2].Mesh, &nearNode->m_Meshes[1] );
+
+    // Depth has all listed materials with a depth pipeline, and the whole node
+    EXPECT_EQ( list.Get( kRenderQueueDepth ).size(), 2 + 2 + 1 );
+    const auto& shadow = list.Get( kRenderQueueShadow );
+    EXPECT_EQ( CountNode( shadow, nearNode ), 1 );
+    EXPECT_EQ( CountNode( shadow, farNode ), 0 );
+    EXPECT_EQ( CountNode( list.Get( kRenderQueueOutline ), nearNode ), 1 );
+    // No material has a sky pipeline, only the whole node may draw there
+    EXPECT_EQ( list.Get( kRenderQueueSkydome ).size(), 1 );
+
+    // Built again from scratch
+    list.Build( *root, camera );
+    EXPECT_EQ( list.Get( kRenderQueueSkinning ).size(), 6 );
+    EXPECT_EQ( list.Get( kRenderQueueTransparent ).size(), 3 );
+}
+
+TEST(RenderListTest, OpaqueFrontToBack)
+{
+    // Same material on every node, so only depth tells them apart
+    FakeMaterial material;
+    auto root = std::make_shared<SceneNode>();
+    std::vector<std::shared_ptr<FakeNode>> nodes;
+    for (float z : { -30.f, 0.f, -10.f, -50.f, 5.f })
+    {
+        nodes.push_back( std::make_shared<FakeNode>( Vector3( 0.f, 0.f, z ), 1 ) );
+        nodes.back()->m_Shared = &material;
+        root->AddChild( nodes.back() );
+    }
+
+    Camera camera;
+    SetCamera( camera );
+    RenderList list;
+    list.Build( *root, camera );
+    for (auto queue : { kRenderQueueDepth, kRenderQueueOpaque })
+    {
+        const auto& packets = list.Get( queue );
+        ASSERT_EQ( packets.size(), nodes.size() );
+        const size_t order[] = { 4, 1, 2, 0, 3 };
+        for (size_t i = 0; i < packets.size(); i++)
+            EXPECT_EQ( packets[i].Node, nodes[order[i]].get() ) << "queue " << queue << " draw " << i;
+    }
+}
+
+namespace {
+    // Nodes spread around the camera, with random material kinds
+    SceneNodePtr MakeCrowd( uint32_t numNodes, uint32_t numMeshes, uint32_t seed )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( -1.f, 1.f );
+        auto root = std::make_shared<SceneNode>();
+        for (uint32_t i = 0; i < numNodes; i++)
+        {
+            auto node = std::make_shared<FakeNode>( Vector3( unit( rng ) * 200.f, unit( rng ) * 50.f, unit( rng ) * 200.f ), numMeshes );
+            for (auto& material : node->m_Materials)
+            {
+                material.bTransparent = unit( rng ) > 0.6f;
+                material.bShadowCaster = unit( rng ) > 0.f;
+                material.bOutline = unit( rng ) > 0.f;
+            }
+            root->AddChild( node );
+        }
+        return root;
+    }
+}
+
+TEST(RenderListTest, ParallelMatchesSerial)
+{
+    auto root = MakeCrowd( 300, 4, 2 );
+    Camera camera;
+    SetCamera( camera );
+
+    RenderList serial, parallel;
+    serial.Build( *root, camera );
+    for (uint32_t numChunks : { 2, 3, 7, 64, 1000 })
+    {
+        parallel.Build( *root, camera, numChunks );
+        ASSERT_EQ( parallel.GetPacketCount(), serial.GetPacketCount() );
+        for (uint32_t q = 0; q < kRenderQueueMax; q++)
+        {
+            const auto& expected = serial.Get( RenderQueue(q) );
+            const auto& packets = parallel.Get( RenderQueue(q) );
+            ASSERT_EQ( packets.size(), expected.size() ) << "queue " << q;
+            for (size_t i = 0; i < packets.size(); i++)
+            {
+                EXPECT_EQ( packets[i].SortKey, expected[i].SortKey );
+                EXPECT_EQ( packets[i].Node, expected[i].Node );
+                EXPECT_EQ( packets[i].Mesh, expected[i].Mesh );
+                EXPECT_EQ( packets[i].Material, expected[i].Material );
+            }
+        }
+    }
+}
+
+TEST(RenderListTest, DISABLED_Benchmark)
+{
+    // 10k meshes
+    const uint32_t kNumNodes = 625, kNumMeshes = 16, kNumRepeat = 50;
+    auto root = MakeCrowd( kNumNodes, kNumMeshes, 1 );
+    Camera camera;
+    SetCamera( camera );
+
+    using Clock = std::chrono::high_resolution_clock;
+    const uint32_t numThreads = TaskManager::GetMaxNumThreads();
+    RenderList list;
+    for (uint32_t numChunks : { 1u, numThreads })
+    {
+        list.Build( *root, camera, numChunks ); // warm up the buffers
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < kNumRepeat; i++)
+            list.Build( *root, camera, numChunks );
+        double elapsed = std::chrono::duration<double, std::milli>( Clock::now() - start ).count() / kNumRepeat;
+        std::cout << kNumNodes * kNumMeshes << " meshes, " << list.GetPacketCount() << " packets, "
+            << numChunks << " chunks " << elapsed << " ms/build" << std::endl;
+    }
+}
@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#include "../Common.h"
+
+#include <atomic>
+
+#include "Scene.h"
+#include "SceneNode.h"
+
+namespace {
+    // Opens the cached graph to the tests
+    struct GraphScene : public Scene
+    {
+        using Scene::m_UpdateOrder;
+        using Scene::m_UpdateWave;
+    };
+
+    class CountingNode : public SceneNode
+    {
+    public:
+        void Update( float ) override { m_NumUpdates++; }
+        std::atomic<int> m_NumUpdates{ 0 };
+    };
+
+    std::shared_ptr<CountingNode> AddNode( SceneNode& parent )
+    {
+        auto node = std::make_shared<CountingNode>();
+        parent.AddChild( node );
+        return node;
+    }
+
+    // Nodes of each wave, in update order
+    std::vector<std::vector<SceneNode*>> Waves( const GraphScene& scene )
+    {
+        std::vector<std::vector<SceneNode*>> waves;
+        for (size_t n = 0; n + 1 < scene.m_UpdateWave.size(); n++)
+            waves.emplace_back( scene.m_UpdateOrder.begin() + scene.m_UpdateWave[n], scene.m_UpdateOrder.begin() + scene.m_UpdateWave[n + 1] );
+        return waves;
+    }
+}
+
+// A node runs one wave after the deepest node it depends on, each node once
+TEST(UpdateGraphTest, Waves)
+{
+    auto scene = std::make_shared<GraphScene>();
+    auto a = AddNode( *scene ), b = AddNode( *scene ), c = AddNode( *scene ), d = AddNode( *scene );
+    scene->AddDependency( c, a );
+    scene->AddDependency( d, c );
+    scene->AddDependency( d, b );
+    scene->UpdateScene( 1.f );
+
+    EXPECT_THAT( Waves( *scene ), ElementsAre(
+        ElementsAre( scene.get(), a.get(), b.get() ), ElementsAre( c.get() ), ElementsAre( d.get() ) ) );
+    for (auto& node : { a, b, c, d })
+        EXPECT_EQ( 1, node->m_NumUpdates );
+}
+
+// The graph is kept across frames, and built again once a node or a dependency is added
+TEST(UpdateGraphTest, CachedUntilChange)
+{
+    auto scene = std::make_shared<GraphScene>();
+    auto a = AddNode( *scene ), b = AddNode( *scene );
+    scene->UpdateScene( 1.f );
+    ASSERT_EQ( 2, scene->m_UpdateWave.size() );
+
+    // Not rebuilt, so the emptied graph updates nothing
+    scene->m_UpdateOrder.clear();
+    scene->m_UpdateWave.clear();
+    scene->UpdateSceneAfterPhysics( 1.f );
+    scene->UpdateScene( 1.f );
+    EXPECT_EQ( 1, a->m_NumUpdates );
+    EXPECT_TRUE( scene->m_UpdateWave.empty() );
+
+    scene->AddDependency( b, a );
+    scene->UpdateScene( 1.f );
+    EXPECT_THAT( Waves( *scene ), ElementsAre( ElementsAre( scene.get(), a.get() ), ElementsAre( b.get() ) ) );
+
+    auto e = AddNode( *b );
+    scene->UpdateScene( 1.f );
+    EXPECT_THAT( Waves( *scene ), ElementsAre( ElementsAre( scene.get(), a.get(), e.get() ), ElementsAre( b.get() ) ) );
+    EXPECT_EQ( 1, e->m_NumUpdates );
+    EXPECT_EQ( 3, b->m_NumUpdates );
+}
+
+// Circular dependency falls back to visit order, one node per wave
+TEST(UpdateGraphTest, CycleFallback)
+{
+    auto scene = std::make_shared<GraphScene>();
+    auto a = AddNode( *scene ), b = AddNode( *scene ), c = AddNode( *scene );
+    scene->AddDependency( a, b );
+    scene->AddDependency( b, a );
+    scene->UpdateScene( 1.f );
+
+    EXPECT_THAT( Waves( *scene ), ElementsAre( ElementsAre( scene.get() ),
+        ElementsAre( a.get() ), ElementsAre( b.get() ), ElementsAre( c.get() ) ) );
+    for (auto& node : { a, b, c })
+        EXPECT_EQ( 1, node->m_NumUpdates );
+}